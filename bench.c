@@ -0,0 +1,520 @@
+/**
+ * The MIT License (MIT).
+ *
+ * https://github.com/jonathanmarvens/hopscotch
+ *
+ * Copyright (c) 2014 Jonathan Barronville (jonathan@scrapum.photos) and contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// For `clock_gettime`.
+#define _POSIX_C_SOURCE 200809L
+
+#include <hopscotch/hopscotch.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// `./bench` runs every benchmark, and `./bench <name>` just the one.
+// The sizes can be scaled down (for a quick run) with `HOPSCOTCH_BENCH_SCALE`, a divisor.
+
+#define BENCH_THREADS_MAX 16
+
+static const size_t bench_threads[] = {1, 2, 4, 8};
+
+#define BENCH_CHECK(expr) \
+	do { \
+		if ((expr) != HOPSCOTCH_RES__SUCCESS) { \
+			fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #expr); \
+			exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+static size_t bench_scale = 1;
+
+static double
+now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1e9);
+}
+
+static uint64_t
+xorshift(uint64_t * state) {
+	uint64_t x = state[0];
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	state[0] = x;
+	return x;
+}
+
+// Big-endian `uint32_t` keys, so that the default order is the numeric one.
+static uint32_t *
+new_keys(size_t count) {
+	uint32_t * keys = (uint32_t *) malloc(count * sizeof(uint32_t));
+	if (keys == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	size_t i;
+	for (i = 0; i < count; i++) {
+		hopscotch_byte_t * val = (hopscotch_byte_t *) &(keys[i]);
+		val[0] = (hopscotch_byte_t) (i >> 24);
+		val[1] = (hopscotch_byte_t) (i >> 16);
+		val[2] = (hopscotch_byte_t) (i >> 8);
+		val[3] = (hopscotch_byte_t) i;
+	}
+	return keys;
+}
+
+static hopscotch_list_t *
+new_list(hopscotch_opts_t * opts) {
+	hopscotch_opts_t * list_opts = (hopscotch_opts_t *) malloc(sizeof(hopscotch_opts_t));
+	if (list_opts == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	memcpy((void *) list_opts, (void *) opts, sizeof(hopscotch_opts_t));
+	hopscotch_list_t * list = NULL;
+	BENCH_CHECK(hopscotch_list_new(&list, list_opts));
+	return list;
+}
+
+// Runs `fn(ctx, thread)` on `threads_count` threads at once, and returns how long it took them all, in seconds.
+static double
+run_threads(size_t threads_count, void * (* fn)(void *), void * ctxs, size_t ctx_size) {
+	pthread_t threads[BENCH_THREADS_MAX];
+	double start = now();
+	size_t i;
+	for (i = 0; i < threads_count; i++) {
+		if (pthread_create(&(threads[i]), NULL, fn, (void *) (((char *) ctxs) + (i * ctx_size))) != 0) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (i = 0; i < threads_count; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	return now() - start;
+}
+
+/**
+ * `hotspot`: writers adding and deleting random keys from a small range in the middle of a big list, with and without combining.
+ * Without it the writers pile up on the same few predecessors' locks, and with it one thread at a time applies everyone's ops as a sorted batch.
+ */
+
+#define BENCH_HOTSPOT_KEYS ((size_t) 100000)
+#define BENCH_HOTSPOT_OPS ((size_t) 1000000)
+#define BENCH_HOTSPOT_HOT_KEYS ((size_t) 64)
+
+typedef struct {
+	hopscotch_list_t * list;
+	uint32_t * keys;
+	size_t ops_count;
+	uint64_t state;
+} bench_hotspot_ctx_t;
+
+static void *
+bench_hotspot_writer(void * arg) {
+	bench_hotspot_ctx_t * ctx = (bench_hotspot_ctx_t *) arg;
+	// The hot keys are the odd ones right after the middle, between the even keys the list starts with.
+	size_t first_hot = (BENCH_HOTSPOT_KEYS / bench_scale) + 1;
+	size_t i;
+	for (i = 0; i < ctx->ops_count; i++) {
+		uint64_t r = xorshift(&(ctx->state));
+		hopscotch_byte_t * val = (hopscotch_byte_t *) &(ctx->keys[first_hot + (2 * ((size_t) ((r >> 1) % BENCH_HOTSPOT_HOT_KEYS)))]);
+		bool done;
+		if ((r & 1) == 0) {
+			BENCH_CHECK(hopscotch_list_add_el(&done, ctx->list, val, sizeof(uint32_t)));
+		} else {
+			BENCH_CHECK(hopscotch_list_del_el(&done, ctx->list, val, sizeof(uint32_t)));
+		}
+	}
+	return NULL;
+}
+
+static void
+bench_hotspot(void) {
+	size_t keys_count = (2 * BENCH_HOTSPOT_KEYS) / bench_scale;
+	size_t ops_count = BENCH_HOTSPOT_OPS / bench_scale;
+	uint32_t * keys = new_keys(keys_count);
+	printf("hotspot: %zu adds and dels (split between the writers) of %zu keys, in a list of %zu\n", ops_count, BENCH_HOTSPOT_HOT_KEYS, keys_count / 2);
+	printf("%8s %16s %18s %8s\n", "threads", "normal (ops/s)", "combining (ops/s)", "ratio");
+	size_t t;
+	for (t = 0; t < (sizeof(bench_threads) / sizeof(bench_threads[0])); t++) {
+		size_t threads_count = bench_threads[t];
+		double ops_per_sec[2];
+		int combining;
+		for (combining = 0; combining < 2; combining++) {
+			hopscotch_opts_t opts;
+			memset((void *) &opts, 0, sizeof(opts));
+			opts.combining.enabled = (bool) combining;
+			hopscotch_list_t * list = new_list(&opts);
+			size_t i;
+			for (i = 0; i < keys_count; i += 2) {
+				bool added;
+				BENCH_CHECK(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) &(keys[i]), sizeof(uint32_t)));
+			}
+			bench_hotspot_ctx_t ctxs[BENCH_THREADS_MAX];
+			for (i = 0; i < threads_count; i++) {
+				ctxs[i].list = list;
+				ctxs[i].keys = keys;
+				ctxs[i].ops_count = ops_count / threads_count;
+				ctxs[i].state = (uint64_t) (0x9e3779b97f4a7c15ull * (i + 1));
+			}
+			double elapsed = run_threads(threads_count, bench_hotspot_writer, (void *) ctxs, sizeof(bench_hotspot_ctx_t));
+			ops_per_sec[combining] = ((double) ((ops_count / threads_count) * threads_count)) / elapsed;
+			BENCH_CHECK(hopscotch_list_free(list));
+		}
+		printf("%8zu %16.0f %18.0f %8.2f\n", threads_count, ops_per_sec[0], ops_per_sec[1], ops_per_sec[1] / ops_per_sec[0]);
+		fflush(stdout);
+	}
+	free((void *) keys);
+}
+
+/**
+ * `ingest`: ordered ingest, where several producers take ascending keys from a shared counter and add them (like timestamps or sequence numbers), with and without the append fast path, and with eager and lazy towers.
+ * Every add goes to the tail, so the producers all fight over the last node; the list is checked afterwards for holding every key, in order.
+ */
+
+#define BENCH_INGEST_KEYS ((size_t) 1000000)
+
+typedef struct {
+	hopscotch_list_t * list;
+	uint32_t * keys;
+	size_t keys_count;
+	atomic_size_t * next;
+} bench_ingest_ctx_t;
+
+static void *
+bench_ingest_producer(void * arg) {
+	bench_ingest_ctx_t * ctx = (bench_ingest_ctx_t *) arg;
+	for (;;) {
+		size_t i = atomic_fetch_add_explicit(ctx->next, (size_t) 1, memory_order_relaxed);
+		if (i >= ctx->keys_count) {
+			break;
+		}
+		bool added;
+		BENCH_CHECK(hopscotch_list_add_el(&added, ctx->list, (hopscotch_byte_t *) &(ctx->keys[i]), sizeof(uint32_t)));
+		if (! added) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	return NULL;
+}
+
+static void
+bench_ingest(void) {
+	size_t keys_count = BENCH_INGEST_KEYS / bench_scale;
+	uint32_t * keys = new_keys(keys_count);
+	printf("ingest: %zu ascending keys, taken from a shared counter by every producer\n", keys_count);
+	printf("%8s %8s %16s %16s %8s\n", "towers", "threads", "normal (adds/s)", "append (adds/s)", "ratio");
+	int lazy;
+	for (lazy = 0; lazy < 2; lazy++) {
+		size_t t;
+		for (t = 0; t < (sizeof(bench_threads) / sizeof(bench_threads[0])); t++) {
+			size_t threads_count = bench_threads[t];
+			double adds_per_sec[2];
+			int append;
+			for (append = 0; append < 2; append++) {
+				hopscotch_opts_t opts;
+				memset((void *) &opts, 0, sizeof(opts));
+				opts.append.enabled = (bool) append;
+				opts.towers.lazy = (bool) lazy;
+				hopscotch_list_t * list = new_list(&opts);
+				BENCH_CHECK(hopscotch_list_maintenance_start(list));
+				atomic_size_t next;
+				atomic_init(&next, (size_t) 0);
+				bench_ingest_ctx_t ctxs[BENCH_THREADS_MAX];
+				size_t i;
+				for (i = 0; i < threads_count; i++) {
+					ctxs[i].list = list;
+					ctxs[i].keys = keys;
+					ctxs[i].keys_count = keys_count;
+					ctxs[i].next = &next;
+				}
+				double elapsed = run_threads(threads_count, bench_ingest_producer, (void *) ctxs, sizeof(bench_ingest_ctx_t));
+				BENCH_CHECK(hopscotch_list_maintenance_stop(list));
+				adds_per_sec[append] = ((double) keys_count) / elapsed;
+				// Whatever order the producers got to the list in, it has to end up holding every key, in order.
+				hopscotch_node_t * node = NULL;
+				BENCH_CHECK(hopscotch_list_next_el(&node, list, NULL));
+				for (i = 0; i < keys_count; i++) {
+					hopscotch_byte_t * val;
+					size_t val_size;
+					if (node == NULL) {
+						exit(EXIT_FAILURE);
+					}
+					BENCH_CHECK(hopscotch_list_el_val(&val, &val_size, list, node));
+					if ((val_size != sizeof(uint32_t)) || (memcmp((void *) val, (void *) &(keys[i]), sizeof(uint32_t)) != 0)) {
+						exit(EXIT_FAILURE);
+					}
+					BENCH_CHECK(hopscotch_list_next_el(&node, list, node));
+				}
+				if (node != NULL) {
+					exit(EXIT_FAILURE);
+				}
+				BENCH_CHECK(hopscotch_list_free(list));
+			}
+			printf("%8s %8zu %16.0f %16.0f %8.2f\n", lazy ? "lazy" : "eager", threads_count, adds_per_sec[0], adds_per_sec[1], adds_per_sec[1] / adds_per_sec[0]);
+			fflush(stdout);
+		}
+	}
+	free((void *) keys);
+}
+
+/**
+ * `lazy`: random adds and dels (2 to 1) from several threads, on a list that starts a quarter full, with eager towers and with lazy ones (built by the maintenance thread, which runs alongside).
+ */
+
+#define BENCH_LAZY_KEYS ((size_t) 1000000)
+#define BENCH_LAZY_OPS ((size_t) 2000000)
+
+typedef struct {
+	hopscotch_list_t * list;
+	uint32_t * keys;
+	size_t keys_count;
+	size_t ops;
+	uint64_t seed;
+} bench_lazy_ctx_t;
+
+static void *
+bench_lazy_writer(void * arg) {
+	bench_lazy_ctx_t * ctx = (bench_lazy_ctx_t *) arg;
+	uint64_t state = ctx->seed;
+	size_t i;
+	for (i = 0; i < ctx->ops; i++) {
+		uint64_t r = xorshift(&state);
+		hopscotch_byte_t * val = (hopscotch_byte_t *) &(ctx->keys[(size_t) ((r >> 8) % ctx->keys_count)]);
+		bool done;
+		if ((r % 3) == 0) {
+			BENCH_CHECK(hopscotch_list_del_el(&done, ctx->list, val, sizeof(uint32_t)));
+		} else {
+			BENCH_CHECK(hopscotch_list_add_el(&done, ctx->list, val, sizeof(uint32_t)));
+		}
+	}
+	return NULL;
+}
+
+static void
+bench_lazy(void) {
+	size_t keys_count = BENCH_LAZY_KEYS / bench_scale;
+	size_t ops = BENCH_LAZY_OPS / bench_scale;
+	uint32_t * keys = new_keys(keys_count);
+	printf("lazy: %zu random adds/dels (2:1) over %zu keys, list starts a quarter full\n", ops, keys_count);
+	printf("%8s %16s %16s %8s\n", "threads", "eager (ops/s)", "lazy (ops/s)", "ratio");
+	size_t t;
+	for (t = 0; t < (sizeof(bench_threads) / sizeof(bench_threads[0])); t++) {
+		size_t threads_count = bench_threads[t];
+		double ops_per_sec[2];
+		int lazy;
+		for (lazy = 0; lazy < 2; lazy++) {
+			hopscotch_opts_t opts;
+			memset((void *) &opts, 0, sizeof(opts));
+			opts.towers.lazy = (bool) lazy;
+			hopscotch_list_t * list = new_list(&opts);
+			size_t i;
+			for (i = 0; i < keys_count; i += 4) {
+				bool added;
+				BENCH_CHECK(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) &(keys[i]), sizeof(uint32_t)));
+			}
+			if (lazy) {
+				// Start from fully built towers, like the eager list.
+				BENCH_CHECK(hopscotch_list_maintenance_run(list));
+				BENCH_CHECK(hopscotch_list_maintenance_start(list));
+			}
+			bench_lazy_ctx_t ctxs[BENCH_THREADS_MAX];
+			for (i = 0; i < threads_count; i++) {
+				ctxs[i].list = list;
+				ctxs[i].keys = keys;
+				ctxs[i].keys_count = keys_count;
+				ctxs[i].ops = ops / threads_count;
+				ctxs[i].seed = (uint64_t) (0x9e3779b97f4a7c15ULL * (i + 1));
+			}
+			double elapsed = run_threads(threads_count, bench_lazy_writer, (void *) ctxs, sizeof(bench_lazy_ctx_t));
+			if (lazy) {
+				BENCH_CHECK(hopscotch_list_maintenance_stop(list));
+			}
+			ops_per_sec[lazy] = ((double) ((ops / threads_count) * threads_count)) / elapsed;
+			BENCH_CHECK(hopscotch_list_free(list));
+		}
+		printf("%8zu %16.0f %16.0f %8.2f\n", threads_count, ops_per_sec[0], ops_per_sec[1], ops_per_sec[1] / ops_per_sec[0]);
+		fflush(stdout);
+	}
+	free((void *) keys);
+}
+
+/**
+ * `zipf`: lookups of Zipf-distributed keys (s = 1, with the ranks shuffled over the key space), with and without adaptive towers.
+ * It reports comparisons per lookup (counted by a custom `cmp`, one per hop) for all the lookups and for the 1000 hottest keys, and the time per lookup.
+ * The adaptive list first gets `BENCH_ZIPF_WARMUP_ROUNDS` rounds of lookups, each followed by a maintenance pass; the eager list gets the same lookups.
+ */
+
+#define BENCH_ZIPF_KEYS ((size_t) 1000000)
+#define BENCH_ZIPF_LOOKUPS ((size_t) 2000000)
+#define BENCH_ZIPF_HOT_KEYS ((size_t) 1000)
+#define BENCH_ZIPF_WARMUP_ROUNDS 40
+
+static uint64_t bench_zipf_cmps = 0;
+
+// The default order, but counted.
+static hopscotch_res_t
+bench_zipf_cmp(int * res, hopscotch_byte_t * val_1, size_t val_1_size, hopscotch_byte_t * val_2, size_t val_2_size) {
+	bench_zipf_cmps++;
+	int cmp_res = memcmp((void *) val_1, (void *) val_2, (val_1_size < val_2_size) ? val_1_size : val_2_size);
+	if (cmp_res == 0) {
+		cmp_res = (val_1_size < val_2_size) ? -1 : ((val_1_size > val_2_size) ? 1 : 0);
+	}
+	res[0] = (cmp_res < 0) ? -1 : ((cmp_res > 0) ? 1 : 0);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+// Draws a rank from `cdf` (`count` of them).
+static size_t
+bench_zipf_rank(uint64_t * state, double * cdf, size_t count) {
+	double u = ((double) (xorshift(state) >> 11)) / ((double) (((uint64_t) 1) << 53));
+	size_t lo = 0;
+	size_t hi = count - 1;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if (cdf[mid] >= u) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return lo;
+}
+
+static void
+bench_zipf(void) {
+	size_t keys_count = BENCH_ZIPF_KEYS / bench_scale;
+	size_t lookups = BENCH_ZIPF_LOOKUPS / bench_scale;
+	uint32_t * keys = new_keys(keys_count);
+	// Rank `r` is key `ranked[r]`, so that the hot keys are spread over the list.
+	size_t * ranked = (size_t *) malloc(keys_count * sizeof(size_t));
+	double * cdf = (double *) malloc(keys_count * sizeof(double));
+	size_t * ranks = (size_t *) malloc(lookups * sizeof(size_t));
+	if ((ranked == NULL) || (cdf == NULL) || (ranks == NULL)) {
+		exit(EXIT_FAILURE);
+	}
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	size_t i;
+	for (i = 0; i < keys_count; i++) {
+		ranked[i] = i;
+	}
+	for (i = keys_count - 1; i > 0; i--) {
+		size_t j = (size_t) (xorshift(&state) % (i + 1));
+		size_t tmp = ranked[i];
+		ranked[i] = ranked[j];
+		ranked[j] = tmp;
+	}
+	double total = 0;
+	for (i = 0; i < keys_count; i++) {
+		total += 1 / ((double) (i + 1));
+		cdf[i] = total;
+	}
+	for (i = 0; i < keys_count; i++) {
+		cdf[i] /= total;
+	}
+	for (i = 0; i < lookups; i++) {
+		ranks[i] = bench_zipf_rank(&state, cdf, keys_count);
+	}
+	printf("zipf: %zu lookups (s = 1) over %zu keys\n", lookups, keys_count);
+	printf("%10s %16s %16s %14s\n", "towers", "cmps/lookup", "hot cmps/lookup", "ns/lookup");
+	int adaptive;
+	for (adaptive = 0; adaptive < 2; adaptive++) {
+		hopscotch_opts_t opts;
+		memset((void *) &opts, 0, sizeof(opts));
+		opts.cmp = bench_zipf_cmp;
+		opts.towers.adaptive = (bool) adaptive;
+		hopscotch_list_t * list = new_list(&opts);
+		bool done;
+		for (i = 0; i < keys_count; i++) {
+			BENCH_CHECK(hopscotch_list_add_el(&done, list, (hopscotch_byte_t *) &(keys[i]), sizeof(uint32_t)));
+		}
+		// Let the hot keys heat up (which is a no-op for the eager list, but keeps the two runs alike).
+		uint64_t warmup_state = 0x2545f4914f6cdd1dULL;
+		int round;
+		for (round = 0; round < BENCH_ZIPF_WARMUP_ROUNDS; round++) {
+			size_t _a;
+			for (_a = 0; _a < (lookups / BENCH_ZIPF_WARMUP_ROUNDS); _a++) {
+				size_t key = ranked[bench_zipf_rank(&warmup_state, cdf, keys_count)];
+				BENCH_CHECK(hopscotch_list_contains_el(&done, list, (hopscotch_byte_t *) &(keys[key]), sizeof(uint32_t)));
+			}
+			BENCH_CHECK(hopscotch_list_maintenance_run(list));
+		}
+		uint64_t cmps = 0;
+		uint64_t hot_cmps = 0;
+		size_t hot_lookups = 0;
+		double start = now();
+		for (i = 0; i < lookups; i++) {
+			uint64_t _cmps = bench_zipf_cmps;
+			BENCH_CHECK(hopscotch_list_contains_el(&done, list, (hopscotch_byte_t *) &(keys[ranked[ranks[i]]]), sizeof(uint32_t)));
+			if (! done) {
+				exit(EXIT_FAILURE);
+			}
+			_cmps = bench_zipf_cmps - _cmps;
+			cmps += _cmps;
+			if (ranks[i] < BENCH_ZIPF_HOT_KEYS) {
+				hot_cmps += _cmps;
+				hot_lookups++;
+			}
+		}
+		double elapsed = now() - start;
+		printf(
+			"%10s %16.1f %16.1f %14.1f\n",
+			adaptive ? "adaptive" : "eager",
+			((double) cmps) / ((double) lookups),
+			(hot_lookups == 0) ? ((double) 0) : (((double) hot_cmps) / ((double) hot_lookups)),
+			(elapsed * 1e9) / ((double) lookups)
+		);
+		fflush(stdout);
+		BENCH_CHECK(hopscotch_list_free(list));
+	}
+	free((void *) ranks);
+	free((void *) cdf);
+	free((void *) ranked);
+	free((void *) keys);
+}
+
+static const struct {
+	const char * name;
+	void (* fn)(void);
+} benches[] = {
+	{"hotspot", bench_hotspot},
+	{"ingest", bench_ingest},
+	{"lazy", bench_lazy},
+	{"zipf", bench_zipf},
+};
+
+int
+main(int argc, char ** argv) {
+	const char * scale = getenv("HOPSCOTCH_BENCH_SCALE");
+	if ((scale != NULL) && (atoi(scale) > 0)) {
+		bench_scale = (size_t) atoi(scale);
+	}
+	bool ran = false;
+	size_t i;
+	for (i = 0; i < (sizeof(benches) / sizeof(benches[0])); i++) {
+		if ((argc < 2) || (strcmp(argv[1], benches[i].name) == 0)) {
+			benches[i].fn();
+			ran = true;
+		}
+	}
+	if (! ran) {
+		fprintf(stderr, "Unknown benchmark `%s`.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,239 @@
+/**
+ * The MIT License (MIT).
+ *
+ * https://github.com/jonathanmarvens/hopscotch
+ *
+ * Copyright (c) 2014 Jonathan Barronville (jonathan@scrapum.photos) and contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <hopscotch/hopscotch.h>
+#include <hopscotch/hopscotch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// The C++ front-end (`hopscotch.hpp`) against the C API, on the same workloads: inserting shuffled keys, looking them all up, and a mix of adds, dels and lookups from several threads.
+// The C API compares bytes through a function pointer and allocates through the GC; the front-end compares `uint32_t`s with an inlined `std::less`.
+// `HOPSCOTCH_BENCH_SCALE` scales the sizes down, like for `bench`.
+
+namespace {
+
+const std::size_t bench_keys = 1000000;
+const std::size_t bench_mixed_ops = 2000000;
+const std::size_t bench_threads[] = {1, 2, 4, 8};
+
+#define BENCH_CHECK(expr) \
+	do { \
+		if ((expr) != HOPSCOTCH_RES__SUCCESS) { \
+			std::fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #expr); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+double
+now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint64_t
+xorshift(std::uint64_t & state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+typedef hopscotch::concurrent_skiplist<std::uint32_t> cpp_list_t;
+
+// Wraps both lists behind the same three calls, so that the workloads are written once.
+struct c_api {
+	hopscotch_list_t * list;
+	// Big-endian copies of the keys, since the C list points at its elements' buffers and compares them as bytes.
+	std::vector<std::uint32_t> vals;
+
+	explicit c_api(std::size_t keys_count) : list(nullptr), vals(keys_count) {
+		hopscotch_opts_t * opts = (hopscotch_opts_t *) std::calloc(1, sizeof(hopscotch_opts_t));
+		if (opts == nullptr) {
+			std::exit(EXIT_FAILURE);
+		}
+		BENCH_CHECK(hopscotch_list_new(&list, opts));
+		for (std::size_t i = 0; i < keys_count; i++) {
+			hopscotch_byte_t * val = (hopscotch_byte_t *) &(vals[i]);
+			val[0] = (hopscotch_byte_t) (i >> 24);
+			val[1] = (hopscotch_byte_t) (i >> 16);
+			val[2] = (hopscotch_byte_t) (i >> 8);
+			val[3] = (hopscotch_byte_t) i;
+		}
+	}
+
+	~c_api() {
+		hopscotch_list_free(list);
+	}
+
+	bool
+	add(std::uint32_t key) {
+		bool added;
+		BENCH_CHECK(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) &(vals[key]), sizeof(std::uint32_t)));
+		return added;
+	}
+
+	bool
+	del(std::uint32_t key) {
+		bool deleted;
+		BENCH_CHECK(hopscotch_list_del_el(&deleted, list, (hopscotch_byte_t *) &(vals[key]), sizeof(std::uint32_t)));
+		return deleted;
+	}
+
+	bool
+	contains(std::uint32_t key) {
+		bool found;
+		BENCH_CHECK(hopscotch_list_contains_el(&found, list, (hopscotch_byte_t *) &(vals[key]), sizeof(std::uint32_t)));
+		return found;
+	}
+
+	std::size_t
+	reclaim() {
+		return 0;
+	}
+};
+
+struct cpp_api {
+	cpp_list_t list;
+
+	explicit cpp_api(std::size_t) {}
+
+	bool
+	add(std::uint32_t key) {
+		return list.insert(key).second;
+	}
+
+	bool
+	del(std::uint32_t key) {
+		return list.erase(key) == 1;
+	}
+
+	bool
+	contains(std::uint32_t key) {
+		return list.contains(key);
+	}
+
+	std::size_t
+	reclaim() {
+		return list.reclaim();
+	}
+};
+
+struct result {
+	double insert;
+	double lookup;
+	double mixed[sizeof(bench_threads) / sizeof(bench_threads[0])];
+	std::size_t reclaimed;
+};
+
+template <typename Api>
+result
+run(std::size_t keys_count, std::size_t mixed_ops) {
+	result res;
+	// Shuffled, so that inserts land all over the list.
+	std::vector<std::uint32_t> order(keys_count);
+	for (std::size_t i = 0; i < keys_count; i++) {
+		order[i] = (std::uint32_t) i;
+	}
+	std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+	for (std::size_t i = keys_count - 1; i > 0; i--) {
+		std::size_t j = (std::size_t) (xorshift(state) % (i + 1));
+		std::uint32_t tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	Api api(keys_count);
+	double start = now();
+	for (std::size_t i = 0; i < keys_count; i += 2) {
+		if (! api.add(order[i])) {
+			std::exit(EXIT_FAILURE);
+		}
+	}
+	res.insert = ((double) ((keys_count + 1) / 2)) / (now() - start);
+	// Half of the lookups miss.
+	start = now();
+	std::size_t found_count = 0;
+	for (std::size_t i = 0; i < keys_count; i++) {
+		found_count += api.contains(order[i]) ? 1 : 0;
+	}
+	res.lookup = ((double) keys_count) / (now() - start);
+	if (found_count != ((keys_count + 1) / 2)) {
+		std::exit(EXIT_FAILURE);
+	}
+	res.reclaimed = 0;
+	for (std::size_t t = 0; t < (sizeof(bench_threads) / sizeof(bench_threads[0])); t++) {
+		std::size_t threads_count = bench_threads[t];
+		std::size_t ops = mixed_ops / threads_count;
+		std::vector<std::thread> threads;
+		start = now();
+		for (std::size_t i = 0; i < threads_count; i++) {
+			threads.push_back(std::thread([&api, ops, keys_count, i]() {
+				std::uint64_t _state = 0x9e3779b97f4a7c15ULL * (i + 1);
+				for (std::size_t j = 0; j < ops; j++) {
+					std::uint64_t r = xorshift(_state);
+					std::uint32_t key = (std::uint32_t) ((r >> 8) % keys_count);
+					switch (r % 4) {
+						case 0:
+							api.add(key);
+							break;
+						case 1:
+							api.del(key);
+							break;
+						default:
+							api.contains(key);
+							break;
+					}
+				}
+			}));
+		}
+		for (std::size_t i = 0; i < threads_count; i++) {
+			threads[i].join();
+		}
+		res.mixed[t] = ((double) (ops * threads_count)) / (now() - start);
+		// Every thread is done, so the list is quiescent.
+		res.reclaimed += api.reclaim();
+	}
+	return res;
+}
+
+}
+
+int
+main() {
+	std::size_t scale = 1;
+	const char * _scale = std::getenv("HOPSCOTCH_BENCH_SCALE");
+	if ((_scale != nullptr) && (std::atoi(_scale) > 0)) {
+		scale = (std::size_t) std::atoi(_scale);
+	}
+	std::size_t keys_count = bench_keys / scale;
+	std::size_t mixed_ops = bench_mixed_ops / scale;
+	std::printf("cpp: %zu keys, %zu mixed ops (1:1:2 adds, dels and lookups) per thread count\n", keys_count, mixed_ops);
+	std::fflush(stdout);
+	result c = run<c_api>(keys_count, mixed_ops);
+	result cpp = run<cpp_api>(keys_count, mixed_ops);
+	std::printf("%-20s %16s %16s %8s\n", "", "C API (ops/s)", "C++ (ops/s)", "ratio");
+	std::printf("%-20s %16.0f %16.0f %8.2f\n", "insert", c.insert, cpp.insert, cpp.insert / c.insert);
+	std::printf("%-20s %16.0f %16.0f %8.2f\n", "lookup", c.lookup, cpp.lookup, cpp.lookup / c.lookup);
+	for (std::size_t t = 0; t < (sizeof(bench_threads) / sizeof(bench_threads[0])); t++) {
+		char label[32];
+		std::snprintf(label, sizeof(label), "mixed, %zu threads", bench_threads[t]);
+		std::printf("%-20s %16.0f %16.0f %8.2f\n", label, c.mixed[t], cpp.mixed[t], cpp.mixed[t] / c.mixed[t]);
+	}
+	std::printf("C++ erased nodes freed by reclaim(): %zu\n", cpp.reclaimed);
+	return EXIT_SUCCESS;
+}
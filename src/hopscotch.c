@@ -12,11 +12,204 @@
  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+// Shared memory segments and robust mutexes are POSIX (and `MAP_FIXED_NOREPLACE` is Linux), not C11.
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "hopscotch.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Robust mutexes tell the next owner that the last one died while holding them. They aren't available everywhere (e.g. on macOS).
+#if defined(EOWNERDEAD) && (! defined(__APPLE__))
+#define _HOPSCOTCH_ROBUST_LOCKS
+#endif
+
+// Kernels that don't know `MAP_FIXED_NOREPLACE` treat the address as a hint, so `hopscotch_list_shm_open` checks where the segment ended up anyway.
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0
+#endif
+
+// Posts an add (or a del) to the list's publication array and waits for it to be applied, taking the combiner's role whenever it's free (see `opts->combining.enabled`).
+static hopscotch_res_t
+_combining_post(
+	bool *,
+	hopscotch_list_t *,
+	bool,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Applies every pending op, sorted, with each one searching from where the one before it left off.
+// The caller must hold `list->combining->lock`.
+static hopscotch_res_t
+_combining_run(hopscotch_list_t *);
+
+static hopscotch_res_t
+_filter_add(hopscotch_filter_t *, uint64_t);
+
+static hopscotch_res_t
+_filter_contains(bool *, hopscotch_filter_t *, uint64_t);
+
+static hopscotch_res_t
+_filter_del(hopscotch_filter_t *, uint64_t);
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_filter_locate(
+	uint16_t *,
+	size_t *,
+	size_t *,
+	hopscotch_filter_t *,
+	uint64_t
+);
+
+static hopscotch_res_t
+_filter_new(hopscotch_filter_t **, hopscotch_opts_t *, size_t);
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_filter_note(hopscotch_filter_t *, uint64_t, bool);
+
+// Gets the element of rank `rank`, checking that it's within the frozen list (a mapped file is only checked as far as it's read).
+_ALWAYS_INLINE static inline hopscotch_res_t
+_frozen_el(hopscotch_byte_t **, size_t *, hopscotch_frozen_t *, uint64_t);
+
+// Finds the rank of the smallest element that's greater than or equal to `val` (`count` if there isn't one).
+static hopscotch_res_t
+_frozen_find(size_t *, hopscotch_frozen_t *, hopscotch_byte_t *, size_t);
+
+// Fills in where everything goes for `count` elements that take up `vals_size` bytes.
+static hopscotch_res_t
+_frozen_layout(hopscotch_frozen_header_t *, size_t, size_t);
+
+// Checks the header at `data` and sets up a frozen list around it.
+static hopscotch_res_t
+_frozen_new(
+	hopscotch_frozen_t **,
+	hopscotch_opts_t *,
+	hopscotch_byte_t *,
+	size_t,
+	bool
+);
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_frozen_prefix(uint64_t *, hopscotch_byte_t *, size_t);
+
+// Adds a node to / deletes a node from the hash index.
+// These must be called from within the critical section that links / unlinks the node.
+static hopscotch_res_t
+_index_add(hopscotch_index_t *, hopscotch_opts_t *, hopscotch_node_t *, uint64_t);
+
+// Same as `_index_add`, but with an entry from `_index_new_entry`, so that the allocation can happen before the critical section.
+static hopscotch_res_t
+_index_add_entry(hopscotch_index_t *, hopscotch_index_entry_t *);
+
+static hopscotch_res_t
+_index_del(hopscotch_index_t *, hopscotch_node_t *, uint64_t);
+
+// Lock-free hash index lookup helper.
+static hopscotch_res_t
+_index_find(
+	hopscotch_node_t **,
+	hopscotch_index_t *,
+	hopscotch_opts_t *,
+	uint64_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Does a bit of resize work, if there's any to do.
+// This must be called outside of any critical section.
+static hopscotch_res_t
+_index_maintain(hopscotch_index_t *, hopscotch_opts_t *);
+
+static hopscotch_res_t
+_index_new(hopscotch_index_t **, hopscotch_opts_t *, size_t);
+
+static hopscotch_res_t
+_index_new_entry(hopscotch_index_entry_t **, hopscotch_opts_t *, hopscotch_node_t *, uint64_t);
+
+static hopscotch_res_t
+_index_table_new(
+	hopscotch_index_table_t **,
+	hopscotch_opts_t *,
+	size_t,
+	hopscotch_index_table_t *
+);
+
+// Moves the towers of the nodes that have heated up (from `adaptive->hot`) or cooled down (from `adaptive->raised`), for `opts->towers.adaptive`.
+// The caller must hold `list->maintenance->lock`.
+static hopscotch_res_t
+_list_adapt(hopscotch_list_t *);
+
+// Works out how tall a node's tower should be from `hits` (taken from it by the caller) since it was last looked at, and raises or lowers it to that.
+// `n` is about how many elements the list has.
+static hopscotch_res_t
+_list_adapt_el(hopscotch_list_t *, hopscotch_node_t *, uint32_t, uint64_t, double);
+
+// Same as `hopscotch_list_add_el`, but starts searching from `finger_nodes` (see `_list_find_el_from`) when it isn't `NULL`, and leaves the new element's predecessors there.
+static hopscotch_res_t
+_list_add_el(
+	bool *,
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Links a new biggest element into a list that no other thread can see yet, e.g. one that's being bulk-built.
+// `tail_nodes` holds the last node at each level and is updated.
+static hopscotch_res_t
+_list_append_el(
+	hopscotch_list_t *,
+	hopscotch_node_t **,
+	hopscotch_byte_t *,
+	size_t
+);
+
 static hopscotch_res_t
 _list_can_del_el(bool *, hopscotch_node_t *, uint8_t);
 
+// Compares a node's element with `val`, like `cmp` does, and also works out how many bytes they share (if `lcp` isn't `NULL`), or `SIZE_MAX` if that wasn't needed.
+// `pred_node` (which may be `NULL`) is a node known to be smaller than `val` and to share `pred_lcp` bytes with it (worked out here if it's `SIZE_MAX`). If the node's prefix comes from there, most of the comparison is already done.
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_cmp_el(
+	int *,
+	size_t *,
+	hopscotch_opts_t *,
+	hopscotch_node_t *,
+	hopscotch_node_t *,
+	size_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Pushes a node whose tower is short of its target level onto the list's pending stack.
+static hopscotch_res_t
+_list_defer_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Same as `hopscotch_list_del_el`, for a list that's a skip list (see `opts->small`).
+// Starts searching from `finger_nodes` (see `_list_find_el_from`) when it isn't `NULL`, and leaves the element's predecessors there.
+static hopscotch_res_t
+_list_del_el(
+	bool *,
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
 static hopscotch_res_t
 _list_default_el_cmp(
 	int *,
@@ -26,6 +219,59 @@ _list_default_el_cmp(
 	size_t
 );
 
+static hopscotch_res_t
+_list_default_el_hash(uint64_t *, hopscotch_byte_t *, size_t);
+
+// Gets the byte at some offset of a (prefix-compressed) node's element.
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_el_byte(hopscotch_byte_t *, hopscotch_node_t *, size_t);
+
+// Works out how many bytes the first `limit` bytes of a (prefix-compressed) node's element share with `val`, without putting the element back together.
+static hopscotch_res_t
+_list_el_lcp(
+	size_t *,
+	hopscotch_node_t *,
+	size_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// See `hopscotch_list_el_val`.
+static hopscotch_res_t
+_list_el_val(
+	hopscotch_byte_t **,
+	size_t *,
+	hopscotch_list_t *,
+	hopscotch_node_t *
+);
+
+// Whether a node's element is in the list as of some version (`HOPSCOTCH_VAL_LIST_VERSION_NOW` for the current state).
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_el_visible(bool *, hopscotch_node_t *, uint64_t);
+
+// Lock-free membership filter check helper.
+static hopscotch_res_t
+_list_filter_check(
+	bool *,
+	hopscotch_filter_t **,
+	uint64_t *,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Adds to / deletes from the list's membership filter(s).
+// These must be called from within the critical section that links / unlinks the node.
+static hopscotch_res_t
+_list_filter_add(hopscotch_list_t *, uint64_t);
+
+static hopscotch_res_t
+_list_filter_del(hopscotch_list_t *, uint64_t);
+
+// Sets up a list's filter record, with a filter for `capacity` elements (or none yet, for `0`).
+static hopscotch_res_t
+_list_filter_new(hopscotch_list_filter_t **, hopscotch_opts_t *, size_t);
+
 // Lock-free node finding helper.
 static hopscotch_res_t
 _list_find_el(
@@ -37,505 +283,8334 @@ _list_find_el(
 	size_t
 );
 
+// Same as `_list_find_el`, but starts from the predecessors of a smaller element (a "finger") when `finger_nodes` isn't `NULL`.
+static hopscotch_res_t
+_list_find_el_from(
+	uint8_t *,
+	hopscotch_node_t **,
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_node_t **,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Finds the last node at every level (the left sentinel where a level is empty).
+static hopscotch_res_t
+_list_find_last_el(hopscotch_node_t **, hopscotch_list_t *);
+
+// Sets `pred_nodes` and `succ_nodes` up to `top_level` from the list's tail pointers (see `opts->append`), if `val` goes after the last element.
+// `at_tail` is set to whether it does; the caller still has to validate them under the predecessors' locks.
+static hopscotch_res_t
+_list_find_tail(
+	bool *,
+	hopscotch_node_t **,
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	uint8_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Drops a node that's being deleted from the membership filter and hash index.
+static hopscotch_res_t
+_list_forget_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Initializes a node lock, making it process-shared if the list lives in shared memory.
+static hopscotch_res_t
+_list_init_lock(hopscotch_list_t *, pthread_mutex_t *);
+
+// Points `node`'s back link at `pred_node`, if the list keeps back links.
+// The caller must hold the lock of `node`'s level-0 predecessor (old or new).
+static hopscotch_res_t
+_list_link_back(hopscotch_list_t *, hopscotch_node_t *, hopscotch_node_t *);
+
+// Moves a node pointer forward to the next live element (or the right sentinel).
+static hopscotch_res_t
+_list_live_el(hopscotch_node_t **);
+
+// Locks a node.
+// If the lock's last owner was a process that died holding it, this also repairs whatever that process left half-done around the node.
+static hopscotch_res_t
+_list_lock_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Point lookup helper.
+// Tries the membership filter, then the hash index, and only then the towers.
+static hopscotch_res_t
+_list_lookup_el(
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Takes the top level of a node's tower out of the list, if `pred_node` is still its predecessor there (see `_list_raise_el`).
+static hopscotch_res_t
+_list_lower_el(
+	bool *,
+	hopscotch_list_t *,
+	hopscotch_node_t *,
+	hopscotch_node_t *,
+	uint8_t
+);
+
+// Does one maintenance pass, i.e. raises the towers of the nodes on the pending stack.
+// The caller must hold `list->maintenance->lock`.
+static hopscotch_res_t
+_list_maintain(hopscotch_list_t *);
+
+// The maintenance thread's entry point.
+static void *
+_list_maintenance_main(void *);
+
+// Allocates memory for nodes and elements, from the shared memory segment if the list lives in one.
+static hopscotch_res_t
+_list_malloc(void **, hopscotch_list_t *, size_t);
+
+// Moves the filter and index entries of the nodes from `node` up to the right sentinel from one list to another.
+static hopscotch_res_t
+_list_move_els(hopscotch_list_t *, hopscotch_list_t *, hopscotch_node_t *);
+
+// Sets up a list, in `shm` if it isn't `NULL` (creating the sentinels there unless another process already has).
+static hopscotch_res_t
+_list_new(hopscotch_list_t **, hopscotch_opts_t *, hopscotch_shm_t *);
+
+// Creates a list's sentinels, with nothing between them.
+static hopscotch_res_t
+_list_new_head(hopscotch_node_t **, hopscotch_list_t *);
+
+// Counts a lookup that found `node`, for `opts->towers.adaptive` (if it's one of the lookups that are sampled).
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_note_hit(hopscotch_list_t *, hopscotch_node_t *);
+
+// The oldest version a snapshot of a versioned list is still pinned at, or the last version handed out if there's none.
+// Nodes deleted at or before it can't be seen by anyone anymore.
+static hopscotch_res_t
+_list_oldest_version(uint64_t *, hopscotch_list_t *);
+
+// Allocates and initializes a node that isn't linked anywhere yet.
+// With prefix compression, the node's element is stored relative to `base_node` (the level-0 predecessor it'll be added after, if known).
+static hopscotch_res_t
+_list_new_el(
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t,
+	uint8_t,
+	uint8_t,
+	hopscotch_node_t *
+);
+
+// Links a node at `level`, right after `pred_node` (its predecessor on that level), if it's still linked exactly up to the level below.
+// `val` is the node's element (see `_list_el_val`).
+static hopscotch_res_t
+_list_raise_el(
+	bool *,
+	hopscotch_list_t *,
+	hopscotch_node_t *,
+	hopscotch_node_t *,
+	uint8_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Finds the live element right before `node` (which may be the right sentinel, or dead), using its back link when it can be trusted.
+static hopscotch_res_t
+_list_prev_el(hopscotch_node_t **, hopscotch_list_t *, hopscotch_node_t *);
+
 _ALWAYS_INLINE static inline hopscotch_res_t
 _list_rand_level(uint8_t *, hopscotch_list_t *);
 
+// Physically deletes a retired node if no snapshot can see it anymore (as of `oldest`), or puts it back on the retired stack otherwise.
 static hopscotch_res_t
-_list_can_del_el(bool * ans, hopscotch_node_t * el, uint8_t level) {
-	ans[0] = (bool) (
-		el->fully_linked &&
-		(el->level == level) &&
-		(! el->marked)
-	);
-	// Success!
-	return HOPSCOTCH_RES__SUCCESS;
-}
+_list_reclaim_el(hopscotch_list_t *, hopscotch_node_t *, uint64_t);
 
+// Goes through the retired stack with `_list_reclaim_el`.
 static hopscotch_res_t
-_list_default_el_cmp(
-	int * res,
-	hopscotch_byte_t * val_a,
-	size_t val_a_size,
-	hopscotch_byte_t * val_b,
-	size_t val_b_size
-) {
-	// Let's first handle the extrema.
-	const char * min_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL;
-	const char * max_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL;
-	size_t min_val_size = (size_t) (strlen(min_val) + 1);
-	size_t max_val_size = (size_t) (strlen(max_val) + 1);
-	// If their sizes aren't equal, no need to even compare and waste precious CPU cycles.
-	// Due to short-circuit eval, this should behave as expected.
-	// NOTE(@jonathanmarvens):
-	// When making comparisons against elements already in a list, this logic assumes `val_a` is the element already in the list.
-	if (
-		(((int) val_a_size) == ((int) min_val_size)) &&
-		(memcmp((void *) val_a, (void *) min_val, min_val_size) == 0)
-	) {
-		res[0] = -1;
-		// Success!
-		return HOPSCOTCH_RES__SUCCESS;
-	}
-	if (
-		(((int) val_a_size) == ((int) max_val_size)) &&
-		(memcmp((void *) val_a, (void *) max_val, max_val_size) == 0)
-	) {
-		res[0] = 1;
-		// Success!
-		return HOPSCOTCH_RES__SUCCESS;
-	}
-	// Make sure the we only compare the buffers up to the smallest buffer's size.
-	size_t cmp_size;
-	if (((int) val_a_size) < ((int) val_b_size)) {
-		cmp_size = val_a_size;
-	} else {
-		cmp_size = val_b_size;
-	}
-	// Compare!
-	res[0] = memcmp((void *) val_a, (void *) val_b, cmp_size);
-	// Success!
-	return HOPSCOTCH_RES__SUCCESS;
-}
+_list_reclaim_els(hopscotch_list_t *);
 
+// Finishes the add / del that a dead process left half-done around a node whose lock the caller holds.
 static hopscotch_res_t
-_list_find_el(
-	uint8_t * level_found,
-	hopscotch_node_t ** pred_nodes,
-	hopscotch_node_t ** succ_nodes,
-	hopscotch_list_t * list,
-	hopscotch_byte_t * val,
-	size_t val_size
-) {
-	bool val_found = false;
-	hopscotch_node_t * pred_node = list->head;
-	int16_t _level;
-	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
-		hopscotch_node_t * curr_node = pred_node->forward[(int) _level];
-		while (true) {
-			int _cmp_res_001;
-			hopscotch_res_t _tmp_001 = list->opts->cmp(
+_list_repair_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Pushes a deleted node that a snapshot could still see onto the list's retired stack, unless it's there already.
+// The caller holds the node's lock.
+static hopscotch_res_t
+_list_retire_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Adds a deleted element back by starting a new version range on its (still linked) node.
+// `revived` is false if the node was physically deleted or added back by someone else first.
+static hopscotch_res_t
+_list_revive_el(bool *, hopscotch_list_t *, hopscotch_node_t *);
+
+// Looks `val` up, stopping at the highest level it's on, unlike `_list_find_el` (which goes all the way down for the predecessors).
+// `node` is `NULL` if it isn't there. Elements have to be stored whole.
+static hopscotch_res_t
+_list_search_el(
+	hopscotch_node_t **,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Merges the level-0 chains of two lists into a new, bulk-built list.
+// The `keep_*` flags pick the elements only in `list_a`, in both, and only in `list_b`.
+static hopscotch_res_t
+_list_set_op(
+	hopscotch_list_t **,
+	hopscotch_list_t *,
+	hopscotch_list_t *,
+	bool,
+	bool,
+	bool
+);
+
+// Points the list's tail pointers (see `opts->append`) at `tail_nodes`, or back at the head if it's `NULL`.
+// Everything that links or unlinks nodes without `_list_add_el` or `_list_del_el` has to call this, so that an append never goes after a node that isn't in the list anymore.
+static hopscotch_res_t
+_list_set_tails(hopscotch_list_t *, hopscotch_node_t **);
+
+// Hands out the next version of a versioned list and stores it in `stamp`, so that snapshots pinned from then on see it.
+// Also gets `_list_oldest_version` in the same go.
+static hopscotch_res_t
+_list_stamp_el(
+	uint64_t *,
+	uint64_t *,
+	hopscotch_list_t *,
+	HOPSCOTCH_ATOMIC(uint64_t) *
+);
+
+// Unlinks a node that the caller has already marked, at whichever levels it's still linked.
+static hopscotch_res_t
+_list_unlink_el(hopscotch_list_t *, hopscotch_node_t *);
+
+// Unlinks the nodes a failing `hopscotch_list_del_range` has marked (`pending_nodes`, and `last_node` if it isn't `NULL`, which comes after all of them), so that nobody is left waiting on them.
+// The nodes are found by walking level 0 from the head, which takes no comparisons (a failed one may be what went wrong) and goes in order, so every node's nearest marked predecessor is gone by the time it's unlinked.
+static hopscotch_res_t
+_list_unlink_pending(hopscotch_list_t *, hopscotch_node_set_t *, hopscotch_node_t *);
+
+// Releases the locks on `pred_nodes[0]` up to `pred_nodes[highest_level_locked]`.
+// A predecessor that spans several levels was only locked once.
+static hopscotch_res_t
+_list_unlock_preds(hopscotch_node_t **, int16_t);
+
+// Pins the store's current state (see `hopscotch_lsm_t`).
+static hopscotch_res_t
+_lsm_acquire(hopscotch_lsm_state_t **, hopscotch_lsm_t *);
+
+static hopscotch_res_t
+_lsm_builder_abort(hopscotch_lsm_builder_t *);
+
+// Adds an entry to the run. Entries have to be added in order.
+static hopscotch_res_t
+_lsm_builder_add(hopscotch_lsm_builder_t *, hopscotch_byte_t, hopscotch_byte_t *, size_t);
+
+// Writes out the block being filled, with its restart points, and adds its fence pointer to the index.
+static hopscotch_res_t
+_lsm_builder_cut(hopscotch_lsm_builder_t *);
+
+// Finishes the run file and opens it. A run without any entries isn't kept, and comes back as `NULL`.
+static hopscotch_res_t
+_lsm_builder_finish(hopscotch_lsm_run_t **, hopscotch_lsm_builder_t *);
+
+static hopscotch_res_t
+_lsm_builder_new(hopscotch_lsm_builder_t *, hopscotch_lsm_t *, uint64_t, uint64_t);
+
+// Merges `count` runs of the current state, from `first` on, into one.
+// The caller must have set `lsm->busy`.
+static hopscotch_res_t
+_lsm_compact(hopscotch_lsm_t *, size_t, size_t);
+
+// Points a cursor at the start of `block`, to go on until it reaches `blocks_end`.
+static hopscotch_res_t
+_lsm_cursor_init(hopscotch_lsm_cursor_t *, hopscotch_lsm_run_t *, size_t, size_t);
+
+// Moves a cursor to the next entry.
+static hopscotch_res_t
+_lsm_cursor_next(hopscotch_lsm_cursor_t *);
+
+// The memtables' `cmp`, which leaves out the op byte in front of every element but the sentinels.
+static hopscotch_res_t
+_lsm_el_cmp(
+	int *,
+	hopscotch_byte_t *,
+	size_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Looks an element up in a run, using the fence pointers to pick the one block it can be in,
+// and the block's restart points to skip to the entries close to it.
+// `known` is set to whether the run has an entry for it, and `op` to the entry's op.
+static hopscotch_res_t
+_lsm_find_el(
+	bool *,
+	hopscotch_byte_t *,
+	hopscotch_lsm_run_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Writes the frozen memtable to a new run, once nobody can be adding to it anymore.
+// The caller must have set `lsm->busy`.
+static hopscotch_res_t
+_lsm_flush_frozen(hopscotch_lsm_t *);
+
+// Freezes `memtable` and puts a new one in its place, unless someone else already has.
+// Waits for the memtable that's being flushed (if there is one) first.
+static hopscotch_res_t
+_lsm_freeze(hopscotch_lsm_t *, hopscotch_list_t *);
+
+static hopscotch_res_t
+_lsm_grow(hopscotch_lsm_t *, hopscotch_byte_t **, size_t *, size_t, size_t);
+
+// Makes `state` the store's current one, and lets go of the one it replaces.
+// The caller must hold `lsm->lock`.
+static hopscotch_res_t
+_lsm_install(hopscotch_lsm_t *, hopscotch_lsm_state_t *);
+
+// Opens the runs in the store's directory, newest first, and deletes what an interrupted flush or compaction left behind.
+static hopscotch_res_t
+_lsm_load(hopscotch_lsm_run_t ***, size_t *, hopscotch_lsm_t *);
+
+static void *
+_lsm_main(void *);
+
+// Finds `compaction_runs` runs in a row that are in the same tier, newest first.
+static hopscotch_res_t
+_lsm_pick(bool *, size_t *, hopscotch_lsm_t *, hopscotch_lsm_state_t *);
+
+static hopscotch_res_t
+_lsm_put(hopscotch_lsm_t *, hopscotch_byte_t, hopscotch_byte_t *, size_t);
+
+static hopscotch_res_t
+_lsm_release(hopscotch_lsm_t *, hopscotch_lsm_state_t *);
+
+// Orders runs newest first, and the ones that hold more flushes before the ones they were (or would have been) merged from.
+static int
+_lsm_run_cmp(const void *, const void *);
+
+static hopscotch_res_t
+_lsm_run_open(hopscotch_lsm_run_t **, hopscotch_lsm_t *, char *);
+
+static hopscotch_res_t
+_lsm_run_path(char **, hopscotch_lsm_t *, uint64_t, uint64_t, uint64_t);
+
+// Lets go of a run, which is unmapped (and deleted, if it's obsolete) if nothing else holds it.
+// The caller must hold the store's `lock`.
+static hopscotch_res_t
+_lsm_run_unref(hopscotch_lsm_run_t *);
+
+// Allocates a state with room for `runs_count` runs, which the caller fills in before installing it.
+static hopscotch_res_t
+_lsm_state_new(hopscotch_lsm_state_t **, hopscotch_lsm_t *, size_t);
+
+// The caller must hold `lsm->lock`.
+static hopscotch_res_t
+_lsm_state_unref(hopscotch_lsm_t *, hopscotch_lsm_state_t *);
+
+// Makes a rename (or a delete) in the store's directory stick.
+static hopscotch_res_t
+_lsm_sync_dir(hopscotch_lsm_t *);
+
+// The order `_list_default_el_cmp` puts elements in, without its checks for the sentinels (which runs and frozen lists don't have).
+static hopscotch_res_t
+_lsm_val_cmp(
+	int *,
+	hopscotch_byte_t *,
+	size_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Writes all of `data` at `offset`, however many `pwrite`s that takes.
+static hopscotch_res_t
+_lsm_write(int, hopscotch_byte_t *, size_t, size_t);
+
+static hopscotch_res_t
+_node_set_add(hopscotch_node_set_t *, hopscotch_opts_t *, hopscotch_node_t *);
+
+static hopscotch_res_t
+_node_set_has(bool *, hopscotch_node_set_t *, hopscotch_node_t *);
+
+static hopscotch_res_t
+_node_set_init(hopscotch_node_set_t *, hopscotch_opts_t *, size_t);
+
+// Cuts the list into about `target` segments (see `hopscotch_scan_t`), at every so many nodes of the highest level that has enough of them.
+static hopscotch_res_t
+_scan_bounds(hopscotch_scan_t *, size_t);
+
+// Records the first failure of a scan, which stops the other workers too.
+static hopscotch_res_t
+_scan_fail(hopscotch_scan_t *, hopscotch_res_t);
+
+// A scan worker's entry point.
+static void *
+_scan_main(void *);
+
+// Walks one segment, calling the scan's `fn` on every element that's in the list.
+static hopscotch_res_t
+_scan_segment(hopscotch_scan_worker_t *, size_t);
+
+// Gets a worker its next segment: its own, or else one stolen from another worker. `found` is false once there are none left.
+static hopscotch_res_t
+_scan_take(size_t *, bool *, hopscotch_scan_worker_t *);
+
+// `hopscotch_list_add_el` / `hopscotch_list_del_el` for a list with `opts->small.capacity`, whichever form it's in.
+static hopscotch_res_t
+_small_add_el(
+	bool *,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+static hopscotch_res_t
+_small_del_el(
+	bool *,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Turns a skip list back into an array, once its writers are out of the way. With `clear`, the elements are dropped instead.
+// The caller holds `small->lock`. `demoted` is false if the list is pinned, or has grown back in the meantime.
+static hopscotch_res_t
+_small_demote(bool *, hopscotch_list_t *, bool);
+
+// Lets a writer into the skip list, unless the list isn't one (or a demotion is under way). `_small_exit` lets it out again.
+static hopscotch_res_t
+_small_enter(bool *, hopscotch_list_t *);
+
+static hopscotch_res_t
+_small_exit(hopscotch_list_t *);
+
+// Binary search of the array as it was at `seq` (see `_small_read_begin`).
+// `pos` is where `val` is, or would go. If `valid` comes back false, a writer got in the way and the rest is meaningless.
+static hopscotch_res_t
+_small_find_el(
+	size_t *,
+	bool *,
+	bool *,
+	hopscotch_list_t *,
+	uint64_t,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Looks an element up in whichever form the list is in, and gets the list's copy of it if `found_val` isn't `NULL`.
+static hopscotch_res_t
+_small_lookup_el(
+	bool *,
+	hopscotch_byte_t **,
+	size_t *,
+	hopscotch_list_t *,
+	hopscotch_byte_t *,
+	size_t
+);
+
+// Makes a list a skip list for good, for the calls that hand out nodes or work on the skip list directly.
+// This does nothing for lists without `opts->small.capacity`.
+static hopscotch_res_t
+_small_pin(hopscotch_list_t *);
+
+// Moves the array's elements into a skip list (a new one, or the one the list was last demoted from, emptied).
+// The caller holds `small->lock`.
+static hopscotch_res_t
+_small_promote(hopscotch_list_t *);
+
+// An optimistic read of a small list starts by getting an even `seq` and which form the list is in, and is only good if `_small_read_end` says `seq` hasn't changed since.
+_ALWAYS_INLINE static inline hopscotch_res_t
+_small_read_begin(uint64_t *, bool *, hopscotch_list_t *);
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_small_read_end(bool *, hopscotch_list_t *, uint64_t);
+
+// Maps a whole shared memory segment, at exactly `base` if it isn't `NULL`.
+static hopscotch_res_t
+_shm_map(hopscotch_shm_t **, int, void *, size_t);
+
+static hopscotch_res_t
+_combining_post(
+	bool * done,
+	hopscotch_list_t * list,
+	bool del,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// Each thread starts looking where it found a free slot the last time, so that it usually gets one on the first try.
+	static _Thread_local uint32_t _hint = 0;
+	hopscotch_combining_slot_t * slot = NULL;
+	uint32_t _a;
+	for (_a = 0; _a < ((uint32_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS); _a++) {
+		uint32_t _idx = (_hint + _a) % ((uint32_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS);
+		uint32_t _expected = HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE;
+		if (atomic_compare_exchange_strong_explicit(
+			&(list->combining->slots[_idx].state),
+			&_expected,
+			HOPSCOTCH_VAL_LIST_COMBINING_SLOT_CLAIMED,
+			memory_order_acquire,
+			memory_order_relaxed
+		)) {
+			slot = &(list->combining->slots[_idx]);
+			_hint = _idx;
+			break;
+		}
+	}
+	// Every slot is taken, so the op is applied right here, like it would be without combining.
+	if (slot == NULL) {
+		if (del) {
+			return _list_del_el(done, NULL, list, val, val_size);
+		}
+		return _list_add_el(done, NULL, list, val, val_size);
+	}
+	// If a combiner misses the op because it looked before `slots_used` took the slot in, we'll get to be the combiner ourselves.
+	uint32_t _used = atomic_load_explicit(&(list->combining->slots_used), memory_order_relaxed);
+	while (
+		(_used < (_hint + 1)) &&
+		(! atomic_compare_exchange_weak_explicit(
+			&(list->combining->slots_used),
+			&_used,
+			_hint + 1,
+			memory_order_release,
+			memory_order_relaxed
+		))
+	) {
+	}
+	slot->del = del;
+	slot->val = val;
+	slot->val_size = val_size;
+	atomic_store_explicit(&(slot->state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_PENDING, memory_order_release);
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	while (atomic_load_explicit(&(slot->state), memory_order_acquire) != HOPSCOTCH_VAL_LIST_COMBINING_SLOT_DONE) {
+		// Whoever gets the lock applies every pending op, this one included.
+		if (pthread_mutex_trylock(&(list->combining->lock)) == 0) {
+			hopscotch_res_t _tmp_001 = _combining_run(list);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				res = _tmp_001;
+			}
+			int _tmp_002 = pthread_mutex_unlock(&(list->combining->lock));
+			if ((_tmp_002 != 0) && (res == HOPSCOTCH_RES__SUCCESS)) {
+				res = HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+		} else {
+			sched_yield();
+		}
+	}
+	done[0] = slot->done;
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		res = slot->res;
+	}
+	atomic_store_explicit(&(slot->state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE, memory_order_release);
+	return res;
+}
+
+static hopscotch_res_t
+_combining_run(hopscotch_list_t * list) {
+	hopscotch_combining_slot_t * batch[HOPSCOTCH_VAL_LIST_COMBINING_SLOTS];
+	// Whether an op's element is the same as the previous op's.
+	bool same[HOPSCOTCH_VAL_LIST_COMBINING_SLOTS];
+	hopscotch_node_t * finger_nodes[(int) list->opts->max_level];
+	int _pass;
+	for (_pass = 0; _pass < HOPSCOTCH_VAL_LIST_COMBINING_PASSES; _pass++) {
+		size_t count = 0;
+		size_t slots_used = (size_t) atomic_load_explicit(&(list->combining->slots_used), memory_order_acquire);
+		size_t _a;
+		for (_a = 0; _a < slots_used; _a++) {
+			if (atomic_load_explicit(&(list->combining->slots[_a].state), memory_order_acquire) == HOPSCOTCH_VAL_LIST_COMBINING_SLOT_PENDING) {
+				batch[count] = &(list->combining->slots[_a]);
+				count++;
+			}
+		}
+		if (count == 0) {
+			break;
+		}
+		// An insertion sort, since a batch is small. It's stable, so ops on the same element are applied in the order of their slots, which is as good an order as any for ops that are concurrent.
+		// If `cmp` fails, the ops are applied in whatever order they're in, each one searching from the head.
+		bool sorted = true;
+		size_t _b;
+		for (_b = 1; sorted && (_b < count); _b++) {
+			hopscotch_combining_slot_t * slot = batch[_b];
+			size_t _c = _b;
+			while (_c > 0) {
+				int _cmp_res_001;
+				hopscotch_res_t _tmp_001 = list->opts->cmp(
+					&_cmp_res_001,
+					batch[_c - 1]->val,
+					batch[_c - 1]->val_size,
+					slot->val,
+					slot->val_size
+				);
+				if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+					sorted = false;
+					break;
+				}
+				if (_cmp_res_001 <= 0) {
+					break;
+				}
+				batch[_c] = batch[_c - 1];
+				_c--;
+			}
+			batch[_c] = slot;
+		}
+		// The elements are compared before anything is applied, since a writer can let go of its element as soon as its op is done.
+		same[0] = false;
+		for (_b = 1; _b < count; _b++) {
+			int _cmp_res_002 = 1;
+			if (sorted) {
+				hopscotch_res_t _tmp_002 = list->opts->cmp(
+					&_cmp_res_002,
+					batch[_b - 1]->val,
+					batch[_b - 1]->val_size,
+					batch[_b]->val,
+					batch[_b]->val_size
+				);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					sorted = false;
+				}
+			}
+			same[_b] = (bool) (sorted && (_cmp_res_002 == 0));
+		}
+		for (_b = 0; _b < count; _b++) {
+			hopscotch_combining_slot_t * slot = batch[_b];
+			// An add leaves the new node itself in the finger, which is only a good start for bigger elements.
+			if ((_b == 0) || same[_b]) {
+				int16_t _level;
+				for (_level = 0; ((int) _level) < ((int) list->opts->max_level); _level++) {
+					finger_nodes[(int) _level] = list->head;
+				}
+			}
+			bool done = false;
+			hopscotch_res_t res;
+			if (slot->del) {
+				res = _list_del_el(&done, sorted ? finger_nodes : NULL, list, slot->val, slot->val_size);
+			} else {
+				res = _list_add_el(&done, sorted ? finger_nodes : NULL, list, slot->val, slot->val_size);
+			}
+			slot->done = done;
+			slot->res = res;
+			atomic_store_explicit(&(slot->state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_DONE, memory_order_release);
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_filter_add(hopscotch_filter_t * filter, uint64_t hash) {
+	uint16_t fingerprint;
+	size_t bucket_a;
+	size_t bucket_b;
+	_filter_locate(&fingerprint, &bucket_a, &bucket_b, filter, hash);
+	size_t _a;
+	// The easy case: there's an empty slot in one of the two candidate buckets.
+	for (_a = 0; _a < HOPSCOTCH_VAL_FILTER_BUCKET_SIZE; _a++) {
+		uint16_t * slot_a = &(filter->slots[(bucket_a * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _a]);
+		if (__atomic_load_n(slot_a, __ATOMIC_RELAXED) == 0) {
+			__atomic_store_n(slot_a, fingerprint, __ATOMIC_RELAXED);
+			filter->count++;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		uint16_t * slot_b = &(filter->slots[(bucket_b * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _a]);
+		if (__atomic_load_n(slot_b, __ATOMIC_RELAXED) == 0) {
+			__atomic_store_n(slot_b, fingerprint, __ATOMIC_RELAXED);
+			filter->count++;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	// Both buckets are full, so we have to kick fingerprints around.
+	// If the stash is taken too, the filter is full and can no longer answer negative lookups until it's rebuilt.
+	if (filter->victim.used) {
+		__atomic_store_n(&(filter->overflowed), true, __ATOMIC_RELEASE);
+		filter->count++;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// While fingerprints are being moved, one of them is briefly in neither of its buckets.
+	// An odd `seq` tells readers not to trust a negative answer.
+	// Everything up to the second bump is stored with release, so a reader that loaded any of it (with acquire) sees the first bump when it checks `seq` again.
+	uint64_t seq = filter->seq;
+	__atomic_store_n(&(filter->seq), seq + 1, __ATOMIC_RELAXED);
+	size_t bucket = ((hash >> 32) & 1) ? bucket_b : bucket_a;
+	uint64_t kick_state = hash | 1;
+	int _b;
+	for (_b = 0; _b < HOPSCOTCH_VAL_FILTER_MAX_KICKS; _b++) {
+		// Cheap xorshift to pick which slot to evict.
+		kick_state ^= kick_state << 13;
+		kick_state ^= kick_state >> 7;
+		kick_state ^= kick_state << 17;
+		uint16_t * slot = &(filter->slots[(bucket * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + (size_t) (kick_state % HOPSCOTCH_VAL_FILTER_BUCKET_SIZE)]);
+		uint16_t evicted = __atomic_load_n(slot, __ATOMIC_RELAXED);
+		__atomic_store_n(slot, fingerprint, __ATOMIC_RELEASE);
+		fingerprint = evicted;
+		bucket = (bucket ^ ((size_t) (((uint64_t) fingerprint) * 0x5bd1e995))) & filter->bucket_mask;
+		for (_a = 0; _a < HOPSCOTCH_VAL_FILTER_BUCKET_SIZE; _a++) {
+			slot = &(filter->slots[(bucket * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _a]);
+			if (__atomic_load_n(slot, __ATOMIC_RELAXED) == 0) {
+				__atomic_store_n(slot, fingerprint, __ATOMIC_RELEASE);
+				filter->count++;
+				__atomic_store_n(&(filter->seq), seq + 2, __ATOMIC_RELEASE);
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+		}
+	}
+	// Out of kicks, so stash the homeless fingerprint.
+	// Readers look at the stash without the lock.
+	__atomic_store_n(&(filter->victim.fingerprint), fingerprint, __ATOMIC_RELEASE);
+	__atomic_store_n(&(filter->victim.bucket), bucket, __ATOMIC_RELEASE);
+	__atomic_store_n(&(filter->victim.used), true, __ATOMIC_RELEASE);
+	filter->count++;
+	__atomic_store_n(&(filter->seq), seq + 2, __ATOMIC_RELEASE);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_filter_contains(bool * maybe, hopscotch_filter_t * filter, uint64_t hash) {
+	if (__atomic_load_n(&(filter->overflowed), __ATOMIC_ACQUIRE)) {
+		maybe[0] = true;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	uint16_t fingerprint;
+	size_t bucket_a;
+	size_t bucket_b;
+	_filter_locate(&fingerprint, &bucket_a, &bucket_b, filter, hash);
+	while (true) {
+		uint64_t seq_a = __atomic_load_n(&(filter->seq), __ATOMIC_ACQUIRE);
+		if ((seq_a & 1) != 0) {
+			// A writer is moving fingerprints around.
+			continue;
+		}
+		size_t _a;
+		for (_a = 0; _a < HOPSCOTCH_VAL_FILTER_BUCKET_SIZE; _a++) {
+			if (
+				(__atomic_load_n(&(filter->slots[(bucket_a * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _a]), __ATOMIC_ACQUIRE) == fingerprint) ||
+				(__atomic_load_n(&(filter->slots[(bucket_b * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _a]), __ATOMIC_ACQUIRE) == fingerprint)
+			) {
+				// A positive answer is always safe to return, even if a writer got in the way.
+				maybe[0] = true;
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+		}
+		if (
+			__atomic_load_n(&(filter->victim.used), __ATOMIC_ACQUIRE) &&
+			(__atomic_load_n(&(filter->victim.fingerprint), __ATOMIC_ACQUIRE) == fingerprint) &&
+			(
+				(__atomic_load_n(&(filter->victim.bucket), __ATOMIC_ACQUIRE) == bucket_a) ||
+				(__atomic_load_n(&(filter->victim.bucket), __ATOMIC_ACQUIRE) == bucket_b)
+			)
+		) {
+			maybe[0] = true;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// A negative answer is only safe if no fingerprints moved while we were looking.
+		uint64_t seq_b = __atomic_load_n(&(filter->seq), __ATOMIC_ACQUIRE);
+		if (seq_a == seq_b) {
+			maybe[0] = false;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+}
+
+static hopscotch_res_t
+_filter_del(hopscotch_filter_t * filter, uint64_t hash) {
+	uint16_t fingerprint;
+	size_t bucket_a;
+	size_t bucket_b;
+	_filter_locate(&fingerprint, &bucket_a, &bucket_b, filter, hash);
+	size_t bucket = bucket_a;
+	int _a;
+	for (_a = 0; _a < 2; _a++, bucket = bucket_b) {
+		size_t _b;
+		for (_b = 0; _b < HOPSCOTCH_VAL_FILTER_BUCKET_SIZE; _b++) {
+			uint16_t * slot = &(filter->slots[(bucket * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + _b]);
+			if (__atomic_load_n(slot, __ATOMIC_RELAXED) != fingerprint) {
+				continue;
+			}
+			// A reader that misses the fingerprint from now on is fine, since its element is being deleted.
+			__atomic_store_n(slot, (uint16_t) 0, __ATOMIC_RELAXED);
+			filter->count--;
+			// If there's a stashed fingerprint that belongs in this bucket, give it the free slot.
+			// It's copied before it's unstashed, so readers never miss it.
+			if (
+				filter->victim.used &&
+				(
+					(filter->victim.bucket == bucket) ||
+					(((filter->victim.bucket ^ ((size_t) (((uint64_t) filter->victim.fingerprint) * 0x5bd1e995))) & filter->bucket_mask) == bucket)
+				)
+			) {
+				__atomic_store_n(slot, filter->victim.fingerprint, __ATOMIC_RELAXED);
+				__atomic_store_n(&(filter->victim.used), false, __ATOMIC_RELEASE);
+			}
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	if (
+		filter->victim.used &&
+		(filter->victim.fingerprint == fingerprint) &&
+		(
+			(filter->victim.bucket == bucket_a) ||
+			(filter->victim.bucket == bucket_b)
+		)
+	) {
+		__atomic_store_n(&(filter->victim.used), false, __ATOMIC_RELEASE);
+		filter->count--;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_filter_locate(
+	uint16_t * fingerprint,
+	size_t * bucket_a,
+	size_t * bucket_b,
+	hopscotch_filter_t * filter,
+	uint64_t hash
+) {
+	// `0` marks an empty slot, so it can't be a fingerprint.
+	uint16_t _fingerprint = (uint16_t) (hash >> 48);
+	if (_fingerprint == 0) {
+		_fingerprint = 1;
+	}
+	fingerprint[0] = _fingerprint;
+	bucket_a[0] = ((size_t) hash) & filter->bucket_mask;
+	// Partial-key cuckoo hashing: the alternate bucket is derived from the fingerprint alone, so it can be found again while kicking.
+	bucket_b[0] = (bucket_a[0] ^ ((size_t) (((uint64_t) _fingerprint) * 0x5bd1e995))) & filter->bucket_mask;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_filter_new(hopscotch_filter_t ** filter, hopscotch_opts_t * opts, size_t capacity) {
+	// Size the filter so that it's at most ~80% full at `capacity` elements.
+	size_t buckets_wanted = ((capacity + (capacity / 4)) / HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) + 1;
+	size_t bucket_count = 1;
+	while (bucket_count < buckets_wanted) {
+		bucket_count <<= 1;
+	}
+	hopscotch_filter_t * _filter = _MALLOC(opts->gc.malloc, hopscotch_filter_t, ((size_t) 1));
+	if (_filter == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_filter->slots = _MALLOC(opts->gc.malloc, uint16_t, (bucket_count * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE));
+	if (_filter->slots == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memset((void *) _filter->slots, 0, (size_t) (sizeof(uint16_t) * bucket_count * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE));
+	_filter->bucket_mask = bucket_count - 1;
+	_filter->count = 0;
+	_filter->seq = 0;
+	_filter->overflowed = false;
+	_filter->victim.used = false;
+	_filter->stats.negatives = 0;
+	_filter->stats.false_positives = 0;
+	// Set the result.
+	filter[0] = _filter;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_filter_note(hopscotch_filter_t * filter, uint64_t hash, bool false_positive) {
+	// Sampling keeps the stats counters from becoming a contention point.
+	if (((hash >> 24) % HOPSCOTCH_VAL_FILTER_STATS_SAMPLE_RATE) != 0) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	if (false_positive) {
+		__atomic_fetch_add(&(filter->stats.false_positives), (uint64_t) 1, __ATOMIC_RELAXED);
+	} else {
+		__atomic_fetch_add(&(filter->stats.negatives), (uint64_t) 1, __ATOMIC_RELAXED);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_frozen_el(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_frozen_t * frozen,
+	uint64_t rank
+) {
+	if (rank >= (uint64_t) frozen->count) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	uint64_t start = frozen->offsets[rank];
+	uint64_t end = frozen->offsets[rank + 1];
+	if ((start > end) || (end > (uint64_t) frozen->vals_size)) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	// Set the result.
+	val[0] = frozen->vals + start;
+	val_size[0] = (size_t) (end - start);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_frozen_find(
+	size_t * rank,
+	hopscotch_frozen_t * frozen,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// Every element starts with the same `prefix_skip` bytes (the first element's), so `val` either does too or comes before or after all of them.
+	size_t skip = (size_t) frozen->header->prefix_skip;
+	if (skip > 0) {
+		hopscotch_byte_t * first_val;
+		size_t first_val_size;
+		hopscotch_res_t _tmp_003 = _frozen_el(&first_val, &first_val_size, frozen, (uint64_t) 0);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+		if (first_val_size < skip) {
+			return HOPSCOTCH_RES_FROZEN_INVALID;
+		}
+		int skip_cmp_res = memcmp((void *) val, (void *) first_val, (val_size < skip) ? val_size : skip);
+		if ((skip_cmp_res != 0) || (val_size < skip)) {
+			// Set the result.
+			rank[0] = ((skip_cmp_res > 0) ? frozen->count : 0);
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	uint64_t prefix;
+	_frozen_prefix(&prefix, val + skip, val_size - skip);
+	bool custom_cmp = (bool) (frozen->header->custom_cmp != 0);
+	uint64_t * prefixes = frozen->prefixes;
+	size_t count = frozen->count;
+	size_t k = 1;
+	while (k <= count) {
+		// Prefetching doesn't fault, so this doesn't have to stop at the end of the array.
+		__builtin_prefetch((void *) (prefixes + (k << HOPSCOTCH_VAL_FROZEN_PREFETCH_LEVELS)));
+		uint64_t k_prefix = prefixes[k];
+		// The descent only depends on whether the element at `k` is less than `val`, which the compiler can turn into a conditional move.
+		// Elements only have to be compared when the prefixes can't tell them apart.
+		size_t less = (size_t) (k_prefix < prefix);
+		if (custom_cmp || (k_prefix == prefix)) {
+			hopscotch_byte_t * k_val;
+			size_t k_val_size;
+			hopscotch_res_t _tmp_001 = _frozen_el(&k_val, &k_val_size, frozen, frozen->ranks[k]);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			int cmp_res;
+			hopscotch_res_t _tmp_002 = custom_cmp ? frozen->opts->cmp(
+				&cmp_res,
+				k_val,
+				k_val_size,
+				val,
+				val_size
+			) : _lsm_val_cmp(
+				&cmp_res,
+				k_val,
+				k_val_size,
+				val,
+				val_size
+			);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+			less = (size_t) (cmp_res < 0);
+		}
+		k = (2 * k) + less;
+	}
+	// The element we're after is where the descent last went left, so drop the right turns after that, and then that one.
+	k >>= __builtin_ffsll((long long) (~k));
+	// Set the result.
+	rank[0] = (k == 0) ? count : (size_t) frozen->ranks[k];
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_frozen_layout(hopscotch_frozen_header_t * header, size_t count, size_t vals_size) {
+	uint64_t array_size = (uint64_t) (sizeof(uint64_t) * (count + 1));
+	header->magic = HOPSCOTCH_VAL_FROZEN_MAGIC;
+	header->count = (uint64_t) count;
+	header->prefixes_offset = (uint64_t) (
+		(sizeof(hopscotch_frozen_header_t) + (HOPSCOTCH_VAL_FROZEN_ALIGNMENT - 1)) & (~((size_t) (HOPSCOTCH_VAL_FROZEN_ALIGNMENT - 1)))
+	);
+	header->ranks_offset = header->prefixes_offset + array_size;
+	header->offsets_offset = header->ranks_offset + array_size;
+	header->vals_offset = header->offsets_offset + array_size;
+	header->size = header->vals_offset + (uint64_t) vals_size;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_frozen_new(
+	hopscotch_frozen_t ** frozen,
+	hopscotch_opts_t * opts,
+	hopscotch_byte_t * data,
+	size_t size,
+	bool mapped
+) {
+	if (size < sizeof(hopscotch_frozen_header_t)) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	hopscotch_frozen_header_t * header = (hopscotch_frozen_header_t *) data;
+	// The layout only depends on the count and the size of the elements, so it has to be exactly the one they make.
+	// The count is checked first, so that working out the layout can't overflow.
+	if (header->count > (uint64_t) (size / (sizeof(uint64_t) * 3))) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	hopscotch_frozen_header_t layout;
+	_frozen_layout(&layout, (size_t) header->count, (size_t) 0);
+	if (layout.vals_offset > (uint64_t) size) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	_frozen_layout(&layout, (size_t) header->count, size - ((size_t) layout.vals_offset));
+	if (
+		(header->magic != layout.magic) ||
+		(header->prefixes_offset != layout.prefixes_offset) ||
+		(header->ranks_offset != layout.ranks_offset) ||
+		(header->offsets_offset != layout.offsets_offset) ||
+		(header->vals_offset != layout.vals_offset) ||
+		(header->size != layout.size)
+	) {
+		return HOPSCOTCH_RES_FROZEN_INVALID;
+	}
+	hopscotch_frozen_t * _frozen = _MALLOC(opts->gc.malloc, hopscotch_frozen_t, ((size_t) 1));
+	if (_frozen == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_frozen->opts = opts;
+	_frozen->data = data;
+	_frozen->size = size;
+	_frozen->mapped = mapped;
+	_frozen->header = header;
+	_frozen->count = (size_t) header->count;
+	_frozen->prefixes = (uint64_t *) (data + header->prefixes_offset);
+	_frozen->ranks = (uint64_t *) (data + header->ranks_offset);
+	_frozen->offsets = (uint64_t *) (data + header->offsets_offset);
+	_frozen->vals = data + header->vals_offset;
+	_frozen->vals_size = size - ((size_t) header->vals_offset);
+	// Set the result.
+	frozen[0] = _frozen;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_frozen_prefix(uint64_t * prefix, hopscotch_byte_t * val, size_t val_size) {
+	uint64_t _prefix = 0;
+	size_t i;
+	for (i = 0; i < sizeof(uint64_t); i++) {
+		_prefix = (_prefix << 8) | ((uint64_t) ((i < val_size) ? val[i] : 0));
+	}
+	// Set the result.
+	prefix[0] = _prefix;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_add(hopscotch_index_t * index, hopscotch_opts_t * opts, hopscotch_node_t * node, uint64_t hash) {
+	hopscotch_index_entry_t * entry;
+	hopscotch_res_t _tmp_001 = _index_new_entry(&entry, opts, node, hash);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	return _index_add_entry(index, entry);
+}
+
+static hopscotch_res_t
+_index_add_entry(hopscotch_index_t * index, hopscotch_index_entry_t * entry) {
+	uint64_t hash = entry->hash;
+	pthread_mutex_t * stripe = &(index->stripes[((size_t) hash) & (HOPSCOTCH_VAL_INDEX_STRIPES - 1)]);
+	int _tmp_001 = pthread_mutex_lock(stripe);
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// New entries always go into the newest table.
+	// If a resize swaps the table right after we load it, migrating our bucket still has to wait for our stripe, so the entry isn't lost.
+	hopscotch_index_table_t * table = __atomic_load_n(&(index->table), __ATOMIC_ACQUIRE);
+	hopscotch_index_entry_t ** bucket = &(table->buckets[((size_t) hash) & table->mask]);
+	entry->next = bucket[0];
+	__atomic_store_n(bucket, entry, __ATOMIC_RELEASE);
+	int _tmp_002 = pthread_mutex_unlock(stripe);
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	__atomic_fetch_add(&(index->count), (size_t) 1, __ATOMIC_RELAXED);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_del(hopscotch_index_t * index, hopscotch_node_t * node, uint64_t hash) {
+	pthread_mutex_t * stripe = &(index->stripes[((size_t) hash) & (HOPSCOTCH_VAL_INDEX_STRIPES - 1)]);
+	int _tmp_001 = pthread_mutex_lock(stripe);
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// During a resize the node can be in both tables.
+	hopscotch_index_table_t * table;
+	for (table = __atomic_load_n(&(index->table), __ATOMIC_ACQUIRE); table != NULL; table = table->old) {
+		hopscotch_index_entry_t ** link = &(table->buckets[((size_t) hash) & table->mask]);
+		while (link[0] != NULL) {
+			if (link[0]->node == node) {
+				// Lock-free readers sitting on the entry can still follow its `next`.
+				__atomic_store_n(link, link[0]->next, __ATOMIC_RELEASE);
+				break;
+			}
+			link = &(link[0]->next);
+		}
+	}
+	int _tmp_002 = pthread_mutex_unlock(stripe);
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	__atomic_fetch_sub(&(index->count), (size_t) 1, __ATOMIC_RELAXED);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_find(
+	hopscotch_node_t ** node,
+	hopscotch_index_t * index,
+	hopscotch_opts_t * opts,
+	uint64_t hash,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_index_table_t * table;
+	for (table = __atomic_load_n(&(index->table), __ATOMIC_ACQUIRE); table != NULL; table = table->old) {
+		hopscotch_index_entry_t * entry = __atomic_load_n(&(table->buckets[((size_t) hash) & table->mask]), __ATOMIC_ACQUIRE);
+		for (; entry != NULL; entry = __atomic_load_n(&(entry->next), __ATOMIC_ACQUIRE)) {
+			if (entry->hash != hash) {
+				continue;
+			}
+			hopscotch_node_t * _node = entry->node;
+			// Same check as `hopscotch_list_contains_el`.
+			// A stale entry for a deleted node doesn't end the search, since the element could have been re-added.
+			bool visible;
+			_list_el_visible(&visible, _node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+			if (! visible) {
+				continue;
+			}
+			int _cmp_res_001;
+			hopscotch_res_t _tmp_001 = _list_cmp_el(
+				&_cmp_res_001,
+				NULL,
+				opts,
+				_node,
+				NULL,
+				NULL,
+				val,
+				val_size
+			);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (_cmp_res_001 == 0) {
+				node[0] = _node;
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+		}
+	}
+	node[0] = NULL;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_maintain(hopscotch_index_t * index, hopscotch_opts_t * opts) {
+	hopscotch_index_table_t * table = __atomic_load_n(&(index->table), __ATOMIC_ACQUIRE);
+	if (table->old == NULL) {
+		// Start a resize once there's more than 1 element per bucket.
+		if (__atomic_load_n(&(index->count), __ATOMIC_RELAXED) <= (table->mask + 1)) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// Somebody else is already on it.
+		if (pthread_mutex_trylock(&(index->resize_lock)) != 0) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		table = __atomic_load_n(&(index->table), __ATOMIC_ACQUIRE);
+		if (table->old == NULL) {
+			hopscotch_index_table_t * new_table = NULL;
+			hopscotch_res_t _tmp_001 = _index_table_new(&new_table, opts, (table->mask + 1) * 2, table);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				pthread_mutex_unlock(&(index->resize_lock));
+				return _tmp_001;
+			}
+			__atomic_store_n(&(index->table), new_table, __ATOMIC_RELEASE);
+		}
+		int _tmp_002 = pthread_mutex_unlock(&(index->resize_lock));
+		if (_tmp_002 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// Migrate a few buckets.
+	hopscotch_index_table_t * old_table = table->old;
+	int _a;
+	for (_a = 0; _a < HOPSCOTCH_VAL_INDEX_MIGRATE_STEP; _a++) {
+		size_t bucket = __atomic_fetch_add(&(table->migrate_next), (size_t) 1, __ATOMIC_RELAXED);
+		if (bucket > old_table->mask) {
+			break;
+		}
+		// Both tables have at least `HOPSCOTCH_VAL_INDEX_STRIPES` buckets, so everything in `bucket` maps to the same stripe in both.
+		pthread_mutex_t * stripe = &(index->stripes[bucket & (HOPSCOTCH_VAL_INDEX_STRIPES - 1)]);
+		int _tmp_003 = pthread_mutex_lock(stripe);
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		hopscotch_index_entry_t * entry;
+		for (entry = old_table->buckets[bucket]; entry != NULL; entry = entry->next) {
+			hopscotch_index_entry_t * copy = _MALLOC(opts->gc.malloc, hopscotch_index_entry_t, ((size_t) 1));
+			if (copy == NULL) {
+				pthread_mutex_unlock(stripe);
+				return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+			}
+			copy->hash = entry->hash;
+			copy->node = entry->node;
+			hopscotch_index_entry_t ** new_bucket = &(table->buckets[((size_t) entry->hash) & table->mask]);
+			copy->next = new_bucket[0];
+			__atomic_store_n(new_bucket, copy, __ATOMIC_RELEASE);
+		}
+		int _tmp_004 = pthread_mutex_unlock(stripe);
+		if (_tmp_004 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		if ((__atomic_add_fetch(&(table->migrated), (size_t) 1, __ATOMIC_ACQ_REL)) == (old_table->mask + 1)) {
+			// Everything's been copied over, so drop the old table.
+			hopscotch_index_table_t * final_table = NULL;
+			hopscotch_res_t _tmp_005 = _index_table_new(&final_table, opts, (size_t) 0, NULL);
+			if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_005;
+			}
+			final_table->buckets = table->buckets;
+			final_table->mask = table->mask;
+			__atomic_store_n(&(index->table), final_table, __ATOMIC_RELEASE);
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_new(hopscotch_index_t ** index, hopscotch_opts_t * opts, size_t capacity) {
+	hopscotch_index_t * _index = _MALLOC(opts->gc.malloc, hopscotch_index_t, ((size_t) 1));
+	if (_index == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	size_t bucket_count = HOPSCOTCH_VAL_INDEX_STRIPES;
+	while (bucket_count < capacity) {
+		bucket_count <<= 1;
+	}
+	_index->table = NULL;
+	hopscotch_res_t _tmp_001 = _index_table_new(&(_index->table), opts, bucket_count, NULL);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	_index->count = 0;
+	int _tmp_002 = pthread_mutex_init(&(_index->resize_lock), NULL);
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	}
+	int _a;
+	for (_a = 0; _a < HOPSCOTCH_VAL_INDEX_STRIPES; _a++) {
+		int _tmp_003 = pthread_mutex_init(&(_index->stripes[_a]), NULL);
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+	}
+	// Set the result.
+	index[0] = _index;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_new_entry(hopscotch_index_entry_t ** entry, hopscotch_opts_t * opts, hopscotch_node_t * node, uint64_t hash) {
+	hopscotch_index_entry_t * _entry = _MALLOC(opts->gc.malloc, hopscotch_index_entry_t, ((size_t) 1));
+	if (_entry == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_entry->hash = hash;
+	_entry->node = node;
+	entry[0] = _entry;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_index_table_new(
+	hopscotch_index_table_t ** table,
+	hopscotch_opts_t * opts,
+	size_t bucket_count,
+	hopscotch_index_table_t * old_table
+) {
+	hopscotch_index_table_t * _table = _MALLOC(opts->gc.malloc, hopscotch_index_table_t, ((size_t) 1));
+	if (_table == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_table->buckets = NULL;
+	_table->mask = 0;
+	// A `bucket_count` of `0` means the caller will fill in the buckets itself.
+	if (bucket_count > 0) {
+		_table->buckets = _MALLOC(opts->gc.malloc, hopscotch_index_entry_t *, bucket_count);
+		if (_table->buckets == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		memset((void *) _table->buckets, 0, (size_t) (sizeof(hopscotch_index_entry_t *) * bucket_count));
+		_table->mask = bucket_count - 1;
+	}
+	_table->old = old_table;
+	_table->migrate_next = 0;
+	_table->migrated = 0;
+	// Set the result.
+	table[0] = _table;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_adapt(hopscotch_list_t * list) {
+	uint64_t samples = __atomic_load_n(&(list->adaptive->samples), __ATOMIC_RELAXED);
+	// Every level has about `rand_level_p` times as many nodes as the one below, so the highest level with enough of them to go by gives a fair estimate of the list's size.
+	// Raised towers make it a little high, which only makes raising a little keener.
+	double scale = 1.0;
+	int16_t _level;
+	for (_level = 1; ((int) _level) < ((int) list->opts->max_level); _level++) {
+		scale /= list->opts->rand_level_p;
+	}
+	double n = 0.0;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		size_t count = 0;
+		hopscotch_node_t * node = atomic_load_explicit(&(list->head->forward[(int) _level]), memory_order_acquire);
+		while (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL) {
+			count++;
+			node = atomic_load_explicit(&(node->forward[(int) _level]), memory_order_acquire);
+		}
+		n = ((double) count) * scale;
+		if (count >= HOPSCOTCH_VAL_LIST_ADAPTIVE_ESTIMATE_NODES) {
+			break;
+		}
+		scale *= list->opts->rand_level_p;
+	}
+	hopscotch_node_t * node = atomic_exchange_explicit(&(list->adaptive->hot), NULL, memory_order_acquire);
+	while (node != NULL) {
+		hopscotch_node_t * next_node = node->adaptive->hot_next;
+		// The node is off the stack now, so the lookup that takes its hits back up to `HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS` can push it again.
+		uint32_t hits = __atomic_exchange_n(&(node->adaptive->hits), (uint32_t) 0, __ATOMIC_RELEASE);
+		hopscotch_res_t _tmp_001 = _list_adapt_el(list, node, hits, samples, n);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		node = next_node;
+	}
+	// Raised nodes that haven't been hot since they were last looked at are looked at again once there's been enough lookups to tell whether they've cooled down.
+	// The ones that are back at their random level (or gone) are dropped.
+	size_t i = list->adaptive->raised_count;
+	while (i > 0) {
+		i--;
+		node = list->adaptive->raised[i];
+		uint64_t since = __atomic_load_n(&(node->adaptive->since), __ATOMIC_RELAXED);
+		if (
+			node->adaptive->raised &&
+			(since < samples) &&
+			(((double) (samples - since)) >= (n * HOPSCOTCH_VAL_LIST_ADAPTIVE_WINDOW))
+		) {
+			// A node that's got as far as `HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS` is (or is about to be) on the stack, and resetting its hits then would let it be pushed twice, so it's left for the next pass.
+			uint32_t hits = __atomic_load_n(&(node->adaptive->hits), __ATOMIC_RELAXED);
+			while (
+				(hits < HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS) &&
+				(! __atomic_compare_exchange_n(&(node->adaptive->hits), &hits, (uint32_t) 0, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			);
+			if (hits < HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS) {
+				hopscotch_res_t _tmp_002 = _list_adapt_el(list, node, hits, samples, n);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_002;
+				}
+			}
+		}
+		if (! node->adaptive->raised) {
+			list->adaptive->raised_count--;
+			list->adaptive->raised[i] = list->adaptive->raised[list->adaptive->raised_count];
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_adapt_el(hopscotch_list_t * list, hopscotch_node_t * node, uint32_t hits, uint64_t samples, double n) {
+	uint64_t since = __atomic_exchange_n(&(node->adaptive->since), samples, __ATOMIC_RELAXED);
+	// How many times as often as the average element this one was looked up, and the level that 1 in that many random towers reach.
+	double heat = (since < samples) ? ((((double) hits) * n) / ((double) (samples - since))) : 0.0;
+	int16_t level = 0;
+	double reach = 1.0 / list->opts->rand_level_p;
+	while ((((int) level) < (((int) list->opts->max_level) - 1)) && (heat >= reach)) {
+		level++;
+		reach /= list->opts->rand_level_p;
+	}
+	// Cold towers only go back down to their random level, which keeps the list balanced for everything else.
+	if (((int) level) < ((int) node->target_level)) {
+		level = (int16_t) node->target_level;
+	}
+	int16_t node_level = (int16_t) atomic_load_explicit(&(node->level), memory_order_acquire);
+	bool gone = atomic_load_explicit(&(node->marked), memory_order_acquire);
+	if ((! gone) && (level != node_level) && ((level > node_level) || node->adaptive->raised)) {
+		hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+		hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+		hopscotch_byte_t * val;
+		size_t val_size;
+		hopscotch_res_t _tmp_001 = _list_el_val(&val, &val_size, list, node);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_002 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			val,
+			val_size
+		);
+		if (
+			(_tmp_002 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_002 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			return _tmp_002;
+		}
+		// A node that's been deleted, or moved to another list, is left alone.
+		gone = (bool) (
+			(_tmp_002 == HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) ||
+			(succ_nodes[(int) _level_found] != node)
+		);
+		int16_t _level;
+		if ((! gone) && (level > node_level)) {
+			// Bottom-up, like `_list_maintain`.
+			for (_level = node_level + 1; ((int) _level) <= ((int) level); _level++) {
+				bool raised;
+				hopscotch_res_t _tmp_003 = _list_raise_el(&raised, list, pred_nodes[(int) _level], node, (uint8_t) _level, val, val_size);
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+				if (! raised) {
+					// Someone changed the neighbourhood; the node gets another go when it's hot again.
+					break;
+				}
+			}
+		} else if (! gone) {
+			// Top-down, so the tower never has a gap in it.
+			for (_level = node_level; ((int) _level) > ((int) level); _level--) {
+				bool lowered;
+				hopscotch_res_t _tmp_004 = _list_lower_el(&lowered, list, pred_nodes[(int) _level], node, (uint8_t) _level);
+				if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_004;
+				}
+				if (! lowered) {
+					break;
+				}
+			}
+		}
+	}
+	bool raised = (bool) (
+		(! gone) &&
+		(((int) atomic_load_explicit(&(node->level), memory_order_acquire)) > ((int) node->target_level))
+	);
+	if (raised && (! node->adaptive->raised)) {
+		if (list->adaptive->raised_count == list->adaptive->raised_capacity) {
+			size_t capacity = (list->adaptive->raised_capacity == 0) ? ((size_t) 64) : (list->adaptive->raised_capacity * 2);
+			hopscotch_node_t ** _raised = _MALLOC(list->opts->gc.malloc, hopscotch_node_t *, capacity);
+			if (_raised == NULL) {
+				return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+			}
+			if (list->adaptive->raised_count > 0) {
+				memcpy((void *) _raised, (void *) list->adaptive->raised, sizeof(hopscotch_node_t *) * list->adaptive->raised_count);
+			}
+			list->adaptive->raised = _raised;
+			list->adaptive->raised_capacity = capacity;
+		}
+		list->adaptive->raised[list->adaptive->raised_count++] = node;
+	}
+	node->adaptive->raised = raised;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_add_el(
+	bool * added,
+	hopscotch_node_t ** finger_nodes,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	uint8_t _top_level;
+	hopscotch_res_t _tmp_010 = _list_rand_level(&_top_level, list);
+	if (_tmp_010 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_010;
+	}
+	int16_t target_level = (int16_t) _top_level;
+	// In lazy mode only level 0 is linked now, so there's a single predecessor to lock.
+	// The maintenance thread raises the rest of the tower later.
+	int16_t top_level = list->opts->towers.lazy ? ((int16_t) 0) : target_level;
+	// Hash up front, so that the filter and index updates inside the critical section are cheap.
+	uint64_t hash;
+	hopscotch_res_t _tmp_007 = list->opts->hash(&hash, val, val_size);
+	if (_tmp_007 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_007;
+	}
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_008 = _index_maintain(list->index, list->opts);
+		if (_tmp_008 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_008;
+		}
+	}
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	// The new node (and its index entry) are only set up once the element turns out to be missing, and then reused if validation fails.
+	// This keeps allocation (and whatever collection it triggers) out of the critical section.
+	hopscotch_node_t * new_node = NULL;
+	hopscotch_index_entry_t * index_entry = NULL;
+	// Only the first search starts from the finger; if validation fails, the finger is probably stale.
+	hopscotch_node_t ** start_nodes = finger_nodes;
+	// The same goes for the tail pointers.
+	bool try_tail = (bool) ((finger_nodes == NULL) && (list->append.tails != NULL));
+	while (true) {
+		bool at_tail = false;
+		if (try_tail) {
+			try_tail = false;
+			hopscotch_res_t _tmp_017 = _list_find_tail(
+				&at_tail,
+				pred_nodes,
+				succ_nodes,
+				list,
+				(uint8_t) top_level,
+				val,
+				val_size
+			);
+			if (_tmp_017 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_017;
+			}
+		}
+		uint8_t _level_found = 0;
+		hopscotch_res_t _tmp_001 = at_tail ? HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND : _list_find_el_from(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			start_nodes,
+			val,
+			val_size
+		);
+		int16_t level_found = (int16_t) _level_found;
+		if (_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) {
+			hopscotch_node_t * node_found = succ_nodes[(int) level_found];
+			if (! atomic_load_explicit(&(node_found->marked), memory_order_acquire)) {
+				while (! atomic_load_explicit(&(node_found->fully_linked), memory_order_acquire)) {
+					// In shared memory, the adder may have died.
+					// Its lock on the node's predecessor settles it: we get the lock once the add is done, or repaired (see `_list_lock_el`).
+					if (list->shm != NULL) {
+						hopscotch_res_t _tmp_011 = _list_lock_el(list, pred_nodes[(int) level_found]);
+						if (_tmp_011 != HOPSCOTCH_RES__SUCCESS) {
+							return _tmp_011;
+						}
+						int _tmp_012 = pthread_mutex_unlock(&(pred_nodes[(int) level_found]->lock));
+						if (_tmp_012 != 0) {
+							return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+						}
+					}
+				}
+				added[0] = false;
+				// In a versioned list, a deleted element keeps its node until no snapshot can see it, so adding it back is a new version range on the same node.
+				if (
+					list->opts->versions.enabled &&
+					(atomic_load_explicit(&(node_found->versions->del), memory_order_acquire) != HOPSCOTCH_VAL_LIST_VERSION_NONE)
+				) {
+					hopscotch_res_t _tmp_015 = _list_revive_el(added, list, node_found);
+					if (_tmp_015 != HOPSCOTCH_RES__SUCCESS) {
+						return _tmp_015;
+					}
+					if (! added[0]) {
+						start_nodes = NULL;
+						continue;
+					}
+				}
+				if (finger_nodes != NULL) {
+					memcpy((void *) finger_nodes, (void *) pred_nodes, (size_t) (sizeof(hopscotch_node_t *) * list->opts->max_level));
+				}
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+			// The same goes for a deleter, which holds the marked node's lock until the node is unlinked.
+			if (list->shm != NULL) {
+				hopscotch_res_t _tmp_013 = _list_lock_el(list, node_found);
+				if (_tmp_013 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_013;
+				}
+				int _tmp_014 = pthread_mutex_unlock(&(node_found->lock));
+				if (_tmp_014 != 0) {
+					return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+				}
+			}
+			// An unlinked finger keeps pointing at the marked node, so retry from the head.
+			start_nodes = NULL;
+			continue;
+		}
+		if (new_node == NULL) {
+			hopscotch_res_t _tmp_003 = _list_new_el(
+				&new_node,
+				list,
+				val,
+				val_size,
+				(uint8_t) top_level,
+				(uint8_t) target_level,
+				pred_nodes[0]
+			);
+			if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_003;
+			}
+			// Snapshots don't see the node until it's stamped.
+			if (list->opts->versions.enabled) {
+				atomic_store_explicit(&(new_node->versions->add), HOPSCOTCH_VAL_LIST_VERSION_NONE, memory_order_relaxed);
+			}
+			if (list->index != NULL) {
+				hopscotch_res_t _tmp_004 = _index_new_entry(&index_entry, list->opts, new_node, hash);
+				if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_004;
+				}
+			}
+		}
+		int16_t highest_level_locked = -1;
+		hopscotch_node_t * pred_node;
+		hopscotch_node_t * succ_node;
+		hopscotch_node_t * prev_pred_node = NULL;
+		bool valid = true;
+		int16_t _level;
+		for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
+			pred_node = pred_nodes[(int) _level];
+			succ_node = succ_nodes[(int) _level];
+			if (pred_node != prev_pred_node) {
+				hopscotch_res_t _tmp_002 = _list_lock_el(list, pred_node);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					// Nothing is linked yet, so letting go of the locks we already have is all the rollback there is.
+					_list_unlock_preds(pred_nodes, highest_level_locked);
+					return _tmp_002;
+				}
+				highest_level_locked = _level;
+				prev_pred_node = pred_node;
+			}
+			if (
+				(! atomic_load_explicit(&(pred_node->marked), memory_order_acquire)) &&
+				(! atomic_load_explicit(&(succ_node->marked), memory_order_acquire)) &&
+				// A node whose tower was lowered (see `opts->towers.adaptive`) still points forward on the levels it left.
+				(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) >= ((int) _level)) &&
+				(atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire) == succ_node)
+			) {
+				valid = true;
+			} else {
+				valid = false;
+			}
+		}
+		if (! valid) {
+			hopscotch_res_t _tmp_005 = _list_unlock_preds(pred_nodes, highest_level_locked);
+			if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_005;
+			}
+			start_nodes = NULL;
+			continue;
+		}
+		// Index lookups skip nodes that aren't fully linked, so the entry can go in before the node is linked, while a failure can still be undone.
+		if (index_entry != NULL) {
+			hopscotch_res_t _tmp_006 = _index_add_entry(list->index, index_entry);
+			if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+				_list_unlock_preds(pred_nodes, highest_level_locked);
+				return _tmp_006;
+			}
+		}
+		int16_t _a;
+		for (_a = 0; ((int) _a) <= ((int) top_level); _a++) {
+			atomic_store_explicit(&(new_node->forward[(int) _a]), succ_nodes[(int) _a], memory_order_relaxed);
+			if (_a == 0) {
+				// Seq-cst for `_list_filter_add`.
+				atomic_store_explicit(&(pred_nodes[(int) _a]->forward[(int) _a]), new_node, memory_order_seq_cst);
+			} else {
+				atomic_store_explicit(&(pred_nodes[(int) _a]->forward[(int) _a]), new_node, memory_order_release);
+			}
+		}
+		_list_link_back(list, new_node, pred_nodes[0]);
+		_list_link_back(list, succ_nodes[0], new_node);
+		// The new node is the last one on every level where its successor is the right sentinel.
+		if (list->append.tails != NULL) {
+			for (_a = 0; ((int) _a) <= ((int) top_level); _a++) {
+				if (atomic_load_explicit(&(succ_nodes[(int) _a]->forward[0]), memory_order_acquire) == NULL) {
+					atomic_store_explicit(&(list->append.tails[(int) _a]), new_node, memory_order_release);
+				}
+			}
+		}
+		// The filter has to know about the node before it's fully linked, otherwise a lookup could be told "no" after an add reported the element as present.
+		// It also has to come after the node is linked (see `hopscotch_list_filter_rebuild`), so if it fails, the add is finished anyway and the error is reported with the element in the list.
+		hopscotch_res_t _tmp_007 = _list_filter_add(list, hash);
+		if (list->opts->versions.enabled) {
+			uint64_t _version;
+			uint64_t _oldest;
+			hopscotch_res_t _tmp_016 = _list_stamp_el(&_version, &_oldest, list, &(new_node->versions->add));
+			if ((_tmp_016 != HOPSCOTCH_RES__SUCCESS) && (_tmp_007 == HOPSCOTCH_RES__SUCCESS)) {
+				_tmp_007 = _tmp_016;
+			}
+		}
+		atomic_store_explicit(&(new_node->fully_linked), true, memory_order_release);
+		added[0] = true;
+		// The new node is the best finger for the next (bigger) element.
+		if (finger_nodes != NULL) {
+			int16_t _d;
+			for (_d = 0; ((int) _d) < ((int) list->opts->max_level); _d++) {
+				finger_nodes[(int) _d] = (((int) _d) <= ((int) top_level)) ? new_node : pred_nodes[(int) _d];
+			}
+		}
+		hopscotch_res_t _tmp_008 = _list_unlock_preds(pred_nodes, highest_level_locked);
+		if (_tmp_007 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_007;
+		}
+		if (_tmp_008 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_008;
+		}
+		if (((int) target_level) > ((int) top_level)) {
+			_list_defer_el(list, new_node);
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+}
+
+static hopscotch_res_t
+_list_append_el(
+	hopscotch_list_t * list,
+	hopscotch_node_t ** tail_nodes,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_001 = _index_maintain(list->index, list->opts);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+	}
+	uint8_t _top_level;
+	hopscotch_res_t _tmp_006 = _list_rand_level(&_top_level, list);
+	if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_006;
+	}
+	int16_t top_level = (int16_t) _top_level;
+	hopscotch_node_t * new_node;
+	hopscotch_res_t _tmp_002 = _list_new_el(
+		&new_node,
+		list,
+		val,
+		val_size,
+		(uint8_t) top_level,
+		(uint8_t) top_level,
+		tail_nodes[0]
+	);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	// Nobody else can see the list yet, so there's nothing to lock or validate.
+	_list_link_back(list, new_node, tail_nodes[0]);
+	_list_link_back(list, atomic_load_explicit(&(tail_nodes[0]->forward[0]), memory_order_relaxed), new_node);
+	int16_t _a;
+	for (_a = 0; ((int) _a) <= ((int) top_level); _a++) {
+		atomic_store_explicit(&(new_node->forward[(int) _a]), atomic_load_explicit(&(tail_nodes[(int) _a]->forward[(int) _a]), memory_order_relaxed), memory_order_relaxed);
+		atomic_store_explicit(&(tail_nodes[(int) _a]->forward[(int) _a]), new_node, memory_order_release);
+		tail_nodes[(int) _a] = new_node;
+	}
+	uint64_t hash;
+	hopscotch_res_t _tmp_003 = list->opts->hash(&hash, val, val_size);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	hopscotch_res_t _tmp_004 = _list_filter_add(list, hash);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_005 = _index_add(list->index, list->opts, new_node, hash);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+	}
+	atomic_store_explicit(&(new_node->fully_linked), true, memory_order_release);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_can_del_el(bool * ans, hopscotch_node_t * el, uint8_t level) {
+	// In lazy mode the tower can grow after the search.
+	// The predecessors found for the levels it grew into won't validate then, so the caller just searches again.
+	ans[0] = (bool) (
+		atomic_load_explicit(&(el->fully_linked), memory_order_acquire) &&
+		(((int) level) <= ((int) atomic_load_explicit(&(el->level), memory_order_acquire))) &&
+		(! atomic_load_explicit(&(el->marked), memory_order_acquire))
+	);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_cmp_el(
+	int * res,
+	size_t * lcp,
+	hopscotch_opts_t * opts,
+	hopscotch_node_t * node,
+	hopscotch_node_t * pred_node,
+	size_t * pred_lcp,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// Elements that are stored in full (which includes the sentinels') are left to `cmp`.
+	if (node->prefix == NULL) {
+		hopscotch_res_t _tmp_001 = opts->cmp(
+			res,
+			node->val.data,
+			node->val.size,
+			val,
+			val_size
+		);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		// Whoever needs it works it out later, which most of the time nobody does.
+		if (lcp != NULL) {
+			lcp[0] = SIZE_MAX;
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	size_t prefix_size = (size_t) node->prefix->size;
+	size_t size = prefix_size + node->val.size;
+	size_t _lcp;
+	if (node->prefix->base == pred_node) {
+		if (pred_lcp[0] == SIZE_MAX) {
+			hopscotch_res_t _tmp_002 = _list_el_lcp(pred_lcp, pred_node, SIZE_MAX, val, val_size);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+		}
+		if (prefix_size > pred_lcp[0]) {
+			// The node has the same byte as `pred_node` where `pred_node` and `val` part ways, so it's before `val` too.
+			res[0] = -1;
+			if (lcp != NULL) {
+				lcp[0] = pred_lcp[0];
+			}
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// `val` has the node's prefix too, so only the rest needs looking at.
+		size_t limit = (size < val_size) ? size : val_size;
+		_lcp = prefix_size;
+		while ((_lcp < limit) && (node->val.data[_lcp - prefix_size] == val[_lcp])) {
+			_lcp++;
+		}
+	} else {
+		hopscotch_res_t _tmp_003 = _list_el_lcp(&_lcp, node, size, val, val_size);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+	}
+	// Same order as `_list_default_el_cmp`: bytewise, and a prefix comes first.
+	if (_lcp == size) {
+		res[0] = (_lcp == val_size) ? 0 : -1;
+	} else if (_lcp == val_size) {
+		res[0] = 1;
+	} else {
+		hopscotch_byte_t byte;
+		_list_el_byte(&byte, node, _lcp);
+		res[0] = (byte < val[_lcp]) ? -1 : 1;
+	}
+	if (lcp != NULL) {
+		lcp[0] = _lcp;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_defer_el(hopscotch_list_t * list, hopscotch_node_t * node) {
+	// Treiber stack push; the maintenance pass takes the whole stack at once, so there's no ABA to worry about.
+	node->towers->pending_next = atomic_load_explicit(&(list->maintenance->pending), memory_order_relaxed);
+	while (! atomic_compare_exchange_weak_explicit(
+		&(list->maintenance->pending),
+		&(node->towers->pending_next),
+		node,
+		memory_order_release,
+		memory_order_relaxed
+	));
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_del_el(
+	bool * deleted,
+	hopscotch_node_t ** finger_nodes,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_node_t * node_to_del;
+	bool marked = false;
+	int16_t top_level;
+	// The first unlock that failed on the way to a del that still went through.
+	hopscotch_res_t unlock_res = HOPSCOTCH_RES__SUCCESS;
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	// Hash up front, so that the filter and index updates inside the critical section are cheap.
+	uint64_t hash;
+	hopscotch_res_t _tmp_009 = list->opts->hash(&hash, val, val_size);
+	if (_tmp_009 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_009;
+	}
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_010 = _index_maintain(list->index, list->opts);
+		if (_tmp_010 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_010;
+		}
+	}
+	// Only the first search starts from the finger, like in `_list_add_el`.
+	hopscotch_node_t ** start_nodes = finger_nodes;
+	while (true) {
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_001 = _list_find_el_from(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			start_nodes,
+			val,
+			val_size
+		);
+		bool from_finger = (bool) (start_nodes != NULL);
+		start_nodes = NULL;
+		int16_t level_found = (int16_t) _level_found;
+		// `_level_found` is only set when `val` was found.
+		bool _can_delete = false;
+		if (_tmp_001 == HOPSCOTCH_RES__SUCCESS) {
+			_list_can_del_el(&_can_delete, succ_nodes[(int) level_found], (uint8_t) level_found);
+		}
+		if (
+			marked ||
+			(
+				(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) &&
+				_can_delete
+			)
+		) {
+			if (! marked) {
+				node_to_del = succ_nodes[(int) level_found];
+				// Nothing is locked (or marked) yet, so a failure here can just be returned.
+				hopscotch_res_t _tmp_002 = _list_lock_el(list, node_to_del);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_002;
+				}
+				if (atomic_load_explicit(&(node_to_del->marked), memory_order_acquire)) {
+					int _tmp_003 = pthread_mutex_unlock(&(node_to_del->lock));
+					if (_tmp_003 != 0) {
+						return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+					}
+					deleted[0] = false;
+					// Success!
+					return HOPSCOTCH_RES__SUCCESS;
+				}
+				if (list->opts->versions.enabled) {
+					// Already deleted, and only kept around for snapshots.
+					if (atomic_load_explicit(&(node_to_del->versions->del), memory_order_acquire) != HOPSCOTCH_VAL_LIST_VERSION_NONE) {
+						int _tmp_012 = pthread_mutex_unlock(&(node_to_del->lock));
+						if (_tmp_012 != 0) {
+							return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+						}
+						deleted[0] = false;
+						// Success!
+						return HOPSCOTCH_RES__SUCCESS;
+					}
+					uint64_t _version;
+					uint64_t _oldest;
+					hopscotch_res_t _tmp_013 = _list_stamp_el(&_version, &_oldest, list, &(node_to_del->versions->del));
+					// A snapshot from before the del can still see the node, so it stays linked until the last such snapshot is released.
+					// Otherwise it goes right away, like in an unversioned list.
+					if ((_tmp_013 != HOPSCOTCH_RES__SUCCESS) || (_version > _oldest)) {
+						if (_tmp_013 == HOPSCOTCH_RES__SUCCESS) {
+							_tmp_013 = _list_retire_el(list, node_to_del);
+						}
+						int _tmp_014 = pthread_mutex_unlock(&(node_to_del->lock));
+						if (_tmp_014 != 0) {
+							return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+						}
+						if (_tmp_013 != HOPSCOTCH_RES__SUCCESS) {
+							return _tmp_013;
+						}
+						// The snapshots that held the node back may have been released before it was pushed, in which case nobody else is going to look at it.
+						hopscotch_res_t _tmp_015 = _list_oldest_version(&_oldest, list);
+						if (_tmp_015 != HOPSCOTCH_RES__SUCCESS) {
+							return _tmp_015;
+						}
+						if (_version <= _oldest) {
+							hopscotch_res_t _tmp_016 = _list_reclaim_els(list);
+							if (_tmp_016 != HOPSCOTCH_RES__SUCCESS) {
+								return _tmp_016;
+							}
+						}
+						deleted[0] = true;
+						// Success!
+						return HOPSCOTCH_RES__SUCCESS;
+					}
+				}
+				atomic_store_explicit(&(node_to_del->marked), true, memory_order_release);
+				marked = true;
+				// The maintenance thread only raises unmarked towers (under the node's lock), so the level is final now.
+				top_level = (int16_t) atomic_load_explicit(&(node_to_del->level), memory_order_acquire);
+			}
+			int16_t highest_level_locked = -1;
+			hopscotch_node_t * pred_node;
+			hopscotch_node_t * succ_node;
+			hopscotch_node_t * prev_pred_node = NULL;
+			bool valid = true;
+			hopscotch_res_t lock_res = HOPSCOTCH_RES__SUCCESS;
+			int16_t _level;
+			for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
+				pred_node = pred_nodes[(int) _level];
+				succ_node = succ_nodes[(int) _level];
+				if (pred_node != prev_pred_node) {
+					hopscotch_res_t _tmp_004 = _list_lock_el(list, pred_node);
+					if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+						lock_res = _tmp_004;
+						valid = false;
+						break;
+					}
+					highest_level_locked = (int16_t) _level;
+					prev_pred_node = pred_node;
+				}
+				if (
+					(! atomic_load_explicit(&(pred_node->marked), memory_order_acquire)) &&
+					(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) >= ((int) _level)) &&
+					(atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire) == succ_node)
+				) {
+					valid = true;
+				} else {
+					valid = false;
+				}
+			}
+			if (lock_res != HOPSCOTCH_RES__SUCCESS) {
+				// Release locks!
+				_list_unlock_preds(pred_nodes, highest_level_locked);
+				highest_level_locked = -1;
+				// `node_to_del` is marked already, and writers wait for marked nodes to be unlinked, so it can't be left in the list.
+				// `_list_unlink_el` searches (and locks the predecessors) again, and is retried until the node is out; then the del is finished as usual.
+				while (_list_unlink_el(list, node_to_del) != HOPSCOTCH_RES__SUCCESS) {
+					sched_yield();
+				}
+			}
+			if (valid || (lock_res != HOPSCOTCH_RES__SUCCESS)) {
+				if (valid) {
+					int16_t _a;
+					for (_a = top_level; ((int) _a) >= 0; _a--) {
+						atomic_store_explicit(&(pred_nodes[(int) _a]->forward[(int) _a]), atomic_load_explicit(&(node_to_del->forward[(int) _a]), memory_order_acquire), memory_order_release);
+					}
+					_list_link_back(list, atomic_load_explicit(&(node_to_del->forward[0]), memory_order_acquire), pred_nodes[0]);
+				}
+				// Still under the locks, so that a concurrent re-add of `val` can't have its fingerprint removed.
+				// The node is unlinked already, so if this (or the index update, or an unlock) fails, the del is finished anyway (and the locks let go of) before the error is reported, like in `_list_add_el`.
+				hopscotch_res_t _tmp_008 = _list_filter_del(list, hash);
+				if (list->index != NULL) {
+					hopscotch_res_t _tmp_011 = _index_del(list->index, node_to_del, hash);
+					if ((_tmp_011 != HOPSCOTCH_RES__SUCCESS) && (_tmp_008 == HOPSCOTCH_RES__SUCCESS)) {
+						_tmp_008 = _tmp_011;
+					}
+				}
+				// Release locks!
+				int _tmp_005 = pthread_mutex_unlock(&(node_to_del->lock));
+				if ((_tmp_005 != 0) && (_tmp_008 == HOPSCOTCH_RES__SUCCESS)) {
+					_tmp_008 = HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+				}
+				hopscotch_res_t _tmp_006 = _list_unlock_preds(pred_nodes, highest_level_locked);
+				deleted[0] = true;
+				if (_tmp_008 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_008;
+				}
+				if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_006;
+				}
+				if (unlock_res != HOPSCOTCH_RES__SUCCESS) {
+					return unlock_res;
+				}
+				if (valid && (finger_nodes != NULL)) {
+					memcpy((void *) finger_nodes, (void *) pred_nodes, (size_t) (sizeof(hopscotch_node_t *) * list->opts->max_level));
+				}
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			} else {
+				// Release locks!
+				// The node is marked (and locked) by this del, so it has to be retried even if an unlock fails; the error is reported once the del is done.
+				hopscotch_res_t _tmp_007 = _list_unlock_preds(pred_nodes, highest_level_locked);
+				if ((_tmp_007 != HOPSCOTCH_RES__SUCCESS) && (unlock_res == HOPSCOTCH_RES__SUCCESS)) {
+					unlock_res = _tmp_007;
+				}
+				// Invalidate `highest_level_locked`.
+				highest_level_locked = -1;
+				continue;
+			}
+		} else {
+			// A finger may have been unlinked since it was taken, and an unlinked node doesn't lead to the elements that were added after it.
+			// A finger node that's still unmarked was in the list all through the search, though, so the search is as good as one from the head.
+			if (from_finger) {
+				bool stale = false;
+				int16_t _d;
+				for (_d = 0; ((int) _d) < ((int) list->opts->max_level); _d++) {
+					if (atomic_load_explicit(&(finger_nodes[(int) _d]->marked), memory_order_acquire)) {
+						stale = true;
+						break;
+					}
+				}
+				if (stale) {
+					continue;
+				}
+			}
+			deleted[0] = false;
+			if (finger_nodes != NULL) {
+				memcpy((void *) finger_nodes, (void *) pred_nodes, (size_t) (sizeof(hopscotch_node_t *) * list->opts->max_level));
+			}
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+}
+
+static hopscotch_res_t
+_list_default_el_cmp(
+	int * res,
+	hopscotch_byte_t * val_a,
+	size_t val_a_size,
+	hopscotch_byte_t * val_b,
+	size_t val_b_size
+) {
+	// Let's first handle the extrema.
+	const char * min_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL;
+	const char * max_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL;
+	size_t min_val_size = (size_t) (strlen(min_val) + 1);
+	size_t max_val_size = (size_t) (strlen(max_val) + 1);
+	// If their sizes aren't equal, no need to even compare and waste precious CPU cycles.
+	// Due to short-circuit eval, this should behave as expected.
+	// NOTE(@jonathanmarvens):
+	// When making comparisons against elements already in a list, this logic assumes `val_a` is the element already in the list.
+	if (
+		(((int) val_a_size) == ((int) min_val_size)) &&
+		(memcmp((void *) val_a, (void *) min_val, min_val_size) == 0)
+	) {
+		res[0] = -1;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	if (
+		(((int) val_a_size) == ((int) max_val_size)) &&
+		(memcmp((void *) val_a, (void *) max_val, max_val_size) == 0)
+	) {
+		res[0] = 1;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// Make sure the we only compare the buffers up to the smallest buffer's size.
+	size_t cmp_size;
+	if (((int) val_a_size) < ((int) val_b_size)) {
+		cmp_size = val_a_size;
+	} else {
+		cmp_size = val_b_size;
+	}
+	// Compare!
+	res[0] = memcmp((void *) val_a, (void *) val_b, cmp_size);
+	// If one is a prefix of the other, the shorter one comes first.
+	// Otherwise elements of different sizes could compare equal, which `_list_default_el_hash` can't agree with.
+	if ((res[0] == 0) && (val_a_size != val_b_size)) {
+		res[0] = (val_a_size < val_b_size) ? -1 : 1;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_default_el_hash(uint64_t * res, hopscotch_byte_t * val, size_t val_size) {
+	// A MurmurHash3-style mix over 8-byte words.
+	// It only has to agree with `_list_default_el_cmp`, i.e. equal bytes must hash equally.
+	uint64_t hash = ((uint64_t) 0x9e3779b97f4a7c15ULL) ^ ((uint64_t) val_size);
+	size_t _a;
+	for (_a = 0; (_a + 8) <= val_size; _a += 8) {
+		uint64_t word;
+		memcpy((void *) &word, (void *) (val + _a), (size_t) 8);
+		word *= (uint64_t) 0x87c37b91114253d5ULL;
+		word = (word << 31) | (word >> 33);
+		word *= (uint64_t) 0x4cf5ad432745937fULL;
+		hash ^= word;
+		hash = ((hash << 27) | (hash >> 37)) * 5 + 0x52dce729;
+	}
+	uint64_t tail = 0;
+	for (; _a < val_size; _a++) {
+		tail = (tail << 8) | ((uint64_t) val[_a]);
+	}
+	hash ^= tail * ((uint64_t) 0x87c37b91114253d5ULL);
+	// Finalize.
+	hash ^= hash >> 33;
+	hash *= (uint64_t) 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= (uint64_t) 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	res[0] = hash;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_el_byte(hopscotch_byte_t * byte, hopscotch_node_t * node, size_t offset) {
+	// Each node down the chain only has the bytes after its prefix.
+	while ((node->prefix != NULL) && (offset < (size_t) node->prefix->size)) {
+		node = node->prefix->base;
+	}
+	byte[0] = node->val.data[offset - ((node->prefix == NULL) ? ((size_t) 0) : ((size_t) node->prefix->size))];
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_el_lcp(
+	size_t * lcp,
+	hopscotch_node_t * node,
+	size_t limit,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	size_t prefix_size = (node->prefix == NULL) ? ((size_t) 0) : ((size_t) node->prefix->size);
+	if (limit > (prefix_size + node->val.size)) {
+		limit = prefix_size + node->val.size;
+	}
+	if (limit > val_size) {
+		limit = val_size;
+	}
+	size_t _lcp = 0;
+	if (node->prefix != NULL) {
+		size_t shared_limit = (prefix_size < limit) ? prefix_size : limit;
+		hopscotch_res_t _tmp_001 = _list_el_lcp(&_lcp, node->prefix->base, shared_limit, val, val_size);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		if (_lcp < shared_limit) {
+			lcp[0] = _lcp;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	while ((_lcp < limit) && (node->val.data[_lcp - prefix_size] == val[_lcp])) {
+		_lcp++;
+	}
+	lcp[0] = _lcp;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_el_val(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+) {
+	if (node->prefix == NULL) {
+		val[0] = node->val.data;
+		val_size[0] = node->val.size;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	size_t size = ((size_t) node->prefix->size) + node->val.size;
+	hopscotch_byte_t * _val = _MALLOC(list->opts->gc.malloc, hopscotch_byte_t, size);
+	if (_val == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// Fill it in back to front: every node down the chain has the bytes between its prefix and what's already there.
+	size_t end = size;
+	hopscotch_node_t * _node = node;
+	while (end > 0) {
+		size_t start = (_node->prefix == NULL) ? ((size_t) 0) : ((size_t) _node->prefix->size);
+		if (start < end) {
+			memcpy((void *) (_val + start), (void *) _node->val.data, end - start);
+			end = start;
+		}
+		if (_node->prefix == NULL) {
+			break;
+		}
+		_node = _node->prefix->base;
+	}
+	val[0] = _val;
+	val_size[0] = size;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_el_visible(bool * visible, hopscotch_node_t * node, uint64_t version) {
+	// `del` goes first: an element that's added back has its `add` reset before its `del` (see `_list_revive_el`), so this never pairs a new `del` with an old `add`.
+	// Nodes of unversioned lists have been there "forever" (until they're marked).
+	hopscotch_node_versions_t * versions = node->versions;
+	uint64_t del = (versions == NULL) ? HOPSCOTCH_VAL_LIST_VERSION_NONE : atomic_load_explicit(&(versions->del), memory_order_acquire);
+	if (version == HOPSCOTCH_VAL_LIST_VERSION_NOW) {
+		visible[0] = (bool) (
+			atomic_load_explicit(&(node->fully_linked), memory_order_acquire) &&
+			(! atomic_load_explicit(&(node->marked), memory_order_acquire)) &&
+			(del == HOPSCOTCH_VAL_LIST_VERSION_NONE)
+		);
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	if (versions == NULL) {
+		visible[0] = true;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	uint64_t add = atomic_load_explicit(&(versions->add), memory_order_acquire);
+	visible[0] = (bool) ((add <= version) && (version < del));
+	hopscotch_version_t * range = atomic_load_explicit(&(versions->older), memory_order_acquire);
+	for (; (! visible[0]) && (range != NULL); range = range->older) {
+		visible[0] = (bool) ((range->add <= version) && (version < range->del));
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_filter_add(hopscotch_list_t * list, uint64_t hash) {
+	// Pairs with the CAS in `hopscotch_list_filter_rebuild`: the level-0 link before this load and this load are seq-cst, and so are the CAS and the walk after it, so either it sees our node while walking, or we see its filter.
+	// Once there's a filter, its lock orders the rest.
+	hopscotch_list_filter_t * filter = __atomic_load_n(&(list->filter), __ATOMIC_SEQ_CST);
+	if (filter == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(filter->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// While the filter is being rebuilt, the new one has to see every add too.
+	if (filter->current != NULL) {
+		_filter_add(filter->current, hash);
+	}
+	if (filter->next != NULL) {
+		_filter_add(filter->next, hash);
+	}
+	int _tmp_002 = pthread_mutex_unlock(&(filter->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_filter_check(
+	bool * maybe,
+	hopscotch_filter_t ** filter,
+	uint64_t * hash,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_list_filter_t * _record = __atomic_load_n(&(list->filter), __ATOMIC_ACQUIRE);
+	hopscotch_filter_t * _filter = (_record == NULL) ? NULL : __atomic_load_n(&(_record->current), __ATOMIC_ACQUIRE);
+	if (
+		(_filter == NULL) ||
+		__atomic_load_n(&(_filter->overflowed), __ATOMIC_ACQUIRE)
+	) {
+		// No (usable) filter, so everything is a "maybe".
+		maybe[0] = true;
+		filter[0] = NULL;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	hopscotch_res_t _tmp_001 = list->opts->hash(hash, val, val_size);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	filter[0] = _filter;
+	return _filter_contains(maybe, _filter, hash[0]);
+}
+
+static hopscotch_res_t
+_list_filter_del(hopscotch_list_t * list, uint64_t hash) {
+	// A stale fingerprint only costs a false positive, so there's no need for a fence here.
+	hopscotch_list_filter_t * filter = __atomic_load_n(&(list->filter), __ATOMIC_RELAXED);
+	if (filter == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(filter->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// The filter that's being rebuilt is left alone: it may not have this element yet, and deleting a fingerprint that was never added could remove another element's.
+	// The stale fingerprint only costs a false positive.
+	if (filter->current != NULL) {
+		_filter_del(filter->current, hash);
+	}
+	int _tmp_002 = pthread_mutex_unlock(&(filter->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_filter_new(hopscotch_list_filter_t ** filter, hopscotch_opts_t * opts, size_t capacity) {
+	hopscotch_list_filter_t * _filter = _MALLOC(opts->gc.malloc, hopscotch_list_filter_t, ((size_t) 1));
+	if (_filter == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_filter->current = NULL;
+	_filter->next = NULL;
+	int _tmp_001 = pthread_mutex_init(&(_filter->lock), NULL);
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	}
+	if (capacity > 0) {
+		hopscotch_res_t _tmp_002 = _filter_new(&(_filter->current), opts, capacity);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+	}
+	// Set the result.
+	filter[0] = _filter;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_find_el(
+	uint8_t * level_found,
+	hopscotch_node_t ** pred_nodes,
+	hopscotch_node_t ** succ_nodes,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	return _list_find_el_from(
+		level_found,
+		pred_nodes,
+		succ_nodes,
+		list,
+		NULL,
+		val,
+		val_size
+	);
+}
+
+static hopscotch_res_t
+_list_find_el_from(
+	uint8_t * level_found,
+	hopscotch_node_t ** pred_nodes,
+	hopscotch_node_t ** succ_nodes,
+	hopscotch_list_t * list,
+	hopscotch_node_t ** finger_nodes,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	bool val_found = false;
+	hopscotch_node_t * pred_node = list->head;
+	// How much of `val` the predecessor shares, when we know it (see `_list_cmp_el`).
+	hopscotch_node_t * lcp_node = list->head;
+	size_t pred_lcp = SIZE_MAX;
+	int16_t start_level = ((int16_t) list->opts->max_level) - 1;
+	// A finger that's still at the head (so every level of it is) is the same as no finger, and there's nothing to climb.
+	if ((finger_nodes != NULL) && (finger_nodes[0] != list->head)) {
+		// Climb up from the finger until its successor isn't before `val` anymore.
+		// The climb is O(log d) for a distance of d elements, which is what makes galloping pay off.
+		for (start_level = 0; ((int) start_level) < (((int) list->opts->max_level) - 1); start_level++) {
+			hopscotch_node_t * next_node = atomic_load_explicit(&(finger_nodes[(int) start_level]->forward[(int) start_level]), memory_order_acquire);
+			int _cmp_res_003;
+			hopscotch_res_t _tmp_003 = _list_cmp_el(
+				&_cmp_res_003,
+				NULL,
+				list->opts,
+				next_node,
+				NULL,
+				NULL,
+				val,
+				val_size
+			);
+			if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_003;
+			}
+			if (_cmp_res_003 >= 0) {
+				break;
+			}
+		}
+	}
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		// Above the start level the finger's predecessors are still good starting points.
+		// `pred_nodes` may be `finger_nodes` itself, which is fine since we read each entry before writing it.
+		if ((finger_nodes != NULL) && (((int) _level) >= ((int) start_level))) {
+			pred_node = finger_nodes[(int) _level];
+			if (pred_node != lcp_node) {
+				lcp_node = NULL;
+			}
+		}
+		hopscotch_node_t * curr_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		int _cmp_res_001;
+		while (true) {
+			size_t curr_lcp;
+			hopscotch_res_t _tmp_001 = _list_cmp_el(
+				&_cmp_res_001,
+				&curr_lcp,
+				list->opts,
+				curr_node,
+				lcp_node,
+				&pred_lcp,
+				val,
+				val_size
+			);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (_cmp_res_001 < 0) {
+				pred_node = curr_node;
+				lcp_node = curr_node;
+				pred_lcp = curr_lcp;
+				curr_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+			} else {
+				break;
+			}
+		}
+		if (
+			(! val_found) &&
+			(_cmp_res_001 == 0)
+		) {
+			val_found = true;
+			level_found[0] = (uint8_t) _level;
+		}
+		pred_nodes[(int) _level] = pred_node;
+		succ_nodes[(int) _level] = curr_node;
+	}
+	if (val_found) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	} else {
+		return HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND;
+	}
+}
+
+static hopscotch_res_t
+_list_find_last_el(hopscotch_node_t ** last_nodes, hopscotch_list_t * list) {
+	hopscotch_node_t * pred_node = list->head;
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		// Only the right sentinel has no level-0 successor.
+		hopscotch_node_t * succ_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		while (atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) != NULL) {
+			pred_node = succ_node;
+			succ_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		}
+		last_nodes[(int) _level] = pred_node;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_find_tail(
+	bool * at_tail,
+	hopscotch_node_t ** pred_nodes,
+	hopscotch_node_t ** succ_nodes,
+	hopscotch_list_t * list,
+	uint8_t top_level,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	at_tail[0] = false;
+	// Level 0 goes last, so that its tail is the newest one we look at.
+	int16_t _level;
+	for (_level = (int16_t) top_level; ((int) _level) >= 0; _level--) {
+		hopscotch_node_t * pred_node = atomic_load_explicit(&(list->append.tails[(int) _level]), memory_order_acquire);
+		if (pred_node == NULL) {
+			pred_node = list->head;
+		}
+		hopscotch_node_t * succ_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		// The right sentinel is the only node without a level-0 successor.
+		if (
+			(atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) != NULL) ||
+			atomic_load_explicit(&(pred_node->marked), memory_order_acquire)
+		) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		pred_nodes[(int) _level] = pred_node;
+		succ_nodes[(int) _level] = succ_node;
+	}
+	// Tails on the levels above that are still in the list can't be after the last node, so the locks are taken in the same order as after a search.
+	for (_level = 1; ((int) _level) <= ((int) top_level); _level++) {
+		if (atomic_load_explicit(&(pred_nodes[(int) _level]->marked), memory_order_acquire)) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	// And the last node is the only one `val` has to be bigger than.
+	if (pred_nodes[0] != list->head) {
+		int _cmp_res_001;
+		hopscotch_res_t _tmp_001 = _list_cmp_el(
+			&_cmp_res_001,
+			NULL,
+			list->opts,
+			pred_nodes[0],
+			NULL,
+			NULL,
+			val,
+			val_size
+		);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		if (_cmp_res_001 >= 0) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	// Set the result.
+	at_tail[0] = true;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_forget_el(hopscotch_list_t * list, hopscotch_node_t * node) {
+	hopscotch_byte_t * val;
+	size_t val_size;
+	hopscotch_res_t _tmp_004 = _list_el_val(&val, &val_size, list, node);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	uint64_t hash;
+	hopscotch_res_t _tmp_001 = list->opts->hash(&hash, val, val_size);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_res_t _tmp_002 = _list_filter_del(list, hash);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_003 = _index_del(list->index, node, hash);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_init_lock(hopscotch_list_t * list, pthread_mutex_t * lock) {
+	int _tmp_001 = pthread_mutex_init(lock, (list->shm != NULL) ? &(list->shm->lock_attr) : NULL);
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_link_back(hopscotch_list_t * list, hopscotch_node_t * node, hopscotch_node_t * pred_node) {
+	if (list->opts->back_links.enabled) {
+		atomic_store_explicit(&(node->backward), pred_node, memory_order_release);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_live_el(hopscotch_node_t ** node) {
+	// Same check as `hopscotch_list_contains_el`.
+	while (atomic_load_explicit(&(node[0]->forward[0]), memory_order_acquire) != NULL) {
+		bool visible;
+		_list_el_visible(&visible, node[0], HOPSCOTCH_VAL_LIST_VERSION_NOW);
+		if (visible) {
+			break;
+		}
+		node[0] = atomic_load_explicit(&(node[0]->forward[0]), memory_order_acquire);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_lock_el(_UNUSED_VAR hopscotch_list_t * list, hopscotch_node_t * node) {
+	int _tmp_001 = pthread_mutex_lock(&(node->lock));
+#ifdef _HOPSCOTCH_ROBUST_LOCKS
+	// Only the first process to take the lock after its owner died is told, so the cleanup can't wait.
+	if (_tmp_001 == EOWNERDEAD) {
+		int _tmp_002 = pthread_mutex_consistent(&(node->lock));
+		if (_tmp_002 != 0) {
+			pthread_mutex_unlock(&(node->lock));
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		hopscotch_res_t _tmp_003 = _list_repair_el(list, node);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			pthread_mutex_unlock(&(node->lock));
+			return _tmp_003;
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+#endif
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_lookup_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// Definite misses are answered by the membership filter without touching the list.
+	bool maybe;
+	hopscotch_filter_t * filter;
+	uint64_t hash;
+	hopscotch_res_t _tmp_001 = _list_filter_check(
+		&maybe,
+		&filter,
+		&hash,
+		list,
+		val,
+		val_size
+	);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (! maybe) {
+		_filter_note(filter, hash, false);
+		node[0] = NULL;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	if (list->index != NULL) {
+		// `hash` is only set if the filter was checked.
+		if (filter == NULL) {
+			hopscotch_res_t _tmp_002 = list->opts->hash(&hash, val, val_size);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+		}
+		hopscotch_res_t _tmp_003 = _index_find(
+			node,
+			list->index,
+			list->opts,
+			hash,
+			val,
+			val_size
+		);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+	} else if (list->opts->towers.adaptive) {
+		// Raised towers only pay off if the search stops as soon as it gets to one.
+		hopscotch_node_t * found_node;
+		hopscotch_res_t _tmp_005 = _list_search_el(&found_node, list, val, val_size);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+		bool visible = false;
+		if (found_node != NULL) {
+			_list_el_visible(&visible, found_node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+		}
+		node[0] = visible ? found_node : NULL;
+	} else {
+		hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+		hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_004 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			val,
+			val_size
+		);
+		if (
+			(_tmp_004 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_004 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			return _tmp_004;
+		}
+		int16_t level_found = (int16_t) _level_found;
+		bool visible = false;
+		if (_tmp_004 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) {
+			_list_el_visible(&visible, succ_nodes[(int) level_found], HOPSCOTCH_VAL_LIST_VERSION_NOW);
+		}
+		if (visible) {
+			node[0] = succ_nodes[(int) level_found];
+		} else {
+			node[0] = NULL;
+		}
+	}
+	if ((filter != NULL) && (node[0] == NULL)) {
+		_filter_note(filter, hash, true);
+	}
+	if (list->opts->towers.adaptive && (node[0] != NULL)) {
+		_list_note_hit(list, node[0]);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_lower_el(
+	bool * lowered,
+	hopscotch_list_t * list,
+	hopscotch_node_t * pred_node,
+	hopscotch_node_t * node,
+	uint8_t level
+) {
+	lowered[0] = false;
+	// Same lock order as `_list_raise_el`.
+	hopscotch_res_t _tmp_001 = _list_lock_el(list, node);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (
+		(! atomic_load_explicit(&(node->marked), memory_order_acquire)) &&
+		(((int) atomic_load_explicit(&(node->level), memory_order_acquire)) == ((int) level))
+	) {
+		hopscotch_res_t _tmp_002 = _list_lock_el(list, pred_node);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		if (
+			(! atomic_load_explicit(&(pred_node->marked), memory_order_acquire)) &&
+			(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) >= ((int) level)) &&
+			(atomic_load_explicit(&(pred_node->forward[(int) level]), memory_order_acquire) == node)
+		) {
+			// The node keeps its forward pointer, so traversals that are on it at `level` just carry on past it.
+			// Writers check a predecessor's level (under its lock) before they trust that pointer.
+			atomic_store_explicit(&(pred_node->forward[(int) level]), atomic_load_explicit(&(node->forward[(int) level]), memory_order_acquire), memory_order_release);
+			atomic_store_explicit(&(node->level), (uint8_t) (level - 1), memory_order_release);
+			lowered[0] = true;
+		}
+		int _tmp_003 = pthread_mutex_unlock(&(pred_node->lock));
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+	}
+	int _tmp_004 = pthread_mutex_unlock(&(node->lock));
+	if (_tmp_004 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_maintain(hopscotch_list_t * list) {
+	// Take the whole stack; nodes that can't be finished in this pass are pushed back for the next one.
+	hopscotch_node_t * node = atomic_exchange_explicit(&(list->maintenance->pending), NULL, memory_order_acquire);
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	while (node != NULL) {
+		hopscotch_node_t * next_node = node->towers->pending_next;
+		hopscotch_byte_t * val;
+		size_t val_size;
+		hopscotch_res_t _tmp_003 = _list_el_val(&val, &val_size, list, node);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_001 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			val,
+			val_size
+		);
+		// Nodes that were deleted, or moved to another list by a split, are simply dropped.
+		if (
+			(_tmp_001 == HOPSCOTCH_RES__SUCCESS) &&
+			(succ_nodes[(int) _level_found] == node) &&
+			(! atomic_load_explicit(&(node->marked), memory_order_acquire))
+		) {
+			// The predecessors from the search are the ones on every level above the tower too, so it's raised bottom-up in one go.
+			int16_t _level;
+			for (_level = ((int16_t) atomic_load_explicit(&(node->level), memory_order_acquire)) + 1; ((int) _level) <= ((int) node->target_level); _level++) {
+				bool raised;
+				hopscotch_res_t _tmp_002 = _list_raise_el(&raised, list, pred_nodes[(int) _level], node, (uint8_t) _level, val, val_size);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_002;
+				}
+				if (! raised) {
+					// A concurrent add or del changed the neighbourhood, so try again on the next pass.
+					if (! atomic_load_explicit(&(node->marked), memory_order_acquire)) {
+						_list_defer_el(list, node);
+					}
+					break;
+				}
+			}
+		}
+		node = next_node;
+	}
+	if (list->opts->towers.adaptive) {
+		return _list_adapt(list);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static void *
+_list_maintenance_main(void * arg) {
+	hopscotch_list_t * list = (hopscotch_list_t *) arg;
+	pthread_mutex_lock(&(list->maintenance->lock));
+	while (list->maintenance->running) {
+		// There's nobody to hand an error to, so a failed pass is simply retried on the next tick.
+		_list_maintain(list);
+		int64_t deadline = timestamp() + ((int64_t) list->opts->towers.interval_ms);
+		struct timespec abstime;
+		abstime.tv_sec = (time_t) (deadline / 1000);
+		abstime.tv_nsec = (long) ((deadline % 1000) * 1000000);
+		pthread_cond_timedwait(&(list->maintenance->cond), &(list->maintenance->lock), &abstime);
+	}
+	pthread_mutex_unlock(&(list->maintenance->lock));
+	return NULL;
+}
+
+static hopscotch_res_t
+_list_malloc(void ** ptr, hopscotch_list_t * list, size_t size) {
+	hopscotch_shm_t * segment = (list->shm == NULL) ? NULL : list->shm->segment;
+	if (segment == NULL) {
+		ptr[0] = list->opts->gc.malloc(size);
+	} else {
+		// Bump allocation, rounded up so that everything in the segment stays suitably aligned.
+		// An allocation that doesn't fit doesn't move the offset, so `used` stays a true count and smaller allocations can still fit after it.
+		size_t aligned_size = (size + (_Alignof(max_align_t) - 1)) & (~(_Alignof(max_align_t) - 1));
+		size_t offset = atomic_load_explicit(&(segment->used), memory_order_relaxed);
+		ptr[0] = NULL;
+		while ((aligned_size <= segment->size) && (offset <= (segment->size - aligned_size))) {
+			if (atomic_compare_exchange_weak_explicit(
+				&(segment->used),
+				&offset,
+				offset + aligned_size,
+				memory_order_relaxed,
+				memory_order_relaxed
+			)) {
+				ptr[0] = (void *) (((hopscotch_byte_t *) segment) + offset);
+				break;
+			}
+		}
+	}
+	if (ptr[0] == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_move_els(
+	hopscotch_list_t * from_list,
+	hopscotch_list_t * to_list,
+	hopscotch_node_t * node
+) {
+	// Without a filter or index the towers are all there is, so there's nothing to do.
+	if (
+		(from_list->filter == NULL) &&
+		(from_list->index == NULL) &&
+		(to_list->filter == NULL) &&
+		(to_list->index == NULL)
+	) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	for (; atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL; node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire)) {
+		hopscotch_byte_t * val;
+		size_t val_size;
+		hopscotch_res_t _tmp_007 = _list_el_val(&val, &val_size, from_list, node);
+		if (_tmp_007 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_007;
+		}
+		uint64_t hash;
+		hopscotch_res_t _tmp_001 = from_list->opts->hash(&hash, val, val_size);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		hopscotch_res_t _tmp_002 = _list_filter_del(from_list, hash);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		if (from_list->index != NULL) {
+			hopscotch_res_t _tmp_003 = _index_del(from_list->index, node, hash);
+			if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_003;
+			}
+		}
+		hopscotch_res_t _tmp_004 = _list_filter_add(to_list, hash);
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_004;
+		}
+		if (to_list->index != NULL) {
+			hopscotch_res_t _tmp_005 = _index_maintain(to_list->index, to_list->opts);
+			if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_005;
+			}
+			hopscotch_res_t _tmp_006 = _index_add(to_list->index, to_list->opts, node, hash);
+			if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_006;
+			}
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_raise_el(
+	bool * raised,
+	hopscotch_list_t * list,
+	hopscotch_node_t * pred_node,
+	hopscotch_node_t * node,
+	uint8_t level,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	raised[0] = false;
+	// `node` comes after `pred_node`, so locking it first keeps to the usual (descending) lock order.
+	hopscotch_res_t _tmp_001 = _list_lock_el(list, node);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (
+		(! atomic_load_explicit(&(node->marked), memory_order_acquire)) &&
+		((((int) atomic_load_explicit(&(node->level), memory_order_acquire)) + 1) == ((int) level))
+	) {
+		hopscotch_res_t _tmp_002 = _list_lock_el(list, pred_node);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		hopscotch_node_t * succ_node = atomic_load_explicit(&(pred_node->forward[(int) level]), memory_order_acquire);
+		bool valid = (bool) (
+			(! atomic_load_explicit(&(pred_node->marked), memory_order_acquire)) &&
+			(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) >= ((int) level))
+		);
+		if (valid) {
+			// A tower could have gone up in between since we walked past, e.g. an eager add.
+			int _cmp_res_001;
+			hopscotch_res_t _tmp_003 = _list_cmp_el(
+				&_cmp_res_001,
+				NULL,
+				list->opts,
+				succ_node,
+				NULL,
+				NULL,
+				val,
+				val_size
+			);
+			if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+				pthread_mutex_unlock(&(pred_node->lock));
+				pthread_mutex_unlock(&(node->lock));
+				return _tmp_003;
+			}
+			valid = (bool) (_cmp_res_001 > 0);
+		}
+		if (valid) {
+			// Same order as `hopscotch_list_add_el`: the new pointer is set up before the node becomes reachable through it.
+			atomic_store_explicit(&(node->forward[(int) level]), succ_node, memory_order_relaxed);
+			atomic_store_explicit(&(pred_node->forward[(int) level]), node, memory_order_release);
+			atomic_store_explicit(&(node->level), level, memory_order_release);
+			raised[0] = true;
+		}
+		int _tmp_004 = pthread_mutex_unlock(&(pred_node->lock));
+		if (_tmp_004 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+	}
+	int _tmp_005 = pthread_mutex_unlock(&(node->lock));
+	if (_tmp_005 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_reclaim_el(hopscotch_list_t * list, hopscotch_node_t * node, uint64_t oldest) {
+	hopscotch_res_t _tmp_001 = _list_lock_el(list, node);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	uint64_t del = atomic_load_explicit(&(node->versions->del), memory_order_acquire);
+	hopscotch_res_t _tmp_002 = HOPSCOTCH_RES__SUCCESS;
+	if (
+		atomic_load_explicit(&(node->marked), memory_order_acquire) ||
+		(del == HOPSCOTCH_VAL_LIST_VERSION_NONE)
+	) {
+		// It was added back (or deleted for good by a del that no snapshot was around for).
+		node->versions->retired = false;
+	} else if (del > oldest) {
+		node->versions->retired_next = atomic_load_explicit(&(list->versions->retired), memory_order_relaxed);
+		while (! atomic_compare_exchange_weak_explicit(
+			&(list->versions->retired),
+			&(node->versions->retired_next),
+			node,
+			memory_order_release,
+			memory_order_relaxed
+		));
+	} else {
+		// Same as a del without snapshots, except that the filter and index go first: a re-add waits for the marked node to be unlinked before it touches them.
+		atomic_store_explicit(&(node->marked), true, memory_order_release);
+		node->versions->retired = false;
+		_tmp_002 = _list_forget_el(list, node);
+		if (_tmp_002 == HOPSCOTCH_RES__SUCCESS) {
+			_tmp_002 = _list_unlink_el(list, node);
+		}
+	}
+	int _tmp_003 = pthread_mutex_unlock(&(node->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return _tmp_002;
+}
+
+static hopscotch_res_t
+_list_reclaim_els(hopscotch_list_t * list) {
+	uint64_t oldest;
+	hopscotch_res_t _tmp_001 = _list_oldest_version(&oldest, list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	while (true) {
+		// Take the whole stack, like `_list_maintain` does; the nodes that have to wait are pushed back.
+		hopscotch_node_t * node = atomic_exchange_explicit(&(list->versions->retired), NULL, memory_order_acquire);
+		while (node != NULL) {
+			hopscotch_node_t * next_node = node->versions->retired_next;
+			hopscotch_res_t _tmp_002 = _list_reclaim_el(list, node, oldest);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+			node = next_node;
+		}
+		// A snapshot released while we were at it found the stack (partly) empty, so its nodes are ours to go through again.
+		uint64_t _oldest;
+		hopscotch_res_t _tmp_003 = _list_oldest_version(&_oldest, list);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+		if (_oldest == oldest) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		oldest = _oldest;
+	}
+}
+
+static hopscotch_res_t
+_list_new(hopscotch_list_t ** list, hopscotch_opts_t * opts, hopscotch_shm_t * shm) {
+	// Compressed elements are compared a byte at a time, which is only right for the default order.
+	if (
+		opts->prefix_compression.enabled &&
+		(opts->cmp != NULL) &&
+		(opts->cmp != _list_default_el_cmp)
+	) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// Processes can't share snapshots (or the version counter) yet.
+	if (opts->versions.enabled && (shm != NULL)) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// A small list keeps its elements outside of any node, so nothing that keeps track of nodes on the side can be used with it.
+	if (
+		(opts->small.capacity > 0) &&
+		(
+			(shm != NULL) ||
+			opts->versions.enabled ||
+			opts->towers.lazy ||
+			opts->index.enabled ||
+			(opts->filter.capacity > 0)
+		)
+	) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// Raised towers are stored whole, and the nodes' hit counters are only good for one process.
+	if (opts->towers.adaptive && (opts->prefix_compression.enabled || (shm != NULL))) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// Tail pointers are kept per process, and another process's `hopscotch_list_clear` would leave them pointing at nodes that aren't in the list anymore.
+	if (opts->append.enabled && (shm != NULL)) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// Posted ops point at the posters' elements, which other processes can't read. A small list's writers don't go through the skip list's locks to begin with.
+	if (opts->combining.enabled && ((shm != NULL) || (opts->small.capacity > 0))) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	// Set the default compare function if one isn't provided.
+	if (opts->cmp == NULL) {
+		opts->cmp = _list_default_el_cmp;
+	}
+	// Set the default maintenance interval if one isn't provided.
+	if (opts->towers.interval_ms == 0) {
+		opts->towers.interval_ms = HOPSCOTCH_VAL_LIST_DEFAULT_TOWERS_INTERVAL_MS;
+	}
+	// Set the default max level if one isn't provided.
+	if (((int) opts->max_level) == 0) {
+		opts->max_level = HOPSCOTCH_VAL_LIST_DEFAULT_MAX_LEVEL;
+	}
+	// Set the default hash function if one isn't provided.
+	// NOTE: A custom `cmp` needs a matching `hash` (equal elements must hash equally) if the membership filter is used.
+	if (opts->hash == NULL) {
+		opts->hash = _list_default_el_hash;
+	}
+	// Set the default GC if one isn't provided.
+	if (opts->gc.malloc == NULL) {
+		opts->gc.malloc = __MALLOC;
+	}
+	// Set the list's default "p" for the random level function if one isn't provided.
+	if (opts->rand_level_p == ((double) 0)) {
+		opts->rand_level_p = HOPSCOTCH_VAL_LIST_DEFAULT_RAND_LEVEL_P;
+	}
+	// Whichever process created the segment has already picked the options that every process has to agree on.
+	bool shm_ready = (bool) (
+		(shm != NULL) &&
+		(atomic_load_explicit(&(shm->magic), memory_order_acquire) == HOPSCOTCH_VAL_SHM_MAGIC)
+	);
+	if (shm_ready) {
+		opts->back_links.enabled = shm->back_links;
+		opts->max_level = shm->max_level;
+	}
+	// Allocate some memory for the list structure.
+	hopscotch_list_t * _list = _MALLOC(opts->gc.malloc, hopscotch_list_t, ((size_t) 1));
+	if (_list == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// Initialize ...
+	_list->opts = opts;
+	_list->filter = NULL;
+	_list->index = NULL;
+	_list->maintenance = NULL;
+	_list->adaptive = NULL;
+	_list->shm = NULL;
+	_list->versions = NULL;
+	_list->small = NULL;
+	_list->append.tails = NULL;
+	_list->combining = NULL;
+	if (shm != NULL) {
+		_list->shm = _MALLOC(opts->gc.malloc, hopscotch_list_shm_t, ((size_t) 1));
+		if (_list->shm == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		_list->shm->segment = shm;
+		int _tmp_010 = pthread_mutexattr_init(&(_list->shm->lock_attr));
+		if (_tmp_010 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+		int _tmp_011 = pthread_mutexattr_setpshared(&(_list->shm->lock_attr), PTHREAD_PROCESS_SHARED);
+		if (_tmp_011 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+#ifdef _HOPSCOTCH_ROBUST_LOCKS
+		int _tmp_012 = pthread_mutexattr_setrobust(&(_list->shm->lock_attr), PTHREAD_MUTEX_ROBUST);
+		if (_tmp_012 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+#endif
+	}
+	if (opts->towers.lazy || opts->towers.adaptive) {
+		_list->maintenance = _MALLOC(opts->gc.malloc, hopscotch_list_maintenance_t, ((size_t) 1));
+		if (_list->maintenance == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		_list->maintenance->running = false;
+		atomic_init(&(_list->maintenance->pending), NULL);
+		int _tmp_006 = pthread_mutex_init(&(_list->maintenance->lock), NULL);
+		if (_tmp_006 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+		int _tmp_007 = pthread_cond_init(&(_list->maintenance->cond), NULL);
+		if (_tmp_007 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_COND_INIT_FAIL;
+		}
+	}
+	if (opts->towers.adaptive) {
+		_list->adaptive = _MALLOC(opts->gc.malloc, hopscotch_list_adaptive_t, ((size_t) 1));
+		if (_list->adaptive == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		_list->adaptive->samples = 0;
+		atomic_init(&(_list->adaptive->hot), NULL);
+		_list->adaptive->raised = NULL;
+		_list->adaptive->raised_count = 0;
+		_list->adaptive->raised_capacity = 0;
+	}
+	if (opts->versions.enabled) {
+		_list->versions = _MALLOC(opts->gc.malloc, hopscotch_list_versions_t, ((size_t) 1));
+		if (_list->versions == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		int _tmp_013 = pthread_mutex_init(&(_list->versions->lock), NULL);
+		if (_tmp_013 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+		_list->versions->current = 0;
+		_list->versions->oldest = NULL;
+		_list->versions->newest = NULL;
+		atomic_init(&(_list->versions->retired), NULL);
+	}
+	if (opts->small.capacity > 0) {
+		_list->small = _MALLOC(opts->gc.malloc, hopscotch_list_small_t, ((size_t) 1));
+		if (_list->small == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		int _tmp_014 = pthread_mutex_init(&(_list->small->lock), NULL);
+		if (_tmp_014 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+		_list->small->seq = 0;
+		_list->small->active = true;
+		_list->small->pinned = false;
+		_list->small->demoting = false;
+		_list->small->count = 0;
+		_list->small->writers = 0;
+		_list->small->els = _MALLOC(opts->gc.malloc, hopscotch_small_el_t, opts->small.capacity);
+		if (_list->small->els == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+	}
+	if (opts->append.enabled) {
+		_list->append.tails = (HOPSCOTCH_ATOMIC(hopscotch_node_t *) *) _MALLOC(
+			opts->gc.malloc,
+			HOPSCOTCH_ATOMIC(hopscotch_node_t *),
+			(size_t) opts->max_level
+		);
+		if (_list->append.tails == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		int16_t _level;
+		for (_level = 0; ((int) _level) < ((int) opts->max_level); _level++) {
+			atomic_init(&(_list->append.tails[(int) _level]), NULL);
+		}
+	}
+	if (opts->combining.enabled) {
+		_list->combining = _MALLOC(opts->gc.malloc, hopscotch_list_combining_t, ((size_t) 1));
+		if (_list->combining == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		int _tmp_015 = pthread_mutex_init(&(_list->combining->lock), NULL);
+		if (_tmp_015 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+		}
+		atomic_init(&(_list->combining->slots_used), 0);
+		_list->combining->slots = _MALLOC(opts->gc.malloc, hopscotch_combining_slot_t, (size_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS);
+		if (_list->combining->slots == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+		size_t _a;
+		for (_a = 0; _a < ((size_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS); _a++) {
+			atomic_init(&(_list->combining->slots[_a].state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE);
+		}
+	}
+	if (shm_ready) {
+		_list->head = shm->head;
+	} else if (opts->small.capacity > 0) {
+		// A small list only gets its sentinels once it's promoted.
+		_list->head = NULL;
+	} else {
+		hopscotch_res_t _tmp_001 = _list_new_head(&(_list->head), _list);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		// Let the processes that are waiting on the segment in.
+		if (shm != NULL) {
+			shm->head = _list->head;
+			shm->back_links = opts->back_links.enabled;
+			shm->max_level = opts->max_level;
+			atomic_store_explicit(&(shm->magic), HOPSCOTCH_VAL_SHM_MAGIC, memory_order_release);
+		}
+	}
+	// Set up the hash index if asked to.
+	if (opts->index.enabled) {
+		hopscotch_res_t _tmp_005 = _index_new(&(_list->index), opts, opts->index.capacity);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+	}
+	// Set up the membership filter if a capacity hint is provided.
+	if (opts->filter.capacity > 0) {
+		hopscotch_res_t _tmp_004 = _list_filter_new(&(_list->filter), opts, opts->filter.capacity);
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_004;
+		}
+	}
+	// Set the result.
+	list[0] = _list;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_new_head(hopscotch_node_t ** head, hopscotch_list_t * list) {
+	// Create the left sentinel node.
+	// The left sentinel node's level is, of course, equal to the max level.
+	hopscotch_node_t * list_left_sentinel_node;
+	hopscotch_res_t _tmp_001 = _list_new_el(
+		&list_left_sentinel_node,
+		list,
+		(hopscotch_byte_t *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL,
+		(size_t) (strlen(HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL) + 1),
+		(uint8_t) (list->opts->max_level - 1),
+		(uint8_t) (list->opts->max_level - 1),
+		NULL
+	);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	// Create the right sentinel node.
+	// The right sentinel node's level is, of course, also equal to the max level.
+	hopscotch_node_t * list_right_sentinel_node;
+	hopscotch_res_t _tmp_002 = _list_new_el(
+		&list_right_sentinel_node,
+		list,
+		(hopscotch_byte_t *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL,
+		(size_t) (strlen(HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL) + 1),
+		(uint8_t) (list->opts->max_level - 1),
+		(uint8_t) (list->opts->max_level - 1),
+		NULL
+	);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	int16_t _level;
+	for (_level = 0; ((int) _level) < ((int) list->opts->max_level); _level++) {
+		// All of the right sentinel node's forward pointers point to `NULL`.
+		atomic_store_explicit(&(list_right_sentinel_node->forward[(int) _level]), NULL, memory_order_relaxed);
+		// Initially, all forward pointers of the left sentinel node point to the right sentinel node.
+		atomic_store_explicit(&(list_left_sentinel_node->forward[(int) _level]), list_right_sentinel_node, memory_order_relaxed);
+	}
+	atomic_store_explicit(&(list_right_sentinel_node->backward), list->opts->back_links.enabled ? list_left_sentinel_node : NULL, memory_order_relaxed);
+	// Both sentinel nodes are, initially, fully linked.
+	atomic_store_explicit(&(list_left_sentinel_node->fully_linked), true, memory_order_relaxed);
+	atomic_store_explicit(&(list_right_sentinel_node->fully_linked), true, memory_order_relaxed);
+	// Set the result.
+	head[0] = list_left_sentinel_node;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_note_hit(hopscotch_list_t * list, hopscotch_node_t * node) {
+	// Each thread picks the lookups it counts with its own xorshift generator, so no element (or access pattern) is always or never counted.
+	static _Thread_local uint32_t _state = 0;
+	if (_state == 0) {
+		_state = ((uint32_t) (uintptr_t) &_state) | ((uint32_t) 1);
+	}
+	_state ^= _state << 13;
+	_state ^= _state >> 17;
+	_state ^= _state << 5;
+	if ((_state % HOPSCOTCH_VAL_LIST_ADAPTIVE_SAMPLE_RATE) != 0) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	__atomic_add_fetch(&(list->adaptive->samples), (uint64_t) 1, __ATOMIC_RELAXED);
+	// Only the lookup that gets the node to exactly `HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS` pushes it, so it's on the stack at most once until a pass resets its hits.
+	// Acquire pairs with the pass that last reset the hits, so it's done with `hot_next` before it's written again.
+	if (__atomic_add_fetch(&(node->adaptive->hits), (uint32_t) 1, __ATOMIC_ACQUIRE) == HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS) {
+		node->adaptive->hot_next = atomic_load_explicit(&(list->adaptive->hot), memory_order_relaxed);
+		while (! atomic_compare_exchange_weak_explicit(
+			&(list->adaptive->hot),
+			&(node->adaptive->hot_next),
+			node,
+			memory_order_release,
+			memory_order_relaxed
+		));
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_oldest_version(uint64_t * oldest, hopscotch_list_t * list) {
+	int _tmp_001 = pthread_mutex_lock(&(list->versions->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	oldest[0] = (list->versions->oldest != NULL) ? list->versions->oldest->version : list->versions->current;
+	int _tmp_002 = pthread_mutex_unlock(&(list->versions->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_new_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size,
+	uint8_t level,
+	uint8_t target_level,
+	hopscotch_node_t * base_node
+) {
+	// Only keep what comes after the prefix the element shares with its predecessor.
+	// Nodes with a tower are kept whole: searches compare against them on the way down, without a predecessor to go by, so they'd have to follow the bases every time.
+	// The chain of bases is capped so that getting at a byte never takes too long.
+	size_t shared = 0;
+	if (
+		list->opts->prefix_compression.enabled &&
+		(((int) target_level) == 0) &&
+		(base_node != NULL) &&
+		(base_node != list->head) &&
+		((base_node->prefix == NULL) || (base_node->prefix->depth < (HOPSCOTCH_VAL_LIST_PREFIX_MAX_DEPTH - 1)))
+	) {
+		hopscotch_res_t _tmp_005 = _list_el_lcp(&shared, base_node, (size_t) UINT32_MAX, val, val_size);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+	}
+	// The parts of a node that only some lists (or nodes) use are allocated right after it, and only by those.
+	size_t node_size = sizeof(hopscotch_node_t);
+	size_t towers_offset = node_size;
+	if (list->opts->towers.lazy) {
+		node_size += sizeof(hopscotch_node_towers_t);
+	}
+	size_t prefix_offset = node_size;
+	if (shared > 0) {
+		node_size += sizeof(hopscotch_node_prefix_t);
+	}
+	size_t versions_offset = node_size;
+	if (list->opts->versions.enabled) {
+		node_size += sizeof(hopscotch_node_versions_t);
+	}
+	size_t adaptive_offset = node_size;
+	if (list->opts->towers.adaptive) {
+		node_size += sizeof(hopscotch_node_adaptive_t);
+	}
+	void * _new_node;
+	hopscotch_res_t _tmp_001 = _list_malloc(&_new_node, list, node_size);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_node_t * new_node = (hopscotch_node_t *) _new_node;
+	atomic_store_explicit(&(new_node->level), level, memory_order_relaxed);
+	new_node->target_level = target_level;
+	new_node->towers = NULL;
+	if (list->opts->towers.lazy) {
+		new_node->towers = (hopscotch_node_towers_t *) (((char *) _new_node) + towers_offset);
+		new_node->towers->pending_next = NULL;
+	}
+	new_node->prefix = NULL;
+	if (shared > 0) {
+		new_node->prefix = (hopscotch_node_prefix_t *) (((char *) _new_node) + prefix_offset);
+		new_node->prefix->base = base_node;
+		new_node->prefix->size = (uint32_t) shared;
+		new_node->prefix->depth = (base_node->prefix == NULL) ? ((uint8_t) 1) : (base_node->prefix->depth + 1);
+		val += shared;
+		val_size -= shared;
+	}
+	// Other processes can't see the caller's buffer, so a list in shared memory keeps its own copy of the element.
+	// So does a compressed one: that's where the savings are.
+	if ((list->shm != NULL) || list->opts->prefix_compression.enabled) {
+		void * val_copy;
+		hopscotch_res_t _tmp_002 = _list_malloc(&val_copy, list, val_size);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		memcpy(val_copy, (void *) val, val_size);
+		val = (hopscotch_byte_t *) val_copy;
+	}
+	new_node->val.data = val;
+	new_node->val.size = val_size;
+	atomic_store_explicit(&(new_node->fully_linked), false, memory_order_relaxed);
+	atomic_store_explicit(&(new_node->marked), false, memory_order_relaxed);
+	atomic_store_explicit(&(new_node->backward), NULL, memory_order_relaxed);
+	new_node->versions = NULL;
+	if (list->opts->versions.enabled) {
+		new_node->versions = (hopscotch_node_versions_t *) (((char *) _new_node) + versions_offset);
+		// Bulk-built lists are never seen half-built, so their nodes have been there "forever". Adds stamp theirs.
+		atomic_store_explicit(&(new_node->versions->add), (uint64_t) 0, memory_order_relaxed);
+		atomic_store_explicit(&(new_node->versions->del), HOPSCOTCH_VAL_LIST_VERSION_NONE, memory_order_relaxed);
+		atomic_store_explicit(&(new_node->versions->older), NULL, memory_order_relaxed);
+		new_node->versions->retired = false;
+	}
+	new_node->adaptive = NULL;
+	if (list->opts->towers.adaptive) {
+		new_node->adaptive = (hopscotch_node_adaptive_t *) (((char *) _new_node) + adaptive_offset);
+		new_node->adaptive->hits = 0;
+		new_node->adaptive->since = __atomic_load_n(&(list->adaptive->samples), __ATOMIC_RELAXED);
+		new_node->adaptive->hot_next = NULL;
+		new_node->adaptive->raised = false;
+	}
+	hopscotch_res_t _tmp_003 = _list_init_lock(list, &(new_node->lock));
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	// An adaptive tower can go up to the top.
+	size_t forward_count = list->opts->towers.adaptive ? ((size_t) list->opts->max_level) : (((size_t) target_level) + 1);
+	void * forward;
+	hopscotch_res_t _tmp_004 = _list_malloc(&forward, list, (size_t) (sizeof(HOPSCOTCH_ATOMIC(hopscotch_node_t *)) * forward_count));
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	new_node->forward = (HOPSCOTCH_ATOMIC(hopscotch_node_t *) *) forward;
+	node[0] = new_node;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_prev_el(hopscotch_node_t ** prev_node, hopscotch_list_t * list, hopscotch_node_t * node) {
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	// Every step goes to a smaller element, so this ends at the left sentinel at the latest.
+	while (true) {
+		hopscotch_node_t * stale_pred_node = atomic_load_explicit(&(node->backward), memory_order_acquire);
+		hopscotch_node_t * pred_node = stale_pred_node;
+		if (
+			(pred_node == NULL) ||
+			atomic_load_explicit(&(pred_node->marked), memory_order_acquire) ||
+			(atomic_load_explicit(&(pred_node->forward[0]), memory_order_acquire) != node)
+		) {
+			if (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) == NULL) {
+				// The right sentinel has no val to search for.
+				hopscotch_res_t _tmp_001 = _list_find_last_el(pred_nodes, list);
+				if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_001;
+				}
+			} else {
+				hopscotch_byte_t * val;
+				size_t val_size;
+				hopscotch_res_t _tmp_003 = _list_el_val(&val, &val_size, list, node);
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+				uint8_t _level_found;
+				hopscotch_res_t _tmp_002 = _list_find_el(
+					&_level_found,
+					pred_nodes,
+					succ_nodes,
+					list,
+					val,
+					val_size
+				);
+				if (
+					(_tmp_002 != HOPSCOTCH_RES__SUCCESS) &&
+					(_tmp_002 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+				) {
+					return _tmp_002;
+				}
+			}
+			pred_node = pred_nodes[0];
+			// Repair the back link for the next reader.
+			// If a writer got there first, it knows better, so this only ever replaces the stale link we saw.
+			if (
+				list->opts->back_links.enabled &&
+				(! atomic_load_explicit(&(node->marked), memory_order_acquire))
+			) {
+				atomic_compare_exchange_strong_explicit(
+					&(node->backward),
+					&stale_pred_node,
+					pred_node,
+					memory_order_release,
+					memory_order_relaxed
+				);
+			}
+		}
+		if (pred_node == list->head) {
+			prev_node[0] = NULL;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		bool visible;
+		_list_el_visible(&visible, pred_node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+		if (visible) {
+			prev_node[0] = pred_node;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		node = pred_node;
+	}
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_list_rand_level(uint8_t * level, hopscotch_list_t * list) {
+	// Each thread has its own xorshift64* generator (seeded from the clock and the thread's copy of the state), so concurrent adds don't contend on a shared one.
+	static _Thread_local uint64_t _state = 0;
+	if (_state == 0) {
+		_state = (((uint64_t) timestamp()) ^ ((uint64_t) (uintptr_t) &_state)) | ((uint64_t) 1);
+	}
+	int16_t _level = 0;
+	while (((int) _level) < (((int) list->opts->max_level) - 1)) {
+		_state ^= _state >> 12;
+		_state ^= _state << 25;
+		_state ^= _state >> 27;
+		// The top 53 bits, as a double in `[0, 1)`.
+		double _r = ((double) ((_state * ((uint64_t) 0x2545F4914F6CDD1DULL)) >> 11)) * (1.0 / 9007199254740992.0);
+		if (_r >= list->opts->rand_level_p) {
+			break;
+		}
+		_level++;
+	}
+	level[0] = (uint8_t) _level;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_repair_el(hopscotch_list_t * list, hopscotch_node_t * node) {
+	// A deleter holds the lock of the node it deletes until the node is unlinked, so a marked node means its delete was cut short.
+	if (atomic_load_explicit(&(node->marked), memory_order_acquire)) {
+		return _list_unlink_el(list, node);
+	}
+	// An adder holds the locks of the new node's predecessors until the new node is fully linked, so a successor that isn't means its add was cut short.
+	// Adds link bottom-up, so the node is linked exactly up to the highest level it's found at. Making that its level finishes the add.
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	int16_t top_level = (int16_t) atomic_load_explicit(&(node->level), memory_order_acquire);
+	int16_t _level;
+	for (_level = 0; ((int) _level) <= ((int) top_level); _level++) {
+		hopscotch_node_t * succ_node = atomic_load_explicit(&(node->forward[(int) _level]), memory_order_acquire);
+		if (
+			(succ_node == NULL) ||
+			atomic_load_explicit(&(succ_node->fully_linked), memory_order_acquire) ||
+			atomic_load_explicit(&(succ_node->marked), memory_order_acquire)
+		) {
+			continue;
+		}
+		hopscotch_byte_t * val;
+		size_t val_size;
+		hopscotch_res_t _tmp_002 = _list_el_val(&val, &val_size, list, succ_node);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_001 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			val,
+			val_size
+		);
+		if (
+			(_tmp_001 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			return _tmp_001;
+		}
+		if (
+			(_tmp_001 == HOPSCOTCH_RES__SUCCESS) &&
+			(succ_nodes[(int) _level_found] == succ_node)
+		) {
+			atomic_store_explicit(&(succ_node->level), _level_found, memory_order_release);
+			atomic_store_explicit(&(succ_node->fully_linked), true, memory_order_release);
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_retire_el(hopscotch_list_t * list, hopscotch_node_t * node) {
+	// A node that's added back and deleted again while it's still on the stack stays there once.
+	if (node->versions->retired) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	node->versions->retired = true;
+	// Treiber stack push, same as `_list_defer_el`.
+	node->versions->retired_next = atomic_load_explicit(&(list->versions->retired), memory_order_relaxed);
+	while (! atomic_compare_exchange_weak_explicit(
+		&(list->versions->retired),
+		&(node->versions->retired_next),
+		node,
+		memory_order_release,
+		memory_order_relaxed
+	));
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_revive_el(bool * revived, hopscotch_list_t * list, hopscotch_node_t * node) {
+	revived[0] = false;
+	// Allocate outside of the node's lock, same as `_list_add_el` does with new nodes.
+	hopscotch_version_t * range = _MALLOC(list->opts->gc.malloc, hopscotch_version_t, ((size_t) 1));
+	if (range == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	hopscotch_res_t _tmp_001 = _list_lock_el(list, node);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_res_t _tmp_002 = HOPSCOTCH_RES__SUCCESS;
+	if (
+		(! atomic_load_explicit(&(node->marked), memory_order_acquire)) &&
+		(atomic_load_explicit(&(node->versions->del), memory_order_acquire) != HOPSCOTCH_VAL_LIST_VERSION_NONE)
+	) {
+		range->add = atomic_load_explicit(&(node->versions->add), memory_order_relaxed);
+		range->del = atomic_load_explicit(&(node->versions->del), memory_order_relaxed);
+		range->older = atomic_load_explicit(&(node->versions->older), memory_order_relaxed);
+		uint64_t oldest;
+		_tmp_002 = _list_oldest_version(&oldest, list);
+		if (_tmp_002 == HOPSCOTCH_RES__SUCCESS) {
+			// Ranges that no snapshot can see anymore are dropped (along with the older ones, which ended before them).
+			atomic_store_explicit(&(node->versions->older), (range->del > oldest) ? range : NULL, memory_order_release);
+			// See `_list_el_visible` for the order.
+			atomic_store_explicit(&(node->versions->add), HOPSCOTCH_VAL_LIST_VERSION_NONE, memory_order_release);
+			atomic_store_explicit(&(node->versions->del), HOPSCOTCH_VAL_LIST_VERSION_NONE, memory_order_release);
+			uint64_t version;
+			_tmp_002 = _list_stamp_el(&version, &oldest, list, &(node->versions->add));
+			revived[0] = true;
+		}
+	}
+	int _tmp_003 = pthread_mutex_unlock(&(node->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return _tmp_002;
+}
+
+static hopscotch_res_t
+_list_search_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_node_t * pred_node = list->head;
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		hopscotch_node_t * curr_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		while (true) {
+			int _cmp_res_001;
+			hopscotch_res_t _tmp_001 = _list_cmp_el(
+				&_cmp_res_001,
+				NULL,
+				list->opts,
+				curr_node,
+				NULL,
+				NULL,
+				val,
+				val_size
+			);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (_cmp_res_001 == 0) {
+				node[0] = curr_node;
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+			if (_cmp_res_001 > 0) {
+				break;
+			}
+			pred_node = curr_node;
+			curr_node = atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire);
+		}
+	}
+	node[0] = NULL;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_set_op(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b,
+	bool keep_a,
+	bool keep_both,
+	bool keep_b
+) {
+	hopscotch_list_t * _result = NULL;
+	hopscotch_res_t _tmp_001 = hopscotch_list_new(&_result, list_a->opts);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_res_t _tmp_012 = _small_pin(_result);
+	if (_tmp_012 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_012;
+	}
+	hopscotch_res_t _tmp_013 = _small_pin(list_a);
+	if (_tmp_013 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_013;
+	}
+	hopscotch_res_t _tmp_014 = _small_pin(list_b);
+	if (_tmp_014 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_014;
+	}
+	hopscotch_node_t * tail_nodes[(int) _result->opts->max_level];
+	hopscotch_node_t * finger_nodes_a[(int) list_a->opts->max_level];
+	hopscotch_node_t * succ_nodes_a[(int) list_a->opts->max_level];
+	hopscotch_node_t * finger_nodes_b[(int) list_b->opts->max_level];
+	hopscotch_node_t * succ_nodes_b[(int) list_b->opts->max_level];
+	int16_t _level;
+	for (_level = 0; ((int) _level) < ((int) _result->opts->max_level); _level++) {
+		tail_nodes[(int) _level] = _result->head;
+	}
+	for (_level = 0; ((int) _level) < ((int) list_a->opts->max_level); _level++) {
+		finger_nodes_a[(int) _level] = list_a->head;
+	}
+	for (_level = 0; ((int) _level) < ((int) list_b->opts->max_level); _level++) {
+		finger_nodes_b[(int) _level] = list_b->head;
+	}
+	hopscotch_node_t * node_a = atomic_load_explicit(&(list_a->head->forward[0]), memory_order_acquire);
+	hopscotch_node_t * node_b = atomic_load_explicit(&(list_b->head->forward[0]), memory_order_acquire);
+	_list_live_el(&node_a);
+	_list_live_el(&node_b);
+	// How many elements in a row we've taken from each side.
+	size_t run_a = 0;
+	size_t run_b = 0;
+	while (
+		(atomic_load_explicit(&(node_a->forward[0]), memory_order_acquire) != NULL) &&
+		(atomic_load_explicit(&(node_b->forward[0]), memory_order_acquire) != NULL)
+	) {
+		// Compressed elements are put back together first, since they're appended to the result (which has its own prefixes).
+		hopscotch_byte_t * val_a;
+		size_t val_a_size;
+		hopscotch_res_t _tmp_008 = _list_el_val(&val_a, &val_a_size, list_a, node_a);
+		if (_tmp_008 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_008;
+		}
+		hopscotch_byte_t * val_b;
+		size_t val_b_size;
+		hopscotch_res_t _tmp_009 = _list_el_val(&val_b, &val_b_size, list_b, node_b);
+		if (_tmp_009 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_009;
+		}
+		int _cmp_res_001;
+		hopscotch_res_t _tmp_002 = list_a->opts->cmp(
+			&_cmp_res_001,
+			val_a,
+			val_a_size,
+			val_b,
+			val_b_size
+		);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		if (_cmp_res_001 == 0) {
+			if (keep_both) {
+				hopscotch_res_t _tmp_003 = _list_append_el(_result, tail_nodes, val_a, val_a_size);
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+			}
+			node_a = atomic_load_explicit(&(node_a->forward[0]), memory_order_acquire);
+			node_b = atomic_load_explicit(&(node_b->forward[0]), memory_order_acquire);
+			_list_live_el(&node_a);
+			_list_live_el(&node_b);
+			run_a = 0;
+			run_b = 0;
+			continue;
+		}
+		// From here on, `node` is whichever side is behind.
+		bool a_is_smaller = (bool) (_cmp_res_001 < 0);
+		hopscotch_node_t ** node = a_is_smaller ? &node_a : &node_b;
+		hopscotch_byte_t * val = a_is_smaller ? val_a : val_b;
+		size_t val_size = a_is_smaller ? val_a_size : val_b_size;
+		hopscotch_byte_t * other_val = a_is_smaller ? val_b : val_a;
+		size_t other_val_size = a_is_smaller ? val_b_size : val_a_size;
+		hopscotch_list_t * list = a_is_smaller ? list_a : list_b;
+		size_t * run = a_is_smaller ? &run_a : &run_b;
+		size_t * other_run = a_is_smaller ? &run_b : &run_a;
+		bool keep = a_is_smaller ? keep_a : keep_b;
+		if (keep) {
+			hopscotch_res_t _tmp_004 = _list_append_el(_result, tail_nodes, val, val_size);
+			if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_004;
+			}
+		}
+		node[0] = atomic_load_explicit(&(node[0]->forward[0]), memory_order_acquire);
+		_list_live_el(node);
+		run[0]++;
+		other_run[0] = 0;
+		// A long run on one side means the lists are lopsided here.
+		// If that side's elements are being thrown away anyway, gallop over them through the upper levels instead of walking level 0.
+		if ((! keep) && (run[0] >= HOPSCOTCH_VAL_LIST_GALLOP_THRESHOLD)) {
+			hopscotch_node_t ** finger_nodes = a_is_smaller ? finger_nodes_a : finger_nodes_b;
+			hopscotch_node_t ** succ_nodes = a_is_smaller ? succ_nodes_a : succ_nodes_b;
+			uint8_t _level_found;
+			hopscotch_res_t _tmp_005 = _list_find_el_from(
+				&_level_found,
+				finger_nodes,
+				succ_nodes,
+				list,
+				finger_nodes,
+				other_val,
+				other_val_size
+			);
+			if (
+				(_tmp_005 != HOPSCOTCH_RES__SUCCESS) &&
+				(_tmp_005 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+			) {
+				return _tmp_005;
+			}
+			node[0] = succ_nodes[0];
+			_list_live_el(node);
+			run[0] = 0;
+		}
+	}
+	// Whatever is left over on one side is bigger than everything on the other.
+	for (; keep_a && (atomic_load_explicit(&(node_a->forward[0]), memory_order_acquire) != NULL); node_a = atomic_load_explicit(&(node_a->forward[0]), memory_order_acquire)) {
+		_list_live_el(&node_a);
+		if (atomic_load_explicit(&(node_a->forward[0]), memory_order_acquire) == NULL) {
+			break;
+		}
+		hopscotch_byte_t * val_a;
+		size_t val_a_size;
+		hopscotch_res_t _tmp_010 = _list_el_val(&val_a, &val_a_size, list_a, node_a);
+		if (_tmp_010 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_010;
+		}
+		hopscotch_res_t _tmp_006 = _list_append_el(_result, tail_nodes, val_a, val_a_size);
+		if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_006;
+		}
+	}
+	for (; keep_b && (atomic_load_explicit(&(node_b->forward[0]), memory_order_acquire) != NULL); node_b = atomic_load_explicit(&(node_b->forward[0]), memory_order_acquire)) {
+		_list_live_el(&node_b);
+		if (atomic_load_explicit(&(node_b->forward[0]), memory_order_acquire) == NULL) {
+			break;
+		}
+		hopscotch_byte_t * val_b;
+		size_t val_b_size;
+		hopscotch_res_t _tmp_011 = _list_el_val(&val_b, &val_b_size, list_b, node_b);
+		if (_tmp_011 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_011;
+		}
+		hopscotch_res_t _tmp_007 = _list_append_el(_result, tail_nodes, val_b, val_b_size);
+		if (_tmp_007 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_007;
+		}
+	}
+	_list_set_tails(_result, tail_nodes);
+	// Set the result.
+	result[0] = _result;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_set_tails(hopscotch_list_t * list, hopscotch_node_t ** tail_nodes) {
+	if (list->append.tails == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int16_t _level;
+	for (_level = 0; ((int) _level) < ((int) list->opts->max_level); _level++) {
+		atomic_store_explicit(
+			&(list->append.tails[(int) _level]),
+			(tail_nodes == NULL) ? NULL : tail_nodes[(int) _level],
+			memory_order_release
+		);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_stamp_el(
+	uint64_t * version,
+	uint64_t * oldest,
+	hopscotch_list_t * list,
+	HOPSCOTCH_ATOMIC(uint64_t) * stamp
+) {
+	int _tmp_001 = pthread_mutex_lock(&(list->versions->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Under the lock, so that a snapshot either gets this version (and sees the change) or an older one (and doesn't).
+	version[0] = ++(list->versions->current);
+	atomic_store_explicit(stamp, version[0], memory_order_release);
+	oldest[0] = (list->versions->oldest != NULL) ? list->versions->oldest->version : list->versions->current;
+	int _tmp_002 = pthread_mutex_unlock(&(list->versions->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_list_unlink_el(hopscotch_list_t * list, hopscotch_node_t * node) {
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	hopscotch_byte_t * val;
+	size_t val_size;
+	hopscotch_res_t _tmp_004 = _list_el_val(&val, &val_size, list, node);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	while (true) {
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_001 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			val,
+			val_size
+		);
+		if (
+			(_tmp_001 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			return _tmp_001;
+		}
+		if (
+			(_tmp_001 == HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) ||
+			(succ_nodes[(int) _level_found] != node)
+		) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// Nodes are unlinked top-down, so one that's been partly unlinked (by a process that died, see `_list_repair_el`) is still linked exactly up to where it's found.
+		int16_t top_level = (int16_t) _level_found;
+		// Same as the second half of `hopscotch_list_del_el`.
+		int16_t highest_level_locked = -1;
+		hopscotch_node_t * prev_pred_node = NULL;
+		bool valid = true;
+		int16_t _level;
+		for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
+			hopscotch_node_t * pred_node = pred_nodes[(int) _level];
+			if (pred_node != prev_pred_node) {
+				hopscotch_res_t _tmp_002 = _list_lock_el(list, pred_node);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					// Release locks!
+					_list_unlock_preds(pred_nodes, highest_level_locked);
+					return _tmp_002;
+				}
+				highest_level_locked = _level;
+				prev_pred_node = pred_node;
+			}
+			valid = (bool) (
+				(! atomic_load_explicit(&(pred_node->marked), memory_order_acquire)) &&
+				(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) >= ((int) _level)) &&
+				(atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire) == node)
+			);
+		}
+		if (valid) {
+			int16_t _a;
+			for (_a = top_level; ((int) _a) >= 0; _a--) {
+				atomic_store_explicit(&(pred_nodes[(int) _a]->forward[(int) _a]), atomic_load_explicit(&(node->forward[(int) _a]), memory_order_acquire), memory_order_release);
+			}
+			_list_link_back(list, atomic_load_explicit(&(node->forward[0]), memory_order_acquire), pred_nodes[0]);
+		}
+		// Release locks!
+		hopscotch_res_t _tmp_003 = _list_unlock_preds(pred_nodes, highest_level_locked);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+		if (valid) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+}
+
+static hopscotch_res_t
+_list_unlink_pending(hopscotch_list_t * list, hopscotch_node_set_t * pending_nodes, hopscotch_node_t * last_node) {
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	size_t unlinked_count = 0;
+	hopscotch_node_t * node = atomic_load_explicit(&(list->head->forward[0]), memory_order_acquire);
+	while ((unlinked_count < pending_nodes->count) && (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL)) {
+		hopscotch_node_t * next_node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+		bool pending;
+		_node_set_has(&pending, pending_nodes, node);
+		if (pending) {
+			// Keep going after a failure, so that as few nodes as possible are left behind.
+			hopscotch_res_t _tmp_001 = _list_unlink_el(list, node);
+			if ((_tmp_001 != HOPSCOTCH_RES__SUCCESS) && (res == HOPSCOTCH_RES__SUCCESS)) {
+				res = _tmp_001;
+			}
+			unlinked_count++;
+		}
+		node = next_node;
+	}
+	if (last_node != NULL) {
+		hopscotch_res_t _tmp_002 = _list_unlink_el(list, last_node);
+		if ((_tmp_002 != HOPSCOTCH_RES__SUCCESS) && (res == HOPSCOTCH_RES__SUCCESS)) {
+			res = _tmp_002;
+		}
+	}
+	return res;
+}
+
+static hopscotch_res_t
+_list_unlock_preds(hopscotch_node_t ** pred_nodes, int16_t highest_level_locked) {
+	// Keep going after a failure, so that one bad unlock doesn't leave the other locks held.
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	hopscotch_node_t * prev_pred_node = NULL;
+	int16_t _level;
+	for (_level = 0; ((int) _level) <= ((int) highest_level_locked); _level++) {
+		if (pred_nodes[(int) _level] == prev_pred_node) {
+			continue;
+		}
+		prev_pred_node = pred_nodes[(int) _level];
+		int _tmp_001 = pthread_mutex_unlock(&(pred_nodes[(int) _level]->lock));
+		if (_tmp_001 != 0) {
+			res = HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+	}
+	return res;
+}
+
+static hopscotch_res_t
+_lsm_acquire(hopscotch_lsm_state_t ** state, hopscotch_lsm_t * lsm) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	lsm->state->refs++;
+	state[0] = lsm->state;
+	int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_builder_abort(hopscotch_lsm_builder_t * builder) {
+	close(builder->fd);
+	if (unlink(builder->tmp_path) != 0) {
+		return HOPSCOTCH_RES_UNLINK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_builder_add(
+	hopscotch_lsm_builder_t * builder,
+	hopscotch_byte_t op,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_lsm_t * lsm = builder->lsm;
+	size_t entry_size = ((size_t) 1) + sizeof(uint32_t) + val_size;
+	if (
+		(builder->block_used > 0) &&
+		((builder->block_used + entry_size) > lsm->opts->lsm.block_size)
+	) {
+		hopscotch_res_t _tmp_001 = _lsm_builder_cut(builder);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+	}
+	uint32_t _val_size = (uint32_t) val_size;
+	if ((builder->block_count % HOPSCOTCH_VAL_LSM_RESTART_INTERVAL) == 0) {
+		hopscotch_res_t _tmp_002 = _lsm_grow(
+			lsm,
+			&(builder->restarts),
+			&(builder->restarts_capacity),
+			builder->restarts_used,
+			builder->restarts_used + sizeof(uint32_t)
+		);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		uint32_t restart = (uint32_t) builder->block_used;
+		memcpy((void *) (builder->restarts + builder->restarts_used), (void *) &restart, sizeof(uint32_t));
+		builder->restarts_used += sizeof(uint32_t);
+	}
+	hopscotch_res_t _tmp_003 = _lsm_grow(
+		lsm,
+		&(builder->block),
+		&(builder->block_capacity),
+		builder->block_used,
+		builder->block_used + entry_size
+	);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	builder->block[builder->block_used] = op;
+	memcpy((void *) (builder->block + builder->block_used + 1), (void *) &_val_size, sizeof(uint32_t));
+	if (val_size > 0) {
+		memcpy((void *) (builder->block + builder->block_used + 1 + sizeof(uint32_t)), (void *) val, val_size);
+	}
+	builder->block_used += entry_size;
+	builder->block_count++;
+	builder->header.count++;
+	if (op == HOPSCOTCH_VAL_LSM_OP_DEL) {
+		builder->header.tombstones++;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_builder_cut(hopscotch_lsm_builder_t * builder) {
+	hopscotch_lsm_t * lsm = builder->lsm;
+	// The block's fence pointer, with the element of its first entry.
+	uint32_t val_size;
+	memcpy((void *) &val_size, (void *) (builder->block + 1), sizeof(uint32_t));
+	hopscotch_res_t _tmp_001 = _lsm_grow(
+		lsm,
+		&(builder->index),
+		&(builder->index_capacity),
+		builder->index_used,
+		builder->index_used + (sizeof(uint64_t) * 2) + sizeof(uint32_t) + ((size_t) val_size)
+	);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	uint64_t offsets[2] = {(uint64_t) builder->offset, (uint64_t) (builder->offset + builder->block_used)};
+	memcpy((void *) (builder->index + builder->index_used), (void *) offsets, sizeof(uint64_t) * 2);
+	builder->index_used += sizeof(uint64_t) * 2;
+	memcpy((void *) (builder->index + builder->index_used), (void *) &val_size, sizeof(uint32_t));
+	builder->index_used += sizeof(uint32_t);
+	if (val_size > 0) {
+		memcpy((void *) (builder->index + builder->index_used), (void *) (builder->block + 1 + sizeof(uint32_t)), (size_t) val_size);
+	}
+	builder->index_used += (size_t) val_size;
+	builder->header.blocks_count++;
+	// The restart points go after the entries.
+	hopscotch_res_t _tmp_002 = _lsm_grow(
+		lsm,
+		&(builder->block),
+		&(builder->block_capacity),
+		builder->block_used,
+		builder->block_used + builder->restarts_used
+	);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	memcpy((void *) (builder->block + builder->block_used), (void *) builder->restarts, builder->restarts_used);
+	builder->block_used += builder->restarts_used;
+	hopscotch_res_t _tmp_003 = _lsm_write(builder->fd, builder->block, builder->block_used, builder->offset);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	builder->offset += builder->block_used;
+	builder->block_used = 0;
+	builder->block_count = 0;
+	builder->restarts_used = 0;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_builder_finish(hopscotch_lsm_run_t ** run, hopscotch_lsm_builder_t * builder) {
+	if (builder->header.count == 0) {
+		run[0] = NULL;
+		return _lsm_builder_abort(builder);
+	}
+	if (builder->block_used > 0) {
+		hopscotch_res_t _tmp_001 = _lsm_builder_cut(builder);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+	}
+	builder->header.index_offset = (uint64_t) builder->offset;
+	hopscotch_res_t _tmp_002 = _lsm_write(builder->fd, builder->index, builder->index_used, builder->offset);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	builder->offset += builder->index_used;
+	builder->header.size = (uint64_t) builder->offset;
+	builder->header.magic = HOPSCOTCH_VAL_LSM_RUN_MAGIC;
+	hopscotch_res_t _tmp_003 = _lsm_write(
+		builder->fd,
+		(hopscotch_byte_t *) &(builder->header),
+		sizeof(hopscotch_lsm_run_header_t),
+		(size_t) 0
+	);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	// The run has to be on disk before it takes the place of the memtable (or the runs) it came from.
+	if (fsync(builder->fd) != 0) {
+		return HOPSCOTCH_RES_FSYNC_FAIL;
+	}
+	close(builder->fd);
+	builder->fd = -1;
+	if (rename(builder->tmp_path, builder->path) != 0) {
+		unlink(builder->tmp_path);
+		return HOPSCOTCH_RES_RENAME_FAIL;
+	}
+	hopscotch_res_t _tmp_004 = _lsm_sync_dir(builder->lsm);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	return _lsm_run_open(run, builder->lsm, builder->path);
+}
+
+static hopscotch_res_t
+_lsm_builder_new(
+	hopscotch_lsm_builder_t * builder,
+	hopscotch_lsm_t * lsm,
+	uint64_t seq_min,
+	uint64_t seq_max
+) {
+	builder->lsm = lsm;
+	builder->fd = -1;
+	memset((void *) &(builder->header), 0, sizeof(hopscotch_lsm_run_header_t));
+	builder->header.seq_min = seq_min;
+	builder->header.seq_max = seq_max;
+	builder->header.file = __atomic_add_fetch(&(lsm->file), (uint64_t) 1, __ATOMIC_RELAXED);
+	hopscotch_res_t _tmp_001 = _lsm_run_path(&(builder->path), lsm, seq_min, seq_max, builder->header.file);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	size_t path_size = strlen(builder->path);
+	builder->tmp_path = _MALLOC(lsm->opts->gc.malloc, char, path_size + 5);
+	if (builder->tmp_path == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memcpy((void *) builder->tmp_path, (void *) builder->path, path_size);
+	memcpy((void *) (builder->tmp_path + path_size), (void *) ".tmp", (size_t) 5);
+	builder->block_used = 0;
+	builder->block_count = 0;
+	builder->block_capacity = lsm->opts->lsm.block_size;
+	builder->block = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, builder->block_capacity);
+	if (builder->block == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	builder->restarts_used = 0;
+	builder->restarts_capacity = (size_t) 64;
+	builder->restarts = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, builder->restarts_capacity);
+	if (builder->restarts == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// The header is written last, once the counts are known.
+	builder->offset = sizeof(hopscotch_lsm_run_header_t);
+	builder->index_used = 0;
+	builder->index_capacity = (size_t) 256;
+	builder->index = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, builder->index_capacity);
+	if (builder->index == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	builder->fd = open(builder->tmp_path, (O_WRONLY | O_CREAT | O_TRUNC), (mode_t) 0644);
+	if (builder->fd < 0) {
+		return HOPSCOTCH_RES_OPEN_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_compact(hopscotch_lsm_t * lsm, size_t first, size_t count) {
+	hopscotch_lsm_state_t * state;
+	hopscotch_res_t _tmp_001 = _lsm_acquire(&state, lsm);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_lsm_run_t ** runs = state->runs + first;
+	// Tombstones only have to be kept while there's an older run that they could be hiding an element in.
+	bool drop = (bool) ((first + count) == state->runs_count);
+	// The number of runs isn't bounded, so the cursors don't go on the stack.
+	hopscotch_lsm_cursor_t * cursors = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_cursor_t, count);
+	if (cursors == NULL) {
+		_lsm_release(lsm, state);
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	size_t i;
+	for (i = 0; i < count; i++) {
+		_lsm_cursor_init(&(cursors[i]), runs[i], (size_t) 0, (size_t) runs[i]->header.blocks_count);
+		if (res == HOPSCOTCH_RES__SUCCESS) {
+			res = _lsm_cursor_next(&(cursors[i]));
+		}
+	}
+	hopscotch_lsm_builder_t builder;
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		res = _lsm_builder_new(&builder, lsm, runs[count - 1]->header.seq_min, runs[0]->header.seq_max);
+		if ((res != HOPSCOTCH_RES__SUCCESS) && (builder.fd >= 0)) {
+			_lsm_builder_abort(&builder);
+		}
+	}
+	hopscotch_lsm_run_t * run = NULL;
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		while (res == HOPSCOTCH_RES__SUCCESS) {
+			// The smallest element the cursors are at. When several runs have it, the newest one's entry wins, and the others are skipped.
+			size_t min = count;
+			int cmp_res;
+			for (i = 0; i < count; i++) {
+				if (cursors[i].val == NULL) {
+					continue;
+				}
+				if (min == count) {
+					min = i;
+					continue;
+				}
+				res = _lsm_val_cmp(&cmp_res, cursors[i].val, cursors[i].val_size, cursors[min].val, cursors[min].val_size);
+				if (res != HOPSCOTCH_RES__SUCCESS) {
+					break;
+				}
+				if (cmp_res < 0) {
+					min = i;
+				}
+			}
+			if ((res != HOPSCOTCH_RES__SUCCESS) || (min == count)) {
+				break;
+			}
+			for (i = min + 1; (i < count) && (res == HOPSCOTCH_RES__SUCCESS); i++) {
+				if (cursors[i].val == NULL) {
+					continue;
+				}
+				res = _lsm_val_cmp(&cmp_res, cursors[i].val, cursors[i].val_size, cursors[min].val, cursors[min].val_size);
+				if ((res == HOPSCOTCH_RES__SUCCESS) && (cmp_res == 0)) {
+					res = _lsm_cursor_next(&(cursors[i]));
+				}
+			}
+			if ((res == HOPSCOTCH_RES__SUCCESS) && (! (drop && (cursors[min].op == HOPSCOTCH_VAL_LSM_OP_DEL)))) {
+				res = _lsm_builder_add(&builder, cursors[min].op, cursors[min].val, cursors[min].val_size);
+			}
+			if (res == HOPSCOTCH_RES__SUCCESS) {
+				res = _lsm_cursor_next(&(cursors[min]));
+			}
+		}
+		if (res == HOPSCOTCH_RES__SUCCESS) {
+			res = _lsm_builder_finish(&run, &builder);
+		} else if (builder.fd >= 0) {
+			_lsm_builder_abort(&builder);
+		}
+	}
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		_lsm_release(lsm, state);
+		return res;
+	}
+	int _tmp_002 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_002 != 0) {
+		// The merged run never made it in, so it goes (the runs it was made from are all still there).
+		if (run != NULL) {
+			munmap((void *) run->map, (size_t) run->header.size);
+			unlink(run->path);
+		}
+		// Our reference has to go too, or `_lsm_flush_frozen` would wait on the state forever.
+		_lsm_release(lsm, state);
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Only compactions take runs out, and they're never run two at a time, so the runs are still next to each other (flushes only add newer ones).
+	hopscotch_lsm_state_t * current_state = lsm->state;
+	size_t at = 0;
+	while (current_state->runs[at] != runs[0]) {
+		at++;
+	}
+	hopscotch_lsm_state_t * next_state;
+	res = _lsm_state_new(
+		&next_state,
+		lsm,
+		(current_state->runs_count - count) + ((run != NULL) ? ((size_t) 1) : ((size_t) 0))
+	);
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		next_state->memtable = current_state->memtable;
+		next_state->frozen = current_state->frozen;
+		next_state->frozen_seq = current_state->frozen_seq;
+		size_t j = 0;
+		for (i = 0; i < current_state->runs_count; i++) {
+			if (i == at) {
+				if (run != NULL) {
+					next_state->runs[j++] = run;
+				}
+				i += count - 1;
+				continue;
+			}
+			next_state->runs[j++] = current_state->runs[i];
+		}
+		for (i = 0; i < count; i++) {
+			runs[i]->obsolete = true;
+		}
+		res = _lsm_install(lsm, next_state);
+	}
+	hopscotch_res_t _tmp_003 = _lsm_state_unref(lsm, state);
+	int _tmp_004 = pthread_mutex_unlock(&(lsm->lock));
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	if (_tmp_004 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_cursor_init(
+	hopscotch_lsm_cursor_t * cursor,
+	hopscotch_lsm_run_t * run,
+	size_t block,
+	size_t blocks_end
+) {
+	cursor->run = run;
+	cursor->block = block;
+	cursor->blocks_end = blocks_end;
+	cursor->offset = run->fences[block].offset;
+	cursor->end = run->fences[block].restarts;
+	cursor->val = NULL;
+	cursor->val_size = 0;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_cursor_next(hopscotch_lsm_cursor_t * cursor) {
+	while (cursor->offset >= cursor->end) {
+		if ((cursor->block + 1) >= cursor->blocks_end) {
+			cursor->val = NULL;
+			cursor->val_size = 0;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		cursor->block++;
+		cursor->offset = cursor->run->fences[cursor->block].offset;
+		cursor->end = cursor->run->fences[cursor->block].restarts;
+	}
+	hopscotch_byte_t * entry = cursor->run->map + cursor->offset;
+	size_t left = cursor->end - cursor->offset;
+	if (left < (((size_t) 1) + sizeof(uint32_t))) {
+		return HOPSCOTCH_RES_LSM_INVALID_RUN;
+	}
+	uint32_t val_size;
+	memcpy((void *) &val_size, (void *) (entry + 1), sizeof(uint32_t));
+	if ((left - ((size_t) 1) - sizeof(uint32_t)) < ((size_t) val_size)) {
+		return HOPSCOTCH_RES_LSM_INVALID_RUN;
+	}
+	cursor->op = entry[0];
+	cursor->val = entry + 1 + sizeof(uint32_t);
+	cursor->val_size = (size_t) val_size;
+	cursor->offset += ((size_t) 1) + sizeof(uint32_t) + ((size_t) val_size);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_el_cmp(
+	int * res,
+	hopscotch_byte_t * val_a,
+	size_t val_a_size,
+	hopscotch_byte_t * val_b,
+	size_t val_b_size
+) {
+	const char * min_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL;
+	const char * max_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL;
+	size_t min_val_size = (size_t) (strlen(min_val) + 1);
+	size_t max_val_size = (size_t) (strlen(max_val) + 1);
+	// Like `_list_default_el_cmp`, this assumes `val_a` is the element already in the list, which is the only one that can be a sentinel.
+	// Since nothing else has a `0` or `1` where the sentinels have a `<`, an element can't be mistaken for one.
+	if (
+		((val_a_size == min_val_size) && (memcmp((void *) val_a, (void *) min_val, min_val_size) == 0)) ||
+		((val_a_size == max_val_size) && (memcmp((void *) val_a, (void *) max_val, max_val_size) == 0))
+	) {
+		return _list_default_el_cmp(res, val_a, val_a_size, val_b, val_b_size);
+	}
+	return _lsm_val_cmp(res, val_a + 1, val_a_size - 1, val_b + 1, val_b_size - 1);
+}
+
+static hopscotch_res_t
+_lsm_find_el(
+	bool * known,
+	hopscotch_byte_t * op,
+	hopscotch_lsm_run_t * run,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	known[0] = false;
+	// Find the first block that starts after `val`; the one before it is the only one `val` can be in.
+	size_t low = 0;
+	size_t high = (size_t) run->header.blocks_count;
+	int cmp_res;
+	while (low < high) {
+		size_t mid = low + ((high - low) / 2);
+		hopscotch_res_t _tmp_001 = _lsm_val_cmp(&cmp_res, run->fences[mid].val, run->fences[mid].val_size, val, val_size);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		if (cmp_res <= 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (low == 0) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	hopscotch_lsm_fence_t * fence = &(run->fences[low - 1]);
+	// Then the last restart point that's at or before `val`.
+	hopscotch_byte_t * restarts = run->map + fence->restarts;
+	size_t restarts_count = (fence->end - fence->restarts) / sizeof(uint32_t);
+	size_t entries_size = fence->restarts - fence->offset;
+	hopscotch_lsm_cursor_t cursor;
+	_lsm_cursor_init(&cursor, run, low - 1, low);
+	low = 1;
+	high = restarts_count;
+	while (low < high) {
+		size_t mid = low + ((high - low) / 2);
+		uint32_t restart;
+		memcpy((void *) &restart, (void *) (restarts + (mid * sizeof(uint32_t))), sizeof(uint32_t));
+		uint32_t restart_val_size;
+		if (
+			(((size_t) restart) >= entries_size) ||
+			((entries_size - ((size_t) restart)) < (((size_t) 1) + sizeof(uint32_t)))
+		) {
+			return HOPSCOTCH_RES_LSM_INVALID_RUN;
+		}
+		memcpy((void *) &restart_val_size, (void *) (run->map + fence->offset + restart + 1), sizeof(uint32_t));
+		if ((entries_size - ((size_t) restart) - ((size_t) 1) - sizeof(uint32_t)) < ((size_t) restart_val_size)) {
+			return HOPSCOTCH_RES_LSM_INVALID_RUN;
+		}
+		hopscotch_res_t _tmp_002 = _lsm_val_cmp(
+			&cmp_res,
+			run->map + fence->offset + restart + 1 + sizeof(uint32_t),
+			(size_t) restart_val_size,
+			val,
+			val_size
+		);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		if (cmp_res <= 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	uint32_t restart;
+	memcpy((void *) &restart, (void *) (restarts + ((low - 1) * sizeof(uint32_t))), sizeof(uint32_t));
+	cursor.offset += (size_t) restart;
+	while (true) {
+		hopscotch_res_t _tmp_005 = _lsm_cursor_next(&cursor);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+		if (cursor.val == NULL) {
+			break;
+		}
+		hopscotch_res_t _tmp_003 = _lsm_val_cmp(&cmp_res, cursor.val, cursor.val_size, val, val_size);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+		if (cmp_res == 0) {
+			known[0] = true;
+			op[0] = cursor.op;
+			break;
+		}
+		if (cmp_res > 0) {
+			break;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_flush_frozen(hopscotch_lsm_t * lsm) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Writers pin the state they add to the memtable in, so once only the current state is left, the frozen memtable can't change anymore.
+	while (lsm->retired > 0) {
+		pthread_cond_wait(&(lsm->cond), &(lsm->lock));
+	}
+	hopscotch_list_t * frozen = lsm->state->frozen;
+	uint64_t seq = lsm->state->frozen_seq;
+	int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	hopscotch_lsm_builder_t builder;
+	hopscotch_res_t _tmp_003 = _lsm_builder_new(&builder, lsm, seq, seq);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		if (builder.fd >= 0) {
+			_lsm_builder_abort(&builder);
+		}
+		return _tmp_003;
+	}
+	// Nothing is ever deleted from a memtable, so its bottom level is just its elements in order, and can be walked without any locks.
+	hopscotch_node_t * node = atomic_load_explicit(&(frozen->head->forward[0]), memory_order_acquire);
+	while (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL) {
+		hopscotch_byte_t op = __atomic_load_n(&(node->val.data[0]), __ATOMIC_ACQUIRE);
+		hopscotch_res_t _tmp_004 = _lsm_builder_add(&builder, op, node->val.data + 1, node->val.size - 1);
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			_lsm_builder_abort(&builder);
+			return _tmp_004;
+		}
+		node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+	}
+	hopscotch_lsm_run_t * run;
+	hopscotch_res_t _tmp_005 = _lsm_builder_finish(&run, &builder);
+	if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+		if (builder.fd >= 0) {
+			_lsm_builder_abort(&builder);
+		}
+		return _tmp_005;
+	}
+	int _tmp_006 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_006 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	hopscotch_lsm_state_t * current_state = lsm->state;
+	hopscotch_lsm_state_t * next_state;
+	hopscotch_res_t res = _lsm_state_new(
+		&next_state,
+		lsm,
+		current_state->runs_count + ((run != NULL) ? ((size_t) 1) : ((size_t) 0))
+	);
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		next_state->memtable = current_state->memtable;
+		size_t i = 0;
+		if (run != NULL) {
+			next_state->runs[i++] = run;
+		}
+		if (current_state->runs_count > 0) {
+			memcpy((void *) (next_state->runs + i), (void *) current_state->runs, sizeof(hopscotch_lsm_run_t *) * current_state->runs_count);
+		}
+		res = _lsm_install(lsm, next_state);
+	}
+	int _tmp_007 = pthread_mutex_unlock(&(lsm->lock));
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_007 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_freeze(hopscotch_lsm_t * lsm, hopscotch_list_t * memtable) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Only one memtable is flushed at a time, so writers that fill up the next one wait here until it's done.
+	while (
+		(lsm->state->memtable == memtable) &&
+		(lsm->state->frozen != NULL) &&
+		(lsm->res == HOPSCOTCH_RES__SUCCESS)
+	) {
+		pthread_cond_wait(&(lsm->cond), &(lsm->lock));
+	}
+	hopscotch_res_t res = lsm->res;
+	if ((res != HOPSCOTCH_RES__SUCCESS) || (lsm->state->memtable != memtable)) {
+		int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+		if (_tmp_002 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		return res;
+	}
+	hopscotch_list_t * next_memtable = NULL;
+	res = _list_new(&next_memtable, lsm->opts, NULL);
+	hopscotch_lsm_state_t * current_state = lsm->state;
+	hopscotch_lsm_state_t * next_state;
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		res = _lsm_state_new(&next_state, lsm, current_state->runs_count);
+	}
+	if (res == HOPSCOTCH_RES__SUCCESS) {
+		next_state->memtable = next_memtable;
+		next_state->frozen = memtable;
+		next_state->frozen_seq = ++(lsm->seq);
+		if (current_state->runs_count > 0) {
+			memcpy((void *) next_state->runs, (void *) current_state->runs, sizeof(hopscotch_lsm_run_t *) * current_state->runs_count);
+		}
+		__atomic_store_n(&(lsm->memtable_size), (size_t) 0, __ATOMIC_RELAXED);
+		res = _lsm_install(lsm, next_state);
+	}
+	int _tmp_003 = pthread_mutex_unlock(&(lsm->lock));
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Towers that are still being built (or moved) stop where they are; the frozen memtable is only walked at level 0 from now on.
+	if (lsm->opts->towers.lazy || lsm->opts->towers.adaptive) {
+		hopscotch_res_t _tmp_004 = hopscotch_list_maintenance_stop(memtable);
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_004;
+		}
+		hopscotch_res_t _tmp_005 = hopscotch_list_maintenance_start(next_memtable);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_grow(
+	hopscotch_lsm_t * lsm,
+	hopscotch_byte_t ** buf,
+	size_t * capacity,
+	size_t used,
+	size_t needed
+) {
+	if (needed <= capacity[0]) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	size_t _capacity = capacity[0] * 2;
+	if (_capacity < needed) {
+		_capacity = needed;
+	}
+	hopscotch_byte_t * _buf = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, _capacity);
+	if (_buf == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	if (used > 0) {
+		memcpy((void *) _buf, (void *) buf[0], used);
+	}
+	buf[0] = _buf;
+	capacity[0] = _capacity;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_install(hopscotch_lsm_t * lsm, hopscotch_lsm_state_t * state) {
+	size_t i;
+	for (i = 0; i < state->runs_count; i++) {
+		state->runs[i]->refs++;
+	}
+	hopscotch_lsm_state_t * old_state = lsm->state;
+	lsm->state = state;
+	pthread_cond_broadcast(&(lsm->cond));
+	if (old_state == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	lsm->retired++;
+	return _lsm_state_unref(lsm, old_state);
+}
+
+static hopscotch_res_t
+_lsm_load(hopscotch_lsm_run_t *** runs, size_t * runs_count, hopscotch_lsm_t * lsm) {
+	DIR * dir = opendir(lsm->path);
+	if (dir == NULL) {
+		return HOPSCOTCH_RES_OPENDIR_FAIL;
+	}
+	size_t path_size = strlen(lsm->path);
+	hopscotch_lsm_run_t ** _runs = NULL;
+	size_t count = 0;
+	size_t capacity = 0;
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	struct dirent * entry;
+	while ((res == HOPSCOTCH_RES__SUCCESS) && ((entry = readdir(dir)) != NULL)) {
+		size_t name_size = strlen(entry->d_name);
+		bool is_run = (bool) ((name_size > 4) && (strcmp(entry->d_name + (name_size - 4), ".run") == 0));
+		bool is_tmp = (bool) ((name_size > 8) && (strcmp(entry->d_name + (name_size - 8), ".run.tmp") == 0));
+		if ((! is_run) && (! is_tmp)) {
+			continue;
+		}
+		char * path = _MALLOC(lsm->opts->gc.malloc, char, path_size + 1 + name_size + 1);
+		if (path == NULL) {
+			res = HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+			break;
+		}
+		memcpy((void *) path, (void *) lsm->path, path_size);
+		path[path_size] = '/';
+		memcpy((void *) (path + path_size + 1), (void *) entry->d_name, name_size + 1);
+		// A run that was still being written when the process died.
+		if (is_tmp) {
+			if (unlink(path) != 0) {
+				res = HOPSCOTCH_RES_UNLINK_FAIL;
+			}
+			continue;
+		}
+		if (count == capacity) {
+			capacity = (capacity == 0) ? ((size_t) 16) : (capacity * 2);
+			hopscotch_lsm_run_t ** _runs_next = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_run_t *, capacity);
+			if (_runs_next == NULL) {
+				res = HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+				break;
+			}
+			if (count > 0) {
+				memcpy((void *) _runs_next, (void *) _runs, sizeof(hopscotch_lsm_run_t *) * count);
+			}
+			_runs = _runs_next;
+		}
+		res = _lsm_run_open(&(_runs[count]), lsm, path);
+		if (res == HOPSCOTCH_RES__SUCCESS) {
+			count++;
+		}
+	}
+	closedir(dir);
+	size_t i;
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		for (i = 0; i < count; i++) {
+			munmap((void *) _runs[i]->map, (size_t) _runs[i]->header.size);
+		}
+		return res;
+	}
+	if (count > 0) {
+		qsort((void *) _runs, count, sizeof(hopscotch_lsm_run_t *), _lsm_run_cmp);
+	}
+	// A compaction that didn't get to delete the runs it merged leaves them behind, inside the flushes of the run it made.
+	size_t kept = 0;
+	for (i = 0; i < count; i++) {
+		if (
+			(kept > 0) &&
+			(_runs[i]->header.seq_min >= _runs[kept - 1]->header.seq_min) &&
+			(_runs[i]->header.seq_max <= _runs[kept - 1]->header.seq_max)
+		) {
+			if (munmap((void *) _runs[i]->map, (size_t) _runs[i]->header.size) != 0) {
+				res = HOPSCOTCH_RES_MUNMAP_FAIL;
+			}
+			if (unlink(_runs[i]->path) != 0) {
+				res = HOPSCOTCH_RES_UNLINK_FAIL;
+			}
+			continue;
+		}
+		if (_runs[i]->header.seq_max > lsm->seq) {
+			lsm->seq = _runs[i]->header.seq_max;
+		}
+		_runs[kept++] = _runs[i];
+	}
+	for (i = 0; i < count; i++) {
+		if (_runs[i]->header.file > lsm->file) {
+			lsm->file = _runs[i]->header.file;
+		}
+	}
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		for (i = 0; i < kept; i++) {
+			munmap((void *) _runs[i]->map, (size_t) _runs[i]->header.size);
+		}
+		return res;
+	}
+	runs[0] = _runs;
+	runs_count[0] = kept;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static void *
+_lsm_main(void * arg) {
+	hopscotch_lsm_t * lsm = (hopscotch_lsm_t *) arg;
+	pthread_mutex_lock(&(lsm->lock));
+	while (lsm->running) {
+		bool flush = false;
+		bool compact = false;
+		size_t first = 0;
+		if ((! lsm->busy) && (lsm->res == HOPSCOTCH_RES__SUCCESS)) {
+			// Compactions come first, even though writers may be waiting for a flush. Otherwise, writers that keep the thread busy with flushes would pile up runs faster than they're merged, and every lookup that misses the memtable would pay for it.
+			_lsm_pick(&compact, &first, lsm, lsm->state);
+			flush = (bool) ((! compact) && (lsm->state->frozen != NULL));
+		}
+		if ((! flush) && (! compact)) {
+			pthread_cond_wait(&(lsm->cond), &(lsm->lock));
+			continue;
+		}
+		lsm->busy = true;
+		pthread_mutex_unlock(&(lsm->lock));
+		hopscotch_res_t res;
+		if (flush) {
+			res = _lsm_flush_frozen(lsm);
+		} else {
+			res = _lsm_compact(lsm, first, lsm->opts->lsm.compaction_runs);
+		}
+		pthread_mutex_lock(&(lsm->lock));
+		lsm->busy = false;
+		// There's nobody to hand the error to, so it's kept for the next flush (and stops any more background work).
+		if ((res != HOPSCOTCH_RES__SUCCESS) && (lsm->res == HOPSCOTCH_RES__SUCCESS)) {
+			lsm->res = res;
+		}
+		pthread_cond_broadcast(&(lsm->cond));
+	}
+	pthread_mutex_unlock(&(lsm->lock));
+	return NULL;
+}
+
+static hopscotch_res_t
+_lsm_pick(bool * found, size_t * first, hopscotch_lsm_t * lsm, hopscotch_lsm_state_t * state) {
+	// A run's tier is how many times its number of flushes can be divided by `compaction_runs`. Merging only runs of the same tier keeps the runs newest (and smallest) first, and rewrites every element about once per tier.
+	size_t k = lsm->opts->lsm.compaction_runs;
+	found[0] = false;
+	size_t i;
+	for (i = 0; (i + k) <= state->runs_count; i++) {
+		int tier = -1;
+		size_t j;
+		for (j = 0; j < k; j++) {
+			uint64_t flushes = (state->runs[i + j]->header.seq_max - state->runs[i + j]->header.seq_min) + 1;
+			int _tier = 0;
+			while (flushes >= ((uint64_t) k)) {
+				flushes /= (uint64_t) k;
+				_tier++;
+			}
+			if ((tier >= 0) && (_tier != tier)) {
+				break;
+			}
+			tier = _tier;
+		}
+		if (j == k) {
+			found[0] = true;
+			first[0] = i;
+			break;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_put(
+	hopscotch_lsm_t * lsm,
+	hopscotch_byte_t op,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// The memtable gets a copy of the element with the op in front. If the element's already there, only its op is changed, which the memtable's `cmp` doesn't look at.
+	hopscotch_byte_t * el = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, val_size + 1);
+	if (el == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	el[0] = op;
+	if (val_size > 0) {
+		memcpy((void *) (el + 1), (void *) val, val_size);
+	}
+	hopscotch_lsm_state_t * state;
+	hopscotch_res_t _tmp_001 = _lsm_acquire(&state, lsm);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_list_t * memtable = state->memtable;
+	bool added = false;
+	hopscotch_res_t res = _list_add_el(
+		&added,
+		NULL,
+		memtable,
+		el,
+		val_size + 1
+	);
+	if ((res == HOPSCOTCH_RES__SUCCESS) && (! added)) {
+		hopscotch_node_t * node;
+		res = _list_lookup_el(
+			&node,
+			memtable,
+			el,
+			val_size + 1
+		);
+		// Nothing is ever deleted from a memtable, so the node that was in the way is still there.
+		if ((res == HOPSCOTCH_RES__SUCCESS) && (node != NULL)) {
+			__atomic_store_n(&(node->val.data[0]), op, __ATOMIC_RELEASE);
+		}
+	}
+	hopscotch_res_t _tmp_002 = _lsm_release(lsm, state);
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	if (! added) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	size_t memtable_size = __atomic_add_fetch(
+		&(lsm->memtable_size),
+		sizeof(hopscotch_node_t) + (sizeof(hopscotch_node_t *) * ((size_t) lsm->opts->max_level)) + val_size + 1,
+		__ATOMIC_RELAXED
+	);
+	if (memtable_size < lsm->opts->lsm.memtable_size) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	return _lsm_freeze(lsm, memtable);
+}
+
+static hopscotch_res_t
+_lsm_release(hopscotch_lsm_t * lsm, hopscotch_lsm_state_t * state) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	hopscotch_res_t res = _lsm_state_unref(lsm, state);
+	int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static int
+_lsm_run_cmp(const void * a, const void * b) {
+	hopscotch_lsm_run_t * run_a = ((hopscotch_lsm_run_t **) a)[0];
+	hopscotch_lsm_run_t * run_b = ((hopscotch_lsm_run_t **) b)[0];
+	if (run_a->header.seq_max != run_b->header.seq_max) {
+		return (run_a->header.seq_max > run_b->header.seq_max) ? -1 : 1;
+	}
+	if (run_a->header.seq_min != run_b->header.seq_min) {
+		return (run_a->header.seq_min < run_b->header.seq_min) ? -1 : 1;
+	}
+	// A run that only lost its tombstones has the same flushes as the one it came from, and a later file number.
+	if (run_a->header.file != run_b->header.file) {
+		return (run_a->header.file > run_b->header.file) ? -1 : 1;
+	}
+	return 0;
+}
+
+static hopscotch_res_t
+_lsm_run_open(hopscotch_lsm_run_t ** run, hopscotch_lsm_t * lsm, char * path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return HOPSCOTCH_RES_OPEN_FAIL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return HOPSCOTCH_RES_FSTAT_FAIL;
+	}
+	size_t size = (size_t) st.st_size;
+	if (size < sizeof(hopscotch_lsm_run_header_t)) {
+		close(fd);
+		return HOPSCOTCH_RES_LSM_INVALID_RUN;
+	}
+	void * addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, (off_t) 0);
+	// The mapping stays valid without the descriptor.
+	close(fd);
+	if (addr == MAP_FAILED) {
+		return HOPSCOTCH_RES_MMAP_FAIL;
+	}
+	hopscotch_lsm_run_t * _run = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_run_t, ((size_t) 1));
+	if (_run == NULL) {
+		munmap(addr, size);
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_run->path = path;
+	_run->map = (hopscotch_byte_t *) addr;
+	memcpy((void *) &(_run->header), addr, sizeof(hopscotch_lsm_run_header_t));
+	_run->refs = 0;
+	_run->obsolete = false;
+	hopscotch_lsm_run_header_t * header = &(_run->header);
+	if (
+		(header->magic != HOPSCOTCH_VAL_LSM_RUN_MAGIC) ||
+		(header->size != (uint64_t) size) ||
+		(header->index_offset < (uint64_t) sizeof(hopscotch_lsm_run_header_t)) ||
+		(header->index_offset > header->size) ||
+		(header->blocks_count == 0) ||
+		(header->seq_min > header->seq_max)
+	) {
+		munmap(addr, size);
+		return HOPSCOTCH_RES_LSM_INVALID_RUN;
+	}
+	_run->fences = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_fence_t, (size_t) header->blocks_count);
+	if (_run->fences == NULL) {
+		munmap(addr, size);
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// Every fence pointer has to fit in the file, and the blocks have to follow each other between the header and the fence pointers.
+	// A block's restart points are at its end, and it has at least one.
+	size_t offset = (size_t) header->index_offset;
+	size_t prev_offset = sizeof(hopscotch_lsm_run_header_t);
+	uint64_t i;
+	for (i = 0; i < header->blocks_count; i++) {
+		if ((size - offset) < ((sizeof(uint64_t) * 2) + sizeof(uint32_t))) {
+			munmap(addr, size);
+			return HOPSCOTCH_RES_LSM_INVALID_RUN;
+		}
+		uint64_t block_offset;
+		uint64_t restarts_offset;
+		uint32_t val_size;
+		memcpy((void *) &block_offset, (void *) (_run->map + offset), sizeof(uint64_t));
+		memcpy((void *) &restarts_offset, (void *) (_run->map + offset + sizeof(uint64_t)), sizeof(uint64_t));
+		memcpy((void *) &val_size, (void *) (_run->map + offset + (sizeof(uint64_t) * 2)), sizeof(uint32_t));
+		offset += (sizeof(uint64_t) * 2) + sizeof(uint32_t);
+		if (
+			((size - offset) < ((size_t) val_size)) ||
+			(block_offset >= header->index_offset) ||
+			(restarts_offset < block_offset) ||
+			(restarts_offset >= header->index_offset) ||
+			((i == 0) ? (block_offset != (uint64_t) prev_offset) : (block_offset <= (uint64_t) prev_offset)) ||
+			((i > 0) && (_run->fences[i - 1].restarts >= (size_t) block_offset))
+		) {
+			munmap(addr, size);
+			return HOPSCOTCH_RES_LSM_INVALID_RUN;
+		}
+		if (i > 0) {
+			_run->fences[i - 1].end = (size_t) block_offset;
+		}
+		_run->fences[i].val = _run->map + offset;
+		_run->fences[i].val_size = (size_t) val_size;
+		_run->fences[i].offset = (size_t) block_offset;
+		_run->fences[i].restarts = (size_t) restarts_offset;
+		offset += (size_t) val_size;
+		prev_offset = (size_t) block_offset;
+	}
+	_run->fences[header->blocks_count - 1].end = (size_t) header->index_offset;
+	for (i = 0; i < header->blocks_count; i++) {
+		if (((_run->fences[i].end - _run->fences[i].restarts) % sizeof(uint32_t)) != 0) {
+			munmap(addr, size);
+			return HOPSCOTCH_RES_LSM_INVALID_RUN;
+		}
+	}
+	run[0] = _run;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_run_path(
+	char ** path,
+	hopscotch_lsm_t * lsm,
+	uint64_t seq_min,
+	uint64_t seq_max,
+	uint64_t file
+) {
+	// "<path>/<seq_min>-<seq_max>-<file>.run", with the numbers in 16 hex digits each.
+	size_t path_size = strlen(lsm->path) + ((size_t) 57);
+	char * _path = _MALLOC(lsm->opts->gc.malloc, char, path_size + 1);
+	if (_path == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	snprintf(
+		_path,
+		path_size + 1,
+		"%s/%016" PRIx64 "-%016" PRIx64 "-%016" PRIx64 ".run",
+		lsm->path,
+		seq_min,
+		seq_max,
+		file
+	);
+	path[0] = _path;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_run_unref(hopscotch_lsm_run_t * run) {
+	run->refs--;
+	if (run->refs > 0) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	if (munmap((void *) run->map, (size_t) run->header.size) != 0) {
+		res = HOPSCOTCH_RES_MUNMAP_FAIL;
+	}
+	if (run->obsolete && (unlink(run->path) != 0)) {
+		res = HOPSCOTCH_RES_UNLINK_FAIL;
+	}
+	return res;
+}
+
+static hopscotch_res_t
+_lsm_state_new(hopscotch_lsm_state_t ** state, hopscotch_lsm_t * lsm, size_t runs_count) {
+	hopscotch_lsm_state_t * _state = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_state_t, ((size_t) 1));
+	if (_state == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_state->memtable = NULL;
+	_state->frozen = NULL;
+	_state->frozen_seq = 0;
+	_state->runs = NULL;
+	_state->runs_count = runs_count;
+	if (runs_count > 0) {
+		_state->runs = _MALLOC(lsm->opts->gc.malloc, hopscotch_lsm_run_t *, runs_count);
+		if (_state->runs == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+	}
+	_state->refs = 1;
+	state[0] = _state;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_state_unref(hopscotch_lsm_t * lsm, hopscotch_lsm_state_t * state) {
+	state->refs--;
+	if (state->refs > 0) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// Only states that have been replaced get here, since the current one holds a reference to itself.
+	lsm->retired--;
+	pthread_cond_broadcast(&(lsm->cond));
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	size_t i;
+	for (i = 0; i < state->runs_count; i++) {
+		hopscotch_res_t _tmp_001 = _lsm_run_unref(state->runs[i]);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			res = _tmp_001;
+		}
+	}
+	return res;
+}
+
+static hopscotch_res_t
+_lsm_sync_dir(hopscotch_lsm_t * lsm) {
+	int fd = open(lsm->path, O_RDONLY);
+	if (fd < 0) {
+		return HOPSCOTCH_RES_OPEN_FAIL;
+	}
+	if (fsync(fd) != 0) {
+		close(fd);
+		return HOPSCOTCH_RES_FSYNC_FAIL;
+	}
+	close(fd);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_val_cmp(
+	int * res,
+	hopscotch_byte_t * val_a,
+	size_t val_a_size,
+	hopscotch_byte_t * val_b,
+	size_t val_b_size
+) {
+	int _res = memcmp((void *) val_a, (void *) val_b, (val_a_size < val_b_size) ? val_a_size : val_b_size);
+	if ((_res == 0) && (val_a_size != val_b_size)) {
+		_res = (val_a_size < val_b_size) ? -1 : 1;
+	}
+	res[0] = _res;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_lsm_write(int fd, hopscotch_byte_t * data, size_t size, size_t offset) {
+	while (size > 0) {
+		ssize_t written = pwrite(fd, (void *) data, size, (off_t) offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return HOPSCOTCH_RES_WRITE_FAIL;
+		}
+		data += (size_t) written;
+		size -= (size_t) written;
+		offset += (size_t) written;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_node_set_add(hopscotch_node_set_t * set, hopscotch_opts_t * opts, hopscotch_node_t * node) {
+	// Keep the set at most half full.
+	if (((set->count + 1) * 2) > (set->mask + 1)) {
+		hopscotch_node_set_t bigger_set;
+		hopscotch_res_t _tmp_001 = _node_set_init(&bigger_set, opts, (set->mask + 1) * 2);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		size_t _a;
+		for (_a = 0; _a <= set->mask; _a++) {
+			if (set->slots[_a] != NULL) {
+				_node_set_add(&bigger_set, opts, set->slots[_a]);
+			}
+		}
+		set[0] = bigger_set;
+	}
+	size_t slot = ((size_t) ((((uint64_t) (uintptr_t) node) * ((uint64_t) 0x9e3779b97f4a7c15ULL)) >> 32)) & set->mask;
+	while (set->slots[slot] != NULL) {
+		if (set->slots[slot] == node) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		slot = (slot + 1) & set->mask;
+	}
+	set->slots[slot] = node;
+	set->count++;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_node_set_has(bool * ans, hopscotch_node_set_t * set, hopscotch_node_t * node) {
+	size_t slot = ((size_t) ((((uint64_t) (uintptr_t) node) * ((uint64_t) 0x9e3779b97f4a7c15ULL)) >> 32)) & set->mask;
+	while (set->slots[slot] != NULL) {
+		if (set->slots[slot] == node) {
+			ans[0] = true;
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		slot = (slot + 1) & set->mask;
+	}
+	ans[0] = false;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_node_set_init(hopscotch_node_set_t * set, hopscotch_opts_t * opts, size_t capacity) {
+	size_t slot_count = 16;
+	while (slot_count < capacity) {
+		slot_count <<= 1;
+	}
+	set->slots = _MALLOC(opts->gc.malloc, hopscotch_node_t *, slot_count);
+	if (set->slots == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memset((void *) set->slots, 0, (size_t) (sizeof(hopscotch_node_t *) * slot_count));
+	set->mask = slot_count - 1;
+	set->count = 0;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_scan_bounds(hopscotch_scan_t * scan, size_t target) {
+	hopscotch_list_t * list = scan->list;
+	hopscotch_node_t * head = list->head;
+	// The right sentinel is the only node without a level-0 successor.
+	// Levels are counted from the top down, so this only gets as far as about `target` nodes per level, give or take a factor of `1 / rand_level_p`.
+	size_t count = 0;
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 1; _level--) {
+		count = 0;
+		hopscotch_node_t * node = atomic_load_explicit(&(head->forward[(int) _level]), memory_order_acquire);
+		while (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL) {
+			count++;
+			node = atomic_load_explicit(&(node->forward[(int) _level]), memory_order_acquire);
+		}
+		if (count >= target) {
+			break;
+		}
+	}
+	size_t stride = (count > (target * 2)) ? (count / target) : 1;
+	// Room for the head, a node out of every `stride` and the `NULL` at the end. Nodes added since they were counted are left out.
+	size_t capacity = (count / stride) + 3;
+	hopscotch_node_t ** bounds = _MALLOC(list->opts->gc.malloc, hopscotch_node_t *, capacity);
+	if (bounds == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	size_t bounds_count = 0;
+	bounds[bounds_count++] = head;
+	if (((int) _level) >= 1) {
+		size_t i = 0;
+		hopscotch_node_t * node = atomic_load_explicit(&(head->forward[(int) _level]), memory_order_acquire);
+		while (
+			(atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL) &&
+			(bounds_count < (capacity - 1))
+		) {
+			if ((i % stride) == 0) {
+				bounds[bounds_count++] = node;
+			}
+			i++;
+			node = atomic_load_explicit(&(node->forward[(int) _level]), memory_order_acquire);
+		}
+	}
+	bounds[bounds_count] = NULL;
+	scan->bounds = bounds;
+	scan->count = bounds_count;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_scan_fail(hopscotch_scan_t * scan, hopscotch_res_t res) {
+	hopscotch_res_t expected = HOPSCOTCH_RES__SUCCESS;
+	__atomic_compare_exchange_n(&(scan->res), &expected, res, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static void *
+_scan_main(void * arg) {
+	hopscotch_scan_worker_t * worker = (hopscotch_scan_worker_t *) arg;
+	hopscotch_scan_t * scan = worker->scan;
+	while (__atomic_load_n(&(scan->res), __ATOMIC_RELAXED) == HOPSCOTCH_RES__SUCCESS) {
+		size_t segment;
+		bool found;
+		hopscotch_res_t _tmp_001 = _scan_take(&segment, &found, worker);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			_scan_fail(scan, _tmp_001);
+			break;
+		}
+		if (! found) {
+			break;
+		}
+		hopscotch_res_t _tmp_002 = _scan_segment(worker, segment);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			_scan_fail(scan, _tmp_002);
+			break;
+		}
+	}
+	return NULL;
+}
+
+static hopscotch_res_t
+_scan_segment(hopscotch_scan_worker_t * worker, size_t segment) {
+	hopscotch_scan_t * scan = worker->scan;
+	hopscotch_list_t * list = scan->list;
+	hopscotch_opts_t * opts = list->opts;
+	hopscotch_node_t * end_node = scan->bounds[segment + 1];
+	hopscotch_byte_t * end_val = NULL;
+	size_t end_val_size = 0;
+	hopscotch_node_t * node = scan->bounds[segment];
+	if (node == list->head) {
+		node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+	}
+	// The last element handed to `fn`, and the node it's from.
+	hopscotch_node_t * val_node = NULL;
+	hopscotch_byte_t * val = NULL;
+	size_t val_size = 0;
+	// Set after a deleted node, whose forward pointer may skip over `end_node`.
+	bool stale = false;
+	while (node != end_node) {
+		hopscotch_node_t * succ_node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+		if (succ_node == NULL) {
+			break;
+		}
+		if (__atomic_load_n(&(scan->res), __ATOMIC_RELAXED) != HOPSCOTCH_RES__SUCCESS) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		bool marked = atomic_load_explicit(&(node->marked), memory_order_acquire);
+		// `end_node` may have been unlinked before this walk got to it (or be behind a deleted node), in which case the segment ends at its element instead.
+		// It's marked before it's unlinked, so a walk that's been routed around it sees that.
+		if (
+			(end_node != NULL) &&
+			(stale || marked || atomic_load_explicit(&(end_node->marked), memory_order_acquire))
+		) {
+			if (end_val == NULL) {
+				hopscotch_res_t _tmp_001 = _list_el_val(&end_val, &end_val_size, list, end_node);
+				if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_001;
+				}
+			}
+			int cmp_res;
+			size_t pred_lcp = SIZE_MAX;
+			hopscotch_res_t _tmp_002 = _list_cmp_el(
+				&cmp_res,
+				NULL,
+				opts,
+				node,
+				NULL,
+				&pred_lcp,
+				end_val,
+				end_val_size
+			);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+			if (cmp_res >= 0) {
+				break;
+			}
+		}
+		stale = marked;
+		bool visible;
+		_list_el_visible(&visible, node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+		if (visible) {
+			if ((node->prefix != NULL) && (node->prefix->base == val_node)) {
+				// The node's prefix is the start of the last element, so only the rest needs copying (and not even the prefix, if the last element is already in `buf`).
+				size_t prefix_size = (size_t) node->prefix->size;
+				size_t size = prefix_size + node->val.size;
+				if (size > worker->buf_size) {
+					hopscotch_byte_t * buf = _MALLOC(opts->gc.malloc, hopscotch_byte_t, size * 2);
+					if (buf == NULL) {
+						return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+					}
+					worker->buf = buf;
+					worker->buf_size = size * 2;
+				}
+				if (val != worker->buf) {
+					memcpy((void *) worker->buf, (void *) val, prefix_size);
+				}
+				memcpy((void *) (worker->buf + prefix_size), (void *) node->val.data, node->val.size);
+				val = worker->buf;
+				val_size = size;
+			} else {
+				hopscotch_res_t _tmp_003 = _list_el_val(&val, &val_size, list, node);
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+			}
+			val_node = node;
+			hopscotch_res_t _tmp_004 = scan->fn(scan->ctx, worker->id, val, val_size);
+			if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_004;
+			}
+		}
+		node = succ_node;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_scan_take(size_t * segment, bool * found, hopscotch_scan_worker_t * worker) {
+	hopscotch_scan_t * scan = worker->scan;
+	found[0] = false;
+	int _tmp_001 = pthread_mutex_lock(&(worker->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	if (worker->next < worker->end) {
+		segment[0] = worker->next++;
+		found[0] = true;
+	}
+	int _tmp_002 = pthread_mutex_unlock(&(worker->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	size_t i;
+	for (i = 1; (! found[0]) && (i < scan->workers_count); i++) {
+		hopscotch_scan_worker_t * victim = &(scan->workers[(worker->id + i) % scan->workers_count]);
+		int _tmp_003 = pthread_mutex_lock(&(victim->lock));
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		size_t start = 0;
+		size_t end = 0;
+		if (victim->next < victim->end) {
+			// The back half, so that the victim keeps walking its segments in order.
+			start = victim->next + ((victim->end - victim->next) / 2);
+			end = victim->end;
+			victim->end = start;
+		}
+		int _tmp_004 = pthread_mutex_unlock(&(victim->lock));
+		if (_tmp_004 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		if (start < end) {
+			int _tmp_005 = pthread_mutex_lock(&(worker->lock));
+			if (_tmp_005 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+			}
+			worker->next = start + 1;
+			worker->end = end;
+			int _tmp_006 = pthread_mutex_unlock(&(worker->lock));
+			if (_tmp_006 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+			segment[0] = start;
+			found[0] = true;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_small_add_el(
+	bool * added,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	while (true) {
+		if (! __atomic_load_n(&(list->small->active), __ATOMIC_ACQUIRE)) {
+			bool entered;
+			hopscotch_res_t _tmp_001 = _small_enter(&entered, list);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (entered) {
+				hopscotch_res_t _tmp_002 = _list_add_el(added, NULL, list, val, val_size);
+				if ((_tmp_002 == HOPSCOTCH_RES__SUCCESS) && added[0]) {
+					__atomic_add_fetch(&(list->small->count), 1, __ATOMIC_RELAXED);
+				}
+				hopscotch_res_t _tmp_003 = _small_exit(list);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_002;
+				}
+				return _tmp_003;
+			}
+			// A demotion is under way, and holds the lock until it's done.
+		}
+		int _tmp_004 = pthread_mutex_lock(&(list->small->lock));
+		if (_tmp_004 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		if (! list->small->active) {
+			int _tmp_005 = pthread_mutex_unlock(&(list->small->lock));
+			if (_tmp_005 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+			continue;
+		}
+		uint64_t seq = list->small->seq;
+		size_t pos;
+		bool found;
+		bool valid;
+		hopscotch_res_t _tmp_006 = _small_find_el(&pos, &found, &valid, list, seq, val, val_size);
+		bool promote = false;
+		added[0] = false;
+		if ((_tmp_006 == HOPSCOTCH_RES__SUCCESS) && (! found)) {
+			size_t count = list->small->count;
+			if (count == list->opts->small.capacity) {
+				promote = true;
+				_tmp_006 = _small_promote(list);
+			} else {
+				__atomic_store_n(&(list->small->seq), seq + 1, __ATOMIC_RELAXED);
+				size_t _a;
+				for (_a = count; _a > pos; _a--) {
+					__atomic_store_n(&(list->small->els[_a].val), list->small->els[_a - 1].val, __ATOMIC_RELEASE);
+					__atomic_store_n(&(list->small->els[_a].val_size), list->small->els[_a - 1].val_size, __ATOMIC_RELEASE);
+				}
+				__atomic_store_n(&(list->small->els[pos].val), val, __ATOMIC_RELEASE);
+				__atomic_store_n(&(list->small->els[pos].val_size), val_size, __ATOMIC_RELEASE);
+				__atomic_store_n(&(list->small->count), count + 1, __ATOMIC_RELEASE);
+				__atomic_store_n(&(list->small->seq), seq + 2, __ATOMIC_RELEASE);
+				added[0] = true;
+			}
+		}
+		int _tmp_007 = pthread_mutex_unlock(&(list->small->lock));
+		if (_tmp_007 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_006;
+		}
+		// The array is full, so the element goes into the skip list it's just been promoted to.
+		if (promote) {
+			continue;
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+}
+
+static hopscotch_res_t
+_small_del_el(
+	bool * deleted,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	while (true) {
+		if (! __atomic_load_n(&(list->small->active), __ATOMIC_ACQUIRE)) {
+			bool entered;
+			hopscotch_res_t _tmp_001 = _small_enter(&entered, list);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (entered) {
+				size_t count = SIZE_MAX;
+				hopscotch_res_t _tmp_002 = _list_del_el(deleted, NULL, list, val, val_size);
+				if ((_tmp_002 == HOPSCOTCH_RES__SUCCESS) && deleted[0]) {
+					count = __atomic_sub_fetch(&(list->small->count), 1, __ATOMIC_RELAXED);
+				}
+				hopscotch_res_t _tmp_003 = _small_exit(list);
+				if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_002;
+				}
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+				// Demote at half the capacity, so that a list that hovers around it doesn't flip back and forth.
+				// Whoever gets the lock first does it; the others carry on.
+				if (
+					(count <= (list->opts->small.capacity / 2)) &&
+					(! __atomic_load_n(&(list->small->pinned), __ATOMIC_RELAXED)) &&
+					(pthread_mutex_trylock(&(list->small->lock)) == 0)
+				) {
+					bool demoted;
+					hopscotch_res_t _tmp_004 = _small_demote(&demoted, list, false);
+					int _tmp_005 = pthread_mutex_unlock(&(list->small->lock));
+					if (_tmp_005 != 0) {
+						return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+					}
+					if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+						return _tmp_004;
+					}
+				}
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+			// A demotion is under way, and holds the lock until it's done.
+		}
+		int _tmp_006 = pthread_mutex_lock(&(list->small->lock));
+		if (_tmp_006 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		if (! list->small->active) {
+			int _tmp_007 = pthread_mutex_unlock(&(list->small->lock));
+			if (_tmp_007 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+			continue;
+		}
+		uint64_t seq = list->small->seq;
+		size_t pos;
+		bool found;
+		bool valid;
+		hopscotch_res_t _tmp_008 = _small_find_el(&pos, &found, &valid, list, seq, val, val_size);
+		deleted[0] = false;
+		if ((_tmp_008 == HOPSCOTCH_RES__SUCCESS) && found) {
+			size_t count = list->small->count;
+			__atomic_store_n(&(list->small->seq), seq + 1, __ATOMIC_RELAXED);
+			size_t _a;
+			for (_a = pos; (_a + 1) < count; _a++) {
+				__atomic_store_n(&(list->small->els[_a].val), list->small->els[_a + 1].val, __ATOMIC_RELEASE);
+				__atomic_store_n(&(list->small->els[_a].val_size), list->small->els[_a + 1].val_size, __ATOMIC_RELEASE);
+			}
+			__atomic_store_n(&(list->small->count), count - 1, __ATOMIC_RELEASE);
+			__atomic_store_n(&(list->small->seq), seq + 2, __ATOMIC_RELEASE);
+			deleted[0] = true;
+		}
+		int _tmp_009 = pthread_mutex_unlock(&(list->small->lock));
+		if (_tmp_009 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		return _tmp_008;
+	}
+}
+
+static hopscotch_res_t
+_small_demote(bool * demoted, hopscotch_list_t * list, bool clear) {
+	demoted[0] = false;
+	if (
+		list->small->active ||
+		__atomic_load_n(&(list->small->pinned), __ATOMIC_RELAXED) ||
+		((! clear) && (__atomic_load_n(&(list->small->count), __ATOMIC_RELAXED) > (list->opts->small.capacity / 2)))
+	) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// Pairs with `_small_enter`: either the writer sees `demoting`, or we see the writer.
+	__atomic_store_n(&(list->small->demoting), true, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&(list->small->writers), __ATOMIC_SEQ_CST) != 0);
+	// Nobody changes the skip list from here on, and readers don't look at the array until `active` is set.
+	// Readers still in the skip list find out from `seq` once it's reset by the next promotion.
+	size_t count = 0;
+	bool fits = true;
+	if (! clear) {
+		hopscotch_node_t * node = atomic_load_explicit(&(list->head->forward[0]), memory_order_acquire);
+		while (true) {
+			_list_live_el(&node);
+			if (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) == NULL) {
+				break;
+			}
+			if (count == list->opts->small.capacity) {
+				fits = false;
+				break;
+			}
+			hopscotch_byte_t * val;
+			size_t val_size;
+			hopscotch_res_t _tmp_001 = _list_el_val(&val, &val_size, list, node);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				__atomic_store_n(&(list->small->demoting), false, __ATOMIC_RELEASE);
+				return _tmp_001;
+			}
+			__atomic_store_n(&(list->small->els[count].val), val, __ATOMIC_RELEASE);
+			__atomic_store_n(&(list->small->els[count].val_size), val_size, __ATOMIC_RELEASE);
+			count++;
+			node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+		}
+	}
+	if (fits) {
+		uint64_t seq = list->small->seq;
+		__atomic_store_n(&(list->small->seq), seq + 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&(list->small->count), count, __ATOMIC_RELEASE);
+		__atomic_store_n(&(list->small->active), true, __ATOMIC_RELEASE);
+		__atomic_store_n(&(list->small->seq), seq + 2, __ATOMIC_RELEASE);
+		demoted[0] = true;
+	}
+	__atomic_store_n(&(list->small->demoting), false, __ATOMIC_RELEASE);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_small_enter(bool * entered, hopscotch_list_t * list) {
+	__atomic_add_fetch(&(list->small->writers), 1, __ATOMIC_SEQ_CST);
+	entered[0] = (bool) (
+		(! __atomic_load_n(&(list->small->active), __ATOMIC_SEQ_CST)) &&
+		(! __atomic_load_n(&(list->small->demoting), __ATOMIC_SEQ_CST))
+	);
+	if (! entered[0]) {
+		__atomic_sub_fetch(&(list->small->writers), 1, __ATOMIC_RELEASE);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_small_exit(hopscotch_list_t * list) {
+	__atomic_sub_fetch(&(list->small->writers), 1, __ATOMIC_RELEASE);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_small_find_el(
+	size_t * pos,
+	bool * found,
+	bool * valid,
+	hopscotch_list_t * list,
+	uint64_t seq,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	found[0] = false;
+	size_t count = __atomic_load_n(&(list->small->count), __ATOMIC_ACQUIRE);
+	// A count from a skip list that's just been demoted.
+	if (count > list->opts->small.capacity) {
+		valid[0] = false;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	size_t lo = 0;
+	size_t hi = count;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		hopscotch_byte_t * el_val = __atomic_load_n(&(list->small->els[mid].val), __ATOMIC_ACQUIRE);
+		size_t el_val_size = __atomic_load_n(&(list->small->els[mid].val_size), __ATOMIC_ACQUIRE);
+		// A writer moving elements around could have paired one element's `val` with another's size, so check before reading it.
+		_small_read_end(valid, list, seq);
+		if (! valid[0]) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		int _cmp_res_001;
+		hopscotch_res_t _tmp_001 = list->opts->cmp(
+			&_cmp_res_001,
+			el_val,
+			el_val_size,
+			val,
+			val_size
+		);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		if (_cmp_res_001 == 0) {
+			found[0] = true;
+			lo = mid;
+			break;
+		}
+		if (_cmp_res_001 < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	pos[0] = lo;
+	valid[0] = true;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_small_lookup_el(
+	bool * found,
+	hopscotch_byte_t ** found_val,
+	size_t * found_val_size,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	while (true) {
+		uint64_t seq;
+		bool active;
+		_small_read_begin(&seq, &active, list);
+		bool valid;
+		if (active) {
+			size_t pos;
+			hopscotch_res_t _tmp_001 = _small_find_el(&pos, found, &valid, list, seq, val, val_size);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (valid && found[0] && (found_val != NULL)) {
+				found_val[0] = __atomic_load_n(&(list->small->els[pos].val), __ATOMIC_ACQUIRE);
+				found_val_size[0] = __atomic_load_n(&(list->small->els[pos].val_size), __ATOMIC_ACQUIRE);
+				_small_read_end(&valid, list, seq);
+			}
+		} else {
+			hopscotch_node_t * node;
+			hopscotch_res_t _tmp_002 = _list_lookup_el(
+				&node,
+				list,
+				val,
+				val_size
+			);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+			found[0] = (bool) (node != NULL);
+			if (found[0] && (found_val != NULL)) {
+				hopscotch_res_t _tmp_003 = _list_el_val(found_val, found_val_size, list, node);
+				if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_003;
+				}
+			}
+			// The skip list may have been demoted (and emptied for the next promotion) under us.
+			_small_read_end(&valid, list, seq);
+		}
+		if (valid) {
+			if ((! found[0]) && (found_val != NULL)) {
+				found_val[0] = NULL;
+				found_val_size[0] = 0;
+			}
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+}
+
+static hopscotch_res_t
+_small_pin(hopscotch_list_t * list) {
+	if (
+		(list->opts->small.capacity == 0) ||
+		__atomic_load_n(&(list->small->pinned), __ATOMIC_ACQUIRE)
+	) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(list->small->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	hopscotch_res_t _tmp_002 = HOPSCOTCH_RES__SUCCESS;
+	if (list->small->active) {
+		_tmp_002 = _small_promote(list);
+	}
+	if (_tmp_002 == HOPSCOTCH_RES__SUCCESS) {
+		__atomic_store_n(&(list->small->pinned), true, __ATOMIC_RELEASE);
+	}
+	int _tmp_003 = pthread_mutex_unlock(&(list->small->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return _tmp_002;
+}
+
+static hopscotch_res_t
+_small_promote(hopscotch_list_t * list) {
+	uint64_t seq = list->small->seq;
+	__atomic_store_n(&(list->small->seq), seq + 1, __ATOMIC_RELAXED);
+	hopscotch_res_t _tmp_001 = HOPSCOTCH_RES__SUCCESS;
+	if (list->head == NULL) {
+		_tmp_001 = _list_new_head(&(list->head), list);
+	} else {
+		// Empty the skip list the list was demoted from.
+		// Its writers are long gone, and readers that are still in there are told to retry by `seq`.
+		int16_t top_level = ((int16_t) list->opts->max_level) - 1;
+		hopscotch_node_t * tail_node = list->head;
+		while (atomic_load_explicit(&(tail_node->forward[(int) top_level]), memory_order_acquire) != NULL) {
+			tail_node = atomic_load_explicit(&(tail_node->forward[(int) top_level]), memory_order_acquire);
+		}
+		int16_t _level;
+		for (_level = 0; ((int) _level) <= ((int) top_level); _level++) {
+			atomic_store_explicit(&(list->head->forward[(int) _level]), tail_node, memory_order_release);
+		}
+		_list_link_back(list, tail_node, list->head);
+	}
+	if (_tmp_001 == HOPSCOTCH_RES__SUCCESS) {
+		hopscotch_node_t * tail_nodes[(int) list->opts->max_level];
+		int16_t _level;
+		for (_level = 0; ((int) _level) < ((int) list->opts->max_level); _level++) {
+			tail_nodes[(int) _level] = list->head;
+		}
+		size_t _a;
+		for (_a = 0; (_tmp_001 == HOPSCOTCH_RES__SUCCESS) && (_a < list->small->count); _a++) {
+			_tmp_001 = _list_append_el(list, tail_nodes, list->small->els[_a].val, list->small->els[_a].val_size);
+		}
+		_list_set_tails(list, (_tmp_001 == HOPSCOTCH_RES__SUCCESS) ? tail_nodes : NULL);
+	}
+	// If that failed, the array is still good, and the skip list is emptied again next time.
+	if (_tmp_001 == HOPSCOTCH_RES__SUCCESS) {
+		__atomic_store_n(&(list->small->active), false, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&(list->small->seq), seq + 2, __ATOMIC_RELEASE);
+	return _tmp_001;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_small_read_begin(uint64_t * seq, bool * active, hopscotch_list_t * list) {
+	while (true) {
+		seq[0] = __atomic_load_n(&(list->small->seq), __ATOMIC_ACQUIRE);
+		if ((seq[0] & 1) == 0) {
+			break;
+		}
+	}
+	active[0] = __atomic_load_n(&(list->small->active), __ATOMIC_ACQUIRE);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+_ALWAYS_INLINE static inline hopscotch_res_t
+_small_read_end(bool * valid, hopscotch_list_t * list, uint64_t seq) {
+	// Writers store everything between the two bumps of `seq` with release, and readers load it with acquire.
+	// So a reader that saw any of it also sees the first bump here.
+	valid[0] = (bool) (__atomic_load_n(&(list->small->seq), __ATOMIC_ACQUIRE) == seq);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+_shm_map(hopscotch_shm_t ** segment, int fd, void * base, size_t size) {
+	int flags = MAP_SHARED;
+	if (base != NULL) {
+		flags |= MAP_FIXED_NOREPLACE;
+	}
+	void * addr = mmap(base, size, (PROT_READ | PROT_WRITE), flags, fd, (off_t) 0);
+	if (addr == MAP_FAILED) {
+		return HOPSCOTCH_RES_MMAP_FAIL;
+	}
+	// The nodes link to each other with plain pointers, so every process has to see the segment at the same address.
+	if ((base != NULL) && (addr != base)) {
+		munmap(addr, size);
+		return HOPSCOTCH_RES_MMAP_FAIL;
+	}
+	segment[0] = (hopscotch_shm_t *) addr;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_new(hopscotch_list_t ** list, hopscotch_opts_t * opts) {
+	// The pointer `list` points to must be initialized to `NULL`!
+	// This check is just done for safety reasons.
+	if (list[0] != NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_LIST_PTR;
+	}
+	// `opts` must not be `NULL`.
+	if (opts == NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS_PTR;
+	}
+	return _list_new(list, opts, NULL);
+}
+
+hopscotch_res_t
+hopscotch_list_shm_open(
+	hopscotch_list_t ** list,
+	hopscotch_opts_t * opts,
+	const char * name,
+	size_t size
+) {
+	// The pointer `list` points to must be initialized to `NULL`!
+	// This check is just done for safety reasons.
+	if (list[0] != NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_LIST_PTR;
+	}
+	// `opts` must not be `NULL`.
+	if (opts == NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS_PTR;
+	}
+	// The filter, the index and the maintenance thread all live in the heap of one process.
+	if ((opts->filter.capacity > 0) || opts->index.enabled || opts->towers.lazy) {
+		return HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED;
+	}
+	size_t header_size = (sizeof(hopscotch_shm_t) + (_Alignof(max_align_t) - 1)) & (~(_Alignof(max_align_t) - 1));
+	if (size <= header_size) {
+		return HOPSCOTCH_RES_LIST_SHM_INVALID_SEGMENT;
+	}
+	hopscotch_shm_t * segment;
+	bool created = true;
+	int fd = shm_open(name, (O_RDWR | O_CREAT | O_EXCL), (mode_t) 0600);
+	if (fd >= 0) {
+		// We created the segment, so we get to pick its size and address.
+		if (ftruncate(fd, (off_t) size) != 0) {
+			close(fd);
+			shm_unlink(name);
+			return HOPSCOTCH_RES_FTRUNCATE_FAIL;
+		}
+		void * base = (opts->shm.base != NULL) ? opts->shm.base : HOPSCOTCH_VAL_SHM_DEFAULT_BASE;
+		hopscotch_res_t _tmp_001 = _shm_map(&segment, fd, base, size);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			close(fd);
+			shm_unlink(name);
+			return _tmp_001;
+		}
+		segment->base = (void *) segment;
+		segment->size = size;
+		atomic_store_explicit(&(segment->used), header_size, memory_order_relaxed);
+	} else {
+		if (errno != EEXIST) {
+			return HOPSCOTCH_RES_SHM_OPEN_FAIL;
+		}
+		created = false;
+		fd = shm_open(name, O_RDWR, (mode_t) 0600);
+		if (fd < 0) {
+			return HOPSCOTCH_RES_SHM_OPEN_FAIL;
+		}
+		// The creator may not have sized or set up the segment yet, so wait a bit for it (but not forever, in case it died).
+		int64_t deadline = timestamp() + ((int64_t) HOPSCOTCH_VAL_SHM_OPEN_TIMEOUT_MS);
+		struct timespec nap = {0, 1000000};
+		hopscotch_shm_t * header = NULL;
+		while (true) {
+			if (header == NULL) {
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					close(fd);
+					return HOPSCOTCH_RES_FSTAT_FAIL;
+				}
+				if (((size_t) st.st_size) >= header_size) {
+					void * addr = mmap(NULL, sizeof(hopscotch_shm_t), PROT_READ, MAP_SHARED, fd, (off_t) 0);
+					if (addr == MAP_FAILED) {
+						close(fd);
+						return HOPSCOTCH_RES_MMAP_FAIL;
+					}
+					header = (hopscotch_shm_t *) addr;
+				}
+			}
+			if (
+				(header != NULL) &&
+				(atomic_load_explicit(&(header->magic), memory_order_acquire) == HOPSCOTCH_VAL_SHM_MAGIC)
+			) {
+				break;
+			}
+			if (timestamp() > deadline) {
+				if (header != NULL) {
+					munmap((void *) header, sizeof(hopscotch_shm_t));
+				}
+				close(fd);
+				return HOPSCOTCH_RES_LIST_SHM_INVALID_SEGMENT;
+			}
+			nanosleep(&nap, NULL);
+		}
+		void * base = header->base;
+		size = header->size;
+		if (munmap((void *) header, sizeof(hopscotch_shm_t)) != 0) {
+			close(fd);
+			return HOPSCOTCH_RES_MUNMAP_FAIL;
+		}
+		hopscotch_res_t _tmp_002 = _shm_map(&segment, fd, base, size);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			close(fd);
+			return _tmp_002;
+		}
+	}
+	// The mapping stays valid without the descriptor.
+	close(fd);
+	hopscotch_res_t _tmp_003 = _list_new(list, opts, segment);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		munmap((void *) segment, size);
+		if (created) {
+			shm_unlink(name);
+		}
+		return _tmp_003;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_shm_unlink(const char * name) {
+	if (shm_unlink(name) != 0) {
+		return HOPSCOTCH_RES_SHM_UNLINK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_shm_usage(size_t * used, size_t * size, hopscotch_list_t * list) {
+	if (list->shm == NULL) {
+		return HOPSCOTCH_RES_LIST_SHM_DISABLED;
+	}
+	hopscotch_shm_t * segment = list->shm->segment;
+	// Set the result.
+	used[0] = atomic_load_explicit(&(segment->used), memory_order_relaxed);
+	size[0] = segment->size;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_add_el(
+	bool * added,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->opts->small.capacity > 0) {
+		return _small_add_el(added, list, val, val_size);
+	}
+	if (list->combining != NULL) {
+		return _combining_post(added, list, false, val, val_size);
+	}
+	return _list_add_el(
+		added,
+		NULL,
+		list,
+		val,
+		val_size
+	);
+}
+
+hopscotch_res_t
+hopscotch_list_contains_el(
+	bool * found,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->opts->small.capacity > 0) {
+		return _small_lookup_el(found, NULL, NULL, list, val, val_size);
+	}
+	hopscotch_node_t * node;
+	hopscotch_res_t _tmp_001 = _list_lookup_el(
+		&node,
+		list,
+		val,
+		val_size
+	);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	found[0] = (bool) (node != NULL);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_contains_batch(
+	bool * found,
+	hopscotch_list_t * list,
+	hopscotch_byte_t ** vals,
+	size_t * val_sizes,
+	size_t count
+) {
+	// Each in-flight search is a tiny state machine.
+	// Every time a search is visited it does one step and, whenever it is about to touch memory it hasn't touched yet, it prefetches that memory and yields to the other searches.
+	// By the time we come back to it, the prefetch has (hopefully) landed.
+	// `_BATCH_STEP_LOAD` means `curr_node` has been prefetched, but we haven't looked inside it yet.
+	// `_BATCH_STEP_CMP` means `curr_node`'s val and forward pointers have been prefetched, so it's time to compare.
+	enum {
+		_BATCH_STEP_LOAD = 0,
+		_BATCH_STEP_CMP,
+	};
+	struct {
+		size_t idx;
+		int16_t level;
+		hopscotch_node_t * pred_node;
+		hopscotch_node_t * curr_node;
+		int step;
+		// For `_filter_note`, like in `_list_lookup_el`.
+		hopscotch_filter_t * filter;
+		uint64_t hash;
+	} searches[HOPSCOTCH_VAL_LIST_BATCH_WIDTH];
+	size_t next_idx = 0;
+	int in_flight = 0;
+	int _a;
+	// A small list is searched one element at a time, whichever form it's in.
+	if (list->opts->small.capacity > 0) {
+		for (next_idx = 0; next_idx < count; next_idx++) {
+			hopscotch_res_t _tmp_004 = _small_lookup_el(
+				&(found[next_idx]),
+				NULL,
+				NULL,
+				list,
+				vals[next_idx],
+				val_sizes[next_idx]
+			);
+			if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_004;
+			}
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	// With a hash index there are no towers to walk.
+	if (list->index != NULL) {
+		for (next_idx = 0; next_idx < count; next_idx++) {
+			hopscotch_node_t * node;
+			hopscotch_res_t _tmp_003 = _list_lookup_el(
+				&node,
+				list,
+				vals[next_idx],
+				val_sizes[next_idx]
+			);
+			if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_003;
+			}
+			found[next_idx] = (bool) (node != NULL);
+		}
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	while (true) {
+		// (Re)fill the window.
+		while ((in_flight < HOPSCOTCH_VAL_LIST_BATCH_WIDTH) && (next_idx < count)) {
+			// Definite misses never make it into the window.
+			bool maybe;
+			hopscotch_filter_t * filter;
+			uint64_t hash;
+			hopscotch_res_t _tmp_001 = _list_filter_check(
+				&maybe,
+				&filter,
+				&hash,
+				list,
+				vals[next_idx],
+				val_sizes[next_idx]
+			);
+			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_001;
+			}
+			if (! maybe) {
+				_filter_note(filter, hash, false);
+				found[next_idx++] = false;
+				continue;
+			}
+			searches[in_flight].idx = next_idx++;
+			searches[in_flight].filter = filter;
+			searches[in_flight].hash = hash;
+			searches[in_flight].level = ((int16_t) list->opts->max_level) - 1;
+			searches[in_flight].pred_node = list->head;
+			searches[in_flight].curr_node = atomic_load_explicit(&(list->head->forward[(int) searches[in_flight].level]), memory_order_acquire);
+			searches[in_flight].step = _BATCH_STEP_LOAD;
+			_PREFETCH(searches[in_flight].curr_node);
+			in_flight++;
+		}
+		if (in_flight == 0) {
+			break;
+		}
+		for (_a = 0; _a < in_flight; _a++) {
+			if (searches[_a].step == _BATCH_STEP_LOAD) {
+				_PREFETCH(searches[_a].curr_node->val.data);
+				_PREFETCH(&(searches[_a].curr_node->forward[(int) searches[_a].level]));
+				searches[_a].step = _BATCH_STEP_CMP;
+				continue;
+			}
+			hopscotch_node_t * curr_node = searches[_a].curr_node;
+			int _cmp_res_001;
+			hopscotch_res_t _tmp_002 = _list_cmp_el(
+				&_cmp_res_001,
+				NULL,
+				list->opts,
+				curr_node,
+				NULL,
+				NULL,
+				vals[searches[_a].idx],
+				val_sizes[searches[_a].idx]
+			);
+			if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_002;
+			}
+			if (_cmp_res_001 < 0) {
+				// Keep moving right on this level.
+				searches[_a].pred_node = curr_node;
+				searches[_a].curr_node = atomic_load_explicit(&(curr_node->forward[(int) searches[_a].level]), memory_order_acquire);
+				searches[_a].step = _BATCH_STEP_LOAD;
+				_PREFETCH(searches[_a].curr_node);
+				continue;
+			}
+			bool done = false;
+			if (_cmp_res_001 == 0) {
+				// Same check as `hopscotch_list_contains_el`, against the highest level the val was found on.
+				_list_el_visible(&(found[searches[_a].idx]), curr_node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+				if (list->opts->towers.adaptive && found[searches[_a].idx]) {
+					_list_note_hit(list, curr_node);
+				}
+				done = true;
+			} else if (((int) searches[_a].level) == 0) {
+				found[searches[_a].idx] = false;
+				done = true;
+			} else {
+				// Drop down a level.
+				searches[_a].level--;
+				searches[_a].curr_node = atomic_load_explicit(&(searches[_a].pred_node->forward[(int) searches[_a].level]), memory_order_acquire);
+				searches[_a].step = _BATCH_STEP_LOAD;
+				_PREFETCH(searches[_a].curr_node);
+			}
+			if (done) {
+				if ((searches[_a].filter != NULL) && (! found[searches[_a].idx])) {
+					_filter_note(searches[_a].filter, searches[_a].hash, true);
+				}
+				// Retire the slot by moving the last in-flight search into it.
+				in_flight--;
+				searches[_a] = searches[in_flight];
+				_a--;
+			}
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_get_el(
+	hopscotch_byte_t ** found_val,
+	size_t * found_val_size,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->opts->small.capacity > 0) {
+		bool found;
+		return _small_lookup_el(&found, found_val, found_val_size, list, val, val_size);
+	}
+	hopscotch_node_t * node;
+	hopscotch_res_t _tmp_001 = _list_lookup_el(
+		&node,
+		list,
+		val,
+		val_size
+	);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (node == NULL) {
+		found_val[0] = NULL;
+		found_val_size[0] = 0;
+	} else {
+		hopscotch_res_t _tmp_002 = _list_el_val(found_val, found_val_size, list, node);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_floor_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_res_t _tmp_002 = _small_pin(list);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	uint8_t _level_found;
+	hopscotch_res_t _tmp_001 = _list_find_el(
+		&_level_found,
+		pred_nodes,
+		succ_nodes,
+		list,
+		val,
+		val_size
+	);
+	if (
+		(_tmp_001 != HOPSCOTCH_RES__SUCCESS) &&
+		(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+	) {
+		return _tmp_001;
+	}
+	bool visible = false;
+	if (_tmp_001 == HOPSCOTCH_RES__SUCCESS) {
+		_list_el_visible(&visible, succ_nodes[(int) _level_found], HOPSCOTCH_VAL_LIST_VERSION_NOW);
+	}
+	if (visible) {
+		node[0] = succ_nodes[(int) _level_found];
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	hopscotch_node_t * pred_node = pred_nodes[0];
+	if (pred_node == list->head) {
+		node[0] = NULL;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	_list_el_visible(&visible, pred_node, HOPSCOTCH_VAL_LIST_VERSION_NOW);
+	if (visible) {
+		node[0] = pred_node;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	return _list_prev_el(node, list, pred_node);
+}
+
+hopscotch_res_t
+hopscotch_list_ceiling_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_res_t _tmp_002 = _small_pin(list);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	uint8_t _level_found;
+	hopscotch_res_t _tmp_001 = _list_find_el(
+		&_level_found,
+		pred_nodes,
+		succ_nodes,
+		list,
+		val,
+		val_size
+	);
+	if (
+		(_tmp_001 != HOPSCOTCH_RES__SUCCESS) &&
+		(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+	) {
+		return _tmp_001;
+	}
+	hopscotch_node_t * succ_node = succ_nodes[0];
+	_list_live_el(&succ_node);
+	node[0] = (atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) == NULL) ? NULL : succ_node;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_prev_el(
+	hopscotch_node_t ** prev_node,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+) {
+	hopscotch_res_t _tmp_001 = _small_pin(list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (node == NULL) {
+		// Start from the right sentinel, which is never more than a few hops away on the top level.
+		int16_t top_level = ((int16_t) list->opts->max_level) - 1;
+		node = list->head;
+		while (atomic_load_explicit(&(node->forward[(int) top_level]), memory_order_acquire) != NULL) {
+			node = atomic_load_explicit(&(node->forward[(int) top_level]), memory_order_acquire);
+		}
+	}
+	return _list_prev_el(prev_node, list, node);
+}
+
+hopscotch_res_t
+hopscotch_list_next_el(
+	hopscotch_node_t ** next_node,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+) {
+	hopscotch_res_t _tmp_001 = _small_pin(list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	// A deleted node keeps its forward pointers, so this works from a node that's gone since, too.
+	hopscotch_node_t * succ_node = atomic_load_explicit(&(((node == NULL) ? list->head : node)->forward[0]), memory_order_acquire);
+	_list_live_el(&succ_node);
+	next_node[0] = (atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) == NULL) ? NULL : succ_node;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_el_val(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+) {
+	return _list_el_val(val, val_size, list, node);
+}
+
+hopscotch_res_t
+hopscotch_list_parallel_for_each(
+	hopscotch_list_t * list,
+	size_t threads_count,
+	hopscotch_res_t (* fn)(
+		void *,
+		size_t,
+		hopscotch_byte_t *,
+		size_t
+	),
+	void * ctx
+) {
+	hopscotch_res_t _tmp_001 = _small_pin(list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (threads_count == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads_count = (cpus > 0) ? ((size_t) cpus) : 1;
+	}
+	hopscotch_scan_t scan;
+	scan.list = list;
+	scan.fn = fn;
+	scan.ctx = ctx;
+	scan.res = HOPSCOTCH_RES__SUCCESS;
+	hopscotch_res_t _tmp_002 = _scan_bounds(&scan, threads_count * HOPSCOTCH_VAL_LIST_SCAN_SEGMENTS_PER_THREAD);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	// A worker without a segment of its own would only steal.
+	if (threads_count > scan.count) {
+		threads_count = scan.count;
+	}
+	scan.workers = _MALLOC(list->opts->gc.malloc, hopscotch_scan_worker_t, threads_count);
+	if (scan.workers == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	scan.workers_count = 0;
+	size_t i;
+	for (i = 0; i < threads_count; i++) {
+		hopscotch_scan_worker_t * worker = &(scan.workers[i]);
+		if (pthread_mutex_init(&(worker->lock), NULL) != 0) {
+			_scan_fail(&scan, HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL);
+			break;
+		}
+		worker->scan = &scan;
+		worker->id = i;
+		// Neighbouring segments go to the same worker, which keeps its walks in key order.
+		worker->next = (i * scan.count) / threads_count;
+		worker->end = ((i + 1) * scan.count) / threads_count;
+		worker->buf = NULL;
+		worker->buf_size = 0;
+		scan.workers_count++;
+	}
+	// The calling thread is worker `0`.
+	size_t threads_started = 1;
+	for (i = 1; (i < scan.workers_count) && (__atomic_load_n(&(scan.res), __ATOMIC_RELAXED) == HOPSCOTCH_RES__SUCCESS); i++) {
+		if (pthread_create(&(scan.workers[i].thread), NULL, _scan_main, (void *) &(scan.workers[i])) != 0) {
+			_scan_fail(&scan, HOPSCOTCH_RES_PTHREAD_CREATE_FAIL);
+			break;
+		}
+		threads_started++;
+	}
+	if (scan.workers_count > 0) {
+		_scan_main((void *) &(scan.workers[0]));
+	}
+	for (i = 1; i < threads_started; i++) {
+		if (pthread_join(scan.workers[i].thread, NULL) != 0) {
+			_scan_fail(&scan, HOPSCOTCH_RES_PTHREAD_JOIN_FAIL);
+		}
+	}
+	for (i = 0; i < scan.workers_count; i++) {
+		pthread_mutex_destroy(&(scan.workers[i].lock));
+	}
+	return scan.res;
+}
+
+hopscotch_res_t
+hopscotch_list_snapshot(hopscotch_snapshot_t ** snapshot, hopscotch_list_t * list) {
+	if (! list->opts->versions.enabled) {
+		return HOPSCOTCH_RES_LIST_VERSIONS_DISABLED;
+	}
+	hopscotch_snapshot_t * _snapshot = _MALLOC(list->opts->gc.malloc, hopscotch_snapshot_t, ((size_t) 1));
+	if (_snapshot == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_snapshot->list = list;
+	_snapshot->newer = NULL;
+	int _tmp_001 = pthread_mutex_lock(&(list->versions->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	// Everything stamped so far is in, everything stamped from now on isn't.
+	_snapshot->version = list->versions->current;
+	_snapshot->older = list->versions->newest;
+	if (list->versions->newest != NULL) {
+		list->versions->newest->newer = _snapshot;
+	} else {
+		list->versions->oldest = _snapshot;
+	}
+	list->versions->newest = _snapshot;
+	int _tmp_002 = pthread_mutex_unlock(&(list->versions->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Set the result.
+	snapshot[0] = _snapshot;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_snapshot_release(hopscotch_snapshot_t * snapshot) {
+	hopscotch_list_t * list = snapshot->list;
+	int _tmp_001 = pthread_mutex_lock(&(list->versions->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	bool was_oldest = (bool) (list->versions->oldest == snapshot);
+	if (snapshot->older != NULL) {
+		snapshot->older->newer = snapshot->newer;
+	} else {
+		list->versions->oldest = snapshot->newer;
+	}
+	if (snapshot->newer != NULL) {
+		snapshot->newer->older = snapshot->older;
+	} else {
+		list->versions->newest = snapshot->older;
+	}
+	int _tmp_002 = pthread_mutex_unlock(&(list->versions->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Only the oldest snapshot holds deleted nodes back.
+	if (was_oldest) {
+		hopscotch_res_t _tmp_003 = _list_reclaim_els(list);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_snapshot_contains_el(
+	bool * found,
+	hopscotch_snapshot_t * snapshot,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	hopscotch_list_t * list = snapshot->list;
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	uint8_t _level_found;
+	// The filter and index only know about the current state, so this takes the long way.
+	hopscotch_res_t _tmp_001 = _list_find_el(
+		&_level_found,
+		pred_nodes,
+		succ_nodes,
+		list,
+		val,
+		val_size
+	);
+	if (_tmp_001 == HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) {
+		found[0] = false;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	_list_el_visible(found, succ_nodes[(int) _level_found], snapshot->version);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_snapshot_next_el(
+	hopscotch_node_t ** next_node,
+	hopscotch_snapshot_t * snapshot,
+	hopscotch_node_t * node
+) {
+	// Nodes a snapshot can see stay linked until it's released, so there's no need to step around unlinked ones like `_list_live_el` does.
+	hopscotch_node_t * succ_node = atomic_load_explicit(&(((node == NULL) ? snapshot->list->head : node)->forward[0]), memory_order_acquire);
+	while (atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) != NULL) {
+		bool visible;
+		_list_el_visible(&visible, succ_node, snapshot->version);
+		if (visible) {
+			break;
+		}
+		succ_node = atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire);
+	}
+	next_node[0] = (atomic_load_explicit(&(succ_node->forward[0]), memory_order_acquire) == NULL) ? NULL : succ_node;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+
+hopscotch_res_t
+hopscotch_list_del_el(
+	bool * deleted,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->opts->small.capacity > 0) {
+		return _small_del_el(deleted, list, val, val_size);
+	}
+	if (list->combining != NULL) {
+		return _combining_post(deleted, list, true, val, val_size);
+	}
+	return _list_del_el(deleted, NULL, list, val, val_size);
+}
+
+hopscotch_res_t
+hopscotch_list_del_range(
+	size_t * deleted_count,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * lo_val,
+	size_t lo_val_size,
+	hopscotch_byte_t * hi_val,
+	size_t hi_val_size
+) {
+	deleted_count[0] = 0;
+	if (list->shm != NULL) {
+		return HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED;
+	}
+	if (list->opts->versions.enabled) {
+		return HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED;
+	}
+	hopscotch_res_t _tmp_016 = _small_pin(list);
+	if (_tmp_016 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_016;
+	}
+	if (list->index != NULL) {
+		hopscotch_res_t _tmp_001 = _index_maintain(list->index, list->opts);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+	}
+	// The nodes we marked but haven't unlinked yet.
+	hopscotch_node_set_t pending_nodes;
+	hopscotch_res_t _tmp_002 = _node_set_init(&pending_nodes, list->opts, (size_t) 64);
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	int16_t top_level = -1;
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * end_nodes[(int) list->opts->max_level];
+	while (true) {
+		uint8_t _level_found;
+		hopscotch_res_t _tmp_003 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			lo_val,
+			lo_val_size
+		);
+		if (
+			(_tmp_003 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_003 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			_list_unlink_pending(list, &pending_nodes, NULL);
+			return _tmp_003;
+		}
+		// Mark everything in the range that isn't pending yet, one node lock at a time (just like `hopscotch_list_del_el`).
+		// Once a node is marked, nothing can be linked right before or after it, so the run can't grow behind our back.
+		bool foreign_found = false;
+		bool contended = false;
+		hopscotch_node_t * node;
+		for (node = succ_nodes[0]; true; node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire)) {
+			int _cmp_res_001;
+			hopscotch_res_t _tmp_004 = _list_cmp_el(
 				&_cmp_res_001,
-				curr_node->val.data,
-				curr_node->val.size,
-				val,
-				val_size
+				NULL,
+				list->opts,
+				node,
+				NULL,
+				NULL,
+				hi_val,
+				hi_val_size
 			);
-			if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
-				return _tmp_001;
+			if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+				_list_unlink_pending(list, &pending_nodes, NULL);
+				return _tmp_004;
+			}
+			if (_cmp_res_001 >= 0) {
+				break;
+			}
+			bool pending;
+			_node_set_has(&pending, &pending_nodes, node);
+			if (pending) {
+				continue;
+			}
+			// The load has to be atomic, otherwise the compiler is free to hoist it out of the spin.
+			while (! atomic_load_explicit(&(node->fully_linked), memory_order_acquire));
+			// Writers can be waiting on our marked nodes to go away while holding this lock, so we can't block on it while any of them are still linked.
+			if (pending_nodes.count > 0) {
+				if (pthread_mutex_trylock(&(node->lock)) != 0) {
+					contended = true;
+					break;
+				}
+			} else {
+				hopscotch_res_t _tmp_005 = _list_lock_el(list, node);
+				if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+					return _tmp_005;
+				}
+			}
+			bool marked_by_us = (bool) (! atomic_load_explicit(&(node->marked), memory_order_acquire));
+			atomic_store_explicit(&(node->marked), true, memory_order_release);
+			int _tmp_006 = pthread_mutex_unlock(&(node->lock));
+			if (! marked_by_us) {
+				if (_tmp_006 != 0) {
+					_list_unlink_pending(list, &pending_nodes, NULL);
+					return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+				}
+				// Some other thread is deleting this one.
+				foreign_found = true;
+				continue;
+			}
+			// From here on, a failure has to unlink the node along with the pending ones.
+			hopscotch_res_t _tmp_007 = _node_set_add(&pending_nodes, list->opts, node);
+			if (_tmp_007 != HOPSCOTCH_RES__SUCCESS) {
+				_list_unlink_pending(list, &pending_nodes, node);
+				return _tmp_007;
+			}
+			hopscotch_res_t _tmp_008 = _list_forget_el(list, node);
+			if ((_tmp_008 == HOPSCOTCH_RES__SUCCESS) && (_tmp_006 != 0)) {
+				_tmp_008 = HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+			if (_tmp_008 != HOPSCOTCH_RES__SUCCESS) {
+				_list_unlink_pending(list, &pending_nodes, NULL);
+				return _tmp_008;
+			}
+			deleted_count[0]++;
+			if (((int) atomic_load_explicit(&(node->level), memory_order_acquire)) > ((int) top_level)) {
+				top_level = (int16_t) atomic_load_explicit(&(node->level), memory_order_acquire);
+			}
+		}
+		if (pending_nodes.count == 0) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// We can't swing pointers over nodes another thread is going to unlink, or past a node we haven't marked yet.
+		if ((! foreign_found) && (! contended)) {
+			// Lock the predecessors, then make sure that at every level, the run right after them is entirely ours.
+			int16_t highest_level_locked = -1;
+			hopscotch_node_t * prev_pred_node = NULL;
+			bool valid = true;
+			int16_t _level;
+			for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
+				hopscotch_node_t * pred_node = pred_nodes[(int) _level];
+				if (pred_node != prev_pred_node) {
+					hopscotch_res_t _tmp_009 = _list_lock_el(list, pred_node);
+					if (_tmp_009 != HOPSCOTCH_RES__SUCCESS) {
+						_list_unlock_preds(pred_nodes, highest_level_locked);
+						_list_unlink_pending(list, &pending_nodes, NULL);
+						return _tmp_009;
+					}
+					highest_level_locked = _level;
+					prev_pred_node = pred_node;
+				}
+				if (
+					atomic_load_explicit(&(pred_node->marked), memory_order_acquire) ||
+					(((int) atomic_load_explicit(&(pred_node->level), memory_order_acquire)) < ((int) _level)) ||
+					(atomic_load_explicit(&(pred_node->forward[(int) _level]), memory_order_acquire) != succ_nodes[(int) _level])
+				) {
+					valid = false;
+					break;
+				}
+				bool pending = true;
+				for (node = succ_nodes[(int) _level]; pending; node = atomic_load_explicit(&(node->forward[(int) _level]), memory_order_acquire)) {
+					_node_set_has(&pending, &pending_nodes, node);
+					if (! pending) {
+						break;
+					}
+				}
+				end_nodes[(int) _level] = node;
+				// Something in the range that isn't ours means a node was linked before we got to mark it.
+				int _cmp_res_002;
+				hopscotch_res_t _tmp_010 = _list_cmp_el(
+					&_cmp_res_002,
+					NULL,
+					list->opts,
+					node,
+					NULL,
+					NULL,
+					hi_val,
+					hi_val_size
+				);
+				if (_tmp_010 != HOPSCOTCH_RES__SUCCESS) {
+					_list_unlock_preds(pred_nodes, highest_level_locked);
+					_list_unlink_pending(list, &pending_nodes, NULL);
+					return _tmp_010;
+				}
+				valid = (bool) (_cmp_res_002 >= 0);
+			}
+			if (valid) {
+				// One pointer swing per level, top-down like `hopscotch_list_del_el`.
+				// Readers that are already inside the run just follow its forward pointers out of it.
+				int16_t _a;
+				for (_a = top_level; ((int) _a) >= 0; _a--) {
+					atomic_store_explicit(&(pred_nodes[(int) _a]->forward[(int) _a]), end_nodes[(int) _a], memory_order_release);
+				}
+				_list_link_back(list, end_nodes[0], pred_nodes[0]);
+			}
+			// Release locks!
+			hopscotch_res_t _tmp_011 = _list_unlock_preds(pred_nodes, highest_level_locked);
+			if (_tmp_011 != HOPSCOTCH_RES__SUCCESS) {
+				if (! valid) {
+					_list_unlink_pending(list, &pending_nodes, NULL);
+				}
+				return _tmp_011;
+			}
+			if (valid) {
+				// Success!
+				return HOPSCOTCH_RES__SUCCESS;
+			}
+			continue;
+		}
+		// Slow path: unlink our nodes one by one, in order.
+		// Going in order means the nearest marked predecessor is always gone (or going) by the time we need it, so everyone makes progress.
+		hopscotch_res_t _tmp_012 = _list_find_el(
+			&_level_found,
+			pred_nodes,
+			succ_nodes,
+			list,
+			lo_val,
+			lo_val_size
+		);
+		if (
+			(_tmp_012 != HOPSCOTCH_RES__SUCCESS) &&
+			(_tmp_012 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+		) {
+			_list_unlink_pending(list, &pending_nodes, NULL);
+			return _tmp_012;
+		}
+		node = succ_nodes[0];
+		while (true) {
+			int _cmp_res_003;
+			hopscotch_res_t _tmp_013 = _list_cmp_el(
+				&_cmp_res_003,
+				NULL,
+				list->opts,
+				node,
+				NULL,
+				NULL,
+				hi_val,
+				hi_val_size
+			);
+			if (_tmp_013 != HOPSCOTCH_RES__SUCCESS) {
+				_list_unlink_pending(list, &pending_nodes, NULL);
+				return _tmp_013;
+			}
+			if (_cmp_res_003 >= 0) {
+				break;
+			}
+			hopscotch_node_t * next_node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+			bool pending;
+			_node_set_has(&pending, &pending_nodes, node);
+			if (pending) {
+				hopscotch_res_t _tmp_014 = _list_unlink_el(list, node);
+				if (_tmp_014 != HOPSCOTCH_RES__SUCCESS) {
+					_list_unlink_pending(list, &pending_nodes, NULL);
+					return _tmp_014;
+				}
+			}
+			node = next_node;
+		}
+		if (! contended) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+		// Nothing of ours is linked anymore, so it's safe to go back and wait for the rest of the range.
+		hopscotch_res_t _tmp_015 = _node_set_init(&pending_nodes, list->opts, (size_t) 64);
+		if (_tmp_015 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_015;
+		}
+		top_level = -1;
+	}
+}
+
+hopscotch_res_t
+hopscotch_list_clear(hopscotch_list_t * list) {
+	if (list->opts->versions.enabled) {
+		return HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED;
+	}
+	// A small list that isn't pinned goes back to being an empty array.
+	if (list->opts->small.capacity > 0) {
+		int _tmp_003 = pthread_mutex_lock(&(list->small->lock));
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+		}
+		bool cleared = false;
+		hopscotch_res_t _tmp_004 = HOPSCOTCH_RES__SUCCESS;
+		if (list->small->active) {
+			uint64_t seq = list->small->seq;
+			__atomic_store_n(&(list->small->seq), seq + 1, __ATOMIC_RELAXED);
+			__atomic_store_n(&(list->small->count), (size_t) 0, __ATOMIC_RELEASE);
+			__atomic_store_n(&(list->small->seq), seq + 2, __ATOMIC_RELEASE);
+			cleared = true;
+		} else {
+			_tmp_004 = _small_demote(&cleared, list, true);
+		}
+		int _tmp_005 = pthread_mutex_unlock(&(list->small->lock));
+		if (_tmp_005 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+		}
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_004;
+		}
+		if (cleared) {
+			// Success!
+			return HOPSCOTCH_RES__SUCCESS;
+		}
+	}
+	// Find the right sentinel.
+	int16_t top_level = ((int16_t) list->opts->max_level) - 1;
+	hopscotch_node_t * tail_node = list->head;
+	while (atomic_load_explicit(&(tail_node->forward[(int) top_level]), memory_order_acquire) != NULL) {
+		tail_node = atomic_load_explicit(&(tail_node->forward[(int) top_level]), memory_order_acquire);
+	}
+	// Start the filter and index over.
+	// Until the swing below, a lookup might be told an element that's about to go is already gone, which is fine since we're racing it.
+	hopscotch_list_filter_t * _filter = __atomic_load_n(&(list->filter), __ATOMIC_ACQUIRE);
+	hopscotch_filter_t * filter = (_filter == NULL) ? NULL : __atomic_load_n(&(_filter->current), __ATOMIC_ACQUIRE);
+	if (filter != NULL) {
+		hopscotch_filter_t * new_filter = NULL;
+		hopscotch_res_t _tmp_001 = _filter_new(
+			&new_filter,
+			list->opts,
+			(((filter->bucket_mask + 1) * HOPSCOTCH_VAL_FILTER_BUCKET_SIZE) * 4) / 5
+		);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		__atomic_store_n(&(_filter->current), new_filter, __ATOMIC_RELEASE);
+	}
+	if (list->index != NULL) {
+		hopscotch_index_t * new_index = NULL;
+		hopscotch_res_t _tmp_002 = _index_new(&new_index, list->opts, list->opts->index.capacity);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		__atomic_store_n(&(list->index), new_index, __ATOMIC_RELEASE);
+	}
+	// Point the left sentinel straight at the right one, top-down.
+	// The old nodes keep their forward pointers, so readers that are already walking them still reach the right sentinel.
+	int16_t _level;
+	for (_level = top_level; ((int) _level) >= 0; _level--) {
+		atomic_store_explicit(&(list->head->forward[(int) _level]), tail_node, memory_order_release);
+	}
+	_list_link_back(list, tail_node, list->head);
+	// The old nodes aren't marked, so the tails have to go too.
+	_list_set_tails(list, NULL);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_union(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+) {
+	return _list_set_op(
+		result,
+		list_a,
+		list_b,
+		true,
+		true,
+		true
+	);
+}
+
+hopscotch_res_t
+hopscotch_list_intersection(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+) {
+	return _list_set_op(
+		result,
+		list_a,
+		list_b,
+		false,
+		true,
+		false
+	);
+}
+
+hopscotch_res_t
+hopscotch_list_difference(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+) {
+	return _list_set_op(
+		result,
+		list_a,
+		list_b,
+		true,
+		false,
+		false
+	);
+}
+
+hopscotch_res_t
+hopscotch_list_merge(
+	size_t * added_count,
+	hopscotch_list_t * list,
+	hopscotch_list_t * other_list
+) {
+	added_count[0] = 0;
+	hopscotch_res_t _tmp_003 = _small_pin(list);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	hopscotch_res_t _tmp_004 = _small_pin(other_list);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	// Every element of `other_list` is added starting from the previous one's predecessors, so each add only climbs as high as the gap to the previous one needs.
+	hopscotch_node_t * finger_nodes[(int) list->opts->max_level];
+	int16_t _level;
+	for (_level = 0; ((int) _level) < ((int) list->opts->max_level); _level++) {
+		finger_nodes[(int) _level] = list->head;
+	}
+	hopscotch_node_t * node = atomic_load_explicit(&(other_list->head->forward[0]), memory_order_acquire);
+	while (true) {
+		_list_live_el(&node);
+		if (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) == NULL) {
+			break;
+		}
+		hopscotch_byte_t * val;
+		size_t val_size;
+		hopscotch_res_t _tmp_002 = _list_el_val(&val, &val_size, other_list, node);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		bool added;
+		hopscotch_res_t _tmp_001 = _list_add_el(
+			&added,
+			finger_nodes,
+			list,
+			val,
+			val_size
+		);
+		if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_001;
+		}
+		if (added) {
+			added_count[0]++;
+		}
+		node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_split(
+	hopscotch_list_t ** right_list,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	if (list->shm != NULL) {
+		return HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED;
+	}
+	if (list->opts->versions.enabled) {
+		return HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED;
+	}
+	hopscotch_list_t * _right_list = NULL;
+	hopscotch_res_t _tmp_001 = hopscotch_list_new(&_right_list, list->opts);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_res_t _tmp_004 = _small_pin(list);
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_004;
+	}
+	hopscotch_res_t _tmp_005 = _small_pin(_right_list);
+	if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_005;
+	}
+	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
+	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
+	uint8_t _level_found;
+	hopscotch_res_t _tmp_002 = _list_find_el(
+		&_level_found,
+		pred_nodes,
+		succ_nodes,
+		list,
+		val,
+		val_size
+	);
+	if (
+		(_tmp_002 != HOPSCOTCH_RES__SUCCESS) &&
+		(_tmp_002 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND)
+	) {
+		return _tmp_002;
+	}
+	hopscotch_res_t _tmp_003 = _list_move_els(list, _right_list, succ_nodes[0]);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	// The new list takes over the tail of the towers, right sentinel and all, and we take its fresh right sentinel in exchange.
+	hopscotch_node_t * tail_node = atomic_load_explicit(&(_right_list->head->forward[0]), memory_order_acquire);
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		atomic_store_explicit(&(_right_list->head->forward[(int) _level]), succ_nodes[(int) _level], memory_order_release);
+	}
+	// Cut top-down, like `hopscotch_list_del_el`.
+	// Readers that are already past the cut just carry on to the (old) right sentinel.
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		atomic_store_explicit(&(pred_nodes[(int) _level]->forward[(int) _level]), tail_node, memory_order_release);
+	}
+	_list_link_back(_right_list, succ_nodes[0], _right_list->head);
+	_list_link_back(list, tail_node, pred_nodes[0]);
+	// Our last nodes are now the ones the cut was made after.
+	_list_set_tails(list, pred_nodes);
+	// Set the result.
+	right_list[0] = _right_list;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_join(hopscotch_list_t * list, hopscotch_list_t * right_list) {
+	if ((list->shm != NULL) || (right_list->shm != NULL)) {
+		return HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED;
+	}
+	if (list->opts->versions.enabled || right_list->opts->versions.enabled) {
+		return HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED;
+	}
+	// Towers can't be taller than the list they end up in.
+	if (((int) list->opts->max_level) != ((int) right_list->opts->max_level)) {
+		return HOPSCOTCH_RES_LIST_JOIN_INVALID_LISTS;
+	}
+	// Compressed nodes can only go where they'll be compared as bytes.
+	if (list->opts->prefix_compression.enabled != right_list->opts->prefix_compression.enabled) {
+		return HOPSCOTCH_RES_LIST_JOIN_INVALID_LISTS;
+	}
+	hopscotch_res_t _tmp_005 = _small_pin(list);
+	if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_005;
+	}
+	hopscotch_res_t _tmp_006 = _small_pin(right_list);
+	if (_tmp_006 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_006;
+	}
+	hopscotch_node_t * first_node = atomic_load_explicit(&(right_list->head->forward[0]), memory_order_acquire);
+	if (atomic_load_explicit(&(first_node->forward[0]), memory_order_acquire) == NULL) {
+		// Nothing to join.
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	hopscotch_node_t * last_nodes[(int) list->opts->max_level];
+	hopscotch_res_t _tmp_001 = _list_find_last_el(last_nodes, list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	if (last_nodes[0] != list->head) {
+		hopscotch_byte_t * first_val;
+		size_t first_val_size;
+		hopscotch_res_t _tmp_004 = _list_el_val(&first_val, &first_val_size, right_list, first_node);
+		if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_004;
+		}
+		int _cmp_res_001;
+		hopscotch_res_t _tmp_002 = _list_cmp_el(
+			&_cmp_res_001,
+			NULL,
+			list->opts,
+			last_nodes[0],
+			NULL,
+			NULL,
+			first_val,
+			first_val_size
+		);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		if (_cmp_res_001 >= 0) {
+			return HOPSCOTCH_RES_LIST_JOIN_INVALID_LISTS;
+		}
+	}
+	hopscotch_res_t _tmp_003 = _list_move_els(right_list, list, first_node);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	// Splice `right_list`'s towers onto ours, and hand it our right sentinel so that it's left empty.
+	hopscotch_node_t * tail_node = atomic_load_explicit(&(last_nodes[0]->forward[0]), memory_order_acquire);
+	int16_t _level;
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		atomic_store_explicit(&(last_nodes[(int) _level]->forward[(int) _level]), atomic_load_explicit(&(right_list->head->forward[(int) _level]), memory_order_acquire), memory_order_release);
+	}
+	for (_level = ((int16_t) list->opts->max_level) - 1; ((int) _level) >= 0; _level--) {
+		atomic_store_explicit(&(right_list->head->forward[(int) _level]), tail_node, memory_order_release);
+	}
+	_list_link_back(list, first_node, last_nodes[0]);
+	_list_link_back(right_list, tail_node, right_list->head);
+	// Our old tails are just stale now, but `right_list`'s are ours.
+	_list_set_tails(right_list, NULL);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_maintenance_start(hopscotch_list_t * list) {
+	// Only lazy and adaptive towers need maintaining.
+	if (list->maintenance == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(list->maintenance->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	if (list->maintenance->running) {
+		pthread_mutex_unlock(&(list->maintenance->lock));
+		return HOPSCOTCH_RES_LIST_MAINTENANCE_BUSY;
+	}
+	list->maintenance->running = true;
+	int _tmp_002 = pthread_create(&(list->maintenance->thread), NULL, _list_maintenance_main, (void *) list);
+	if (_tmp_002 != 0) {
+		list->maintenance->running = false;
+		pthread_mutex_unlock(&(list->maintenance->lock));
+		return HOPSCOTCH_RES_PTHREAD_CREATE_FAIL;
+	}
+	int _tmp_003 = pthread_mutex_unlock(&(list->maintenance->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_maintenance_stop(hopscotch_list_t * list) {
+	// Only lazy and adaptive towers need maintaining.
+	if (list->maintenance == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(list->maintenance->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	bool was_running = list->maintenance->running;
+	list->maintenance->running = false;
+	pthread_cond_signal(&(list->maintenance->cond));
+	int _tmp_002 = pthread_mutex_unlock(&(list->maintenance->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	if (was_running) {
+		int _tmp_003 = pthread_join(list->maintenance->thread, NULL);
+		if (_tmp_003 != 0) {
+			return HOPSCOTCH_RES_PTHREAD_JOIN_FAIL;
+		}
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_maintenance_run(hopscotch_list_t * list) {
+	// Only lazy and adaptive towers need maintaining.
+	if (list->maintenance == NULL) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	int _tmp_001 = pthread_mutex_lock(&(list->maintenance->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	hopscotch_res_t _tmp_002 = _list_maintain(list);
+	int _tmp_003 = pthread_mutex_unlock(&(list->maintenance->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return _tmp_002;
+}
+
+hopscotch_res_t
+hopscotch_list_filter_fp_rate(double * rate, hopscotch_list_t * list) {
+	hopscotch_list_filter_t * _filter = __atomic_load_n(&(list->filter), __ATOMIC_ACQUIRE);
+	hopscotch_filter_t * filter = (_filter == NULL) ? NULL : __atomic_load_n(&(_filter->current), __ATOMIC_ACQUIRE);
+	if (filter == NULL) {
+		return HOPSCOTCH_RES_LIST_FILTER_DISABLED;
+	}
+	if (__atomic_load_n(&(filter->overflowed), __ATOMIC_ACQUIRE)) {
+		rate[0] = (double) 1;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	uint64_t negatives = __atomic_load_n(&(filter->stats.negatives), __ATOMIC_RELAXED);
+	uint64_t false_positives = __atomic_load_n(&(filter->stats.false_positives), __ATOMIC_RELAXED);
+	if ((negatives + false_positives) == 0) {
+		rate[0] = (double) 0;
+	} else {
+		rate[0] = ((double) false_positives) / ((double) (negatives + false_positives));
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_list_filter_rebuild(hopscotch_list_t * list, size_t capacity) {
+	if (list->shm != NULL) {
+		return HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED;
+	}
+	hopscotch_res_t _tmp_010 = _small_pin(list);
+	if (_tmp_010 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_010;
+	}
+	hopscotch_node_t * node;
+	// Size the new filter from the number of elements if a capacity isn't provided.
+	if (capacity == 0) {
+		for (node = atomic_load_explicit(&(list->head->forward[0]), memory_order_acquire); atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL; node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire)) {
+			capacity++;
+		}
+		capacity += capacity / 2;
+		if (capacity < list->opts->filter.capacity) {
+			capacity = list->opts->filter.capacity;
+		}
+	}
+	hopscotch_filter_t * filter_next = NULL;
+	hopscotch_res_t _tmp_001 = _filter_new(&filter_next, list->opts, capacity);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	// A list that doesn't have a filter yet gets its record now (and of two rebuilds racing to set it up, one is told the other is busy below).
+	hopscotch_list_filter_t * filter = __atomic_load_n(&(list->filter), __ATOMIC_ACQUIRE);
+	if (filter == NULL) {
+		hopscotch_list_filter_t * new_filter = NULL;
+		hopscotch_res_t _tmp_011 = _list_filter_new(&new_filter, list->opts, (size_t) 0);
+		if (_tmp_011 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_011;
+		}
+		if (__atomic_compare_exchange_n(&(list->filter), &filter, new_filter, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+			filter = new_filter;
+		} else {
+			pthread_mutex_destroy(&(new_filter->lock));
+		}
+	}
+	int _tmp_002 = pthread_mutex_lock(&(filter->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	if (filter->next != NULL) {
+		pthread_mutex_unlock(&(filter->lock));
+		return HOPSCOTCH_RES_LIST_FILTER_BUSY;
+	}
+	// From here on, every add and del also goes to the new filter.
+	// Any add that didn't see it linked its node before we took the lock, or (if it didn't see the record either) before our CAS above, so the walk below finds it.
+	__atomic_store_n(&(filter->next), filter_next, __ATOMIC_RELEASE);
+	int _tmp_003 = pthread_mutex_unlock(&(filter->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Walk level 0 and add everything that's currently there.
+	// Hashes are added in chunks so that we don't take the filter lock once per element.
+	uint64_t hashes[256];
+	size_t hash_count = 0;
+	// Seq-cst for `_list_filter_add`.
+	node = atomic_load_explicit(&(list->head->forward[0]), memory_order_seq_cst);
+	while (true) {
+		bool at_end = (atomic_load_explicit(&(node->forward[0]), memory_order_seq_cst) == NULL);
+		if ((! at_end) && (! atomic_load_explicit(&(node->marked), memory_order_acquire))) {
+			hopscotch_byte_t * val;
+			size_t val_size;
+			hopscotch_res_t _tmp_009 = _list_el_val(&val, &val_size, list, node);
+			if (_tmp_009 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_009;
 			}
-			if (_cmp_res_001 < 0) {
-				pred_node = curr_node;
-				curr_node = pred_node->forward[(int) _level];
-			} else {
-				break;
+			hopscotch_res_t _tmp_004 = list->opts->hash(&(hashes[hash_count]), val, val_size);
+			if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+				return _tmp_004;
 			}
+			hash_count++;
 		}
-		int _cmp_res_002;
-		hopscotch_res_t _tmp_002 = list->opts->cmp(
-			&_cmp_res_002,
-			curr_node->val.data,
-			curr_node->val.size,
-			val,
-			val_size
+		if (
+			(hash_count == (sizeof(hashes) / sizeof(hashes[0]))) ||
+			(at_end && (hash_count > 0))
+		) {
+			int _tmp_005 = pthread_mutex_lock(&(filter->lock));
+			if (_tmp_005 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+			}
+			size_t _a;
+			for (_a = 0; _a < hash_count; _a++) {
+				_filter_add(filter_next, hashes[_a]);
+			}
+			int _tmp_006 = pthread_mutex_unlock(&(filter->lock));
+			if (_tmp_006 != 0) {
+				return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+			}
+			hash_count = 0;
+		}
+		if (at_end) {
+			break;
+		}
+		node = atomic_load_explicit(&(node->forward[0]), memory_order_seq_cst);
+	}
+	// Swap the new filter in.
+	int _tmp_007 = pthread_mutex_lock(&(filter->lock));
+	if (_tmp_007 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	__atomic_store_n(&(filter->current), filter_next, __ATOMIC_RELEASE);
+	__atomic_store_n(&(filter->next), NULL, __ATOMIC_RELEASE);
+	int _tmp_008 = pthread_mutex_unlock(&(filter->lock));
+	if (_tmp_008 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_lsm_open(hopscotch_lsm_t ** lsm, const char * path, hopscotch_opts_t * opts) {
+	// The pointer `lsm` points to must be initialized to `NULL`!
+	// This check is just done for safety reasons.
+	if (lsm[0] != NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_LIST_PTR;
+	}
+	// `opts` must not be `NULL`.
+	if (opts == NULL) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS_PTR;
+	}
+	// The memtables need their own `cmp`, and the filter, the index and prefix compression would see the op byte. Runs of one element each make no sense either.
+	if (
+		(opts->cmp != NULL) ||
+		(opts->filter.capacity > 0) ||
+		opts->index.enabled ||
+		opts->prefix_compression.enabled ||
+		opts->versions.enabled ||
+		(opts->small.capacity > 0) ||
+		(opts->lsm.compaction_runs == 1)
+	) {
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
+	}
+	void * (* gc_malloc)(size_t) = (opts->gc.malloc != NULL) ? opts->gc.malloc : __MALLOC;
+	hopscotch_lsm_t * _lsm = _MALLOC(gc_malloc, hopscotch_lsm_t, ((size_t) 1));
+	if (_lsm == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	_lsm->opts = _MALLOC(gc_malloc, hopscotch_opts_t, ((size_t) 1));
+	if (_lsm->opts == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memcpy((void *) _lsm->opts, (void *) opts, sizeof(hopscotch_opts_t));
+	_lsm->opts->cmp = _lsm_el_cmp;
+	_lsm->opts->gc.malloc = gc_malloc;
+	if (_lsm->opts->lsm.memtable_size == 0) {
+		_lsm->opts->lsm.memtable_size = HOPSCOTCH_VAL_LSM_DEFAULT_MEMTABLE_SIZE;
+	}
+	if (_lsm->opts->lsm.block_size == 0) {
+		_lsm->opts->lsm.block_size = HOPSCOTCH_VAL_LSM_DEFAULT_BLOCK_SIZE;
+	}
+	if (_lsm->opts->lsm.compaction_runs == 0) {
+		_lsm->opts->lsm.compaction_runs = HOPSCOTCH_VAL_LSM_DEFAULT_COMPACTION_RUNS;
+	}
+	size_t path_size = strlen(path);
+	_lsm->path = _MALLOC(gc_malloc, char, path_size + 1);
+	if (_lsm->path == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memcpy((void *) _lsm->path, (void *) path, path_size + 1);
+	if ((mkdir(path, (mode_t) 0755) != 0) && (errno != EEXIST)) {
+		return HOPSCOTCH_RES_MKDIR_FAIL;
+	}
+	_lsm->state = NULL;
+	_lsm->retired = 0;
+	_lsm->memtable_size = 0;
+	_lsm->seq = 0;
+	_lsm->file = 0;
+	_lsm->running = false;
+	_lsm->busy = false;
+	_lsm->res = HOPSCOTCH_RES__SUCCESS;
+	int _tmp_001 = pthread_mutex_init(&(_lsm->lock), NULL);
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	}
+	int _tmp_002 = pthread_cond_init(&(_lsm->cond), NULL);
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_COND_INIT_FAIL;
+	}
+	hopscotch_lsm_run_t ** runs;
+	size_t runs_count;
+	hopscotch_res_t _tmp_003 = _lsm_load(&runs, &runs_count, _lsm);
+	if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_003;
+	}
+	hopscotch_list_t * memtable = NULL;
+	hopscotch_res_t _tmp_004 = _list_new(&memtable, _lsm->opts, NULL);
+	hopscotch_lsm_state_t * state;
+	if (_tmp_004 == HOPSCOTCH_RES__SUCCESS) {
+		_tmp_004 = _lsm_state_new(&state, _lsm, runs_count);
+	}
+	if (_tmp_004 != HOPSCOTCH_RES__SUCCESS) {
+		size_t i;
+		for (i = 0; i < runs_count; i++) {
+			munmap((void *) runs[i]->map, (size_t) runs[i]->header.size);
+		}
+		return _tmp_004;
+	}
+	state->memtable = memtable;
+	if (runs_count > 0) {
+		memcpy((void *) state->runs, (void *) runs, sizeof(hopscotch_lsm_run_t *) * runs_count);
+	}
+	// Nobody else can see the store yet, so there's no need for the lock.
+	_lsm_install(_lsm, state);
+	if (_lsm->opts->towers.lazy || _lsm->opts->towers.adaptive) {
+		hopscotch_res_t _tmp_005 = hopscotch_list_maintenance_start(memtable);
+		if (_tmp_005 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_005;
+		}
+	}
+	_lsm->running = true;
+	int _tmp_006 = pthread_create(&(_lsm->thread), NULL, _lsm_main, (void *) _lsm);
+	if (_tmp_006 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_CREATE_FAIL;
+	}
+	// Set the result.
+	lsm[0] = _lsm;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_lsm_add_el(hopscotch_lsm_t * lsm, hopscotch_byte_t * val, size_t val_size) {
+	return _lsm_put(lsm, HOPSCOTCH_VAL_LSM_OP_ADD, val, val_size);
+}
+
+hopscotch_res_t
+hopscotch_lsm_del_el(hopscotch_lsm_t * lsm, hopscotch_byte_t * val, size_t val_size) {
+	return _lsm_put(lsm, HOPSCOTCH_VAL_LSM_OP_DEL, val, val_size);
+}
+
+hopscotch_res_t
+hopscotch_lsm_contains_el(
+	bool * found,
+	hopscotch_lsm_t * lsm,
+	hopscotch_byte_t * val,
+	size_t val_size
+) {
+	// The memtables are searched with a copy of `val` that has an op in front, like their elements (the op itself doesn't matter).
+	hopscotch_byte_t short_el[256];
+	hopscotch_byte_t * el = short_el;
+	if ((val_size + 1) > sizeof(short_el)) {
+		el = _MALLOC(lsm->opts->gc.malloc, hopscotch_byte_t, val_size + 1);
+		if (el == NULL) {
+			return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+		}
+	}
+	el[0] = HOPSCOTCH_VAL_LSM_OP_ADD;
+	if (val_size > 0) {
+		memcpy((void *) (el + 1), (void *) val, val_size);
+	}
+	hopscotch_lsm_state_t * state;
+	hopscotch_res_t _tmp_001 = _lsm_acquire(&state, lsm);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	bool known = false;
+	hopscotch_byte_t op = HOPSCOTCH_VAL_LSM_OP_DEL;
+	hopscotch_list_t * memtables[2] = {state->memtable, state->frozen};
+	size_t i;
+	for (i = 0; (i < 2) && (! known) && (res == HOPSCOTCH_RES__SUCCESS); i++) {
+		if (memtables[i] == NULL) {
+			continue;
+		}
+		hopscotch_node_t * node;
+		res = _list_lookup_el(
+			&node,
+			memtables[i],
+			el,
+			val_size + 1
 		);
+		if ((res == HOPSCOTCH_RES__SUCCESS) && (node != NULL)) {
+			known = true;
+			op = __atomic_load_n(&(node->val.data[0]), __ATOMIC_ACQUIRE);
+		}
+	}
+	for (i = 0; (i < state->runs_count) && (! known) && (res == HOPSCOTCH_RES__SUCCESS); i++) {
+		res = _lsm_find_el(&known, &op, state->runs[i], val, val_size);
+	}
+	hopscotch_res_t _tmp_002 = _lsm_release(lsm, state);
+	if (res != HOPSCOTCH_RES__SUCCESS) {
+		return res;
+	}
+	if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_002;
+	}
+	// Set the result.
+	found[0] = (bool) (known && (op == HOPSCOTCH_VAL_LSM_OP_ADD));
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+hopscotch_res_t
+hopscotch_lsm_flush(hopscotch_lsm_t * lsm) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	hopscotch_list_t * memtable = lsm->state->memtable;
+	int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	if (__atomic_load_n(&(lsm->memtable_size), __ATOMIC_RELAXED) > 0) {
+		hopscotch_res_t _tmp_003 = _lsm_freeze(lsm, memtable);
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
+		}
+	}
+	int _tmp_004 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_004 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	while ((lsm->state->frozen != NULL) && (lsm->res == HOPSCOTCH_RES__SUCCESS)) {
+		pthread_cond_wait(&(lsm->cond), &(lsm->lock));
+	}
+	hopscotch_res_t res = lsm->res;
+	int _tmp_005 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_005 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return res;
+}
+
+hopscotch_res_t
+hopscotch_lsm_compact(hopscotch_lsm_t * lsm) {
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	while (lsm->busy) {
+		pthread_cond_wait(&(lsm->cond), &(lsm->lock));
+	}
+	lsm->busy = true;
+	// Flushes can't happen while we're busy, so the runs stay the same until we're done.
+	size_t runs_count = lsm->state->runs_count;
+	bool needed = (bool) (
+		(runs_count > 1) ||
+		((runs_count == 1) && (lsm->state->runs[0]->header.tombstones > 0))
+	);
+	int _tmp_002 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_002 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	hopscotch_res_t res = HOPSCOTCH_RES__SUCCESS;
+	if (needed) {
+		res = _lsm_compact(lsm, (size_t) 0, runs_count);
+	}
+	int _tmp_003 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_003 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	lsm->busy = false;
+	pthread_cond_broadcast(&(lsm->cond));
+	int _tmp_004 = pthread_mutex_unlock(&(lsm->lock));
+	if (_tmp_004 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
+	}
+	return res;
+}
+
+hopscotch_res_t
+hopscotch_lsm_close(hopscotch_lsm_t * lsm) {
+	// Keep going after a failure, so that the thread is stopped and the runs are unmapped anyway.
+	hopscotch_res_t res = hopscotch_lsm_flush(lsm);
+	int _tmp_001 = pthread_mutex_lock(&(lsm->lock));
+	if (_tmp_001 != 0) {
+		return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
+	}
+	lsm->running = false;
+	pthread_cond_broadcast(&(lsm->cond));
+	pthread_mutex_unlock(&(lsm->lock));
+	int _tmp_002 = pthread_join(lsm->thread, NULL);
+	if ((_tmp_002 != 0) && (res == HOPSCOTCH_RES__SUCCESS)) {
+		res = HOPSCOTCH_RES_PTHREAD_JOIN_FAIL;
+	}
+	if (lsm->opts->towers.lazy || lsm->opts->towers.adaptive) {
+		hopscotch_res_t _tmp_003 = hopscotch_list_maintenance_stop(lsm->state->memtable);
+		if ((_tmp_003 != HOPSCOTCH_RES__SUCCESS) && (res == HOPSCOTCH_RES__SUCCESS)) {
+			res = _tmp_003;
+		}
+	}
+	// The current state is the last one left, and letting go of it unmaps every run.
+	hopscotch_lsm_state_t * state = lsm->state;
+	lsm->state = NULL;
+	lsm->retired++;
+	hopscotch_res_t _tmp_004 = _lsm_state_unref(lsm, state);
+	if ((_tmp_004 != HOPSCOTCH_RES__SUCCESS) && (res == HOPSCOTCH_RES__SUCCESS)) {
+		res = _tmp_004;
+	}
+	pthread_cond_destroy(&(lsm->cond));
+	pthread_mutex_destroy(&(lsm->lock));
+	return res;
+}
+
+hopscotch_res_t
+hopscotch_list_freeze(hopscotch_frozen_t ** frozen, hopscotch_list_t * list) {
+	hopscotch_res_t _tmp_001 = _small_pin(list);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	// The elements are gathered first, since the list can change between two walks of it.
+	size_t count = 0;
+	size_t capacity = (size_t) 64;
+	size_t vals_size = 0;
+	hopscotch_byte_t ** vals = _MALLOC(list->opts->gc.malloc, hopscotch_byte_t *, capacity);
+	size_t * val_sizes = _MALLOC(list->opts->gc.malloc, size_t, capacity);
+	if ((vals == NULL) || (val_sizes == NULL)) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	hopscotch_node_t * node = atomic_load_explicit(&(list->head->forward[0]), memory_order_acquire);
+	_list_live_el(&node);
+	while (atomic_load_explicit(&(node->forward[0]), memory_order_acquire) != NULL) {
+		if (count == capacity) {
+			hopscotch_byte_t ** bigger_vals = _MALLOC(list->opts->gc.malloc, hopscotch_byte_t *, capacity * 2);
+			size_t * bigger_val_sizes = _MALLOC(list->opts->gc.malloc, size_t, capacity * 2);
+			if ((bigger_vals == NULL) || (bigger_val_sizes == NULL)) {
+				return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+			}
+			memcpy((void *) bigger_vals, (void *) vals, sizeof(hopscotch_byte_t *) * count);
+			memcpy((void *) bigger_val_sizes, (void *) val_sizes, sizeof(size_t) * count);
+			vals = bigger_vals;
+			val_sizes = bigger_val_sizes;
+			capacity *= 2;
+		}
+		hopscotch_res_t _tmp_002 = _list_el_val(&(vals[count]), &(val_sizes[count]), list, node);
 		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
 			return _tmp_002;
 		}
-		if (
-			(! val_found) &&
-			(_cmp_res_002 == 0)
+		vals_size += val_sizes[count];
+		count++;
+		node = atomic_load_explicit(&(node->forward[0]), memory_order_acquire);
+		_list_live_el(&node);
+	}
+	hopscotch_frozen_header_t header;
+	memset((void *) &header, 0, sizeof(hopscotch_frozen_header_t));
+	header.custom_cmp = (uint64_t) (list->opts->cmp != _list_default_el_cmp);
+	// What all the elements start with is what the first and the last one do. The prefixes leave it out, since it can't tell any of them apart.
+	if ((header.custom_cmp == 0) && (count > 0)) {
+		size_t last_val_size = val_sizes[count - 1];
+		while (
+			(header.prefix_skip < (uint64_t) val_sizes[0]) &&
+			(header.prefix_skip < (uint64_t) last_val_size) &&
+			(vals[0][header.prefix_skip] == vals[count - 1][header.prefix_skip])
 		) {
-			val_found = true;
-			level_found[0] = (uint8_t) _level;
+			header.prefix_skip++;
+		}
+	}
+	_frozen_layout(&header, count, vals_size);
+	// With room to start the layout at a cache line.
+	hopscotch_byte_t * buffer = _MALLOC(
+		list->opts->gc.malloc,
+		hopscotch_byte_t,
+		((size_t) header.size) + HOPSCOTCH_VAL_FROZEN_ALIGNMENT
+	);
+	if (buffer == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	hopscotch_byte_t * data = buffer + (
+		(HOPSCOTCH_VAL_FROZEN_ALIGNMENT - (((uintptr_t) buffer) % HOPSCOTCH_VAL_FROZEN_ALIGNMENT)) % HOPSCOTCH_VAL_FROZEN_ALIGNMENT
+	);
+	memcpy((void *) data, (void *) &header, sizeof(hopscotch_frozen_header_t));
+	uint64_t * prefixes = (uint64_t *) (data + header.prefixes_offset);
+	uint64_t * ranks = (uint64_t *) (data + header.ranks_offset);
+	uint64_t * offsets = (uint64_t *) (data + header.offsets_offset);
+	hopscotch_byte_t * packed_vals = data + header.vals_offset;
+	// The elements, in order.
+	uint64_t offset = 0;
+	size_t i;
+	for (i = 0; i < count; i++) {
+		offsets[i] = offset;
+		if (val_sizes[i] > 0) {
+			memcpy((void *) (packed_vals + offset), (void *) vals[i], val_sizes[i]);
+		}
+		offset += (uint64_t) val_sizes[i];
+	}
+	offsets[count] = offset;
+	// Then the tree, which gets the elements in order if its nodes are visited in order (left subtree, node, right subtree).
+	prefixes[0] = 0;
+	ranks[0] = 0;
+	size_t k = 1;
+	while ((2 * k) <= count) {
+		k = 2 * k;
+	}
+	for (i = 0; i < count; i++) {
+		_frozen_prefix(&(prefixes[k]), vals[i] + header.prefix_skip, val_sizes[i] - ((size_t) header.prefix_skip));
+		ranks[k] = (uint64_t) i;
+		if (((2 * k) + 1) <= count) {
+			// The leftmost node of the right subtree.
+			k = (2 * k) + 1;
+			while ((2 * k) <= count) {
+				k = 2 * k;
+			}
+		} else {
+			// The closest ancestor whose left subtree this is the end of.
+			while ((k % 2) == 1) {
+				k /= 2;
+			}
+			k /= 2;
 		}
-		pred_nodes[(int) _level] = pred_node;
-		succ_nodes[(int) _level] = curr_node;
-	}
-	if (val_found) {
-		// Success!
-		return HOPSCOTCH_RES__SUCCESS;
-	} else {
-		return HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND;
 	}
+	return _frozen_new(frozen, list->opts, data, (size_t) header.size, false);
 }
 
-_ALWAYS_INLINE static inline hopscotch_res_t
-_list_rand_level(uint8_t * level, hopscotch_list_t * list) {
-	int16_t _level = 0;
-	while (
-		(genrand_real2() < list->opts->rand_level_p) &&
-		(((int) _level) <= ((int) list->opts->max_level))
-	) {
-		_level++;
+hopscotch_res_t
+hopscotch_frozen_save(hopscotch_frozen_t * frozen, const char * path) {
+	size_t path_size = strlen(path);
+	char * tmp_path = _MALLOC(frozen->opts->gc.malloc, char, path_size + 5);
+	if (tmp_path == NULL) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	memcpy((void *) tmp_path, (void *) path, path_size);
+	memcpy((void *) (tmp_path + path_size), (void *) ".tmp", (size_t) 5);
+	int fd = open(tmp_path, (O_WRONLY | O_CREAT | O_TRUNC), (mode_t) 0644);
+	if (fd < 0) {
+		return HOPSCOTCH_RES_OPEN_FAIL;
+	}
+	hopscotch_res_t _tmp_001 = _lsm_write(fd, frozen->data, frozen->size, (size_t) 0);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		close(fd);
+		unlink(tmp_path);
+		return _tmp_001;
+	}
+	// The file has to be on disk before it takes the place of an older one.
+	if (fsync(fd) != 0) {
+		close(fd);
+		unlink(tmp_path);
+		return HOPSCOTCH_RES_FSYNC_FAIL;
+	}
+	close(fd);
+	if (rename(tmp_path, path) != 0) {
+		unlink(tmp_path);
+		return HOPSCOTCH_RES_RENAME_FAIL;
 	}
-	level[0] = (uint8_t) _level;
 	// Success!
 	return HOPSCOTCH_RES__SUCCESS;
 }
 
 hopscotch_res_t
-hopscotch_list_new(hopscotch_list_t ** list, hopscotch_opts_t * opts) {
-	// The pointer `list` points to must be initialized to `NULL`!
-	// This check is just done for safety reasons.
-	if (list[0] != NULL) {
-		return HOPSCOTCH_RES_LIST_NEW_INVALID_LIST_PTR;
-	}
+hopscotch_frozen_open(hopscotch_frozen_t ** frozen, const char * path, hopscotch_opts_t * opts) {
 	// `opts` must not be `NULL`.
 	if (opts == NULL) {
 		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS_PTR;
 	}
-	// Set the default compare function if one isn't provided.
-	if (opts->cmp == NULL) {
-		opts->cmp = _list_default_el_cmp;
-	}
-	// Set the default max level if one isn't provided.
-	if (((int) opts->max_level) == 0) {
-		opts->max_level = HOPSCOTCH_VAL_LIST_DEFAULT_MAX_LEVEL;
-	}
-	// Set the default GC if one isn't provided.
-	if (opts->gc.malloc == NULL) {
-		opts->gc.malloc = __MALLOC;
-	}
-	// Set the list's default "p" for the random level function if one isn't provided.
-	if (opts->rand_level_p == ((double) 0)) {
-		opts->rand_level_p = HOPSCOTCH_VAL_LIST_DEFAULT_RAND_LEVEL_P;
-	}
-	// Set seed for the random number generator.
-	init_genrand(
-		(unsigned long) timestamp()
-	);
-	// Allocate some memory for the left sentinel node.
-	hopscotch_node_t * list_left_sentinel_node = _MALLOC(opts->gc.malloc, hopscotch_node_t, ((size_t) 1));
-	if (list_left_sentinel_node == NULL) {
+	void * (* gc_malloc)(size_t) = (opts->gc.malloc != NULL) ? opts->gc.malloc : __MALLOC;
+	hopscotch_opts_t * _opts = _MALLOC(gc_malloc, hopscotch_opts_t, ((size_t) 1));
+	if (_opts == NULL) {
 		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
 	}
-	// Initialize the left sentinel node.
-	// The left sentinel node's level is, of course, equal to the max level.
-	list_left_sentinel_node->level = opts->max_level - 1;
-	list_left_sentinel_node->val.data = (hopscotch_byte_t *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL;
-	list_left_sentinel_node->val.size = (size_t) (strlen((char *) list_left_sentinel_node->val.data) + 1);
-	list_left_sentinel_node->marked = false;
-	int _tmp_001 = pthread_mutex_init(&(list_left_sentinel_node->lock), NULL);
-	if (_tmp_001 != 0) {
-		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	memcpy((void *) _opts, (void *) opts, sizeof(hopscotch_opts_t));
+	if (_opts->cmp == NULL) {
+		_opts->cmp = _list_default_el_cmp;
 	}
-	// Allocate some memory for the right sentinel node.
-	hopscotch_node_t * list_right_sentinel_node = _MALLOC(opts->gc.malloc, hopscotch_node_t, ((size_t) 1));
-	if (list_right_sentinel_node == NULL) {
-		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	_opts->gc.malloc = gc_malloc;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return HOPSCOTCH_RES_OPEN_FAIL;
 	}
-	// Initialize the right sentinel node.
-	// The right sentinel node's level is, of course, also equal to the max level.
-	list_right_sentinel_node->level = opts->max_level - 1;
-	list_right_sentinel_node->val.data = (hopscotch_byte_t *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL;
-	list_right_sentinel_node->val.size = (size_t) (strlen((char *) list_right_sentinel_node->val.data) + 1);
-	list_right_sentinel_node->marked = false;
-	int _tmp_002 = pthread_mutex_init(&(list_right_sentinel_node->lock), NULL);
-	if (_tmp_002 != 0) {
-		return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return HOPSCOTCH_RES_FSTAT_FAIL;
 	}
-	// Allocate some memory for the sentinel nodes' forward pointers.
-	// We need space for `opts->max_level` forward pointers for both.
-	list_left_sentinel_node->forward = _MALLOC(opts->gc.malloc, hopscotch_node_t *, ((size_t) opts->max_level));
-	if (list_left_sentinel_node->forward == NULL) {
-		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	size_t size = (size_t) st.st_size;
+	if (size < sizeof(hopscotch_frozen_header_t)) {
+		close(fd);
+		return HOPSCOTCH_RES_FROZEN_INVALID;
 	}
-	list_right_sentinel_node->forward = _MALLOC(opts->gc.malloc, hopscotch_node_t *, ((size_t) opts->max_level));
-	if (list_right_sentinel_node->forward == NULL) {
-		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	void * addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, (off_t) 0);
+	// The mapping stays valid without the descriptor.
+	close(fd);
+	if (addr == MAP_FAILED) {
+		return HOPSCOTCH_RES_MMAP_FAIL;
 	}
-	int16_t _level;
-	for (_level = 0; ((int) _level) < ((int) opts->max_level); _level++) {
-		// All of the right sentinel node's forward pointers point to `NULL`.
-		list_right_sentinel_node->forward[(int) _level] = NULL;
-		// Initially, all forward pointers of the left sentinel node point to the right sentinel node.
-		list_left_sentinel_node->forward[(int) _level] = list_right_sentinel_node;
+	hopscotch_res_t _tmp_001 = _frozen_new(frozen, _opts, (hopscotch_byte_t *) addr, size, true);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		munmap(addr, size);
+		return _tmp_001;
 	}
-	// Both sentinel nodes are, initially, fully linked.
-	list_left_sentinel_node->fully_linked = true;
-	list_right_sentinel_node->fully_linked = true;
-	// Allocate some memory for the list structure.
-	hopscotch_list_t * _list = _MALLOC(opts->gc.malloc, hopscotch_list_t, ((size_t) 1));
-	if (_list == NULL) {
-		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	// The prefixes only agree with the default order, so the file has to have been frozen with the same `cmp` (or one of its own) as the options say.
+	if (((bool) (frozen[0]->header->custom_cmp != 0)) != ((bool) (_opts->cmp != _list_default_el_cmp))) {
+		munmap(addr, size);
+		frozen[0] = NULL;
+		return HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS;
 	}
-	// Initialize ...
-	_list->head = list_left_sentinel_node;
-	_list->opts = opts;
-	// Set the result.
-	list[0] = _list;
 	// Success!
 	return HOPSCOTCH_RES__SUCCESS;
 }
 
 hopscotch_res_t
-hopscotch_list_add_el(
-	bool * added,
-	hopscotch_list_t * list,
+hopscotch_frozen_contains_el(
+	bool * found,
+	hopscotch_frozen_t * frozen,
 	hopscotch_byte_t * val,
 	size_t val_size
 ) {
-	uint8_t _top_level;
-	_list_rand_level(&_top_level, list);
-	int16_t top_level = (int16_t) _top_level;
-	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
-	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
-	while (true) {
-		uint8_t _level_found;
-		hopscotch_res_t _tmp_001 = _list_find_el(
-			&_level_found,
-			pred_nodes,
-			succ_nodes,
-			list,
+	size_t rank;
+	hopscotch_res_t _tmp_001 = _frozen_find(&rank, frozen, val, val_size);
+	if (_tmp_001 != HOPSCOTCH_RES__SUCCESS) {
+		return _tmp_001;
+	}
+	bool _found = false;
+	if (rank < frozen->count) {
+		hopscotch_byte_t * rank_val;
+		size_t rank_val_size;
+		hopscotch_res_t _tmp_002 = _frozen_el(&rank_val, &rank_val_size, frozen, (uint64_t) rank);
+		if (_tmp_002 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_002;
+		}
+		int cmp_res;
+		hopscotch_res_t _tmp_003 = (frozen->header->custom_cmp != 0) ? frozen->opts->cmp(
+			&cmp_res,
+			rank_val,
+			rank_val_size,
+			val,
+			val_size
+		) : _lsm_val_cmp(
+			&cmp_res,
+			rank_val,
+			rank_val_size,
 			val,
 			val_size
 		);
-		int16_t level_found = (int16_t) _level_found;
-		if (_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) {
-			hopscotch_node_t * node_found = succ_nodes[(int) level_found];
-			if (! node_found->marked) {
-				while (! node_found->fully_linked);
-				added[0] = false;
-				// Success!
-				return HOPSCOTCH_RES__SUCCESS;
-			}
-			continue;
-		}
-		int16_t highest_level_locked = -1;
-		hopscotch_node_t * pred_node;
-		hopscotch_node_t * succ_node;
-		hopscotch_node_t * prev_pred_node = NULL;
-		bool valid = true;
-		int16_t _level;
-		for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
-			pred_node = pred_nodes[(int) _level];
-			succ_node = succ_nodes[(int) _level];
-			if (pred_node != prev_pred_node) {
-				int _tmp_002 = pthread_mutex_lock(&(pred_node->lock));
-				// TODO(@jonathanmarvens): Figure out a better way to handle this.
-				if (_tmp_002 != 0) {
-					return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
-				}
-				highest_level_locked = _level;
-				prev_pred_node = pred_node;
-			}
-			if (
-				(! pred_node->marked) &&
-				(! succ_node->marked) &&
-				(pred_node->forward[(int) _level] == succ_node)
-			) {
-				valid = true;
-			} else {
-				valid = false;
-			}
-		}
-		if (valid) {
-			hopscotch_node_t * new_node = _MALLOC(list->opts->gc.malloc, hopscotch_node_t, ((size_t) 1));
-			if (new_node == NULL) {
-				return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
-			}
-			new_node->level = (uint8_t) top_level;
-			new_node->val.data = val;
-			new_node->val.size = val_size;
-			new_node->marked = false;
-			int _tmp_003 = pthread_mutex_init(&(new_node->lock), NULL);
-			if (_tmp_003 != 0) {
-				return HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL;
-			}
-			new_node->forward = _MALLOC(list->opts->gc.malloc, hopscotch_node_t *, ((size_t) (top_level + 1)));
-			if (new_node->forward == NULL) {
-				return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
-			}
-			int16_t _a;
-			for (_a = 0; ((int) _a) <= ((int) top_level); _a++) {
-				new_node->forward[(int) _a] = succ_nodes[(int) _a];
-				pred_nodes[(int) _a]->forward[(int) _a] = new_node;
-			}
-			new_node->fully_linked = true;
-			added[0] = true;
-			// Release locks!
-			int16_t _b;
-			for (_b = 0; ((int) _b) <= ((int) highest_level_locked); _b++) {
-				int _tmp_004 = pthread_mutex_unlock(&(pred_nodes[(int) _b]->lock));
-				// TODO(@jonathanmarvens): Figure out a better way to handle this.
-				if (_tmp_004 != 0) {
-					return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-				}
-			}
-			// Success!
-			return HOPSCOTCH_RES__SUCCESS;
-		} else {
-			// Release locks!
-			int16_t _c;
-			for (_c = 0; ((int) _c) <= ((int) highest_level_locked); _c++) {
-				int _tmp_005 = pthread_mutex_unlock(&(pred_nodes[(int) _c]->lock));
-				// TODO(@jonathanmarvens): Figure out a better way to handle this.
-				if (_tmp_005 != 0) {
-					return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-				}
-			}
-			// Invalidate `highest_level_locked`.
-			highest_level_locked = -1;
-			continue;
+		if (_tmp_003 != HOPSCOTCH_RES__SUCCESS) {
+			return _tmp_003;
 		}
+		_found = (bool) (cmp_res == 0);
 	}
+	// Set the result.
+	found[0] = _found;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
 }
 
 hopscotch_res_t
-hopscotch_list_contains_el(
-	bool * found,
-	hopscotch_list_t * list,
+hopscotch_frozen_ceiling_el(
+	size_t * rank,
+	hopscotch_frozen_t * frozen,
 	hopscotch_byte_t * val,
 	size_t val_size
 ) {
-	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
-	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
-	uint8_t _level_found;
-	hopscotch_res_t _tmp_001 = _list_find_el(
-		&_level_found,
-		pred_nodes,
-		succ_nodes,
-		list,
-		val,
-		val_size
-	);
-	int16_t level_found = (int16_t) _level_found;
-	found[0] = (bool) (
-		(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) &&
-		succ_nodes[(int) level_found]->fully_linked &&
-		(! succ_nodes[(int) level_found]->marked)
-	);
-	// Success!
-	return HOPSCOTCH_RES__SUCCESS;
+	return _frozen_find(rank, frozen, val, val_size);
 }
 
 hopscotch_res_t
-hopscotch_list_del_el(
-	bool * deleted,
-	hopscotch_list_t * list,
-	hopscotch_byte_t * val,
-	size_t val_size
+hopscotch_frozen_el(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_frozen_t * frozen,
+	size_t rank
 ) {
-	hopscotch_node_t * node_to_del;
-	bool marked = false;
-	int16_t top_level;
-	hopscotch_node_t * pred_nodes[(int) list->opts->max_level];
-	hopscotch_node_t * succ_nodes[(int) list->opts->max_level];
-	while (true) {
-		uint8_t _level_found;
-		hopscotch_res_t _tmp_001 = _list_find_el(
-			&_level_found,
-			pred_nodes,
-			succ_nodes,
-			list,
-			val,
-			val_size
-		);
-		int16_t level_found = (int16_t) _level_found;
-		bool _can_delete;
-		_list_can_del_el(&_can_delete, succ_nodes[(int) level_found], (uint8_t) level_found);
-		if (
-			marked ||
-			(
-				(_tmp_001 != HOPSCOTCH_RES_LIST__FIND_EL_VAL_NOT_FOUND) &&
-				_can_delete
-			)
-		) {
-			if (! marked) {
-				node_to_del = succ_nodes[(int) level_found];
-				top_level = (int16_t) node_to_del->level;
-				int _tmp_002 = pthread_mutex_lock(&(node_to_del->lock));
-				// TODO(@jonathanmarvens): Figure out a better way to handle this.
-				if (_tmp_002 != 0) {
-					return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
-				}
-				if (node_to_del->marked) {
-					int _tmp_003 = pthread_mutex_unlock(&(node_to_del->lock));
-					// TODO(@jonathanmarvens): Figure out a better way to handle this.
-					if (_tmp_003 != 0) {
-						return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-					}
-					deleted[0] = false;
-					// Success!
-					return HOPSCOTCH_RES__SUCCESS;
-				}
-				node_to_del->marked = true;
-				marked = true;
-			}
-			int16_t highest_level_locked = -1;
-			hopscotch_node_t * pred_node;
-			hopscotch_node_t * succ_node;
-			hopscotch_node_t * prev_pred_node = NULL;
-			bool valid = true;
-			int16_t _level;
-			for (_level = 0; valid && (((int) _level) <= ((int) top_level)); _level++) {
-				pred_node = pred_nodes[(int) _level];
-				succ_node = succ_nodes[(int) _level];
-				if (pred_node != prev_pred_node) {
-					int _tmp_004 = pthread_mutex_lock(&(pred_node->lock));
-					// TODO(@jonathanmarvens): Figure out a better way to handle this.
-					if (_tmp_004 != 0) {
-						return HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL;
-					}
-					highest_level_locked = (int16_t) _level;
-					prev_pred_node = pred_node;
-				}
-				if (
-					(! pred_node->marked) &&
-					(pred_node->forward[(int) _level] == succ_node)
-				) {
-					valid = true;
-				} else {
-					valid = false;
-				}
-			}
-			if (valid) {
-				int16_t _a;
-				for (_a = top_level; ((int) _a) >= 0; _a--) {
-					pred_nodes[(int) _a]->forward[(int) _a] = node_to_del->forward[(int) _a];
-				}
-				int _tmp_005 = pthread_mutex_unlock(&(node_to_del->lock));
-				// TODO(@jonathanmarvens): Figure out a better way to handle this.
-				if (_tmp_005 != 0) {
-					return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-				}
-				// Release locks!
-				int16_t _b;
-				for (_b = 0; ((int) _b) <= ((int) highest_level_locked); _b++) {
-					int _tmp_006 = pthread_mutex_unlock(&(pred_nodes[(int) _b]->lock));
-					// TODO(@jonathanmarvens): Figure out a better way to handle this.
-					if (_tmp_006 != 0) {
-						return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-					}
-				}
-				deleted[0] = true;
-				// Success!
-				return HOPSCOTCH_RES__SUCCESS;
-			} else {
-				// Release locks!
-				int16_t _c;
-				for (_c = 0; ((int) _c) <= ((int) highest_level_locked); _c++) {
-					int _tmp_007 = pthread_mutex_unlock(&(pred_nodes[(int) _c]->lock));
-					// TODO(@jonathanmarvens): Figure out a better way to handle this.
-					if (_tmp_007 != 0) {
-						return HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL;
-					}
-				}
-				// Invalidate `highest_level_locked`.
-				highest_level_locked = -1;
-				continue;
-			}
-		} else {
-			deleted[0] = false;
-			// Success!
-			return HOPSCOTCH_RES__SUCCESS;
+	if (rank >= frozen->count) {
+		val[0] = NULL;
+		val_size[0] = 0;
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	return _frozen_el(val, val_size, frozen, (uint64_t) rank);
+}
+
+hopscotch_res_t
+hopscotch_frozen_free(hopscotch_frozen_t * frozen) {
+	// A buffer is left to the GC.
+	if (frozen->mapped) {
+		if (munmap((void *) frozen->data, frozen->size) != 0) {
+			return HOPSCOTCH_RES_MUNMAP_FAIL;
 		}
 	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
 }
 
 hopscotch_res_t
-hopscotch_list_free(_UNUSED_VAR hopscotch_list_t * list) {
-	// Since we use a GC, this function is essentially NOP.
+hopscotch_list_free(hopscotch_list_t * list) {
+	// Since we use a GC, this function is essentially NOP ...
+	// ... except for lists in shared memory, which only get unmapped (the segment lives on until it's unlinked).
+	if (list->shm != NULL) {
+		hopscotch_shm_t * segment = list->shm->segment;
+		pthread_mutexattr_destroy(&(list->shm->lock_attr));
+		if (munmap(segment->base, segment->size) != 0) {
+			return HOPSCOTCH_RES_MUNMAP_FAIL;
+		}
+	}
 	// Success!
 	return HOPSCOTCH_RES__SUCCESS;
 }
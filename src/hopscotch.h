@@ -47,6 +47,7 @@ using namespace std;
 #else
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
@@ -64,6 +65,20 @@ using namespace std;
 #define _ALWAYS_INLINE
 #endif
 
+// Node state that's read without locks is C11 `_Atomic`.
+// C++ (before C++23) has no `_Atomic`, and C++ code only ever sees nodes through the API, so there it's the plain type (same size and alignment).
+#ifdef __cplusplus
+#define HOPSCOTCH_ATOMIC(type) type
+#else
+#define HOPSCOTCH_ATOMIC(type) _Atomic(type)
+#endif
+
+#if defined(__GNUC__) && ((__GNUC__ > 3) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 1)))
+#define _PREFETCH(addr) __builtin_prefetch((const void *) (addr), 0, 3)
+#else
+#define _PREFETCH(addr) ((void) (addr))
+#endif
+
 #if defined(__GNUC__) && ((__GNUC__ > 2) || ((__GNUC__ == 2) && (__GNUC_MINOR__ >= 7)))
 #define _UNUSED_VAR __attribute__ ((unused))
 #else
@@ -93,6 +108,96 @@ using namespace std;
 // Other defaults.
 #define HOPSCOTCH_VAL_LIST_DEFAULT_MAX_LEVEL 16
 #define HOPSCOTCH_VAL_LIST_DEFAULT_RAND_LEVEL_P 0.5
+#define HOPSCOTCH_VAL_LIST_DEFAULT_TOWERS_INTERVAL_MS 10
+
+// How many searches `hopscotch_list_contains_batch` keeps in flight at once.
+#define HOPSCOTCH_VAL_LIST_BATCH_WIDTH 16
+// How many elements in a row the set operations take from one side before they start galloping through the upper levels instead.
+#define HOPSCOTCH_VAL_LIST_GALLOP_THRESHOLD 8
+// How many segments `hopscotch_list_parallel_for_each` cuts a list into per thread, so that the threads that finish early have some left to steal.
+#define HOPSCOTCH_VAL_LIST_SCAN_SEGMENTS_PER_THREAD 16
+
+// Flat combining (see `opts->combining.enabled`).
+// How many ops can be posted to a list at once. A writer that finds every slot taken applies its op itself.
+#define HOPSCOTCH_VAL_LIST_COMBINING_SLOTS 64
+// How many times a combiner goes over the slots before it lets someone else take over, so that it isn't kept serving the others forever.
+#define HOPSCOTCH_VAL_LIST_COMBINING_PASSES 4
+// The states of a slot (see `hopscotch_combining_slot_t`).
+#define HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE 0
+#define HOPSCOTCH_VAL_LIST_COMBINING_SLOT_CLAIMED 1
+#define HOPSCOTCH_VAL_LIST_COMBINING_SLOT_PENDING 2
+#define HOPSCOTCH_VAL_LIST_COMBINING_SLOT_DONE 3
+
+// How many nodes an element can be spread over with `opts->prefix_compression.enabled`.
+// A longer chain of shared prefixes is cut by storing the element in full, so that comparisons don't have to chase too many pointers.
+#define HOPSCOTCH_VAL_LIST_PREFIX_MAX_DEPTH 8
+
+// Adaptive towers (see `opts->towers.adaptive`).
+// Only 1 in every `HOPSCOTCH_VAL_LIST_ADAPTIVE_SAMPLE_RATE` lookups (per thread, at random) is counted.
+#define HOPSCOTCH_VAL_LIST_ADAPTIVE_SAMPLE_RATE 16
+// How many counted lookups get a node looked at by the next maintenance pass.
+#define HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS 8
+// How many counted lookups (as a multiple of the list's size) there have to be before a raised node that hasn't been hot since is looked at again, and lowered if it's cooled down.
+// A node that's worth a level more than its random one gets about twice this many hits in that time, so it isn't lowered by chance.
+#define HOPSCOTCH_VAL_LIST_ADAPTIVE_WINDOW 4
+// How many nodes a level needs for a maintenance pass to estimate the list's size from it.
+#define HOPSCOTCH_VAL_LIST_ADAPTIVE_ESTIMATE_NODES 64
+
+// Versioned lists.
+// A node's `versions->add` / `versions->del` before they happen (or if they never do).
+#define HOPSCOTCH_VAL_LIST_VERSION_NONE UINT64_MAX
+// The version reads that aren't made through a snapshot are made at: after every add and del so far.
+#define HOPSCOTCH_VAL_LIST_VERSION_NOW (UINT64_MAX - 1)
+
+// Membership filter tuning.
+#define HOPSCOTCH_VAL_FILTER_BUCKET_SIZE 4
+#define HOPSCOTCH_VAL_FILTER_MAX_KICKS 500
+// Only 1 in every `HOPSCOTCH_VAL_FILTER_STATS_SAMPLE_RATE` filtered lookups updates the false-positive stats.
+#define HOPSCOTCH_VAL_FILTER_STATS_SAMPLE_RATE 64
+
+// Hash index tuning.
+// `HOPSCOTCH_VAL_INDEX_STRIPES` must be a power of 2, and is also the smallest table size.
+#define HOPSCOTCH_VAL_INDEX_STRIPES 64
+// How many buckets each add / del moves to the new table while the index is being resized.
+#define HOPSCOTCH_VAL_INDEX_MIGRATE_STEP 2
+
+// Shared memory tuning.
+// Where `hopscotch_list_shm_open` maps new segments unless `opts->shm.base` says otherwise.
+// It's far away from where the heap, thread stacks and shared libraries usually end up, so other processes are likely to have it free too.
+// ThreadSanitizer keeps that part of the address space for itself though, so under it the kernel picks the address.
+#if defined(__SANITIZE_THREAD__)
+#define _HOPSCOTCH_TSAN
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define _HOPSCOTCH_TSAN
+#endif
+#endif
+#if (UINTPTR_MAX > 0xffffffffu) && (! defined(_HOPSCOTCH_TSAN))
+#define HOPSCOTCH_VAL_SHM_DEFAULT_BASE ((void *) (uintptr_t) 0x200000000000ULL)
+#else
+#define HOPSCOTCH_VAL_SHM_DEFAULT_BASE NULL
+#endif
+#define HOPSCOTCH_VAL_SHM_MAGIC 0x68736c6973743031ULL
+// How long `hopscotch_list_shm_open` waits for another process to finish setting up a segment it just created.
+#define HOPSCOTCH_VAL_SHM_OPEN_TIMEOUT_MS 1000
+
+// Log-structured stores (see `hopscotch_lsm_open`).
+#define HOPSCOTCH_VAL_LSM_DEFAULT_MEMTABLE_SIZE ((size_t) 4194304)
+#define HOPSCOTCH_VAL_LSM_DEFAULT_BLOCK_SIZE ((size_t) 4096)
+#define HOPSCOTCH_VAL_LSM_DEFAULT_COMPACTION_RUNS ((size_t) 4)
+#define HOPSCOTCH_VAL_LSM_RUN_MAGIC 0x68736c736d72756eULL
+// How many entries of a run's block there are per restart point, i.e. how many a lookup goes through one by one after it's binary searched the block.
+#define HOPSCOTCH_VAL_LSM_RESTART_INTERVAL 16
+// The byte in front of every memtable element (and every run entry) that says whether it's an add or a tombstone.
+#define HOPSCOTCH_VAL_LSM_OP_DEL ((hopscotch_byte_t) 0)
+#define HOPSCOTCH_VAL_LSM_OP_ADD ((hopscotch_byte_t) 1)
+
+// Frozen lists (see `hopscotch_list_freeze`).
+#define HOPSCOTCH_VAL_FROZEN_MAGIC 0x6873667266726f7aULL
+// Frozen lists start at a cache line, and so do their prefixes (after the header).
+#define HOPSCOTCH_VAL_FROZEN_ALIGNMENT 64
+// A frozen lookup prefetches the prefixes this many levels below the one it's at. The `2 ^ levels` of them are next to each other, so `3` is one cache line of them.
+#define HOPSCOTCH_VAL_FROZEN_PREFETCH_LEVELS 3
 
 typedef unsigned char hopscotch_byte_t;
 
@@ -106,6 +211,34 @@ typedef enum {
 	HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL,
 	HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL,
 	HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL,
+	HOPSCOTCH_RES_LIST_FILTER_DISABLED,
+	HOPSCOTCH_RES_LIST_FILTER_BUSY,
+	HOPSCOTCH_RES_LIST_JOIN_INVALID_LISTS,
+	HOPSCOTCH_RES_LIST_MAINTENANCE_BUSY,
+	HOPSCOTCH_RES_PTHREAD_COND_INIT_FAIL,
+	HOPSCOTCH_RES_PTHREAD_CREATE_FAIL,
+	HOPSCOTCH_RES_PTHREAD_JOIN_FAIL,
+	HOPSCOTCH_RES_LIST_SHM_INVALID_SEGMENT,
+	HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED,
+	HOPSCOTCH_RES_FSTAT_FAIL,
+	HOPSCOTCH_RES_FTRUNCATE_FAIL,
+	HOPSCOTCH_RES_MMAP_FAIL,
+	HOPSCOTCH_RES_MUNMAP_FAIL,
+	HOPSCOTCH_RES_SHM_OPEN_FAIL,
+	HOPSCOTCH_RES_SHM_UNLINK_FAIL,
+	HOPSCOTCH_RES_LIST_SHM_DISABLED,
+	HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS,
+	HOPSCOTCH_RES_LIST_VERSIONS_DISABLED,
+	HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED,
+	HOPSCOTCH_RES_FSYNC_FAIL,
+	HOPSCOTCH_RES_MKDIR_FAIL,
+	HOPSCOTCH_RES_OPEN_FAIL,
+	HOPSCOTCH_RES_OPENDIR_FAIL,
+	HOPSCOTCH_RES_RENAME_FAIL,
+	HOPSCOTCH_RES_UNLINK_FAIL,
+	HOPSCOTCH_RES_WRITE_FAIL,
+	HOPSCOTCH_RES_LSM_INVALID_RUN,
+	HOPSCOTCH_RES_FROZEN_INVALID,
 } hopscotch_res_t;
 
 // C-string values that represent results of type `hopscotch_res_t`.
@@ -117,31 +250,517 @@ typedef enum {
 #define HOPSCOTCH_RES_PTHREAD_MUTEX_INIT_FAIL_VAL "`pthread_mutex_init` failed!"
 #define HOPSCOTCH_RES_PTHREAD_MUTEX_LOCK_FAIL_VAL "`pthread_mutex_lock` failed!"
 #define HOPSCOTCH_RES_PTHREAD_MUTEX_UNLOCK_FAIL_VAL "`pthread_mutex_unlock` failed!"
+#define HOPSCOTCH_RES_LIST_FILTER_DISABLED_VAL "The list doesn't have a membership filter!"
+#define HOPSCOTCH_RES_LIST_FILTER_BUSY_VAL "The list's membership filter is already being rebuilt!"
+#define HOPSCOTCH_RES_LIST_JOIN_INVALID_LISTS_VAL "The lists overlap or have different max levels!"
+#define HOPSCOTCH_RES_LIST_MAINTENANCE_BUSY_VAL "The list's maintenance thread is already running!"
+#define HOPSCOTCH_RES_PTHREAD_COND_INIT_FAIL_VAL "`pthread_cond_init` failed!"
+#define HOPSCOTCH_RES_PTHREAD_CREATE_FAIL_VAL "`pthread_create` failed!"
+#define HOPSCOTCH_RES_PTHREAD_JOIN_FAIL_VAL "`pthread_join` failed!"
+#define HOPSCOTCH_RES_LIST_SHM_INVALID_SEGMENT_VAL "The shared memory segment doesn't hold a Hopscotch list (or was never finished)!"
+#define HOPSCOTCH_RES_LIST_SHM_UNSUPPORTED_VAL "This isn't supported for lists in shared memory!"
+#define HOPSCOTCH_RES_FSTAT_FAIL_VAL "`fstat` failed!"
+#define HOPSCOTCH_RES_FTRUNCATE_FAIL_VAL "`ftruncate` failed!"
+#define HOPSCOTCH_RES_MMAP_FAIL_VAL "`mmap` failed (or couldn't map the segment at its address)!"
+#define HOPSCOTCH_RES_MUNMAP_FAIL_VAL "`munmap` failed!"
+#define HOPSCOTCH_RES_SHM_OPEN_FAIL_VAL "`shm_open` failed!"
+#define HOPSCOTCH_RES_SHM_UNLINK_FAIL_VAL "`shm_unlink` failed!"
+#define HOPSCOTCH_RES_LIST_SHM_DISABLED_VAL "The list isn't in shared memory!"
+#define HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS_VAL "The options provided don't go together!"
+#define HOPSCOTCH_RES_LIST_VERSIONS_DISABLED_VAL "The list isn't versioned!"
+#define HOPSCOTCH_RES_LIST_VERSIONS_UNSUPPORTED_VAL "This isn't supported for versioned lists!"
+#define HOPSCOTCH_RES_FSYNC_FAIL_VAL "`fsync` failed!"
+#define HOPSCOTCH_RES_MKDIR_FAIL_VAL "`mkdir` failed!"
+#define HOPSCOTCH_RES_OPEN_FAIL_VAL "`open` failed!"
+#define HOPSCOTCH_RES_OPENDIR_FAIL_VAL "`opendir` failed!"
+#define HOPSCOTCH_RES_RENAME_FAIL_VAL "`rename` failed!"
+#define HOPSCOTCH_RES_UNLINK_FAIL_VAL "`unlink` failed!"
+#define HOPSCOTCH_RES_WRITE_FAIL_VAL "`write` failed!"
+#define HOPSCOTCH_RES_LSM_INVALID_RUN_VAL "A run file is truncated or doesn't hold a Hopscotch run!"
+#define HOPSCOTCH_RES_FROZEN_INVALID_VAL "A file is truncated or doesn't hold a frozen Hopscotch list!"
 
 #define HOPSCOTCH_RES_VAL(res_code) res_code##_VAL
 
+typedef struct _hopscotch_combining_slot hopscotch_combining_slot_t;
+typedef struct _hopscotch_filter hopscotch_filter_t;
+typedef struct _hopscotch_frozen hopscotch_frozen_t;
+typedef struct _hopscotch_frozen_header hopscotch_frozen_header_t;
+typedef struct _hopscotch_index hopscotch_index_t;
+typedef struct _hopscotch_index_entry hopscotch_index_entry_t;
+typedef struct _hopscotch_index_table hopscotch_index_table_t;
 typedef struct _hopscotch_list hopscotch_list_t;
+typedef struct _hopscotch_list_adaptive hopscotch_list_adaptive_t;
+typedef struct _hopscotch_list_combining hopscotch_list_combining_t;
+typedef struct _hopscotch_list_filter hopscotch_list_filter_t;
+typedef struct _hopscotch_list_maintenance hopscotch_list_maintenance_t;
+typedef struct _hopscotch_list_shm hopscotch_list_shm_t;
+typedef struct _hopscotch_list_small hopscotch_list_small_t;
+typedef struct _hopscotch_list_versions hopscotch_list_versions_t;
+typedef struct _hopscotch_lsm hopscotch_lsm_t;
+typedef struct _hopscotch_lsm_builder hopscotch_lsm_builder_t;
+typedef struct _hopscotch_lsm_cursor hopscotch_lsm_cursor_t;
+typedef struct _hopscotch_lsm_fence hopscotch_lsm_fence_t;
+typedef struct _hopscotch_lsm_run hopscotch_lsm_run_t;
+typedef struct _hopscotch_lsm_run_header hopscotch_lsm_run_header_t;
+typedef struct _hopscotch_lsm_state hopscotch_lsm_state_t;
 typedef struct _hopscotch_node hopscotch_node_t;
+typedef struct _hopscotch_node_adaptive hopscotch_node_adaptive_t;
+typedef struct _hopscotch_node_prefix hopscotch_node_prefix_t;
+typedef struct _hopscotch_node_set hopscotch_node_set_t;
+typedef struct _hopscotch_node_towers hopscotch_node_towers_t;
+typedef struct _hopscotch_node_versions hopscotch_node_versions_t;
 typedef struct _hopscotch_opts hopscotch_opts_t;
+typedef struct _hopscotch_scan hopscotch_scan_t;
+typedef struct _hopscotch_scan_worker hopscotch_scan_worker_t;
+typedef struct _hopscotch_shm hopscotch_shm_t;
+typedef struct _hopscotch_small_el hopscotch_small_el_t;
+typedef struct _hopscotch_snapshot hopscotch_snapshot_t;
+typedef struct _hopscotch_version hopscotch_version_t;
+
+// A cuckoo filter with 16-bit fingerprints.
+// Writers are serialized by the owning list's `filter->lock`; readers are lock-free and use `seq` to detect concurrent relocations.
+struct _hopscotch_filter {
+	uint16_t * slots;
+	size_t bucket_mask;
+	size_t count;
+	uint64_t seq;
+	bool overflowed;
+	struct {
+		uint16_t fingerprint;
+		size_t bucket;
+		bool used;
+	} victim;
+	struct {
+		uint64_t negatives;
+		uint64_t false_positives;
+	} stats;
+};
+
+// A chained hash table that maps elements to their nodes.
+// Writers lock one of `stripes` (picked by hash); readers are lock-free.
+// Resizing is incremental: `table->old` is migrated a few buckets at a time by writers.
+struct _hopscotch_index {
+	hopscotch_index_table_t * table;
+	size_t count;
+	pthread_mutex_t resize_lock;
+	pthread_mutex_t stripes[HOPSCOTCH_VAL_INDEX_STRIPES];
+};
+
+struct _hopscotch_index_entry {
+	uint64_t hash;
+	hopscotch_node_t * node;
+	hopscotch_index_entry_t * next;
+};
+
+struct _hopscotch_index_table {
+	hopscotch_index_entry_t ** buckets;
+	size_t mask;
+	// The table that's being migrated into this one, if any.
+	// Its chains are copied, never torn down, so lock-free readers that still look there don't miss anything.
+	hopscotch_index_table_t * old;
+	size_t migrate_next;
+	size_t migrated;
+};
 
 struct _hopscotch_list {
 	hopscotch_node_t * head;
 	hopscotch_opts_t * opts;
+	// The rest is only there for lists that use it (and `NULL` otherwise), so that a plain list stays small.
+	// Only there once the list has a membership filter (from `opts->filter.capacity` or `hopscotch_list_filter_rebuild`).
+	hopscotch_list_filter_t * filter;
+	hopscotch_index_t * index;
+	// Only there with `opts->towers.lazy` or `opts->towers.adaptive`.
+	hopscotch_list_maintenance_t * maintenance;
+	// Only there with `opts->towers.adaptive`.
+	hopscotch_list_adaptive_t * adaptive;
+	// Only there for lists opened with `hopscotch_list_shm_open`.
+	hopscotch_list_shm_t * shm;
+	// Only there with `opts->versions.enabled`.
+	hopscotch_list_versions_t * versions;
+	// Only there with `opts->small.capacity > 0`.
+	hopscotch_list_small_t * small;
+	// Only used if `opts->append.enabled`.
+	// The last node on each level as of the last add that went on the end of it (`NULL` for the head).
+	// They're only hints: an add that starts from them validates them under the predecessors' locks like any other predecessors.
+	struct {
+		HOPSCOTCH_ATOMIC(hopscotch_node_t *) * tails;
+	} append;
+	// Only there with `opts->combining.enabled`.
+	hopscotch_list_combining_t * combining;
+};
+
+struct _hopscotch_list_filter {
+	// The filter in use, if any.
+	hopscotch_filter_t * current;
+	// The filter that `hopscotch_list_filter_rebuild` is filling, if any.
+	hopscotch_filter_t * next;
+	// Held to write to either filter, and to swap them.
+	pthread_mutex_t lock;
+};
+
+// The background thread that builds towers in lazy mode.
+// `lock` is held for the whole of each pass, so `hopscotch_list_maintenance_run` and the thread never overlap.
+struct _hopscotch_list_maintenance {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool running;
+	// A lock-free stack (linked through the nodes' `towers->pending_next`) of the nodes whose towers still have to be raised.
+	HOPSCOTCH_ATOMIC(hopscotch_node_t *) pending;
+};
+
+// Lookups count into `samples` and the nodes' `adaptive->hits`; the rest is only touched by maintenance passes.
+struct _hopscotch_list_adaptive {
+	// How many lookups have been counted so far.
+	uint64_t samples;
+	// A lock-free stack (linked through the nodes' `adaptive->hot_next`) of the nodes that have just reached `HOPSCOTCH_VAL_LIST_ADAPTIVE_HOT_HITS`.
+	HOPSCOTCH_ATOMIC(hopscotch_node_t *) hot;
+	// The nodes whose towers are above their random level.
+	hopscotch_node_t ** raised;
+	size_t raised_count;
+	size_t raised_capacity;
+};
+
+struct _hopscotch_list_shm {
+	hopscotch_shm_t * segment;
+	// Every lock in the segment is process-shared (and robust, where that's supported).
+	pthread_mutexattr_t lock_attr;
+};
+
+// `lock` is held to hand out a version and stamp it on a node, and to pin or unpin a snapshot, so a snapshot sees every stamp up to its version.
+struct _hopscotch_list_versions {
+	pthread_mutex_t lock;
+	// The last version handed out.
+	uint64_t current;
+	// The snapshots that are still pinned, oldest first.
+	hopscotch_snapshot_t * oldest;
+	hopscotch_snapshot_t * newest;
+	// A lock-free stack (linked through the nodes' `versions->retired_next`) of deleted nodes that a snapshot could still see.
+	HOPSCOTCH_ATOMIC(hopscotch_node_t *) retired;
+};
+
+// While `active`, the elements are in `els` (sorted, `count` of them) and `head` is `NULL` or a skip list that isn't used anymore.
+// Writers of `els` hold `lock`, and so do promotions and demotions; `seq` is odd while any of them is under way, and readers use it to tell whether what they saw is still true.
+struct _hopscotch_list_small {
+	pthread_mutex_t lock;
+	uint64_t seq;
+	bool active;
+	// Once set, the list stays a skip list (see `opts->small`).
+	bool pinned;
+	// Set while a demotion waits for the skip list's writers to leave, so that no new ones come in.
+	bool demoting;
+	hopscotch_small_el_t * els;
+	// While the list is a skip list, this is kept up to date by `hopscotch_list_add_el` and `hopscotch_list_del_el`, which decide when to demote.
+	size_t count;
+	// How many writers are in the skip list.
+	size_t writers;
+};
+
+// Writers post their ops to `slots` (`HOPSCOTCH_VAL_LIST_COMBINING_SLOTS` of them), and whoever holds `lock` (the combiner) applies every op that's posted.
+struct _hopscotch_list_combining {
+	pthread_mutex_t lock;
+	hopscotch_combining_slot_t * slots;
+	// How many slots from the start have ever been claimed, which is as far as the combiner looks.
+	HOPSCOTCH_ATOMIC(uint32_t) slots_used;
+};
+
+// An op posted to a list's publication array (see `opts->combining.enabled`).
+// A writer claims a free slot, fills it in and makes it pending. The combiner applies it, fills in the result and makes it done, and the writer takes the result and frees the slot.
+struct _hopscotch_combining_slot {
+	HOPSCOTCH_ATOMIC(uint32_t) state;
+	// Whether it's a del (or else an add).
+	bool del;
+	hopscotch_byte_t * val;
+	size_t val_size;
+	// What the add or del returned.
+	bool done;
+	hopscotch_res_t res;
 };
 
+// `forward`, `fully_linked`, `level` and `marked` are only written under `lock`, but traversals read them without it.
+// Links and flags are published with release stores and read with acquire loads.
 struct _hopscotch_node {
-	hopscotch_node_t ** forward;
-	bool fully_linked;
-	uint8_t level;
+	// The level-0 predecessor, if `opts->back_links.enabled`.
+	// It's only a hint: it's trusted while the node it points at is unmarked and still points forward to this one.
+	HOPSCOTCH_ATOMIC(hopscotch_node_t *) backward;
+	HOPSCOTCH_ATOMIC(hopscotch_node_t *) * forward;
+	HOPSCOTCH_ATOMIC(bool) fully_linked;
+	HOPSCOTCH_ATOMIC(uint8_t) level;
+	HOPSCOTCH_ATOMIC(bool) marked;
+	// The level `forward` has room for (with `opts->towers.adaptive`, `forward` has room for every level, and this is just the node's random level).
+	// In lazy mode, `level` starts at `0` and is raised towards this by the maintenance thread (under `lock`).
+	uint8_t target_level;
 	pthread_mutex_t lock;
-	bool marked;
+	// Only there with `opts->towers.lazy` (and `NULL` otherwise), so that lists that don't use it don't pay for it.
+	hopscotch_node_towers_t * towers;
 	struct {
 		hopscotch_byte_t * data;
 		size_t size;
 	} val;
+	// With `opts->prefix_compression.enabled`, `val` may only hold what comes after the element's first `prefix->size` bytes, which are the same as `prefix->base`'s.
+	// `prefix` is `NULL` if `val` is the whole element (so only compressed nodes pay for it).
+	hopscotch_node_prefix_t * prefix;
+	// Only there with `opts->versions.enabled` (and `NULL` otherwise).
+	hopscotch_node_versions_t * versions;
+	// Only there with `opts->towers.adaptive` (and `NULL` otherwise).
+	hopscotch_node_adaptive_t * adaptive;
+};
+
+// How many counted lookups found the node since the list's `adaptive->samples` was `since`.
+struct _hopscotch_node_adaptive {
+	uint32_t hits;
+	uint64_t since;
+	hopscotch_node_t * hot_next;
+	// Whether the node is in the list's `adaptive->raised`.
+	bool raised;
+};
+
+// The part of a node that only lists with lazy towers use (see `hopscotch_node_t.towers`).
+// It's allocated along with the node.
+struct _hopscotch_node_towers {
+	// The next node on the list's `maintenance->pending` stack.
+	hopscotch_node_t * pending_next;
+};
+
+// Where a compressed node's prefix comes from (see `hopscotch_node_t.prefix`).
+// It's allocated along with the node, and never changes.
+struct _hopscotch_node_prefix {
+	// The level-0 predecessor the node was added after (which may have been deleted since).
+	hopscotch_node_t * base;
+	uint32_t size;
+	// How many nodes down the chain of `base` pointers goes.
+	uint8_t depth;
+};
+
+// When a versioned list's node was in the list (see `hopscotch_node_t.versions`).
+// The element is in the list as of version `v` if `add <= v < del`, or if one of the `older` ranges says so.
+// A delete only sets `del`; the node stays linked until no snapshot can see it anymore.
+// `add` and `del` are written under the node's `lock` and the list's `versions->lock`, and read without them (`del` first).
+// It's allocated along with the node.
+struct _hopscotch_node_versions {
+	HOPSCOTCH_ATOMIC(uint64_t) add;
+	HOPSCOTCH_ATOMIC(uint64_t) del;
+	// The ranges from before the element was last re-added, newest first.
+	HOPSCOTCH_ATOMIC(hopscotch_version_t *) older;
+	// Whether the node is on the list's `versions.retired` stack (only changed under the node's `lock`), and the next node on it.
+	bool retired;
+	hopscotch_node_t * retired_next;
+};
+
+// A pinned version of a list, which `hopscotch_list_snapshot_*` read at.
+struct _hopscotch_snapshot {
+	hopscotch_list_t * list;
+	uint64_t version;
+	hopscotch_snapshot_t * older;
+	hopscotch_snapshot_t * newer;
+};
+
+// A range of versions a node's element was in the list for, before it was deleted and added back.
+struct _hopscotch_version {
+	uint64_t add;
+	uint64_t del;
+	hopscotch_version_t * older;
+};
+
+// An element of a small list (see `opts->small`).
+// Like a node's `val`, `val` points at the caller's buffer.
+struct _hopscotch_small_el {
+	hopscotch_byte_t * val;
+	size_t val_size;
+};
+
+// A small open-addressing set of node pointers, used to keep track of the nodes a bulk operation owns.
+struct _hopscotch_node_set {
+	hopscotch_node_t ** slots;
+	size_t mask;
+	size_t count;
+};
+
+// What the threads of a `hopscotch_list_parallel_for_each` share.
+// Segment `i` of the list runs from `bounds[i]` (the head, for the first one) up to, but not including, `bounds[i + 1]` (`NULL`, for the last one).
+struct _hopscotch_scan {
+	hopscotch_list_t * list;
+	hopscotch_node_t ** bounds;
+	size_t count;
+	hopscotch_res_t (* fn)(
+		void *,
+		size_t,
+		hopscotch_byte_t *,
+		size_t
+	);
+	void * ctx;
+	hopscotch_scan_worker_t * workers;
+	size_t workers_count;
+	// The first failure, which every worker stops at.
+	hopscotch_res_t res;
+};
+
+struct _hopscotch_scan_worker {
+	hopscotch_scan_t * scan;
+	size_t id;
+	pthread_t thread;
+	// The segments `[next, end)` are the worker's to do. Workers that run out steal the back half of someone else's.
+	pthread_mutex_t lock;
+	size_t next;
+	size_t end;
+	// Where the worker puts elements back together, with `opts->prefix_compression.enabled`.
+	hopscotch_byte_t * buf;
+	size_t buf_size;
+};
+
+// A log-structured store: a list that takes the writes (the memtable), and the immutable sorted runs it's been flushed to, newest first.
+// Every operation works on the `state` that's current when it starts, which it pins with `refs`; flushes and compactions swap in a new one under `lock`.
+struct _hopscotch_lsm {
+	char * path;
+	// The options of the memtables (a copy of the ones the store was opened with, and the store's own).
+	hopscotch_opts_t * opts;
+	pthread_mutex_t lock;
+	// Signalled whenever `state`, `busy` or `res` changes, or a state is let go of.
+	pthread_cond_t cond;
+	hopscotch_lsm_state_t * state;
+	// How many states other than `state` are still pinned. A frozen memtable is only flushed once this is `0`, so that nobody's still adding to it.
+	size_t retired;
+	// Roughly how many bytes the current memtable takes up.
+	size_t memtable_size;
+	// The last flush number handed out. Flushes are numbered from `1`, and every run knows which of them it holds.
+	uint64_t seq;
+	// The last run file number handed out.
+	uint64_t file;
+	// The background thread that flushes frozen memtables and compacts runs.
+	pthread_t thread;
+	bool running;
+	// Set while a flush or a compaction is under way (by the thread, or by `hopscotch_lsm_compact`), so that they're never run two at a time.
+	bool busy;
+	// The first thing that went wrong in the background, which every later flush returns.
+	hopscotch_res_t res;
+};
+
+struct _hopscotch_lsm_state {
+	hopscotch_list_t * memtable;
+	// The memtable that's being flushed (`NULL` if there isn't one), and its flush number.
+	hopscotch_list_t * frozen;
+	uint64_t frozen_seq;
+	hopscotch_lsm_run_t ** runs;
+	size_t runs_count;
+	// How many operations have pinned the state, plus one while it's the store's current one.
+	size_t refs;
+};
+
+// A run file is a header, the entries in order, and then the fence pointers.
+// An entry is an op byte (`HOPSCOTCH_VAL_LSM_OP_*`), its element's size as a `uint32_t` and the element. Entries are packed into blocks of about `opts->lsm.block_size` bytes, which they never straddle (an element that's bigger than that gets a block of its own).
+// Every block ends with its restart points: the offsets (from the start of the block, as `uint32_t`s) of every `HOPSCOTCH_VAL_LSM_RESTART_INTERVAL`th entry.
+// The fence pointers are, for every block, its offset and the offset of its restart points as `uint64_t`s, followed by its first element (as its size and the element). Everything is in the machine's byte order.
+struct _hopscotch_lsm_run_header {
+	uint64_t magic;
+	// The flushes the run holds (`seq_min` to `seq_max`), and its file number (which only tells apart runs of the same flushes). They also make up its file name.
+	uint64_t seq_min;
+	uint64_t seq_max;
+	uint64_t file;
+	uint64_t count;
+	uint64_t tombstones;
+	uint64_t blocks_count;
+	uint64_t index_offset;
+	uint64_t size;
+};
+
+// A run file, mapped in whole.
+struct _hopscotch_lsm_run {
+	char * path;
+	hopscotch_byte_t * map;
+	hopscotch_lsm_run_header_t header;
+	hopscotch_lsm_fence_t * fences;
+	// How many states hold the run. The last one to let go of it unmaps it, and deletes the file if `obsolete` (i.e. it's been compacted into another run).
+	size_t refs;
+	bool obsolete;
+};
+
+// Where a block of a run starts, where its entries stop and its restart points start, and where it ends, and the element it starts with.
+struct _hopscotch_lsm_fence {
+	hopscotch_byte_t * val;
+	size_t val_size;
+	size_t offset;
+	size_t restarts;
+	size_t end;
+};
+
+// Writes a run file as `<path>.tmp`, and renames it to `path` once it's all on disk.
+struct _hopscotch_lsm_builder {
+	hopscotch_lsm_t * lsm;
+	char * path;
+	char * tmp_path;
+	int fd;
+	hopscotch_lsm_run_header_t header;
+	// The block being filled, which starts at `offset` in the file, and its restart points so far.
+	hopscotch_byte_t * block;
+	size_t block_used;
+	size_t block_capacity;
+	size_t block_count;
+	hopscotch_byte_t * restarts;
+	size_t restarts_used;
+	size_t restarts_capacity;
+	size_t offset;
+	// The fence pointers, which are written after the last block.
+	hopscotch_byte_t * index;
+	size_t index_used;
+	size_t index_capacity;
+};
+
+// Walks the entries of a run in order, from a block up to (but not including) `blocks_end`.
+struct _hopscotch_lsm_cursor {
+	hopscotch_lsm_run_t * run;
+	size_t block;
+	size_t blocks_end;
+	// Where the next entry is, and where the current block's entries stop.
+	size_t offset;
+	size_t end;
+	// The current entry (`val` is `NULL` once the cursor is past the last one).
+	hopscotch_byte_t op;
+	hopscotch_byte_t * val;
+	size_t val_size;
+};
+
+// A frozen list is its header, then three arrays of `count + 1` `uint64_t`s, and then its elements, back to back in order.
+// `prefixes` and `ranks` are in Eytzinger order (the children of `k` are `2 * k` and `2 * k + 1`, and `0` isn't used): `prefixes[k]` is the 8 bytes of the element `ranks[k]` that come after the `prefix_skip` bytes every element starts with (as a big-endian number, padded with zeros), which only agrees with the default order.
+// The element of rank `i` is at `offsets[i]` from the start of the elements, and `offsets[count]` is where they end. Everything is in the machine's byte order.
+struct _hopscotch_frozen_header {
+	uint64_t magic;
+	// Whether the list had a `cmp` of its own, in which case the prefixes aren't used.
+	uint64_t custom_cmp;
+	uint64_t count;
+	uint64_t prefix_skip;
+	uint64_t prefixes_offset;
+	uint64_t ranks_offset;
+	uint64_t offsets_offset;
+	uint64_t vals_offset;
+	uint64_t size;
+};
+
+struct _hopscotch_frozen {
+	// `cmp` and `gc` are the only options that are used.
+	hopscotch_opts_t * opts;
+	// The whole layout, which starts at a cache line. It's either a file mapped in whole (`mapped`), or a buffer.
+	hopscotch_byte_t * data;
+	size_t size;
+	bool mapped;
+	hopscotch_frozen_header_t * header;
+	size_t count;
+	uint64_t * prefixes;
+	uint64_t * ranks;
+	uint64_t * offsets;
+	hopscotch_byte_t * vals;
+	size_t vals_size;
 };
 
 struct _hopscotch_opts {
+	struct {
+		// Keep a tail pointer per level, so that adding an element that's bigger than every other one (e.g. a timestamp or a sequence number) links it after the last node without a search.
+		// Elements that come out of order take the normal path. This can't be used with shared memory.
+		bool enabled;
+	} append;
+	struct {
+		// Keep level-0 back links, so that `hopscotch_list_prev_el` is O(1) instead of a search from the head.
+		bool enabled;
+	} back_links;
 	hopscotch_res_t (* cmp)(
 		int *,
 		hopscotch_byte_t *,
@@ -149,11 +768,86 @@ struct _hopscotch_opts {
 		hopscotch_byte_t *,
 		size_t
 	);
+	struct {
+		// Have `hopscotch_list_add_el` and `hopscotch_list_del_el` post their ops, and wait while one thread at a time (the combiner) applies everything that's posted as a single sorted batch, each op searching from the one before it.
+		// Writers to a hot spot then stop piling up on the same predecessors' locks (and searching again from the head whenever validation fails). It isn't worth it for writes that are spread out.
+		// This can't be used with shared memory or small lists.
+		bool enabled;
+	} combining;
+	struct {
+		size_t capacity;
+	} filter;
 	struct {
 		void * (* malloc)(size_t);
 	} gc;
+	hopscotch_res_t (* hash)(
+		uint64_t *,
+		hopscotch_byte_t *,
+		size_t
+	);
+	struct {
+		bool enabled;
+		size_t capacity;
+	} index;
+	struct {
+		// Only used by `hopscotch_lsm_open`. `0` picks the `HOPSCOTCH_VAL_LSM_DEFAULT_*` value.
+		// How many bytes (roughly, counting the nodes) the memtable can take up before it's frozen and flushed to a run.
+		size_t memtable_size;
+		// How big the blocks of a run (and so the gaps between its fence pointers) are.
+		size_t block_size;
+		// How many runs of about the same size there have to be before the background thread merges them into one.
+		size_t compaction_runs;
+	} lsm;
 	uint8_t max_level;
+	struct {
+		// Store each element as the bytes that differ from its level-0 predecessor's (see `hopscotch_node_t.prefix`), copied into the list.
+		// Nodes with a tower are stored whole, since searches compare against them on the upper levels.
+		// This only works with the default `cmp`, and nodes need `hopscotch_list_el_val` to get their elements back.
+		bool enabled;
+	} prefix_compression;
 	double rand_level_p;
+	struct {
+		// Where `hopscotch_list_shm_open` maps a segment it creates. `NULL` means `HOPSCOTCH_VAL_SHM_DEFAULT_BASE`.
+		void * base;
+	} shm;
+	struct {
+		// Keep up to this many elements in a sorted array instead of a skip list (`0` means never), which saves the sentinels and a node per element.
+		// Reads of the array don't take locks. The list is promoted to a skip list when an add goes past `capacity`, and demoted again when a del leaves half of it.
+		// Calls that hand out nodes or work on the whole list (the set operations, `hopscotch_list_del_range`, `split`, `join`, `merge`, `filter_rebuild`, `parallel_for_each` and the iterators) promote the list for good.
+		// This can't be used with shared memory, versions, lazy towers, the hash index, a filter capacity or combining.
+		size_t capacity;
+	} small;
+	struct {
+		// Link new elements at level 0 only (with a single predecessor lock), and leave building their towers to the maintenance thread.
+		bool lazy;
+		// Raise the towers of the elements that are looked up most, so that they're found in fewer hops, and lower them back to their random level once they cool down.
+		// Lookups that find an element count towards it; the towers are moved by maintenance passes (`hopscotch_list_maintenance_start` or `hopscotch_list_maintenance_run`). An element that's looked up k times as often as the average one gets the tower that 1 in k random ones reach.
+		// Every node gets room for a full-height tower. This can't be used with prefix compression or shared memory.
+		bool adaptive;
+		// How long the maintenance thread waits between passes, in milliseconds.
+		uint32_t interval_ms;
+	} towers;
+	struct {
+		// Stamp every add and del with a version, so that `hopscotch_list_snapshot` can pin one and read the list as it was then.
+		// This isn't supported for lists in shared memory, and `hopscotch_list_del_range`, `hopscotch_list_clear`, `hopscotch_list_split` and `hopscotch_list_join` aren't supported.
+		bool enabled;
+	} versions;
+};
+
+// The header at the start of a shared memory segment that holds a list.
+// The segment is mapped at `base` in every process, so the nodes in it can point at each other (and at their elements) directly.
+struct _hopscotch_shm {
+	// Set to `HOPSCOTCH_VAL_SHM_MAGIC` once the creating process is done setting the segment up.
+	HOPSCOTCH_ATOMIC(uint64_t) magic;
+	void * base;
+	size_t size;
+	// The bump allocator's offset of the first free byte (never more than `size`).
+	// Nothing is ever given back: another process may still be reading a deleted node, and there's no way to tell when every process is done with it.
+	HOPSCOTCH_ATOMIC(size_t) used;
+	hopscotch_node_t * head;
+	// The options that every process has to agree on.
+	bool back_links;
+	uint8_t max_level;
 };
 
 #ifdef __cplusplus
@@ -169,8 +863,53 @@ extern "C" {
 HOPSCOTCH_ABI_EXPORT hopscotch_res_t
 hopscotch_list_new(hopscotch_list_t ** list, hopscotch_opts_t * opts);
 
+/**
+ * Opens a Hopscotch list that lives in a POSIX shared memory segment, creating the segment (with an empty list in it) if it doesn't exist yet.
+ * Every process that opens the segment works on the same list, since its nodes, elements and locks all live there: an add is visible to the other processes as soon as it returns.
+ * The segment is mapped at the same address in every process, so opening fails with `HOPSCOTCH_RES_MMAP_FAIL` if that address is already taken (see `opts->shm.base`).
+ * Elements are copied into the segment, whose space isn't reused after deletes (another process may still be reading a deleted node), so `size` should allow for every add the list will ever see.
+ * Once the segment is full, adds fail with `HOPSCOTCH_RES_MEM_ALLOC_FAIL` and leave the list as it was; `hopscotch_list_shm_usage` tells how close it is.
+ * The max level and back links are taken from the segment, and `cmp` / `hash` must agree across processes.
+ * The membership filter, hash index and lazy towers aren't supported.
+ * If a process dies while it holds a lock, the next process to take that lock finishes the add / del the dead process was in the middle of.
+ * \param list A pointer to where the Hopscotch list pointer should be stored.
+ * \param opts A pointer to a `hopscotch_opts_t` containing initialization options.
+ * \param name The segment's name, as for `shm_open` (e.g. `"/my-list"`).
+ * \param size The segment's size in bytes, which is only used if the segment is created.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_shm_open(
+	hopscotch_list_t ** list,
+	hopscotch_opts_t * opts,
+	const char * name,
+	size_t size
+);
+
+/**
+ * Removes a shared memory segment's name, so that the next `hopscotch_list_shm_open` creates a new list.
+ * Processes that have the list open can keep using it; its memory is released once they've all freed their lists.
+ * \param name The segment's name.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_shm_unlink(const char * name);
+
+/**
+ * How much of a shared memory list's segment has been used up, by every process that has it open.
+ * Deletes don't give any of it back (see `hopscotch_list_shm_open`).
+ * \param used A pointer to a size variable, which will be set to the number of bytes used (including the segment's header and the list's sentinels).
+ * \param size A pointer to a size variable, which will be set to the segment's size in bytes.
+ * \param list The Hopscotch list, which must have been opened with `hopscotch_list_shm_open`.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_shm_usage(size_t * used, size_t * size, hopscotch_list_t * list);
+
 /**
  * Adds an element to a Hopscotch list.
+ * With `opts->append.enabled`, an element that's bigger than every other one is linked after the last node without a search, i.e. with O(1) work per level.
+ * With `opts->combining.enabled`, the add may be applied by another thread, along with the other ops that are waiting.
  * \param added A pointer to a boolean variable, which will be set to true if `val` is added to `list` and false if `val` is already in `list`.
  * \param list The Hopscotch list the to add the element to.
  * \param val The element.
@@ -201,8 +940,201 @@ hopscotch_list_contains_el(
 	size_t val_size
 );
 
+/**
+ * Searches a Hopscotch list for several elements at once.
+ * The searches are interleaved so that the cache misses of one are overlapped with the work of the others.
+ * \param found An array of `count` boolean variables, each of which will be set to true if the matching element is in `list`.
+ * \param list The Hopscotch list to search in.
+ * \param vals An array of `count` elements to search for.
+ * \param val_sizes An array of `count` element sizes.
+ * \param count The number of elements to search for.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_contains_batch(
+	bool * found,
+	hopscotch_list_t * list,
+	hopscotch_byte_t ** vals,
+	size_t * val_sizes,
+	size_t count
+);
+
+/**
+ * Looks up an element in a Hopscotch list and returns the copy stored in the list.
+ * This is mostly useful with a custom `cmp` that only looks at part of the element (e.g. a key followed by a value).
+ * Point lookups are answered by the hash index when the list has one.
+ * \param found_val A pointer to where the stored element should be stored, which will be set to `NULL` if `val` isn't in `list`.
+ * \param found_val_size A pointer to where the stored element's size should be stored.
+ * \param list The Hopscotch list to search in.
+ * \param val The element to search for.
+ * \param val_size The element's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_get_el(
+	hopscotch_byte_t ** found_val,
+	size_t * found_val_size,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Finds the largest element in a Hopscotch list that's less than or equal to `val`.
+ * The returned node stays valid even if it's deleted later, so it can be passed on to `hopscotch_list_prev_el` / `hopscotch_list_next_el`.
+ * \param node A pointer to where the node should be stored, which will be set to `NULL` if there's no such element.
+ * \param list The Hopscotch list to search in.
+ * \param val The element to search for.
+ * \param val_size The element's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_floor_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Finds the smallest element in a Hopscotch list that's greater than or equal to `val`.
+ * \param node A pointer to where the node should be stored, which will be set to `NULL` if there's no such element.
+ * \param list The Hopscotch list to search in.
+ * \param val The element to search for.
+ * \param val_size The element's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_ceiling_el(
+	hopscotch_node_t ** node,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Steps to the previous element of a Hopscotch list, e.g. for descending scans.
+ * With `opts->back_links.enabled` this is O(1) (unless the back link is stale, in which case it's repaired with a search).
+ * \param prev_node A pointer to where the previous node should be stored, which will be set to `NULL` at the start of the list.
+ * \param list The Hopscotch list.
+ * \param node A node returned by one of the `hopscotch_list_*_el` functions that return nodes, or `NULL` to start from the end of the list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_prev_el(
+	hopscotch_node_t ** prev_node,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+);
+
+/**
+ * Steps to the next element of a Hopscotch list.
+ * \param next_node A pointer to where the next node should be stored, which will be set to `NULL` at the end of the list.
+ * \param list The Hopscotch list.
+ * \param node A node returned by one of the `hopscotch_list_*_el` functions that return nodes, or `NULL` to start from the start of the list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_next_el(
+	hopscotch_node_t ** next_node,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+);
+
+/**
+ * Gets the element a node holds.
+ * This is just `node->val`, unless the list uses prefix compression, in which case the element is put back together in a new buffer.
+ * \param val A pointer to where the element should be stored.
+ * \param val_size A pointer to where the element's size should be stored.
+ * \param list The Hopscotch list the node is from.
+ * \param node A node returned by one of the `hopscotch_list_*_el` functions that return nodes.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_el_val(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_list_t * list,
+	hopscotch_node_t * node
+);
+
+/**
+ * Calls `fn` on every element of a Hopscotch list, from several threads at once (the calling thread is one of them).
+ * The list is cut into segments at nodes from its upper levels, and each thread walks level 0 through its share of them, stealing from the others once it's done.
+ * `fn` gets `ctx`, the number of the thread it's called from (below `threads_count`, so per-thread results don't need locking), and the element.
+ * The element is the node's own copy, unless the list uses prefix compression, in which case it's put back together in a buffer that's only good until `fn` returns.
+ * Elements are visited in order within a segment, but segments are visited in no particular order. As with `hopscotch_list_next_el`, elements added or deleted while this runs may or may not be visited.
+ * \param list The Hopscotch list.
+ * \param threads_count How many threads to use, or `0` for one per online CPU.
+ * \param fn The function to call on every element. If it fails, the scan stops and its result is returned.
+ * \param ctx Whatever `fn` needs.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_parallel_for_each(
+	hopscotch_list_t * list,
+	size_t threads_count,
+	hopscotch_res_t (* fn)(
+		void *,
+		size_t,
+		hopscotch_byte_t *,
+		size_t
+	),
+	void * ctx
+);
+
+/**
+ * Pins the current version of a versioned Hopscotch list (see `opts->versions.enabled`), to read the list as it is now while writers carry on.
+ * Elements deleted after this stay in the list (invisibly to everyone else) until the snapshot is released.
+ * \param snapshot A pointer to where the snapshot pointer should be stored.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_snapshot(hopscotch_snapshot_t ** snapshot, hopscotch_list_t * list);
+
+/**
+ * Unpins a snapshot, and physically deletes the elements that only it could still see.
+ * \param snapshot The snapshot, which mustn't be used anymore afterwards.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_snapshot_release(hopscotch_snapshot_t * snapshot);
+
+/**
+ * Searches a snapshot of a Hopscotch list for an element.
+ * \param found A pointer to a boolean variable, which will be set to true if `val` was in the list when the snapshot was taken.
+ * \param snapshot The snapshot.
+ * \param val The element to search for.
+ * \param val_size The element's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_snapshot_contains_el(
+	bool * found,
+	hopscotch_snapshot_t * snapshot,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Steps to the next element of a snapshot of a Hopscotch list, e.g. for a scan that has to be consistent.
+ * \param next_node A pointer to where the next node should be stored, which will be set to `NULL` at the end of the list.
+ * \param snapshot The snapshot.
+ * \param node A node returned by this function, or `NULL` to start from the start of the list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_snapshot_next_el(
+	hopscotch_node_t ** next_node,
+	hopscotch_snapshot_t * snapshot,
+	hopscotch_node_t * node
+);
+
 /**
  * Delete an element from a Hopscotch list.
+ * With `opts->versions.enabled`, the element is only marked as deleted if a snapshot could still see it.
+ * With `opts->combining.enabled`, the del may be applied by another thread, along with the other ops that are waiting.
  * \param deleted A pointer to a boolean variable, which will be set to true if `val` was successfully deleted and false otherwise.
  * \param list The Hopscotch list to delete the element from.
  * \param val The element.
@@ -217,6 +1149,39 @@ hopscotch_list_del_el(
 	size_t val_size
 );
 
+/**
+ * Delete a range of elements from a Hopscotch list.
+ * Every element `el` with `lo_val <= el < hi_val` is deleted.
+ * The boundary predecessors are found once and, unless another thread is deleting inside the range at the same time, the whole run is unlinked with a single pointer swing per level.
+ * This isn't supported for lists in shared memory.
+ * \param deleted_count A pointer to a size variable, which will be set to the number of elements deleted.
+ * \param list The Hopscotch list to delete the elements from.
+ * \param lo_val The (inclusive) lower bound.
+ * \param lo_val_size The lower bound's size.
+ * \param hi_val The (exclusive) upper bound.
+ * \param hi_val_size The upper bound's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_del_range(
+	size_t * deleted_count,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * lo_val,
+	size_t lo_val_size,
+	hopscotch_byte_t * hi_val,
+	size_t hi_val_size
+);
+
+/**
+ * Delete every element from a Hopscotch list in O(max level).
+ * Concurrent readers are safe: they either finish their walk over the old elements or see the empty list.
+ * Concurrent writers aren't, so this must not race with adds and dels.
+ * \param list The Hopscotch list to clear.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_clear(hopscotch_list_t * list);
+
 HOPSCOTCH_ABI_EXPORT _ALWAYS_INLINE inline hopscotch_res_t
 hopscotch_list_delete_el(
 	bool * deleted,
@@ -232,8 +1197,325 @@ hopscotch_list_delete_el(
 	);
 }
 
+/**
+ * Builds a new Hopscotch list with every element that's in either of two lists.
+ * Both lists' level-0 chains are walked together, so this is O(n + m), and the new list is bulk-built in order without any locking.
+ * The new list uses `list_a`'s options, so both lists must order their elements the same way.
+ * Elements aren't copied: the new list points to the same element buffers (unless it uses prefix compression, which always keeps its own copies).
+ * This isn't an atomic snapshot: elements added to or deleted from either list while this runs may or may not make it into the result.
+ * \param result A pointer to where the new Hopscotch list pointer should be stored.
+ * \param list_a The first Hopscotch list.
+ * \param list_b The second Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_union(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+);
+
+/**
+ * Builds a new Hopscotch list with every element that's in both of two lists.
+ * Same as `hopscotch_list_union`, except that when one list is much smaller, the walk over the bigger one gallops through its upper levels.
+ * That makes it O(m log(n / m)) for lists of m and n elements.
+ * \param result A pointer to where the new Hopscotch list pointer should be stored.
+ * \param list_a The first Hopscotch list.
+ * \param list_b The second Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_intersection(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+);
+
+/**
+ * Builds a new Hopscotch list with every element of `list_a` that isn't in `list_b`.
+ * Same as `hopscotch_list_union`, except that the walk over `list_b` gallops through its upper levels when `list_b` is much bigger.
+ * \param result A pointer to where the new Hopscotch list pointer should be stored.
+ * \param list_a The Hopscotch list to take elements from.
+ * \param list_b The Hopscotch list of elements to leave out.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_difference(
+	hopscotch_list_t ** result,
+	hopscotch_list_t * list_a,
+	hopscotch_list_t * list_b
+);
+
+/**
+ * Adds every element of one Hopscotch list to another, in place.
+ * Each add starts searching from where the previous one left off rather than from the head, so merging m elements into a list of n is O(m log(n / m)).
+ * The adds are regular concurrent adds, so other threads can keep using `list` meanwhile.
+ * \param added_count A pointer to a size variable, which will be set to the number of elements that weren't already in `list`.
+ * \param list The Hopscotch list to add the elements to.
+ * \param other_list The Hopscotch list to take the elements from. It must order its elements the same way as `list`.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_merge(
+	size_t * added_count,
+	hopscotch_list_t * list,
+	hopscotch_list_t * other_list
+);
+
+/**
+ * Splits a Hopscotch list in two at an element.
+ * Every element `el` with `val <= el` is moved to a new list, by cutting the towers at every level.
+ * Nothing is copied or re-added, so this is O(log n), plus O(k) in the k moved elements if the list has a membership filter or hash index.
+ * Concurrent readers are safe, but concurrent writers aren't, so this must not race with adds and dels.
+ * This isn't supported for lists in shared memory.
+ * \param right_list A pointer to where the new Hopscotch list pointer (which gets the elements from `val` on) should be stored.
+ * \param list The Hopscotch list to split. It keeps the elements before `val`.
+ * \param val The element to split at.
+ * \param val_size The element's size.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_split(
+	hopscotch_list_t ** right_list,
+	hopscotch_list_t * list,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Moves every element of one Hopscotch list onto the end of another, by splicing the towers together at every level.
+ * Every element of `right_list` must be bigger than every element of `list`, and both lists must have the same max level.
+ * `right_list` is left empty.
+ * Like `hopscotch_list_split`, this is O(log n) (plus O(k) with a membership filter or hash index) and must not race with writers on either list.
+ * This isn't supported for lists in shared memory.
+ * \param list The Hopscotch list to add the elements to.
+ * \param right_list The Hopscotch list to take the elements from.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_join(hopscotch_list_t * list, hopscotch_list_t * right_list);
+
+/**
+ * Starts a Hopscotch list's maintenance thread.
+ * In lazy tower mode (`opts->towers.lazy`), adds only link new elements at level 0, and this thread raises their towers every `opts->towers.interval_ms`.
+ * Until it gets to them, new elements are found by walking level 0 from their nearest taller predecessor.
+ * Lists without lazy or adaptive towers have nothing to maintain, so this does nothing for them.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_maintenance_start(hopscotch_list_t * list);
+
+/**
+ * Stops a Hopscotch list's maintenance thread, waiting for the pass it's in to finish.
+ * Stopping a list that has no maintenance thread running is a no-op.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_maintenance_stop(hopscotch_list_t * list);
+
+/**
+ * Runs a single maintenance pass on the calling thread, raising every tower that's due (and, with `opts->towers.adaptive`, moving the towers of elements whose lookups have heated up or cooled down).
+ * This is useful for driving lazy tower mode without a background thread, e.g. at the end of a bulk load.
+ * Like `hopscotch_list_maintenance_start`, this does nothing for lists without lazy or adaptive towers.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_maintenance_run(hopscotch_list_t * list);
+
+/**
+ * Rebuild a Hopscotch list's membership filter from the elements currently in the list.
+ * Use this when the false-positive rate has drifted, e.g. after lots of deletes or after the list outgrew its capacity hint.
+ * The old filter keeps answering lookups until the new one is swapped in, so this is safe to call while other threads use the list.
+ * If the list doesn't have a filter yet, one is created.
+ * This isn't supported for lists in shared memory.
+ * \param list The Hopscotch list.
+ * \param capacity How many elements the new filter should be sized for. `0` sizes it from the number of elements in the list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_filter_rebuild(hopscotch_list_t * list, size_t capacity);
+
+/**
+ * Estimate a Hopscotch list's membership filter false-positive rate.
+ * The estimate is sampled from recent lookups of elements that weren't in the list.
+ * An overflowed filter reports a rate of `1`, since it no longer answers any lookups.
+ * \param rate A pointer to a double variable, which will be set to the estimated false-positive rate.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_filter_fp_rate(double * rate, hopscotch_list_t * list);
+
+/**
+ * Opens a log-structured store in the directory at `path` (which is created if it doesn't exist yet), picking up the runs that are already there.
+ * Writes go to a Hopscotch list (the memtable) and are copied into it. Once it's bigger than `opts->lsm.memtable_size` it's frozen, a new one takes the writes, and a background thread flushes the frozen one in order to a run file: an immutable sorted run of blocks, with a fence pointer per block. Writers wait if the memtable fills up again before the flush is done.
+ * The same thread merges runs of about the same size (see `opts->lsm.compaction_runs`), dropping the tombstones of deleted elements when the merge takes in the oldest run.
+ * Only runs are on disk: writes that haven't been flushed (see `hopscotch_lsm_flush`) are lost if the process dies.
+ * Elements are ordered the way the default `cmp` orders them, so `opts->cmp` has to be `NULL`. The hash index, the membership filter, prefix compression, versions and small lists can't be used for the memtables.
+ * \param lsm A pointer to where the store pointer should be stored.
+ * \param path The directory the runs are kept in.
+ * \param opts A pointer to a `hopscotch_opts_t` containing the memtables' options and `opts->lsm`.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_open(hopscotch_lsm_t ** lsm, const char * path, hopscotch_opts_t * opts);
+
+/**
+ * Add an element to a log-structured store (replacing a tombstone for it, if there is one).
+ * \param lsm The store.
+ * \param val A pointer to the element, which is copied.
+ * \param val_size The size of the element.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_add_el(hopscotch_lsm_t * lsm, hopscotch_byte_t * val, size_t val_size);
+
+/**
+ * Delete an element from a log-structured store, by writing a tombstone for it that hides it in the older runs.
+ * \param lsm The store.
+ * \param val A pointer to the element.
+ * \param val_size The size of the element.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_del_el(hopscotch_lsm_t * lsm, hopscotch_byte_t * val, size_t val_size);
+
+/**
+ * Check whether a log-structured store contains an element.
+ * The memtable is checked first, then the one being flushed, then the runs from the newest to the oldest; the first one that knows the element decides.
+ * \param found A pointer to a boolean variable, which will be set to whether the element was found.
+ * \param lsm The store.
+ * \param val A pointer to the element.
+ * \param val_size The size of the element.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_contains_el(
+	bool * found,
+	hopscotch_lsm_t * lsm,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Freeze a log-structured store's memtable (if it has anything in it), and wait for it to be flushed to a run.
+ * \param lsm The store.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure (including a failure of an earlier flush in the background).
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_flush(hopscotch_lsm_t * lsm);
+
+/**
+ * Merge all of a log-structured store's runs into one, leaving out the tombstones.
+ * This runs in the calling thread, after waiting for whatever the background thread is doing.
+ * \param lsm The store.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_compact(hopscotch_lsm_t * lsm);
+
+/**
+ * Flush a log-structured store, stop its background thread and unmap its runs.
+ * The store mustn't be used anymore, even if this fails.
+ * \param lsm The store.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_lsm_close(hopscotch_lsm_t * lsm);
+
+/**
+ * Copies a Hopscotch list's elements into a frozen list: a read-only form of the list that's searched without following any pointers.
+ * The elements are packed in order into one buffer, so scans read memory sequentially. Lookups descend an Eytzinger-ordered array of 8-byte element prefixes (i.e. a binary search tree that's laid out breadth first), which doesn't branch on the comparisons and prefetches a few levels ahead; elements are only compared when their prefixes are the same.
+ * A frozen list takes up 24 bytes per element besides the elements themselves. It can be written to a file with `hopscotch_frozen_save` and mapped back in with `hopscotch_frozen_open`.
+ * As with `hopscotch_list_next_el`, elements added or deleted while this runs may or may not be copied.
+ * \param frozen A pointer to where the frozen list pointer should be stored.
+ * \param list The Hopscotch list.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_list_freeze(hopscotch_frozen_t ** frozen, hopscotch_list_t * list);
+
+/**
+ * Writes a frozen list to a file (as `<path>.tmp`, which is renamed to `path` once it's all on disk).
+ * \param frozen The frozen list.
+ * \param path Where the file should be.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_save(hopscotch_frozen_t * frozen, const char * path);
+
+/**
+ * Maps a frozen list that was written with `hopscotch_frozen_save` back in, read-only. Only the header is checked up front, so this doesn't read the file.
+ * \param frozen A pointer to where the frozen list pointer should be stored.
+ * \param path The file.
+ * \param opts A pointer to a `hopscotch_opts_t` with the `cmp` of the list the file was frozen from (`NULL` for the default one) and the `gc` to use.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_open(hopscotch_frozen_t ** frozen, const char * path, hopscotch_opts_t * opts);
+
+/**
+ * Searches a frozen list for an element.
+ * \param found A pointer to a boolean variable, which will be set to true if the element is in `frozen`.
+ * \param frozen The frozen list.
+ * \param val A pointer to the element.
+ * \param val_size The size of the element.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_contains_el(
+	bool * found,
+	hopscotch_frozen_t * frozen,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Finds the smallest element in a frozen list that's greater than or equal to `val`, e.g. to start a scan from.
+ * \param rank A pointer to where the element's rank (its position in the list, from `0`) should be stored, which will be set to `frozen->count` if there's no such element.
+ * \param frozen The frozen list.
+ * \param val A pointer to the element.
+ * \param val_size The size of the element.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_ceiling_el(
+	size_t * rank,
+	hopscotch_frozen_t * frozen,
+	hopscotch_byte_t * val,
+	size_t val_size
+);
+
+/**
+ * Gets the element of a frozen list with a given rank. Going through the ranks in order is a scan of the list.
+ * \param val A pointer to where the element should be stored, which will be set to `NULL` if `rank` is past the end of the list. It points into the frozen list, and is only good until the list is freed.
+ * \param val_size A pointer to where the element's size should be stored.
+ * \param frozen The frozen list.
+ * \param rank The element's rank.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_el(
+	hopscotch_byte_t ** val,
+	size_t * val_size,
+	hopscotch_frozen_t * frozen,
+	size_t rank
+);
+
+/**
+ * Free a frozen list, which is only unmapped if it came from `hopscotch_frozen_open`.
+ * \param frozen The frozen list, which mustn't be used anymore afterwards.
+ * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
+ */
+HOPSCOTCH_ABI_EXPORT hopscotch_res_t
+hopscotch_frozen_free(hopscotch_frozen_t * frozen);
+
 /**
  * Free a Hopscotch list.
+ * A list opened with `hopscotch_list_shm_open` is only unmapped; the list itself stays in the segment until the segment is unlinked.
  * \param list The Hopscotch list to free.
  * \return `hopscotch_res_t` is `0` on success and otherwise on failure.
  */
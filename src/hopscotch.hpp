@@ -0,0 +1,646 @@
+/**
+ * The MIT License (MIT).
+ *
+ * Hopscotch - A generic concurrent skip list library.
+ * https://github.com/jonathanmarvens/hopscotch
+ *
+ * Copyright (c) 2014 Jonathan Barronville (jonathan@scrapum.photos) and contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __JONATHANMARVENS_HOPSCOTCH_HOPSCOTCH_HPP__INCLUDED__
+#define __JONATHANMARVENS_HOPSCOTCH_HOPSCOTCH_HPP__INCLUDED__
+
+/**
+ * A header-only C++11 front-end to the same lazy, lock-based skip list as `hopscotch.h`.
+ * The comparator is a template parameter (so it gets inlined), keys are typed, and the max level is a compile-time constant.
+ * It doesn't need the GC: nodes come from `Alloc`, and erased nodes are kept until `reclaim` is called (or the list is destroyed), so concurrent readers and iterators never see freed memory.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace hopscotch {
+
+namespace detail {
+
+// A per-thread xorshift64* generator, so that picking a level never touches shared state.
+inline std::uint64_t
+rand64() {
+	static thread_local std::uint64_t state = 0;
+	if (state == 0) {
+		state = (((std::uint64_t) std::chrono::steady_clock::now().time_since_epoch().count()) ^ ((std::uint64_t) (std::uintptr_t) &state)) | ((std::uint64_t) 1);
+	}
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * ((std::uint64_t) 0x2545F4914F6CDD1DULL);
+}
+
+}
+
+/**
+ * A concurrent sorted set.
+ * `insert`, `emplace`, `erase`, `contains`, `find` and `lower_bound` are all safe to call from any number of threads at once.
+ * Lookups and iteration are lock-free; writers lock only the predecessors of the element they change.
+ *
+ * \tparam Key The element type. It only has to be move-constructible.
+ * \tparam Compare A strict weak ordering on `Key`. If it has an `is_transparent` member type, lookups accept any type it can compare with `Key`.
+ * \tparam Alloc The allocator the nodes and their forward pointer arrays are allocated with (rebound as needed).
+ * \tparam MaxLevel The number of levels, i.e. the height of the tallest possible tower.
+ */
+template <
+	typename Key,
+	typename Compare = std::less<Key>,
+	typename Alloc = std::allocator<Key>,
+	std::uint8_t MaxLevel = 16
+>
+class concurrent_skiplist {
+	static_assert((MaxLevel >= 1) && (MaxLevel <= 64), "MaxLevel must be between 1 and 64.");
+
+	struct node_base {
+		node_base() : marked(false), fully_linked(false), level(0), forward(nullptr) {}
+
+		std::mutex lock;
+		std::atomic<bool> marked;
+		std::atomic<bool> fully_linked;
+		std::uint8_t level;
+		std::atomic<node_base *> * forward;
+	};
+
+	struct node : node_base {
+		template <typename... Args>
+		explicit node(Args &&... args) : key(std::forward<Args>(args)...), retired_next(nullptr) {}
+
+		Key key;
+		// The next node on the list's retired stack, once erased.
+		node * retired_next;
+	};
+
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<node> node_allocator_type;
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<std::atomic<node_base *>> forward_allocator_type;
+	typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+	typedef std::allocator_traits<forward_allocator_type> forward_allocator_traits;
+
+public:
+	typedef Key key_type;
+	typedef Key value_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef Compare key_compare;
+	typedef Compare value_compare;
+	typedef Alloc allocator_type;
+	typedef const Key & reference;
+	typedef const Key & const_reference;
+
+	/**
+	 * Walks level 0, skipping elements that are being added or have been erased.
+	 * Iterators stay valid while other threads add and erase (erased nodes aren't freed until `reclaim` or the destructor).
+	 */
+	class const_iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Key value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Key * pointer;
+		typedef const Key & reference;
+
+		const_iterator() : curr_node(nullptr) {}
+
+		reference
+		operator*() const {
+			return static_cast<node *>(curr_node)->key;
+		}
+
+		pointer
+		operator->() const {
+			return &(static_cast<node *>(curr_node)->key);
+		}
+
+		const_iterator &
+		operator++() {
+			curr_node = curr_node->forward[0].load(std::memory_order_acquire);
+			skip_dead();
+			return *this;
+		}
+
+		const_iterator
+		operator++(int) {
+			const_iterator prev = *this;
+			++(*this);
+			return prev;
+		}
+
+		friend bool
+		operator==(const const_iterator & a, const const_iterator & b) {
+			return a.curr_node == b.curr_node;
+		}
+
+		friend bool
+		operator!=(const const_iterator & a, const const_iterator & b) {
+			return a.curr_node != b.curr_node;
+		}
+
+	private:
+		friend class concurrent_skiplist;
+
+		explicit const_iterator(node_base * node_) : curr_node(node_) {
+			skip_dead();
+		}
+
+		void
+		skip_dead() {
+			while (
+				(curr_node != nullptr) &&
+				((! curr_node->fully_linked.load(std::memory_order_acquire)) || curr_node->marked.load(std::memory_order_acquire))
+			) {
+				curr_node = curr_node->forward[0].load(std::memory_order_acquire);
+			}
+		}
+
+		node_base * curr_node;
+	};
+
+	typedef const_iterator iterator;
+
+	explicit
+	concurrent_skiplist(const Compare & comp = Compare(), const Alloc & alloc = Alloc()) :
+		comp_(comp),
+		node_alloc_(alloc),
+		forward_alloc_(alloc),
+		retired_(nullptr),
+		retired_size_(0),
+		size_(0) {
+		head_.level = (std::uint8_t) (MaxLevel - 1);
+		head_.forward = head_forward_;
+		for (int level = 0; level < MaxLevel; level++) {
+			head_forward_[level].store(nullptr, std::memory_order_relaxed);
+		}
+		head_.fully_linked.store(true, std::memory_order_relaxed);
+	}
+
+	explicit
+	concurrent_skiplist(const Alloc & alloc) : concurrent_skiplist(Compare(), alloc) {}
+
+	// Other threads may hold pointers into the list, so it can't be copied or moved.
+	concurrent_skiplist(const concurrent_skiplist &) = delete;
+	concurrent_skiplist & operator=(const concurrent_skiplist &) = delete;
+
+	/**
+	 * Must not race with any other operation on the list.
+	 */
+	~concurrent_skiplist() {
+		node_base * curr_node = head_.forward[0].load(std::memory_order_acquire);
+		while (curr_node != nullptr) {
+			node_base * next_node = curr_node->forward[0].load(std::memory_order_relaxed);
+			destroy_node(static_cast<node *>(curr_node));
+			curr_node = next_node;
+		}
+		reclaim();
+	}
+
+	static constexpr std::uint8_t
+	max_level() {
+		return MaxLevel;
+	}
+
+	allocator_type
+	get_allocator() const {
+		return allocator_type(node_alloc_);
+	}
+
+	key_compare
+	key_comp() const {
+		return comp_;
+	}
+
+	const_iterator
+	begin() const {
+		return const_iterator(head_.forward[0].load(std::memory_order_acquire));
+	}
+
+	const_iterator
+	end() const {
+		return const_iterator();
+	}
+
+	const_iterator
+	cbegin() const {
+		return begin();
+	}
+
+	const_iterator
+	cend() const {
+		return end();
+	}
+
+	bool
+	empty() const {
+		return begin() == end();
+	}
+
+	/**
+	 * The number of elements, which can be stale by the time it's returned if other threads are writing.
+	 */
+	size_type
+	size() const {
+		return size_.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * The number of erased elements that are waiting for `reclaim`.
+	 */
+	size_type
+	retired_size() const {
+		return retired_size_.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Frees the elements that have been erased so far, which are otherwise kept (so that readers never see freed memory) until the list is destroyed.
+	 * Like the destructor, this must not race with any other operation on the list, so it's meant for points where the list is known to be quiescent (e.g. between the phases of a workload, or under a lock that every user of the list takes shared). Iterators to erased elements are invalidated.
+	 * \return The number of elements freed.
+	 */
+	size_type
+	reclaim() {
+		node * retired_node = retired_.exchange(nullptr, std::memory_order_acquire);
+		size_type freed = 0;
+		while (retired_node != nullptr) {
+			node * next_node = retired_node->retired_next;
+			destroy_node(retired_node);
+			retired_node = next_node;
+			freed++;
+		}
+		retired_size_.fetch_sub(freed, std::memory_order_relaxed);
+		return freed;
+	}
+
+	/**
+	 * \return An iterator to the element and `true` if it was added, or an iterator to the equal element that was already there and `false`.
+	 */
+	std::pair<iterator, bool>
+	insert(const value_type & key) {
+		// Don't pay for a node (or a copy) when the element is already there.
+		node_base * found_node = find_live_node(key);
+		if (found_node != nullptr) {
+			return std::pair<iterator, bool>(iterator(found_node), false);
+		}
+		return emplace(key);
+	}
+
+	std::pair<iterator, bool>
+	insert(value_type && key) {
+		node_base * found_node = find_live_node(key);
+		if (found_node != nullptr) {
+			return std::pair<iterator, bool>(iterator(found_node), false);
+		}
+		return emplace(std::move(key));
+	}
+
+	/**
+	 * Constructs the element in place, before any lock is taken; it's destroyed again if an equal element turns out to be there already.
+	 */
+	template <typename... Args>
+	std::pair<iterator, bool>
+	emplace(Args &&... args) {
+		node * new_node = create_node(rand_level(), std::forward<Args>(args)...);
+		std::pair<iterator, bool> res = link_node(new_node);
+		if (! res.second) {
+			destroy_node(new_node);
+		}
+		return res;
+	}
+
+	/**
+	 * \return The number of elements erased (`0` or `1`).
+	 */
+	size_type
+	erase(const key_type & key) {
+		return erase_key(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type
+	erase(const K & key) {
+		return erase_key(key);
+	}
+
+	bool
+	contains(const key_type & key) const {
+		return find_live_node(key) != nullptr;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool
+	contains(const K & key) const {
+		return find_live_node(key) != nullptr;
+	}
+
+	size_type
+	count(const key_type & key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type
+	count(const K & key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	const_iterator
+	find(const key_type & key) const {
+		return const_iterator(find_live_node(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator
+	find(const K & key) const {
+		return const_iterator(find_live_node(key));
+	}
+
+	/**
+	 * \return An iterator to the first element that isn't less than `key`.
+	 */
+	const_iterator
+	lower_bound(const key_type & key) const {
+		return const_iterator(find_lower_bound(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator
+	lower_bound(const K & key) const {
+		return const_iterator(find_lower_bound(key));
+	}
+
+private:
+	static const Key &
+	key_of(node_base * node_) {
+		return static_cast<node *>(node_)->key;
+	}
+
+	static std::uint8_t
+	rand_level() {
+		// Every set bit is a coin flip that came up heads (p = 0.5, like `HOPSCOTCH_VAL_LIST_DEFAULT_RAND_LEVEL_P`).
+		std::uint64_t bits = detail::rand64();
+		std::uint8_t level = 0;
+		while (((bits & 1) != 0) && (level < (MaxLevel - 1))) {
+			level++;
+			bits >>= 1;
+		}
+		return level;
+	}
+
+	template <typename... Args>
+	node *
+	create_node(std::uint8_t level, Args &&... args) {
+		node * new_node = node_allocator_traits::allocate(node_alloc_, 1);
+		try {
+			node_allocator_traits::construct(node_alloc_, new_node, std::forward<Args>(args)...);
+		} catch (...) {
+			node_allocator_traits::deallocate(node_alloc_, new_node, 1);
+			throw;
+		}
+		try {
+			new_node->forward = forward_allocator_traits::allocate(forward_alloc_, ((std::size_t) level) + 1);
+		} catch (...) {
+			node_allocator_traits::destroy(node_alloc_, new_node);
+			node_allocator_traits::deallocate(node_alloc_, new_node, 1);
+			throw;
+		}
+		for (int _level = 0; _level <= level; _level++) {
+			::new ((void *) &(new_node->forward[_level])) std::atomic<node_base *>(nullptr);
+		}
+		new_node->level = level;
+		return new_node;
+	}
+
+	void
+	destroy_node(node * node_) {
+		forward_allocator_traits::deallocate(forward_alloc_, node_->forward, ((std::size_t) node_->level) + 1);
+		node_allocator_traits::destroy(node_alloc_, node_);
+		node_allocator_traits::deallocate(node_alloc_, node_, 1);
+	}
+
+	// Fills in the predecessors and successors of `key` on every level.
+	// Returns the highest level `key` was found on, or `-1`.
+	template <typename K>
+	int
+	find_preds(const K & key, node_base ** pred_nodes, node_base ** succ_nodes) const {
+		int level_found = -1;
+		node_base * pred_node = const_cast<node_base *>(&head_);
+		for (int level = MaxLevel - 1; level >= 0; level--) {
+			node_base * curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			while ((curr_node != nullptr) && comp_(key_of(curr_node), key)) {
+				pred_node = curr_node;
+				curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			}
+			if ((level_found == -1) && (curr_node != nullptr) && (! comp_(key, key_of(curr_node)))) {
+				level_found = level;
+			}
+			pred_nodes[level] = pred_node;
+			succ_nodes[level] = curr_node;
+		}
+		return level_found;
+	}
+
+	// Like `find_preds`, but stops as soon as `key` is found.
+	template <typename K>
+	node_base *
+	find_live_node(const K & key) const {
+		node_base * pred_node = const_cast<node_base *>(&head_);
+		for (int level = MaxLevel - 1; level >= 0; level--) {
+			node_base * curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			while ((curr_node != nullptr) && comp_(key_of(curr_node), key)) {
+				pred_node = curr_node;
+				curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			}
+			if ((curr_node != nullptr) && (! comp_(key, key_of(curr_node)))) {
+				if (
+					curr_node->fully_linked.load(std::memory_order_acquire) &&
+					(! curr_node->marked.load(std::memory_order_acquire))
+				) {
+					return curr_node;
+				}
+				return nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	template <typename K>
+	node_base *
+	find_lower_bound(const K & key) const {
+		node_base * pred_node = const_cast<node_base *>(&head_);
+		node_base * curr_node = nullptr;
+		for (int level = MaxLevel - 1; level >= 0; level--) {
+			curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			while ((curr_node != nullptr) && comp_(key_of(curr_node), key)) {
+				pred_node = curr_node;
+				curr_node = pred_node->forward[level].load(std::memory_order_acquire);
+			}
+		}
+		return curr_node;
+	}
+
+	// Unlocks the predecessors locked on levels `0` through `highest_level_locked`.
+	// A predecessor that spans several levels was only locked once.
+	static void
+	unlock_preds(node_base ** pred_nodes, int highest_level_locked) {
+		node_base * prev_pred_node = nullptr;
+		for (int level = 0; level <= highest_level_locked; level++) {
+			if (pred_nodes[level] == prev_pred_node) {
+				continue;
+			}
+			prev_pred_node = pred_nodes[level];
+			pred_nodes[level]->lock.unlock();
+		}
+	}
+
+	std::pair<iterator, bool>
+	link_node(node * new_node) {
+		int top_level = new_node->level;
+		node_base * pred_nodes[MaxLevel];
+		node_base * succ_nodes[MaxLevel];
+		while (true) {
+			int level_found = find_preds(new_node->key, pred_nodes, succ_nodes);
+			if (level_found != -1) {
+				node_base * node_found = succ_nodes[level_found];
+				if (! node_found->marked.load(std::memory_order_acquire)) {
+					while (! node_found->fully_linked.load(std::memory_order_acquire));
+					return std::pair<iterator, bool>(iterator(node_found), false);
+				}
+				continue;
+			}
+			int highest_level_locked = -1;
+			node_base * prev_pred_node = nullptr;
+			bool valid = true;
+			for (int level = 0; valid && (level <= top_level); level++) {
+				node_base * pred_node = pred_nodes[level];
+				node_base * succ_node = succ_nodes[level];
+				if (pred_node != prev_pred_node) {
+					pred_node->lock.lock();
+					highest_level_locked = level;
+					prev_pred_node = pred_node;
+				}
+				valid = (
+					(! pred_node->marked.load(std::memory_order_acquire)) &&
+					((succ_node == nullptr) || (! succ_node->marked.load(std::memory_order_acquire))) &&
+					(pred_node->forward[level].load(std::memory_order_acquire) == succ_node)
+				);
+			}
+			if (valid) {
+				for (int level = 0; level <= top_level; level++) {
+					new_node->forward[level].store(succ_nodes[level], std::memory_order_relaxed);
+					pred_nodes[level]->forward[level].store(new_node, std::memory_order_release);
+				}
+				new_node->fully_linked.store(true, std::memory_order_release);
+				size_.fetch_add(1, std::memory_order_relaxed);
+			}
+			unlock_preds(pred_nodes, highest_level_locked);
+			if (valid) {
+				return std::pair<iterator, bool>(iterator(new_node), true);
+			}
+		}
+	}
+
+	template <typename K>
+	size_type
+	erase_key(const K & key) {
+		node * node_to_del = nullptr;
+		bool is_marked = false;
+		int top_level = -1;
+		node_base * pred_nodes[MaxLevel];
+		node_base * succ_nodes[MaxLevel];
+		while (true) {
+			int level_found = find_preds(key, pred_nodes, succ_nodes);
+			if (level_found != -1) {
+				node_to_del = static_cast<node *>(succ_nodes[level_found]);
+			}
+			if (
+				(! is_marked) &&
+				(
+					(level_found == -1) ||
+					(! node_to_del->fully_linked.load(std::memory_order_acquire)) ||
+					(node_to_del->level != level_found) ||
+					node_to_del->marked.load(std::memory_order_acquire)
+				)
+			) {
+				return 0;
+			}
+			if (! is_marked) {
+				top_level = node_to_del->level;
+				node_to_del->lock.lock();
+				if (node_to_del->marked.load(std::memory_order_relaxed)) {
+					node_to_del->lock.unlock();
+					return 0;
+				}
+				node_to_del->marked.store(true, std::memory_order_release);
+				is_marked = true;
+			}
+			int highest_level_locked = -1;
+			node_base * prev_pred_node = nullptr;
+			bool valid = true;
+			for (int level = 0; valid && (level <= top_level); level++) {
+				node_base * pred_node = pred_nodes[level];
+				if (pred_node != prev_pred_node) {
+					pred_node->lock.lock();
+					highest_level_locked = level;
+					prev_pred_node = pred_node;
+				}
+				valid = (
+					(! pred_node->marked.load(std::memory_order_acquire)) &&
+					(pred_node->forward[level].load(std::memory_order_acquire) == node_to_del)
+				);
+			}
+			if (! valid) {
+				unlock_preds(pred_nodes, highest_level_locked);
+				continue;
+			}
+			for (int level = top_level; level >= 0; level--) {
+				pred_nodes[level]->forward[level].store(node_to_del->forward[level].load(std::memory_order_relaxed), std::memory_order_release);
+			}
+			node_to_del->lock.unlock();
+			unlock_preds(pred_nodes, highest_level_locked);
+			retire_node(node_to_del);
+			size_.fetch_sub(1, std::memory_order_relaxed);
+			return 1;
+		}
+	}
+
+	// Readers may still be inside an unlinked node, so it's only freed by `reclaim` (or when the list is destroyed).
+	void
+	retire_node(node * node_) {
+		retired_size_.fetch_add(1, std::memory_order_relaxed);
+		node_->retired_next = retired_.load(std::memory_order_relaxed);
+		while (! retired_.compare_exchange_weak(
+			node_->retired_next,
+			node_,
+			std::memory_order_release,
+			std::memory_order_relaxed
+		));
+	}
+
+	Compare comp_;
+	node_allocator_type node_alloc_;
+	forward_allocator_type forward_alloc_;
+	node_base head_;
+	std::atomic<node_base *> head_forward_[MaxLevel];
+	std::atomic<node *> retired_;
+	std::atomic<size_type> retired_size_;
+	std::atomic<size_type> size_;
+};
+
+}
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * The MIT License (MIT).
+ *
+ * https://github.com/jonathanmarvens/hopscotch
+ *
+ * Copyright (c) 2014 Jonathan Barronville (jonathan@scrapum.photos) and contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <hopscotch/hopscotch.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hammers lists with adds, dels and lookups from several threads at once, and then checks what's left.
+// Meant to be run under ThreadSanitizer: `make HOPSCOTCH_COMPILE_TSAN=true stress && ./stress`.
+// Every thread owns the keys `k` with `k % STRESS_THREADS == thread`, and keeps track of which of them should be in the list; everyone also reads all the keys, and the first `STRESS_SHARED_KEYS` keys are written by everyone (so writers fight over the same predecessors), but only checked for order.
+
+#define STRESS_THREADS 4
+#define STRESS_KEYS 4096
+#define STRESS_SHARED_KEYS 64
+#define STRESS_OPS 100000
+
+#define CHECK(cond) \
+	do { \
+		if (! (cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+#define CHECK_RES(expr) CHECK((expr) == HOPSCOTCH_RES__SUCCESS)
+
+static uint32_t keys[STRESS_KEYS];
+
+typedef struct {
+	hopscotch_list_t * list;
+	size_t thread;
+	bool in_list[STRESS_KEYS];
+} stress_ctx_t;
+
+static uint32_t
+key_of(hopscotch_byte_t * val) {
+	return (uint32_t) ((((uint32_t) val[0]) << 24) | (((uint32_t) val[1]) << 16) | (((uint32_t) val[2]) << 8) | ((uint32_t) val[3]));
+}
+
+static void *
+stress_thread(void * arg) {
+	stress_ctx_t * ctx = (stress_ctx_t *) arg;
+	uint64_t state = (uint64_t) (0x9e3779b97f4a7c15ULL * (ctx->thread + 1));
+	size_t i;
+	for (i = 0; i < STRESS_OPS; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		size_t op = (size_t) (state % 4);
+		size_t k = (size_t) ((state >> 8) % STRESS_KEYS);
+		bool owned = (bool) ((k >= STRESS_SHARED_KEYS) && ((k % STRESS_THREADS) == ctx->thread));
+		hopscotch_byte_t * val = (hopscotch_byte_t *) &(keys[k]);
+		bool res;
+		if ((op == 0) && (owned || (k < STRESS_SHARED_KEYS))) {
+			CHECK_RES(hopscotch_list_add_el(&res, ctx->list, val, sizeof(uint32_t)));
+			if (owned) {
+				CHECK(res == (! ctx->in_list[k]));
+				ctx->in_list[k] = true;
+			}
+		} else if ((op == 1) && (owned || (k < STRESS_SHARED_KEYS))) {
+			CHECK_RES(hopscotch_list_del_el(&res, ctx->list, val, sizeof(uint32_t)));
+			if (owned) {
+				CHECK(res == ctx->in_list[k]);
+				ctx->in_list[k] = false;
+			}
+		} else {
+			CHECK_RES(hopscotch_list_contains_el(&res, ctx->list, val, sizeof(uint32_t)));
+			if (owned) {
+				CHECK(res == ctx->in_list[k]);
+			}
+		}
+	}
+	return NULL;
+}
+
+static void
+stress(const char * name, hopscotch_opts_t * opts) {
+	hopscotch_opts_t * list_opts = (hopscotch_opts_t *) malloc(sizeof(hopscotch_opts_t));
+	CHECK(list_opts != NULL);
+	memcpy((void *) list_opts, (void *) opts, sizeof(hopscotch_opts_t));
+	hopscotch_list_t * list = NULL;
+	CHECK_RES(hopscotch_list_new(&list, list_opts));
+	if (opts->towers.lazy || opts->towers.adaptive) {
+		CHECK_RES(hopscotch_list_maintenance_start(list));
+	}
+	static stress_ctx_t ctxs[STRESS_THREADS];
+	pthread_t threads[STRESS_THREADS];
+	size_t i;
+	for (i = 0; i < STRESS_THREADS; i++) {
+		memset((void *) &(ctxs[i]), 0, sizeof(stress_ctx_t));
+		ctxs[i].list = list;
+		ctxs[i].thread = i;
+		CHECK(pthread_create(&(threads[i]), NULL, stress_thread, (void *) &(ctxs[i])) == 0);
+	}
+	for (i = 0; i < STRESS_THREADS; i++) {
+		CHECK(pthread_join(threads[i], NULL) == 0);
+	}
+	if (opts->towers.lazy || opts->towers.adaptive) {
+		CHECK_RES(hopscotch_list_maintenance_stop(list));
+	}
+	// In order, without duplicates, and holding exactly the owned keys that should be there.
+	bool seen[STRESS_KEYS];
+	memset((void *) seen, 0, sizeof(seen));
+	int64_t last = -1;
+	hopscotch_node_t * node = NULL;
+	CHECK_RES(hopscotch_list_next_el(&node, list, NULL));
+	while (node != NULL) {
+		hopscotch_byte_t * val;
+		size_t val_size;
+		CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+		CHECK(val_size == sizeof(uint32_t));
+		uint32_t k = key_of(val);
+		CHECK(((int64_t) k) > last);
+		last = (int64_t) k;
+		seen[k] = true;
+		CHECK_RES(hopscotch_list_next_el(&node, list, node));
+	}
+	for (i = STRESS_SHARED_KEYS; i < STRESS_KEYS; i++) {
+		CHECK(seen[i] == ctxs[i % STRESS_THREADS].in_list[i]);
+	}
+	CHECK_RES(hopscotch_list_free(list));
+	printf("%s: ok\n", name);
+	fflush(stdout);
+}
+
+int
+main(void) {
+	size_t i;
+	for (i = 0; i < STRESS_KEYS; i++) {
+		hopscotch_byte_t * val = (hopscotch_byte_t *) &(keys[i]);
+		val[0] = (hopscotch_byte_t) (i >> 24);
+		val[1] = (hopscotch_byte_t) (i >> 16);
+		val[2] = (hopscotch_byte_t) (i >> 8);
+		val[3] = (hopscotch_byte_t) i;
+	}
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	stress("default", &opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.back_links.enabled = true;
+	opts.filter.capacity = (size_t) STRESS_KEYS;
+	opts.index.enabled = true;
+	stress("back links, filter and index", &opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.towers.lazy = true;
+	opts.towers.interval_ms = 1;
+	stress("lazy towers", &opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.towers.adaptive = true;
+	opts.towers.interval_ms = 1;
+	stress("adaptive towers", &opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.combining.enabled = true;
+	stress("combining", &opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.small.capacity = 64;
+	stress("small", &opts);
+	return EXIT_SUCCESS;
+}
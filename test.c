@@ -12,84 +12,1399 @@
  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+// For `mkdtemp`.
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
 #include <hopscotch/hopscotch.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-int
-main(void) {
+// Stops the tests at the first check that doesn't hold.
+#define CHECK(cond) \
+	do { \
+		if (! (cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+#define CHECK_RES(expr) CHECK((expr) == HOPSCOTCH_RES__SUCCESS)
+
+// Elements are big-endian `uint32_t`s, so that the default order is the numeric one.
+// Lists point at their elements' buffers, so every element the tests use lives here.
+#define TEST_KEYS_COUNT 4096
+
+static uint32_t test_keys[TEST_KEYS_COUNT];
+
+static hopscotch_byte_t *
+key(uint32_t k) {
+	return (hopscotch_byte_t *) &(test_keys[k]);
+}
+
+static uint32_t
+key_of(hopscotch_byte_t * val, size_t val_size) {
+	CHECK(val_size == sizeof(uint32_t));
+	return (uint32_t) (
+		(((uint32_t) val[0]) << 24) |
+		(((uint32_t) val[1]) << 16) |
+		(((uint32_t) val[2]) << 8) |
+		((uint32_t) val[3])
+	);
+}
+
+static hopscotch_list_t *
+new_list(hopscotch_opts_t * opts) {
+	hopscotch_opts_t * list_opts = (hopscotch_opts_t *) calloc((size_t) 1, sizeof(hopscotch_opts_t));
+	CHECK(list_opts != NULL);
+	if (opts != NULL) {
+		memcpy((void *) list_opts, (void *) opts, sizeof(hopscotch_opts_t));
+	}
 	hopscotch_list_t * list = NULL;
-	hopscotch_opts_t list_opts = {
-		.cmp = NULL,
-		.max_level = (uint8_t) 0,
-		.rand_level_p = (double) 0,
+	CHECK_RES(hopscotch_list_new(&list, list_opts));
+	return list;
+}
+
+static void
+add_keys(hopscotch_list_t * list, uint32_t from, uint32_t to, uint32_t step) {
+	uint32_t k;
+	for (k = from; k < to; k += step) {
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, list, key(k), sizeof(uint32_t)));
+		CHECK(added);
+	}
+}
+
+// Checks that `list` holds exactly the keys below `TEST_KEYS_COUNT` that `want` says it should, in order.
+static void
+check_keys(hopscotch_list_t * list, bool (* want)(uint32_t)) {
+	uint32_t expected = 0;
+	hopscotch_node_t * node = NULL;
+	CHECK_RES(hopscotch_list_next_el(&node, list, NULL));
+	for (; node != NULL; ) {
+		hopscotch_byte_t * val;
+		size_t val_size;
+		CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+		uint32_t k = key_of(val, val_size);
+		while ((expected < k) && (! want(expected))) {
+			expected++;
+		}
+		CHECK(expected == k);
+		expected++;
+		CHECK_RES(hopscotch_list_next_el(&node, list, node));
+	}
+	while (expected < TEST_KEYS_COUNT) {
+		CHECK(! want(expected));
+		expected++;
+	}
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		bool found;
+		CHECK_RES(hopscotch_list_contains_el(&found, list, key(k), sizeof(uint32_t)));
+		CHECK(found == want(k));
+	}
+}
+
+// A fresh directory for the tests that write files, which `remove_tmp_dir` takes away again.
+static void
+new_tmp_dir(char * path, size_t path_size) {
+	CHECK(snprintf(path, path_size, "/tmp/hopscotch-test-XXXXXX") < ((int) path_size));
+	CHECK(mkdtemp(path) != NULL);
+}
+
+// Counts the files in `path` whose names end with `suffix`.
+static size_t
+count_files(const char * path, const char * suffix) {
+	DIR * dir = opendir(path);
+	CHECK(dir != NULL);
+	size_t count = 0;
+	size_t suffix_size = strlen(suffix);
+	struct dirent * entry;
+	while ((entry = readdir(dir)) != NULL) {
+		size_t name_size = strlen(entry->d_name);
+		if ((name_size > suffix_size) && (strcmp(entry->d_name + (name_size - suffix_size), suffix) == 0)) {
+			count++;
+		}
+	}
+	closedir(dir);
+	return count;
+}
+
+static void
+remove_tmp_dir(const char * path) {
+	DIR * dir = opendir(path);
+	CHECK(dir != NULL);
+	struct dirent * entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+			continue;
+		}
+		char file_path[512];
+		CHECK(snprintf(file_path, sizeof(file_path), "%s/%s", path, entry->d_name) < ((int) sizeof(file_path)));
+		CHECK(unlink(file_path) == 0);
+	}
+	closedir(dir);
+	CHECK(rmdir(path) == 0);
+}
+
+static bool
+want_none(uint32_t k) {
+	(void) k;
+	return false;
+}
+
+static bool
+want_all(uint32_t k) {
+	(void) k;
+	return true;
+}
+
+static bool
+want_even(uint32_t k) {
+	return (bool) ((k % 2) == 0);
+}
+
+static bool
+want_div3(uint32_t k) {
+	return (bool) ((k % 3) == 0);
+}
+
+static bool
+want_even_or_div3(uint32_t k) {
+	return (bool) (want_even(k) || want_div3(k));
+}
+
+static bool
+want_div6(uint32_t k) {
+	return (bool) ((k % 6) == 0);
+}
+
+static bool
+want_even_not_div3(uint32_t k) {
+	return (bool) (want_even(k) && (! want_div3(k)));
+}
+
+static bool
+want_even_xor_div3(uint32_t k) {
+	return (bool) (want_even(k) != want_div3(k));
+}
+
+// Where `test_split_join` splits, for the predicates below.
+static uint32_t split_at;
+
+static bool
+want_even_before_split(uint32_t k) {
+	return (bool) (want_even(k) && (k < split_at));
+}
+
+static bool
+want_even_from_split(uint32_t k) {
+	return (bool) (want_even(k) && (k >= split_at));
+}
+
+// Like `check_keys`, but for what a snapshot of `list` can see.
+static void
+check_snapshot_keys(hopscotch_list_t * list, hopscotch_snapshot_t * snapshot, bool (* want)(uint32_t)) {
+	uint32_t expected = 0;
+	hopscotch_node_t * node = NULL;
+	CHECK_RES(hopscotch_list_snapshot_next_el(&node, snapshot, NULL));
+	for (; node != NULL; ) {
+		hopscotch_byte_t * val;
+		size_t val_size;
+		CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+		uint32_t k = key_of(val, val_size);
+		while ((expected < k) && (! want(expected))) {
+			expected++;
+		}
+		CHECK(expected == k);
+		expected++;
+		CHECK_RES(hopscotch_list_snapshot_next_el(&node, snapshot, node));
+	}
+	while (expected < TEST_KEYS_COUNT) {
+		CHECK(! want(expected));
+		expected++;
+	}
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		bool found;
+		CHECK_RES(hopscotch_list_snapshot_contains_el(&found, snapshot, key(k), sizeof(uint32_t)));
+		CHECK(found == want(k));
+	}
+}
+
+static void
+test_basic(void) {
+	hopscotch_list_t * list = new_list(NULL);
+	bool added;
+	CHECK_RES(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) ("hello"), (size_t) 6));
+	CHECK(added);
+	CHECK_RES(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(added);
+	CHECK_RES(hopscotch_list_add_el(&added, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(! added);
+	bool found;
+	CHECK_RES(hopscotch_list_contains_el(&found, list, (hopscotch_byte_t *) ("homie"), (size_t) 6));
+	CHECK(! found);
+	CHECK_RES(hopscotch_list_contains_el(&found, list, (hopscotch_byte_t *) ("hello"), (size_t) 6));
+	CHECK(found);
+	CHECK_RES(hopscotch_list_contains_el(&found, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(found);
+	bool deleted;
+	CHECK_RES(hopscotch_list_del_el(&deleted, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(deleted);
+	CHECK_RES(hopscotch_list_del_el(&deleted, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(! deleted);
+	CHECK_RES(hopscotch_list_contains_el(&found, list, (hopscotch_byte_t *) ("hola"), (size_t) 5));
+	CHECK(! found);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+// Checks `hopscotch_list_contains_batch` against `hopscotch_list_contains_el`, for every key, in batches that are empty, smaller than the window and bigger than it.
+static void
+check_contains_batch(hopscotch_list_t * list) {
+	static hopscotch_byte_t * vals[TEST_KEYS_COUNT];
+	static size_t val_sizes[TEST_KEYS_COUNT];
+	static bool found[TEST_KEYS_COUNT];
+	size_t counts[] = {0, 1, HOPSCOTCH_VAL_LIST_BATCH_WIDTH - 1, HOPSCOTCH_VAL_LIST_BATCH_WIDTH, HOPSCOTCH_VAL_LIST_BATCH_WIDTH + 1, TEST_KEYS_COUNT};
+	size_t i;
+	for (i = 0; i < (sizeof(counts) / sizeof(counts[0])); i++) {
+		size_t j;
+		for (j = 0; j < counts[i]; j++) {
+			// Out of order (7919 is prime, so every key comes up once), so that the searches in the window end at different places.
+			vals[j] = key((uint32_t) ((j * 7919) % TEST_KEYS_COUNT));
+			val_sizes[j] = sizeof(uint32_t);
+			found[j] = (bool) ((j % 2) == 0);
+		}
+		CHECK_RES(hopscotch_list_contains_batch(found, list, vals, val_sizes, counts[i]));
+		for (j = 0; j < counts[i]; j++) {
+			bool _found;
+			CHECK_RES(hopscotch_list_contains_el(&_found, list, vals[j], val_sizes[j]));
+			CHECK(found[j] == _found);
+		}
+	}
+}
+
+static void
+test_contains_batch_with(hopscotch_opts_t * opts) {
+	// Many elements, and (for small lists) few enough to stay in the array.
+	uint32_t steps[] = {2, 128};
+	size_t i;
+	for (i = 0; i < (sizeof(steps) / sizeof(steps[0])); i++) {
+		hopscotch_list_t * list = new_list(opts);
+		check_contains_batch(list);
+		add_keys(list, 0, TEST_KEYS_COUNT, steps[i]);
+		check_contains_batch(list);
+		// Deleted elements are misses again.
+		uint32_t k;
+		for (k = 0; k < TEST_KEYS_COUNT; k += 3 * steps[i]) {
+			bool deleted;
+			CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+			CHECK(deleted);
+		}
+		check_contains_batch(list);
+		// Adaptive towers move once there have been lookups to go by.
+		CHECK_RES(hopscotch_list_maintenance_run(list));
+		check_contains_batch(list);
+		CHECK_RES(hopscotch_list_free(list));
+	}
+}
+
+static void
+test_contains_batch(void) {
+	test_contains_batch_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.filter.capacity = (size_t) TEST_KEYS_COUNT;
+	test_contains_batch_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.index.enabled = true;
+	test_contains_batch_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.small.capacity = 64;
+	test_contains_batch_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.towers.adaptive = true;
+	test_contains_batch_with(&opts);
+}
+
+// Records are a key (the same bytes as `key(k)`) followed by a value, and `record_cmp` / `record_hash` only look at the key.
+#define TEST_RECORD_SIZE (sizeof(uint32_t) * 2)
+
+static hopscotch_byte_t test_records[2][TEST_KEYS_COUNT][TEST_RECORD_SIZE];
+
+static hopscotch_byte_t *
+record(uint32_t k, uint32_t version) {
+	hopscotch_byte_t * val = test_records[version][k];
+	memcpy((void *) val, (void *) key(k), sizeof(uint32_t));
+	uint32_t value = (k * 2654435761u) ^ version;
+	memcpy((void *) (val + sizeof(uint32_t)), (void *) &value, sizeof(uint32_t));
+	return val;
+}
+
+// A `cmp` of the tests' own gets the list's sentinels as `val_1` (like the default one), and has to keep them at the ends.
+// Returns whether `val_1` is one of them, and if so sets `res[0]`.
+static bool
+cmp_sentinel(int * res, hopscotch_byte_t * val_1, size_t val_1_size) {
+	const char * min_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MIN_VAL;
+	const char * max_val = (char *) HOPSCOTCH_VAL_LIST_DEFAULT_MAX_VAL;
+	if ((val_1_size == (strlen(min_val) + 1)) && (memcmp((void *) val_1, (void *) min_val, val_1_size) == 0)) {
+		res[0] = -1;
+		return true;
+	}
+	if ((val_1_size == (strlen(max_val) + 1)) && (memcmp((void *) val_1, (void *) max_val, val_1_size) == 0)) {
+		res[0] = 1;
+		return true;
+	}
+	return false;
+}
+
+static hopscotch_res_t
+record_cmp(int * res, hopscotch_byte_t * val_1, size_t val_1_size, hopscotch_byte_t * val_2, size_t val_2_size) {
+	if (cmp_sentinel(res, val_1, val_1_size)) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	CHECK(val_1_size >= sizeof(uint32_t));
+	CHECK(val_2_size >= sizeof(uint32_t));
+	res[0] = memcmp((void *) val_1, (void *) val_2, sizeof(uint32_t));
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static hopscotch_res_t
+record_hash(uint64_t * hash, hopscotch_byte_t * val, size_t val_size) {
+	CHECK(val_size >= sizeof(uint32_t));
+	hash[0] = ((uint64_t) key_of(val, sizeof(uint32_t))) * 0x9e3779b97f4a7c15ull;
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+// Checks that looking up `key(k)` gets back `record(k, version)` for the wanted keys, and nothing for the others.
+static void
+check_records(hopscotch_list_t * list, bool (* want)(uint32_t), uint32_t version) {
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		hopscotch_byte_t * found_val = NULL;
+		size_t found_val_size = 0;
+		CHECK_RES(hopscotch_list_get_el(&found_val, &found_val_size, list, key(k), sizeof(uint32_t)));
+		if (want(k)) {
+			CHECK(found_val != NULL);
+			CHECK(found_val_size == TEST_RECORD_SIZE);
+			CHECK(memcmp((void *) found_val, (void *) test_records[version][k], TEST_RECORD_SIZE) == 0);
+		} else {
+			CHECK(found_val == NULL);
+		}
+	}
+}
+
+static void
+test_get_el_with(hopscotch_opts_t * opts) {
+	hopscotch_list_t * list = new_list(opts);
+	check_records(list, want_none, 0);
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k += 2) {
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, list, record(k, 0), TEST_RECORD_SIZE));
+		CHECK(added);
+	}
+	check_records(list, want_even, 0);
+	// The same key with another value is already in the list.
+	bool added;
+	CHECK_RES(hopscotch_list_add_el(&added, list, record(0, 1), TEST_RECORD_SIZE));
+	CHECK(! added);
+	check_records(list, want_even, 0);
+	// Deleting by key alone, and then a lookup mustn't find what the index had for the deleted nodes.
+	for (k = 0; k < TEST_KEYS_COUNT; k += 6) {
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted);
+	}
+	check_records(list, want_even_not_div3, 0);
+	// Replacing every record with a new value (deleting the ones still there first) has lookups find the new records.
+	for (k = 0; k < TEST_KEYS_COUNT; k += 2) {
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted == want_even_not_div3(k));
+		CHECK_RES(hopscotch_list_add_el(&added, list, record(k, 1), TEST_RECORD_SIZE));
+		CHECK(added);
+	}
+	check_records(list, want_even, 1);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_get_el(void) {
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.cmp = record_cmp;
+	opts.hash = record_hash;
+	test_get_el_with(&opts);
+	opts.index.enabled = true;
+	test_get_el_with(&opts);
+	// A small index has to grow while the elements are added.
+	opts.index.capacity = 16;
+	test_get_el_with(&opts);
+}
+
+static void
+test_set_ops_with(hopscotch_opts_t * opts) {
+	hopscotch_list_t * list_a = new_list(opts);
+	hopscotch_list_t * list_b = new_list(opts);
+	add_keys(list_a, 0, TEST_KEYS_COUNT, 2);
+	add_keys(list_b, 0, TEST_KEYS_COUNT, 3);
+	hopscotch_list_t * result = NULL;
+	CHECK_RES(hopscotch_list_union(&result, list_a, list_b));
+	check_keys(result, want_even_or_div3);
+	result = NULL;
+	CHECK_RES(hopscotch_list_intersection(&result, list_a, list_b));
+	check_keys(result, want_div6);
+	result = NULL;
+	CHECK_RES(hopscotch_list_difference(&result, list_a, list_b));
+	check_keys(result, want_even_not_div3);
+	// The results are new lists: the inputs are left alone, and can still be written to.
+	check_keys(list_a, want_even);
+	check_keys(list_b, want_div3);
+	bool added;
+	CHECK_RES(hopscotch_list_add_el(&added, result, key(1), sizeof(uint32_t)));
+	CHECK(added);
+	// Against an empty list.
+	hopscotch_list_t * empty = new_list(opts);
+	result = NULL;
+	CHECK_RES(hopscotch_list_union(&result, empty, list_b));
+	check_keys(result, want_div3);
+	result = NULL;
+	CHECK_RES(hopscotch_list_intersection(&result, list_a, empty));
+	check_keys(result, want_none);
+	// In-place merge.
+	size_t added_count;
+	CHECK_RES(hopscotch_list_merge(&added_count, list_a, list_b));
+	CHECK(added_count == ((size_t) ((TEST_KEYS_COUNT + 2) / 3) - (size_t) ((TEST_KEYS_COUNT + 5) / 6)));
+	check_keys(list_a, want_even_or_div3);
+	CHECK_RES(hopscotch_list_merge(&added_count, list_a, list_b));
+	CHECK(added_count == 0);
+}
+
+static void
+test_set_ops(void) {
+	test_set_ops_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.prefix_compression.enabled = true;
+	test_set_ops_with(&opts);
+}
+
+static void
+test_split_join_with(hopscotch_opts_t * opts) {
+	// At the first element, in the middle, between two elements, at the last element and past the end.
+	uint32_t split_ats[] = {0, TEST_KEYS_COUNT / 2, (TEST_KEYS_COUNT / 2) + 1, TEST_KEYS_COUNT - 2, TEST_KEYS_COUNT - 1};
+	hopscotch_list_t * list = new_list(opts);
+	add_keys(list, 0, TEST_KEYS_COUNT, 2);
+	size_t i;
+	for (i = 0; i < (sizeof(split_ats) / sizeof(split_ats[0])); i++) {
+		split_at = split_ats[i];
+		hopscotch_list_t * right_list = NULL;
+		CHECK_RES(hopscotch_list_split(&right_list, list, key(split_at), sizeof(uint32_t)));
+		check_keys(list, want_even_before_split);
+		check_keys(right_list, want_even_from_split);
+		CHECK_RES(hopscotch_list_join(list, right_list));
+		check_keys(list, want_even);
+		check_keys(right_list, want_none);
+		// Both halves are ordinary lists again: an element can go back into the emptied one, and be joined back once more.
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, right_list, key(TEST_KEYS_COUNT - 1), sizeof(uint32_t)));
+		CHECK(added);
+		CHECK_RES(hopscotch_list_join(list, right_list));
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(TEST_KEYS_COUNT - 1), sizeof(uint32_t)));
+		CHECK(deleted);
+		check_keys(list, want_even);
+	}
+}
+
+static void
+test_split_join(void) {
+	test_split_join_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.back_links.enabled = true;
+	opts.filter.capacity = (size_t) TEST_KEYS_COUNT;
+	opts.index.enabled = true;
+	test_split_join_with(&opts);
+}
+
+// What `test_parallel_for_each` counts its visits in.
+typedef struct {
+	size_t threads_count;
+	uint32_t visits[TEST_KEYS_COUNT];
+	// Fail once this many elements have been visited (`0` for never).
+	uint32_t fail_after;
+	uint32_t visited;
+} scan_ctx_t;
+
+static hopscotch_res_t
+scan_visit(void * ctx, size_t thread, hopscotch_byte_t * val, size_t val_size) {
+	scan_ctx_t * scan = (scan_ctx_t *) ctx;
+	CHECK((scan->threads_count == 0) || (thread < scan->threads_count));
+	__atomic_add_fetch(&(scan->visits[key_of(val, val_size)]), (uint32_t) 1, __ATOMIC_RELAXED);
+	uint32_t visited = __atomic_add_fetch(&(scan->visited), (uint32_t) 1, __ATOMIC_RELAXED);
+	if ((scan->fail_after > 0) && (visited >= scan->fail_after)) {
+		return HOPSCOTCH_RES_MEM_ALLOC_FAIL;
+	}
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+// Which keys the tests that add and delete as they go expect to be in their list.
+static bool present_keys[TEST_KEYS_COUNT];
+
+static bool
+want_present(uint32_t k) {
+	return present_keys[k];
+}
+
+static void
+add_present_keys(hopscotch_list_t * list, uint32_t from, uint32_t to, uint32_t step) {
+	add_keys(list, from, to, step);
+	uint32_t k;
+	for (k = from; k < to; k += step) {
+		present_keys[k] = true;
+	}
+}
+
+// Deletes `[lo, hi)` and checks the count and what's left.
+static void
+check_del_range(hopscotch_list_t * list, uint32_t lo, uint32_t hi) {
+	size_t expected_count = 0;
+	uint32_t k;
+	for (k = lo; k < hi; k++) {
+		if (present_keys[k]) {
+			present_keys[k] = false;
+			expected_count++;
+		}
+	}
+	size_t deleted_count = (size_t) -1;
+	CHECK_RES(hopscotch_list_del_range(&deleted_count, list, key(lo), sizeof(uint32_t), key(hi), sizeof(uint32_t)));
+	CHECK(deleted_count == expected_count);
+	check_keys(list, want_present);
+}
+
+static void
+test_del_range_with(hopscotch_opts_t * opts) {
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	hopscotch_list_t * list = new_list(opts);
+	check_del_range(list, 0, TEST_KEYS_COUNT - 1);
+	add_present_keys(list, 0, TEST_KEYS_COUNT, 2);
+	// Empty ranges: `lo` equal to `hi`, and `lo` past `hi`.
+	check_del_range(list, 100, 100);
+	check_del_range(list, 200, 100);
+	// Bounds that aren't in the list.
+	check_del_range(list, 101, 103);
+	check_del_range(list, 1001, 1999);
+	// Bounds that are, at the front and running past the last element.
+	check_del_range(list, 0, 10);
+	check_del_range(list, 4000, TEST_KEYS_COUNT - 1);
+	// The gaps fill up again, and then a range covers the whole list.
+	add_present_keys(list, 1002, 1999, 2);
+	add_present_keys(list, 1, TEST_KEYS_COUNT, 64);
+	check_del_range(list, 0, TEST_KEYS_COUNT - 1);
+	check_keys(list, want_none);
+	// The emptied list is an ordinary list again.
+	add_present_keys(list, 0, TEST_KEYS_COUNT, 3);
+	check_del_range(list, 1, TEST_KEYS_COUNT - 1);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_clear_with(hopscotch_opts_t * opts) {
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	hopscotch_list_t * list = new_list(opts);
+	CHECK_RES(hopscotch_list_clear(list));
+	check_keys(list, want_none);
+	add_present_keys(list, 0, TEST_KEYS_COUNT, 2);
+	CHECK_RES(hopscotch_list_clear(list));
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	check_keys(list, want_none);
+	// Nothing of the old elements (or where they ended) is left behind, so smaller and bigger elements go back in the same way.
+	add_present_keys(list, 1, TEST_KEYS_COUNT, 2);
+	check_keys(list, want_present);
+	CHECK_RES(hopscotch_list_clear(list));
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	add_present_keys(list, 0, TEST_KEYS_COUNT / 2, 1);
+	add_present_keys(list, TEST_KEYS_COUNT / 2, TEST_KEYS_COUNT, 3);
+	check_keys(list, want_present);
+	check_del_range(list, 10, TEST_KEYS_COUNT / 2);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_del_range(void) {
+	test_del_range_with(NULL);
+	test_clear_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.filter.capacity = (size_t) TEST_KEYS_COUNT;
+	opts.index.enabled = true;
+	test_del_range_with(&opts);
+	test_clear_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.back_links.enabled = true;
+	test_del_range_with(&opts);
+	test_clear_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.small.capacity = 64;
+	test_del_range_with(&opts);
+	test_clear_with(&opts);
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.append.enabled = true;
+	test_del_range_with(&opts);
+	test_clear_with(&opts);
+}
+
+// The same as `check_keys`, walking the list backwards from its end.
+static void
+check_keys_backwards(hopscotch_list_t * list, bool (* want)(uint32_t)) {
+	uint32_t expected = TEST_KEYS_COUNT;
+	hopscotch_node_t * node = NULL;
+	CHECK_RES(hopscotch_list_prev_el(&node, list, NULL));
+	for (; node != NULL; ) {
+		hopscotch_byte_t * val;
+		size_t val_size;
+		CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+		uint32_t k = key_of(val, val_size);
+		while ((expected > (k + 1)) && (! want(expected - 1))) {
+			expected--;
+		}
+		CHECK(expected == (k + 1));
+		expected--;
+		CHECK_RES(hopscotch_list_prev_el(&node, list, node));
+	}
+	while (expected > 0) {
+		CHECK(! want(expected - 1));
+		expected--;
+	}
+}
+
+// Checks that `node` holds `key(k)`, or is `NULL` for `k == TEST_KEYS_COUNT`.
+static void
+check_node_key(hopscotch_list_t * list, hopscotch_node_t * node, uint32_t k) {
+	if (k == TEST_KEYS_COUNT) {
+		CHECK(node == NULL);
+		return;
+	}
+	CHECK(node != NULL);
+	hopscotch_byte_t * val;
+	size_t val_size;
+	CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+	CHECK(key_of(val, val_size) == k);
+}
+
+// Checks `hopscotch_list_floor_el` and `hopscotch_list_ceiling_el` for every key.
+static void
+check_floor_ceiling(hopscotch_list_t * list, bool (* want)(uint32_t)) {
+	static uint32_t floor_keys[TEST_KEYS_COUNT];
+	uint32_t floor_key = TEST_KEYS_COUNT;
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		if (want(k)) {
+			floor_key = k;
+		}
+		floor_keys[k] = floor_key;
+	}
+	uint32_t ceiling_key = TEST_KEYS_COUNT;
+	for (k = TEST_KEYS_COUNT; k > 0; k--) {
+		if (want(k - 1)) {
+			ceiling_key = k - 1;
+		}
+		hopscotch_node_t * node = NULL;
+		CHECK_RES(hopscotch_list_floor_el(&node, list, key(k - 1), sizeof(uint32_t)));
+		check_node_key(list, node, floor_keys[k - 1]);
+		CHECK_RES(hopscotch_list_ceiling_el(&node, list, key(k - 1), sizeof(uint32_t)));
+		check_node_key(list, node, ceiling_key);
+	}
+}
+
+static void
+test_prev_next_with(hopscotch_opts_t * opts) {
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	hopscotch_list_t * list = new_list(opts);
+	check_keys_backwards(list, want_none);
+	check_floor_ceiling(list, want_none);
+	add_present_keys(list, 0, TEST_KEYS_COUNT, 1);
+	check_keys_backwards(list, want_present);
+	// Deletes (and some adds) spread over the list, in rounds, so that many back links go stale between the scans.
+	uint32_t r;
+	for (r = 0; r < 5; r++) {
+		uint32_t k;
+		for (k = r; k < TEST_KEYS_COUNT; k += 7) {
+			bool deleted;
+			CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+			CHECK(deleted);
+			present_keys[k] = false;
+		}
+		if ((r % 2) == 1) {
+			add_present_keys(list, r - 1, TEST_KEYS_COUNT, 14);
+		}
+		check_keys_backwards(list, want_present);
+		check_keys(list, want_present);
+		check_floor_ceiling(list, want_present);
+	}
+	// Range deletes unlink whole runs, and the back links past them have to be repaired too.
+	check_del_range(list, 1000, 2000);
+	check_del_range(list, 3001, 3003);
+	check_keys_backwards(list, want_present);
+	// A node that's been deleted still steps to its old neighbours that are left.
+	uint32_t ks[] = {0, 5, 6, 2047, TEST_KEYS_COUNT - 1};
+	size_t i;
+	for (i = 0; i < (sizeof(ks) / sizeof(ks[0])); i++) {
+		hopscotch_node_t * node = NULL;
+		CHECK_RES(hopscotch_list_floor_el(&node, list, key(ks[i]), sizeof(uint32_t)));
+		CHECK(node != NULL);
+		hopscotch_byte_t * val;
+		size_t val_size;
+		CHECK_RES(hopscotch_list_el_val(&val, &val_size, list, node));
+		uint32_t k = key_of(val, val_size);
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted);
+		present_keys[k] = false;
+		uint32_t prev_key = TEST_KEYS_COUNT;
+		uint32_t j;
+		for (j = k; j > 0; j--) {
+			if (present_keys[j - 1]) {
+				prev_key = j - 1;
+				break;
+			}
+		}
+		uint32_t next_key = TEST_KEYS_COUNT;
+		for (j = k + 1; j < TEST_KEYS_COUNT; j++) {
+			if (present_keys[j]) {
+				next_key = j;
+				break;
+			}
+		}
+		hopscotch_node_t * other_node = NULL;
+		CHECK_RES(hopscotch_list_prev_el(&other_node, list, node));
+		check_node_key(list, other_node, prev_key);
+		CHECK_RES(hopscotch_list_next_el(&other_node, list, node));
+		check_node_key(list, other_node, next_key);
+	}
+	check_keys_backwards(list, want_present);
+	check_keys(list, want_present);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_prev_next(void) {
+	test_prev_next_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.back_links.enabled = true;
+	test_prev_next_with(&opts);
+}
+
+static void
+del_present_keys(hopscotch_list_t * list, uint32_t from, uint32_t to, uint32_t step) {
+	uint32_t k;
+	for (k = from; k < to; k += step) {
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted == present_keys[k]);
+		present_keys[k] = false;
+	}
+}
+
+static void
+test_append_with(hopscotch_opts_t * opts) {
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	hopscotch_list_t * list = new_list(opts);
+	// In order, then into the gaps behind the tail, then in order again.
+	add_present_keys(list, 0, 1024, 2);
+	add_present_keys(list, 1, 1024, 2);
+	add_present_keys(list, 1024, 2048, 1);
+	check_keys(list, want_present);
+	// Deleting the tail has the next appends go after the new last element, even when they're smaller than the deleted one.
+	del_present_keys(list, 1900, 2048, 1);
+	add_present_keys(list, 1950, 2000, 1);
+	del_present_keys(list, 1999, 2000, 1);
+	add_present_keys(list, 1900, 1950, 7);
+	add_present_keys(list, 2000, 2100, 1);
+	check_keys(list, want_present);
+	// Nothing is left of the old tail after a clear.
+	CHECK_RES(hopscotch_list_clear(list));
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	check_keys(list, want_none);
+	add_present_keys(list, 100, 200, 1);
+	add_present_keys(list, 0, 100, 3);
+	add_present_keys(list, 200, 2048, 2);
+	check_keys(list, want_present);
+	// Each half of a split has its own tail, and the joined list has the right half's.
+	hopscotch_list_t * right_list = NULL;
+	CHECK_RES(hopscotch_list_split(&right_list, list, key(1024), sizeof(uint32_t)));
+	add_present_keys(list, 1025, 1100, 2);
+	del_present_keys(list, 1025, 1100, 2);
+	uint32_t k;
+	for (k = 2048; k < 2100; k++) {
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, right_list, key(k), sizeof(uint32_t)));
+		CHECK(added);
+		present_keys[k] = true;
+	}
+	CHECK_RES(hopscotch_list_join(list, right_list));
+	check_keys(list, want_present);
+	check_keys(right_list, want_none);
+	add_present_keys(list, 2100, TEST_KEYS_COUNT, 1);
+	check_keys(list, want_present);
+	// The emptied right half appends from scratch.
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	add_present_keys(right_list, 0, TEST_KEYS_COUNT, 5);
+	check_keys(right_list, want_present);
+	CHECK_RES(hopscotch_list_free(right_list));
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_append(void) {
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.append.enabled = true;
+	test_append_with(&opts);
+	opts.back_links.enabled = true;
+	opts.filter.capacity = (size_t) TEST_KEYS_COUNT;
+	opts.index.enabled = true;
+	test_append_with(&opts);
+}
+
+// The shared keys every combining thread adds and dels, and the keys each thread has to itself start after them.
+#define TEST_COMBINING_SHARED_KEYS 16
+#define TEST_COMBINING_THREADS 8
+
+typedef struct {
+	hopscotch_list_t * list;
+	uint32_t thread;
+	// How many of this thread's adds and dels of each shared key went through.
+	uint32_t shared_added[TEST_COMBINING_SHARED_KEYS];
+	uint32_t shared_deleted[TEST_COMBINING_SHARED_KEYS];
+} combining_ctx_t;
+
+static void *
+combining_thread(void * arg) {
+	combining_ctx_t * ctx = (combining_ctx_t *) arg;
+	uint32_t k;
+	for (k = TEST_COMBINING_SHARED_KEYS + ctx->thread; k < TEST_KEYS_COUNT; k += TEST_COMBINING_THREADS) {
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, ctx->list, key(k), sizeof(uint32_t)));
+		CHECK(added);
+		uint32_t shared_k = (k * 7) % TEST_COMBINING_SHARED_KEYS;
+		bool done;
+		if (((k / TEST_COMBINING_THREADS) % 2) == 0) {
+			CHECK_RES(hopscotch_list_add_el(&done, ctx->list, key(shared_k), sizeof(uint32_t)));
+			ctx->shared_added[shared_k] += (uint32_t) done;
+		} else {
+			CHECK_RES(hopscotch_list_del_el(&done, ctx->list, key(shared_k), sizeof(uint32_t)));
+			ctx->shared_deleted[shared_k] += (uint32_t) done;
+		}
+	}
+	for (k = TEST_COMBINING_SHARED_KEYS + ctx->thread; k < TEST_KEYS_COUNT; k += TEST_COMBINING_THREADS) {
+		if ((k % 3) == 0) {
+			bool deleted;
+			CHECK_RES(hopscotch_list_del_el(&deleted, ctx->list, key(k), sizeof(uint32_t)));
+			CHECK(deleted);
+		}
+	}
+	return NULL;
+}
+
+// Posts an op to slot `idx` by hand, the way `hopscotch_list_add_el` / `hopscotch_list_del_el` would.
+static void
+post_combining_op(hopscotch_list_t * list, uint32_t idx, bool del, uint32_t k) {
+	hopscotch_combining_slot_t * slot = &(list->combining->slots[idx]);
+	CHECK(atomic_load(&(slot->state)) == HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE);
+	slot->del = del;
+	slot->val = key(k);
+	slot->val_size = sizeof(uint32_t);
+	if (atomic_load(&(list->combining->slots_used)) < (idx + 1)) {
+		atomic_store(&(list->combining->slots_used), idx + 1);
+	}
+	atomic_store(&(slot->state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_PENDING);
+}
+
+static void
+test_combining(void) {
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.combining.enabled = true;
+	hopscotch_list_t * list = new_list(&opts);
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	add_present_keys(list, 20, 40, 10);
+	// Ops posted out of order (and several to the same element) are applied as one sorted batch by the next writer, in slot order for the same element.
+	struct {
+		bool del;
+		uint32_t k;
+		bool done;
+	} ops[] = {
+		{false, 10, true},
+		{true, 10, true},
+		{false, 10, true},
+		{true, 7, false},
+		{false, 3, true},
+		{false, 3, false},
+		{true, 20, true},
+		{false, 20, true},
 	};
-	list_opts.gc.malloc = NULL;
-	hopscotch_list_new(&list, &list_opts);
-	bool a;
-	hopscotch_list_add_el(
-		&a,
-		list,
-		(hopscotch_byte *) ("hello"),
-		(size_t) 6
-	);
-	bool b;
-	hopscotch_list_add_el(
-		&b,
-		list,
-		(hopscotch_byte *) ("hola"),
-		(size_t) 5
-	);
-	bool c;
-	hopscotch_list_contains_el(
-		&c,
-		list,
-		(hopscotch_byte *) ("homie"),
-		(size_t) 6
-	);
-	if (c) {
-		printf("\"homie\" found!\n");
-	}
-	bool d;
-	hopscotch_list_contains_el(
-		&d,
-		list,
-		(hopscotch_byte *) ("hello"),
-		(size_t) 6
-	);
-	if (d) {
-		printf("\"hello\" found!\n");
-	}
-	bool e;
-	hopscotch_list_contains_el(
-		&e,
-		list,
-		(hopscotch_byte *) ("hola"),
-		(size_t) 5
-	);
-	if (e) {
-		printf("\"hola\" found!\n");
-	}
-	bool f;
-	hopscotch_list_del_el(
-		&f,
-		list,
-		(hopscotch_byte *) ("hola"),
-		(size_t) 5
-	);
-	bool g;
-	hopscotch_list_contains_el(
-		&g,
-		list,
-		(hopscotch_byte *) ("hola"),
-		(size_t) 5
-	);
-	if (g) {
-		printf("\"hola\" found!\n");
+	uint32_t ops_count = (uint32_t) (sizeof(ops) / sizeof(ops[0]));
+	uint32_t i;
+	for (i = 0; i < ops_count; i++) {
+		post_combining_op(list, i, ops[i].del, ops[i].k);
+	}
+	add_present_keys(list, 40, 41, 1);
+	for (i = 0; i < ops_count; i++) {
+		hopscotch_combining_slot_t * slot = &(list->combining->slots[i]);
+		CHECK(atomic_load(&(slot->state)) == HOPSCOTCH_VAL_LIST_COMBINING_SLOT_DONE);
+		CHECK_RES(slot->res);
+		CHECK(slot->done == ops[i].done);
+		atomic_store(&(slot->state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE);
+	}
+	present_keys[3] = true;
+	present_keys[10] = true;
+	check_keys(list, want_present);
+	// With every slot taken, the ops are applied directly.
+	for (i = 0; i < ((uint32_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS); i++) {
+		atomic_store(&(list->combining->slots[i].state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_CLAIMED);
+	}
+	add_present_keys(list, 41, 100, 2);
+	del_present_keys(list, 0, 100, 3);
+	check_keys(list, want_present);
+	for (i = 0; i < ((uint32_t) HOPSCOTCH_VAL_LIST_COMBINING_SLOTS); i++) {
+		atomic_store(&(list->combining->slots[i].state), HOPSCOTCH_VAL_LIST_COMBINING_SLOT_FREE);
+	}
+	CHECK_RES(hopscotch_list_clear(list));
+	// Threads adding and deleting their own keys (which always goes through), and racing each other on the shared ones.
+	static combining_ctx_t ctxs[TEST_COMBINING_THREADS];
+	pthread_t threads[TEST_COMBINING_THREADS];
+	memset((void *) ctxs, 0, sizeof(ctxs));
+	for (i = 0; i < TEST_COMBINING_THREADS; i++) {
+		ctxs[i].list = list;
+		ctxs[i].thread = i;
+		CHECK(pthread_create(&(threads[i]), NULL, combining_thread, (void *) &(ctxs[i])) == 0);
+	}
+	for (i = 0; i < TEST_COMBINING_THREADS; i++) {
+		CHECK(pthread_join(threads[i], NULL) == 0);
+	}
+	memset((void *) present_keys, 0, sizeof(present_keys));
+	uint32_t k;
+	for (k = 0; k < TEST_COMBINING_SHARED_KEYS; k++) {
+		uint32_t added = 0;
+		uint32_t deleted = 0;
+		for (i = 0; i < TEST_COMBINING_THREADS; i++) {
+			added += ctxs[i].shared_added[k];
+			deleted += ctxs[i].shared_deleted[k];
+		}
+		// Adds and dels of the same element alternate, whatever order they went in.
+		CHECK((added == deleted) || (added == (deleted + 1)));
+		present_keys[k] = (bool) (added > deleted);
+	}
+	for (k = TEST_COMBINING_SHARED_KEYS; k < TEST_KEYS_COUNT; k++) {
+		present_keys[k] = (bool) ((k % 3) != 0);
+	}
+	check_keys(list, want_present);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_parallel_for_each_with(hopscotch_opts_t * opts) {
+	// `0` is one thread per online CPU.
+	size_t threads_counts[] = {0, 1, 2, 3, 4, 8};
+	// Empty, a single element, fewer elements than segments, and enough for every thread to steal.
+	uint32_t steps[] = {0, TEST_KEYS_COUNT, 128, 2};
+	static scan_ctx_t scan;
+	size_t i;
+	for (i = 0; i < (sizeof(steps) / sizeof(steps[0])); i++) {
+		hopscotch_list_t * list = new_list(opts);
+		if (steps[i] > 0) {
+			add_keys(list, 0, TEST_KEYS_COUNT, steps[i]);
+		}
+		size_t j;
+		for (j = 0; j < (sizeof(threads_counts) / sizeof(threads_counts[0])); j++) {
+			memset((void *) &scan, 0, sizeof(scan));
+			scan.threads_count = threads_counts[j];
+			CHECK_RES(hopscotch_list_parallel_for_each(list, threads_counts[j], scan_visit, (void *) &scan));
+			// Every element exactly once, and nothing else.
+			uint32_t k;
+			for (k = 0; k < TEST_KEYS_COUNT; k++) {
+				CHECK(scan.visits[k] == (uint32_t) (((steps[i] > 0) && ((k % steps[i]) == 0)) ? 1 : 0));
+			}
+		}
+		CHECK_RES(hopscotch_list_free(list));
+	}
+	// A failing `fn` stops the scan, and its result is returned.
+	hopscotch_list_t * list = new_list(opts);
+	add_keys(list, 0, TEST_KEYS_COUNT, 1);
+	memset((void *) &scan, 0, sizeof(scan));
+	scan.threads_count = 4;
+	scan.fail_after = 100;
+	CHECK(hopscotch_list_parallel_for_each(list, 4, scan_visit, (void *) &scan) == HOPSCOTCH_RES_MEM_ALLOC_FAIL);
+	CHECK(scan.visited < TEST_KEYS_COUNT);
+	CHECK_RES(hopscotch_list_free(list));
+}
+
+static void
+test_parallel_for_each(void) {
+	test_parallel_for_each_with(NULL);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.prefix_compression.enabled = true;
+	test_parallel_for_each_with(&opts);
+}
+
+static void
+test_snapshots(void) {
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.versions.enabled = true;
+	hopscotch_list_t * list = new_list(&opts);
+	add_keys(list, 0, TEST_KEYS_COUNT, 2);
+	hopscotch_snapshot_t * old_snapshot = NULL;
+	CHECK_RES(hopscotch_list_snapshot(&old_snapshot, list));
+	// Writes after a snapshot is taken don't show up in it.
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k += 6) {
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted);
+	}
+	add_keys(list, 3, TEST_KEYS_COUNT, 6);
+	check_keys(list, want_even_xor_div3);
+	check_snapshot_keys(list, old_snapshot, want_even);
+	hopscotch_snapshot_t * new_snapshot = NULL;
+	CHECK_RES(hopscotch_list_snapshot(&new_snapshot, list));
+	// Elements deleted under a snapshot can be added back, and each snapshot still sees just its own version of them.
+	add_keys(list, 0, TEST_KEYS_COUNT, 6);
+	check_keys(list, want_even_or_div3);
+	check_snapshot_keys(list, old_snapshot, want_even);
+	check_snapshot_keys(list, new_snapshot, want_even_xor_div3);
+	// Releasing the oldest snapshot reclaims what only it could see, and leaves the newer one alone.
+	CHECK_RES(hopscotch_list_snapshot_release(old_snapshot));
+	check_snapshot_keys(list, new_snapshot, want_even_xor_div3);
+	for (k = 1; k < TEST_KEYS_COUNT; k += 6) {
+		bool added;
+		CHECK_RES(hopscotch_list_add_el(&added, list, key(k), sizeof(uint32_t)));
+		CHECK(added);
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted);
+	}
+	check_snapshot_keys(list, new_snapshot, want_even_xor_div3);
+	CHECK_RES(hopscotch_list_snapshot_release(new_snapshot));
+	check_keys(list, want_even_or_div3);
+	CHECK_RES(hopscotch_list_free(list));
+	// Only versioned lists have snapshots.
+	hopscotch_list_t * plain_list = new_list(NULL);
+	hopscotch_snapshot_t * snapshot = NULL;
+	CHECK(hopscotch_list_snapshot(&snapshot, plain_list) == HOPSCOTCH_RES_LIST_VERSIONS_DISABLED);
+	CHECK_RES(hopscotch_list_free(plain_list));
+}
+
+// Like `check_keys`, for a frozen list (which also has to find the ceiling of every key).
+static void
+check_frozen_keys(hopscotch_frozen_t * frozen, bool (* want)(uint32_t)) {
+	size_t rank = 0;
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		bool found;
+		CHECK_RES(hopscotch_frozen_contains_el(&found, frozen, key(k), sizeof(uint32_t)));
+		CHECK(found == want(k));
+		// The ranks go through the wanted keys in order, and the ceiling of a key is the next one that's wanted.
+		size_t ceiling;
+		CHECK_RES(hopscotch_frozen_ceiling_el(&ceiling, frozen, key(k), sizeof(uint32_t)));
+		CHECK(ceiling == rank);
+		if (found) {
+			hopscotch_byte_t * val;
+			size_t val_size;
+			CHECK_RES(hopscotch_frozen_el(&val, &val_size, frozen, rank));
+			CHECK(val != NULL);
+			CHECK(key_of(val, val_size) == k);
+			rank++;
+		}
+	}
+	CHECK(frozen->count == rank);
+	hopscotch_byte_t * val;
+	size_t val_size;
+	CHECK_RES(hopscotch_frozen_el(&val, &val_size, frozen, rank));
+	CHECK(val == NULL);
+}
+
+// The reverse of the default order, for a list with a `cmp` of its own.
+static hopscotch_res_t
+reverse_cmp(int * res, hopscotch_byte_t * val_1, size_t val_1_size, hopscotch_byte_t * val_2, size_t val_2_size) {
+	if (cmp_sentinel(res, val_1, val_1_size)) {
+		// Success!
+		return HOPSCOTCH_RES__SUCCESS;
+	}
+	uint32_t k_1 = key_of(val_1, val_1_size);
+	uint32_t k_2 = key_of(val_2, val_2_size);
+	res[0] = (k_1 > k_2) ? -1 : ((k_1 < k_2) ? 1 : 0);
+	// Success!
+	return HOPSCOTCH_RES__SUCCESS;
+}
+
+static void
+test_frozen_with(hopscotch_opts_t * opts, const char * path) {
+	uint32_t steps[] = {0, 1, 2, 3};
+	size_t i;
+	for (i = 0; i < (sizeof(steps) / sizeof(steps[0])); i++) {
+		bool (* want)(uint32_t) = (steps[i] == 0) ? want_none : ((steps[i] == 2) ? want_even : ((steps[i] == 3) ? want_div3 : want_all));
+		hopscotch_list_t * list = new_list(opts);
+		if (steps[i] > 0) {
+			add_keys(list, 0, TEST_KEYS_COUNT, steps[i]);
+		}
+		hopscotch_frozen_t * frozen = NULL;
+		CHECK_RES(hopscotch_list_freeze(&frozen, list));
+		// The frozen list is a copy, which the list's writes don't touch.
+		if (steps[i] > 1) {
+			add_keys(list, 1, TEST_KEYS_COUNT, steps[i]);
+		}
+		check_frozen_keys(frozen, want);
+		CHECK_RES(hopscotch_frozen_save(frozen, path));
+		CHECK_RES(hopscotch_frozen_free(frozen));
+		hopscotch_opts_t open_opts;
+		memset((void *) &open_opts, 0, sizeof(open_opts));
+		frozen = NULL;
+		CHECK_RES(hopscotch_frozen_open(&frozen, path, &open_opts));
+		check_frozen_keys(frozen, want);
+		CHECK_RES(hopscotch_frozen_free(frozen));
+		CHECK_RES(hopscotch_list_free(list));
+	}
+}
+
+static void
+test_frozen(void) {
+	char dir[64];
+	new_tmp_dir(dir, sizeof(dir));
+	char path[128];
+	CHECK(snprintf(path, sizeof(path), "%s/list.frozen", dir) < ((int) sizeof(path)));
+	test_frozen_with(NULL, path);
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.prefix_compression.enabled = true;
+	test_frozen_with(&opts, path);
+	// Saving writes a temporary file, and renames it.
+	CHECK(count_files(dir, ".tmp") == 0);
+	CHECK(count_files(dir, ".frozen") == 1);
+	// A list with a `cmp` of its own has to be opened with the same `cmp`.
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.cmp = reverse_cmp;
+	hopscotch_list_t * list = new_list(&opts);
+	add_keys(list, 0, TEST_KEYS_COUNT, 2);
+	hopscotch_frozen_t * frozen = NULL;
+	CHECK_RES(hopscotch_list_freeze(&frozen, list));
+	CHECK_RES(hopscotch_frozen_save(frozen, path));
+	CHECK_RES(hopscotch_frozen_free(frozen));
+	hopscotch_opts_t open_opts;
+	memset((void *) &open_opts, 0, sizeof(open_opts));
+	frozen = NULL;
+	CHECK(hopscotch_frozen_open(&frozen, path, &open_opts) == HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS);
+	open_opts.cmp = reverse_cmp;
+	frozen = NULL;
+	CHECK_RES(hopscotch_frozen_open(&frozen, path, &open_opts));
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		bool found;
+		CHECK_RES(hopscotch_frozen_contains_el(&found, frozen, key(k), sizeof(uint32_t)));
+		CHECK(found == want_even(k));
+	}
+	hopscotch_byte_t * val;
+	size_t val_size;
+	CHECK_RES(hopscotch_frozen_el(&val, &val_size, frozen, (size_t) 0));
+	CHECK(key_of(val, val_size) == (TEST_KEYS_COUNT - 2));
+	CHECK_RES(hopscotch_frozen_free(frozen));
+	CHECK_RES(hopscotch_list_free(list));
+	// Neither is a file that was cut short, or one that isn't a frozen list at all.
+	struct stat path_stat;
+	CHECK(stat(path, &path_stat) == 0);
+	CHECK(truncate(path, path_stat.st_size / 2) == 0);
+	frozen = NULL;
+	CHECK(hopscotch_frozen_open(&frozen, path, &open_opts) == HOPSCOTCH_RES_FROZEN_INVALID);
+	FILE * file = fopen(path, "wb");
+	CHECK(file != NULL);
+	CHECK(fwrite("hopscotch", (size_t) 1, (size_t) 9, file) == 9);
+	CHECK(fclose(file) == 0);
+	frozen = NULL;
+	CHECK(hopscotch_frozen_open(&frozen, path, &open_opts) == HOPSCOTCH_RES_FROZEN_INVALID);
+	remove_tmp_dir(dir);
+}
+
+// Like `check_keys`, for a store (which has no iterator).
+static void
+check_lsm_keys(hopscotch_lsm_t * lsm, bool (* want)(uint32_t)) {
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		bool found;
+		CHECK_RES(hopscotch_lsm_contains_el(&found, lsm, key(k), sizeof(uint32_t)));
+		CHECK(found == want(k));
+	}
+}
+
+static hopscotch_lsm_t *
+open_lsm(const char * path) {
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	// Small enough for every few hundred writes to make a run, with a few blocks each.
+	opts.lsm.memtable_size = 16384;
+	opts.lsm.block_size = 256;
+	hopscotch_lsm_t * lsm = NULL;
+	CHECK_RES(hopscotch_lsm_open(&lsm, path, &opts));
+	return lsm;
+}
+
+static void
+test_lsm(void) {
+	char path[64];
+	new_tmp_dir(path, sizeof(path));
+	hopscotch_lsm_t * lsm = open_lsm(path);
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k += 2) {
+		CHECK_RES(hopscotch_lsm_add_el(lsm, key(k), sizeof(uint32_t)));
+	}
+	// The tombstones go to newer runs than the elements they hide.
+	for (k = 0; k < TEST_KEYS_COUNT; k += 6) {
+		CHECK_RES(hopscotch_lsm_del_el(lsm, key(k), sizeof(uint32_t)));
+	}
+	check_lsm_keys(lsm, want_even_not_div3);
+	CHECK_RES(hopscotch_lsm_close(lsm));
+	CHECK(count_files(path, ".run") > 1);
+	// Everything was flushed on close, and comes back from the runs.
+	lsm = open_lsm(path);
+	check_lsm_keys(lsm, want_even_not_div3);
+	// A full compaction leaves one run, without the tombstones, and the same elements.
+	CHECK_RES(hopscotch_lsm_compact(lsm));
+	CHECK(count_files(path, ".run") == 1);
+	check_lsm_keys(lsm, want_even_not_div3);
+	// Deleted elements can come back, over tombstones that are gone as well as ones that are still in runs.
+	for (k = 0; k < TEST_KEYS_COUNT; k += 3) {
+		if ((k % 6) != 0) {
+			CHECK_RES(hopscotch_lsm_add_el(lsm, key(k), sizeof(uint32_t)));
+		}
+	}
+	for (k = 6; k < TEST_KEYS_COUNT; k += 12) {
+		CHECK_RES(hopscotch_lsm_del_el(lsm, key(k), sizeof(uint32_t)));
+	}
+	for (k = 0; k < TEST_KEYS_COUNT; k += 12) {
+		CHECK_RES(hopscotch_lsm_add_el(lsm, key(k), sizeof(uint32_t)));
+	}
+	CHECK_RES(hopscotch_lsm_flush(lsm));
+	for (k = 6; k < TEST_KEYS_COUNT; k += 12) {
+		CHECK_RES(hopscotch_lsm_add_el(lsm, key(k), sizeof(uint32_t)));
+	}
+	check_lsm_keys(lsm, want_even_or_div3);
+	CHECK_RES(hopscotch_lsm_close(lsm));
+	lsm = open_lsm(path);
+	check_lsm_keys(lsm, want_even_or_div3);
+	CHECK_RES(hopscotch_lsm_compact(lsm));
+	CHECK(count_files(path, ".run") == 1);
+	check_lsm_keys(lsm, want_even_or_div3);
+	CHECK_RES(hopscotch_lsm_close(lsm));
+	lsm = open_lsm(path);
+	check_lsm_keys(lsm, want_even_or_div3);
+	CHECK_RES(hopscotch_lsm_close(lsm));
+	// Stores keep the default order.
+	hopscotch_opts_t opts;
+	memset((void *) &opts, 0, sizeof(opts));
+	opts.index.enabled = true;
+	lsm = NULL;
+	CHECK(hopscotch_lsm_open(&lsm, path, &opts) == HOPSCOTCH_RES_LIST_NEW_INVALID_OPTS);
+	remove_tmp_dir(path);
+}
+
+static void
+test_shm(void) {
+	const char * name = "/hopscotch-test";
+	// Left over from an earlier run that didn't get to unlink it, maybe.
+	hopscotch_list_shm_unlink(name);
+	hopscotch_opts_t * opts = (hopscotch_opts_t *) calloc((size_t) 1, sizeof(hopscotch_opts_t));
+	CHECK(opts != NULL);
+	hopscotch_list_t * list = NULL;
+	CHECK_RES(hopscotch_list_shm_open(&list, opts, name, (size_t) 65536));
+	size_t used;
+	size_t size;
+	CHECK_RES(hopscotch_list_shm_usage(&used, &size, list));
+	CHECK(size == (size_t) 65536);
+	CHECK((used > 0) && (used < size));
+	// Fill the segment up: every add takes some of it, until one doesn't fit, which leaves the list as it was.
+	uint32_t added_count = 0;
+	while (true) {
+		CHECK(added_count < TEST_KEYS_COUNT);
+		size_t used_before = used;
+		bool added;
+		hopscotch_res_t res = hopscotch_list_add_el(&added, list, key(added_count), sizeof(uint32_t));
+		CHECK_RES(hopscotch_list_shm_usage(&used, &size, list));
+		CHECK(used <= size);
+		if (res == HOPSCOTCH_RES_MEM_ALLOC_FAIL) {
+			break;
+		}
+		CHECK_RES(res);
+		CHECK(added);
+		CHECK(used > used_before);
+		added_count++;
+	}
+	CHECK(added_count > 0);
+	uint32_t k;
+	for (k = 0; k <= added_count; k++) {
+		bool found;
+		CHECK_RES(hopscotch_list_contains_el(&found, list, key(k), sizeof(uint32_t)));
+		CHECK(found == (k < added_count));
+	}
+	// Deletes don't give any space back.
+	size_t used_full = used;
+	for (k = 0; k < added_count; k += 2) {
+		bool deleted;
+		CHECK_RES(hopscotch_list_del_el(&deleted, list, key(k), sizeof(uint32_t)));
+		CHECK(deleted);
+	}
+	CHECK_RES(hopscotch_list_shm_usage(&used, &size, list));
+	CHECK(used == used_full);
+	for (k = 0; k < added_count; k++) {
+		bool found;
+		CHECK_RES(hopscotch_list_contains_el(&found, list, key(k), sizeof(uint32_t)));
+		CHECK(found == ((k % 2) == 1));
+	}
+	CHECK_RES(hopscotch_list_free(list));
+	CHECK_RES(hopscotch_list_shm_unlink(name));
+	// Only lists in shared memory have a segment.
+	hopscotch_list_t * heap_list = new_list(NULL);
+	CHECK(hopscotch_list_shm_usage(&used, &size, heap_list) == HOPSCOTCH_RES_LIST_SHM_DISABLED);
+}
+
+int
+main(void) {
+	uint32_t k;
+	for (k = 0; k < TEST_KEYS_COUNT; k++) {
+		hopscotch_byte_t * val = key(k);
+		val[0] = (hopscotch_byte_t) (k >> 24);
+		val[1] = (hopscotch_byte_t) (k >> 16);
+		val[2] = (hopscotch_byte_t) (k >> 8);
+		val[3] = (hopscotch_byte_t) k;
 	}
-	hopscotch_list_free(list);
+	test_basic();
+	test_contains_batch();
+	test_get_el();
+	test_set_ops();
+	test_split_join();
+	test_del_range();
+	test_prev_next();
+	test_append();
+	test_combining();
+	test_parallel_for_each();
+	test_snapshots();
+	test_frozen();
+	test_lsm();
+	test_shm();
+	printf("All tests passed!\n");
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,300 @@
+/**
+ * The MIT License (MIT).
+ *
+ * https://github.com/jonathanmarvens/hopscotch
+ *
+ * Copyright (c) 2014 Jonathan Barronville (jonathan@scrapum.photos) and contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <hopscotch/hopscotch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The C++ front-end (`hopscotch.hpp`) on its own: it's header-only, so this doesn't link against the C library.
+
+namespace {
+
+// Stops the tests at the first check that doesn't hold.
+#define CHECK(cond) \
+	do { \
+		if (! (cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+const int test_keys_count = 1000;
+
+// Orders `std::string`s, and compares them with C strings without making a `std::string` out of them.
+struct string_less {
+	typedef void is_transparent;
+
+	bool
+	operator()(const std::string & a, const std::string & b) const {
+		return a < b;
+	}
+
+	bool
+	operator()(const std::string & a, const char * b) const {
+		return std::strcmp(a.c_str(), b) < 0;
+	}
+
+	bool
+	operator()(const char * a, const std::string & b) const {
+		return std::strcmp(a, b.c_str()) < 0;
+	}
+};
+
+// Orders move-only keys by what they point at, and looks them up by an `int`.
+struct ptr_less {
+	typedef void is_transparent;
+
+	bool
+	operator()(const std::unique_ptr<int> & a, const std::unique_ptr<int> & b) const {
+		return *a < *b;
+	}
+
+	bool
+	operator()(const std::unique_ptr<int> & a, int b) const {
+		return *a < b;
+	}
+
+	bool
+	operator()(int a, const std::unique_ptr<int> & b) const {
+		return a < *b;
+	}
+};
+
+// How many objects the `counting_allocator`s have handed out and not gotten back yet.
+std::atomic<long> live_allocs(0);
+
+template <typename T>
+struct counting_allocator {
+	typedef T value_type;
+
+	counting_allocator() {}
+
+	template <typename U>
+	counting_allocator(const counting_allocator<U> &) {}
+
+	T *
+	allocate(std::size_t n) {
+		live_allocs.fetch_add(1, std::memory_order_relaxed);
+		return std::allocator<T>().allocate(n);
+	}
+
+	void
+	deallocate(T * p, std::size_t n) {
+		live_allocs.fetch_sub(1, std::memory_order_relaxed);
+		std::allocator<T>().deallocate(p, n);
+	}
+};
+
+template <typename T, typename U>
+bool
+operator==(const counting_allocator<T> &, const counting_allocator<U> &) {
+	return true;
+}
+
+template <typename T, typename U>
+bool
+operator!=(const counting_allocator<T> &, const counting_allocator<U> &) {
+	return false;
+}
+
+typedef hopscotch::concurrent_skiplist<int, std::less<int>, counting_allocator<int>> int_list_t;
+
+// Checks the elements with a walk over the list and with a lookup of every key.
+template <typename Want>
+void
+check_keys(const int_list_t & list, Want want) {
+	std::vector<int> expected;
+	for (int k = 0; k < test_keys_count; k++) {
+		if (want(k)) {
+			expected.push_back(k);
+		}
+		CHECK(list.contains(k) == want(k));
+	}
+	CHECK(std::equal(expected.begin(), expected.end(), list.begin()));
+	CHECK(((std::size_t) std::distance(list.begin(), list.end())) == expected.size());
+	CHECK(list.size() == expected.size());
+}
+
+void
+test_transparent() {
+	hopscotch::concurrent_skiplist<std::string, string_less> list;
+	const char * words[] = {"delta", "alpha", "echo", "charlie", "bravo"};
+	for (std::size_t i = 0; i < (sizeof(words) / sizeof(words[0])); i++) {
+		CHECK(list.insert(std::string(words[i])).second);
+	}
+	CHECK(! list.insert(std::string("echo")).second);
+	// Every lookup takes the C string as it is.
+	CHECK(list.contains("charlie"));
+	CHECK(! list.contains("foxtrot"));
+	CHECK(list.count("alpha") == 1);
+	CHECK(list.count("al") == 0);
+	CHECK(*(list.find("bravo")) == "bravo");
+	CHECK(list.find("bravos") == list.end());
+	CHECK(*(list.lower_bound("c")) == "charlie");
+	CHECK(*(list.lower_bound("charlie")) == "charlie");
+	CHECK(list.lower_bound("f") == list.end());
+	CHECK(list.erase("delta") == 1);
+	CHECK(list.erase("delta") == 0);
+	CHECK(! list.contains("delta"));
+	// And so does a `std::string`.
+	CHECK(list.contains(std::string("echo")));
+	CHECK(list.erase(std::string("echo")) == 1);
+	std::vector<std::string> expected = {"alpha", "bravo", "charlie"};
+	CHECK(std::equal(expected.begin(), expected.end(), list.begin()));
+}
+
+void
+test_move_only() {
+	hopscotch::concurrent_skiplist<std::unique_ptr<int>, ptr_less> list;
+	for (int k = test_keys_count - 1; k >= 0; k -= 2) {
+		CHECK(list.insert(std::unique_ptr<int>(new int(k))).second);
+	}
+	for (int k = 0; k < test_keys_count; k += 2) {
+		CHECK(list.emplace(new int(k)).second);
+	}
+	// A key that's already there isn't moved from.
+	std::unique_ptr<int> dup(new int(7));
+	CHECK(! list.insert(std::move(dup)).second);
+	CHECK((dup != nullptr) && (*dup == 7));
+	CHECK(! list.emplace(new int(8)).second);
+	CHECK(list.size() == ((std::size_t) test_keys_count));
+	int expected = 0;
+	for (const std::unique_ptr<int> & key : list) {
+		CHECK(*key == expected);
+		expected++;
+	}
+	CHECK(expected == test_keys_count);
+	for (int k = 0; k < test_keys_count; k += 3) {
+		CHECK(list.erase(k) == 1);
+	}
+	for (int k = 0; k < test_keys_count; k++) {
+		CHECK(list.contains(k) == ((k % 3) != 0));
+	}
+	CHECK(list.reclaim() == ((std::size_t) ((test_keys_count + 2) / 3)));
+}
+
+void
+test_erase_reclaim() {
+	{
+		int_list_t list;
+		CHECK(list.empty());
+		for (int k = 0; k < test_keys_count; k++) {
+			CHECK(list.insert(k).second);
+		}
+		long allocs = live_allocs.load();
+		// An iterator to an erased element still reads it, and steps on to what's left, until `reclaim`.
+		int_list_t::const_iterator it = list.find(10);
+		for (int k = 0; k < test_keys_count; k += 2) {
+			CHECK(list.erase(k) == 1);
+			CHECK(list.erase(k) == 0);
+		}
+		CHECK(*it == 10);
+		CHECK(*(++it) == 11);
+		check_keys(list, [](int k) { return (k % 2) == 1; });
+		CHECK(list.retired_size() == ((std::size_t) (test_keys_count / 2)));
+		CHECK(live_allocs.load() == allocs);
+		CHECK(list.reclaim() == ((std::size_t) (test_keys_count / 2)));
+		CHECK(list.retired_size() == 0);
+		CHECK(list.reclaim() == 0);
+		// A node and its forward pointers each.
+		CHECK(live_allocs.load() == (allocs - test_keys_count));
+		// The erased elements go back in.
+		for (int k = 0; k < test_keys_count; k += 4) {
+			CHECK(list.insert(k).second);
+		}
+		check_keys(list, [](int k) { return ((k % 2) == 1) || ((k % 4) == 0); });
+		for (int k = 0; k < test_keys_count; k++) {
+			list.erase(k);
+		}
+		CHECK(list.empty());
+		check_keys(list, [](int) { return false; });
+	}
+	// The destructor frees what's left, erased or not.
+	CHECK(live_allocs.load() == 0);
+}
+
+void
+test_algorithm() {
+	int_list_t list;
+	for (int k = test_keys_count - 1; k >= 0; k--) {
+		if ((k % 5) != 0) {
+			list.insert(k);
+		}
+	}
+	CHECK(std::is_sorted(list.begin(), list.end()));
+	CHECK(std::adjacent_find(list.begin(), list.end()) == list.end());
+	CHECK(*(std::find_if(list.begin(), list.end(), [](int k) { return k > 500; })) == 501);
+	CHECK(std::count_if(list.begin(), list.end(), [](int k) { return (k % 2) == 0; }) == 400);
+	CHECK(std::accumulate(list.begin(), list.end(), 0L) == ((999L * 1000L / 2) - (5L * 199L * 200L / 2)));
+	CHECK(*(std::lower_bound(list.begin(), list.end(), 500)) == 501);
+	CHECK(std::binary_search(list.begin(), list.end(), 501));
+	CHECK(! std::binary_search(list.begin(), list.end(), 500));
+	std::vector<int> keys(list.cbegin(), list.cend());
+	CHECK(keys.size() == list.size());
+	std::vector<int> evens;
+	std::copy_if(list.begin(), list.end(), std::back_inserter(evens), [](int k) { return (k % 2) == 0; });
+	CHECK((evens.size() == 400) && (evens.front() == 2) && (evens.back() == 998));
+	int_list_t::const_iterator it = std::next(list.begin(), 3);
+	CHECK(*it == 4);
+	CHECK(*(it++) == 4);
+	CHECK(*it == 6);
+}
+
+void
+test_threads() {
+	int_list_t list;
+	const int threads_count = 4;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threads_count; t++) {
+		threads.push_back(std::thread([&list, t]() {
+			for (int k = t; k < test_keys_count; k += threads_count) {
+				CHECK(list.insert(k).second);
+			}
+			for (int k = t; k < test_keys_count; k += threads_count) {
+				if ((k % 3) == 0) {
+					CHECK(list.erase(k) == 1);
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < threads_count; t++) {
+		threads[t].join();
+	}
+	check_keys(list, [](int k) { return (k % 3) != 0; });
+	CHECK(list.reclaim() == ((std::size_t) ((test_keys_count + 2) / 3)));
+}
+
+}
+
+int
+main() {
+	test_transparent();
+	test_move_only();
+	test_erase_reclaim();
+	test_algorithm();
+	test_threads();
+	std::printf("All tests passed!\n");
+	return EXIT_SUCCESS;
+}